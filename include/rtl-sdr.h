@@ -64,6 +64,62 @@ RTLSDR_API int rtlsdr_open(rtlsdr_dev_t **dev, uint32_t index);
 
 RTLSDR_API int rtlsdr_close(rtlsdr_dev_t *dev);
 
+/* capture file replay */
+
+enum rtlsdr_replay_flags {
+	RTLSDR_REPLAY_UNTHROTTLED = 1,	/* as fast as the samples are consumed */
+	RTLSDR_REPLAY_LOOP = 2		/* start over at the end of the file */
+};
+
+/*!
+ * Open a virtual device which streams a capture file instead of a dongle.
+ *
+ * The file holds interleaved 8 bit unsigned I/Q samples as written by
+ * rtl_sdr. rtlsdr_read_sync() and the asynchronous read functions deliver
+ * its contents at the rate set with rtlsdr_set_sample_rate(), or as fast
+ * as they are consumed with RTLSDR_REPLAY_UNTHROTTLED. Tuner settings are
+ * accepted and reported back, but do not change the samples. Unless
+ * looping, asynchronous reads end at the end of the file as if
+ * rtlsdr_cancel_async() had been called.
+ *
+ * rtlsdr_open() offers the same device after all USB devices when the
+ * environment variable RTLSDR_REPLAY holds the file name, optionally
+ * followed by ",fast" and ",loop".
+ *
+ * \param dev the opened device
+ * \param path capture file, "-" reads from stdin
+ * \param flags combination of enum rtlsdr_replay_flags
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_open_replay(rtlsdr_dev_t **dev, const char *path,
+				  int flags);
+
+/* tuner calibration cache */
+
+enum rtlsdr_cal_cache_mode {
+	RTLSDR_CAL_CACHE_USE = 0,	/* reuse cached results, store new ones */
+	RTLSDR_CAL_CACHE_REFRESH,	/* always calibrate, rewrite the cache */
+	RTLSDR_CAL_CACHE_OFF		/* always calibrate, leave the cache alone */
+};
+
+/*!
+ * Configure how rtlsdr_open() handles tuner calibration results.
+ *
+ * Tuners that need calibrating on power up (currently the R820T) store
+ * their results in a per-serial file, so later opens of the same device
+ * can skip the calibration. Devices without a serial number or with a
+ * factory default one such as "00000001" are always calibrated, since
+ * the serial can not tell them apart; rtl_eeprom -s assigns a unique
+ * one. The setting applies to all devices opened after the call.
+ *
+ * \param dir directory holding the cache files, NULL for the default:
+ *            $RTLSDR_CACHE_DIR, $XDG_CACHE_HOME/rtl-sdr, ~/.cache/rtl-sdr
+ *            or %LOCALAPPDATA%\rtl-sdr, whichever is found first
+ * \param mode one of enum rtlsdr_cal_cache_mode
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_set_cal_cache(const char *dir, int mode);
+
 /* configuration functions */
 
 /*!
@@ -142,6 +198,18 @@ RTLSDR_API int rtlsdr_write_eeprom(rtlsdr_dev_t *dev, uint8_t *data,
 RTLSDR_API int rtlsdr_read_eeprom(rtlsdr_dev_t *dev, uint8_t *data,
 				  uint8_t offset, uint16_t len);
 
+/*!
+ * Set the center frequency of the device.
+ *
+ * May be called while streaming. The call returns once the tuner reports
+ * its PLL locked, and the buffers delivered afterwards carry the index of
+ * the first sample captured at the new frequency in their
+ * rtlsdr_xfer_info_t.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param freq frequency in Hz
+ * \return 0 on success
+ */
 RTLSDR_API int rtlsdr_set_center_freq(rtlsdr_dev_t *dev, uint32_t freq);
 
 /*!
@@ -186,6 +254,159 @@ enum rtlsdr_tuner {
  */
 RTLSDR_API enum rtlsdr_tuner rtlsdr_get_tuner_type(rtlsdr_dev_t *dev);
 
+/* simulated device and transport profiling */
+
+/*!
+ * Open a virtual device backed by a register model of the RTL2832U and
+ * the given tuner instead of a dongle.
+ *
+ * The drivers probe, initialize and tune the model through the same code
+ * paths as real hardware, which makes the register traffic of an API call
+ * measurable without a device. Samples read from it are at mid scale.
+ *
+ * rtlsdr_open() offers the same device after all USB devices when the
+ * environment variable RTLSDR_SIM holds the tuner name (e4000, fc0012,
+ * fc0013, fc2580, r820t or none), optionally followed by a comma and the
+ * latency per round trip in microseconds.
+ *
+ * \param dev the opened device
+ * \param tuner the tuner on the modelled I2C bus
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_open_sim(rtlsdr_dev_t **dev, enum rtlsdr_tuner tuner);
+
+typedef struct rtlsdr_transport_stats {
+	uint32_t ctrl_in;	/* register reads */
+	uint32_t ctrl_out;	/* register writes */
+	uint32_t round_trips;	/* waits for the device, a batch counts once */
+	uint64_t bytes;		/* register data transferred */
+	uint64_t time_us;	/* spent waiting for the device */
+} rtlsdr_transport_stats_t;
+
+/*!
+ * Add a fixed delay to every round trip to the device.
+ *
+ * Models a slower bus, e.g. a dongle behind a hub or a network link, to
+ * see how API calls scale with the latency.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param us delay per round trip in microseconds, 0 disables it
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_set_transport_latency(rtlsdr_dev_t *dev, uint32_t us);
+
+/*!
+ * Get the register traffic counted since the device was opened or the
+ * counters were reset.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param stats filled with the counters
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_get_transport_stats(rtlsdr_dev_t *dev,
+					  rtlsdr_transport_stats_t *stats);
+
+/*!
+ * Reset the register traffic counters.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_reset_transport_stats(rtlsdr_dev_t *dev);
+
+/* control transfer tracing */
+
+enum rtlsdr_trace_format {
+	RTLSDR_TRACE_BINARY = 0,
+	RTLSDR_TRACE_JSON
+};
+
+enum rtlsdr_trace_flags {
+	RTLSDR_TRACE_READ = 1,	/* transfer from the device */
+	RTLSDR_TRACE_BATCH = 2,	/* shares its round trip with the others of a batch */
+	RTLSDR_TRACE_ERROR = 4	/* the transfer failed */
+};
+
+/* one control transfer, as stored in a binary trace */
+typedef struct rtlsdr_trace_rec {
+	uint32_t time_us;	/* start, since the trace started */
+	uint32_t dur_us;	/* of its round trip */
+	uint16_t addr;		/* register, or the I2C address for block 6 */
+	uint16_t len;		/* bytes */
+	uint8_t block;		/* 0 demod, 1 USB, 2 SYS, ... 6 I2C */
+	uint8_t sub;		/* demod page, or the register an I2C write starts at */
+	uint8_t flags;		/* enum rtlsdr_trace_flags */
+	uint8_t api;		/* index of the public call that caused it */
+} rtlsdr_trace_rec_t;
+
+typedef struct rtlsdr_trace_api_stats {
+	const char *api;	/* public function, "other" for the rest */
+	uint32_t calls;
+	uint32_t transfers;
+	uint32_t round_trips;	/* waits for the device, a batch counts once */
+	uint64_t bytes;
+	uint64_t transfer_us;	/* spent waiting for the device */
+	uint64_t call_us;	/* spent in the calls altogether */
+} rtlsdr_trace_api_stats_t;
+
+/*!
+ * Start recording every control transfer to the device into a ring buffer,
+ * together with the public call it was made for.
+ *
+ * Calls made from inside another call are accounted to the outer one, so
+ * the traffic of rtlsdr_set_center_freq() includes the IF frequency it
+ * programs. Earlier records and the summary are discarded.
+ *
+ * rtlsdr_open() starts a trace by itself when the environment variable
+ * RTLSDR_TRACE names a file, rtlsdr_close() then dumps it there, as JSON if
+ * the name ends in ".json", and prints the summary to stderr.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param entries records kept before the oldest are overwritten, 0 for 16384
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_trace_start(rtlsdr_dev_t *dev, uint32_t entries);
+
+/*!
+ * Stop recording, the records and the summary are kept.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_trace_stop(rtlsdr_dev_t *dev);
+
+/*!
+ * Write the recorded control transfers to a file.
+ *
+ * The binary format is a header of five 32 bit words: "RTRC", version 1,
+ * the number of records, the number of API names and the tuner type. The
+ * API names follow, 32 bytes each, then the records oldest first. All in
+ * host byte order. The JSON format holds the summary and the records.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param path file to create
+ * \param format enum rtlsdr_trace_format
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_trace_dump(rtlsdr_dev_t *dev, const char *path,
+				 enum rtlsdr_trace_format format);
+
+/*!
+ * Get the control transfers and round trips per public call since the
+ * trace started.
+ *
+ * NOTE: If NULL is being given for stats, only the number of entries is
+ * returned.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param stats array receiving one entry per call with traffic
+ * \param n number of entries the array holds
+ * \return number of entries, or a negative value on error
+ */
+RTLSDR_API int rtlsdr_trace_get_summary(rtlsdr_dev_t *dev,
+					rtlsdr_trace_api_stats_t *stats,
+					uint32_t n);
+
 /*!
  * Get a list of gains supported by the tuner.
  *
@@ -311,6 +532,48 @@ RTLSDR_API int rtlsdr_set_offset_tuning(rtlsdr_dev_t *dev, int on);
  */
 RTLSDR_API int rtlsdr_get_offset_tuning(rtlsdr_dev_t *dev);
 
+/* retune plans */
+
+typedef struct rtlsdr_retune_plan rtlsdr_retune_plan_t;
+
+/*!
+ * Precompile a list of frequencies for fast hopping.
+ *
+ * The device is tuned to every frequency once and the register writes
+ * this takes are recorded, afterwards it is tuned back to the previous
+ * center frequency. Changing the gain, sample rate, frequency correction,
+ * crystal frequency, direct sampling or offset tuning makes existing
+ * plans stale, rtlsdr_retune_plan_apply() then falls back to
+ * rtlsdr_set_center_freq() until the plan is compiled again.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param plan returned plan, free with rtlsdr_retune_plan_destroy()
+ * \param freqs frequencies in Hz
+ * \param count number of frequencies
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_retune_plan_create(rtlsdr_dev_t *dev,
+					 rtlsdr_retune_plan_t **plan,
+					 const uint32_t *freqs, uint32_t count);
+
+/*!
+ * Tune to a precompiled frequency.
+ *
+ * Only the registers which differ from the current state are written,
+ * all in one pipelined batch. Afterwards only the PLL lock state is read
+ * back, on tuners which provide one.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param plan plan created for this device
+ * \param index position of the frequency in the list given at creation
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_retune_plan_apply(rtlsdr_dev_t *dev,
+					rtlsdr_retune_plan_t *plan,
+					uint32_t index);
+
+RTLSDR_API int rtlsdr_retune_plan_destroy(rtlsdr_retune_plan_t *plan);
+
 /* streaming functions */
 
 RTLSDR_API int rtlsdr_reset_buffer(rtlsdr_dev_t *dev);
@@ -351,6 +614,46 @@ RTLSDR_API int rtlsdr_read_async(rtlsdr_dev_t *dev,
 				 uint32_t buf_num,
 				 uint32_t buf_len);
 
+typedef struct rtlsdr_xfer_info {
+	/* ns, monotonic capture time of the first sample, recovered from the
+	 * transfer completion times by a clock tracking loop */
+	uint64_t timestamp;
+	/* running count of the first I/Q sample since streaming started,
+	 * samples lost in between are counted as well */
+	uint64_t sample_index;
+	/* I/Q samples lost right before this buffer */
+	uint32_t dropped;
+	/* center frequency in Hz of the most recent retune */
+	uint32_t freq;
+	/* running count of the first sample captured after the tuner settled
+	 * on freq, samples before it are from the previous frequency or the
+	 * PLL transient and should be discarded */
+	uint64_t settled_index;
+} rtlsdr_xfer_info_t;
+
+typedef void(*rtlsdr_read_async_ex_cb_t)(unsigned char *buf, uint32_t len,
+					 const rtlsdr_xfer_info_t *info,
+					 void *ctx);
+
+/*!
+ * Read samples from the device asynchronously, like rtlsdr_read_async(),
+ * but pass the capture timestamp and sample counter of every buffer to the
+ * callback. This function will block until it is being canceled using
+ * rtlsdr_cancel_async()
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param cb callback function to return received samples
+ * \param ctx user specific context to pass via the callback function
+ * \param buf_num optional buffer count, see rtlsdr_read_async()
+ * \param buf_len optional buffer length, see rtlsdr_read_async()
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_read_async_ex(rtlsdr_dev_t *dev,
+				    rtlsdr_read_async_ex_cb_t cb,
+				    void *ctx,
+				    uint32_t buf_num,
+				    uint32_t buf_len);
+
 /*!
  * Cancel all pending asynchronous operations on the device.
  *
@@ -359,6 +662,263 @@ RTLSDR_API int rtlsdr_read_async(rtlsdr_dev_t *dev,
  */
 RTLSDR_API int rtlsdr_cancel_async(rtlsdr_dev_t *dev);
 
+/*!
+ * Set how long the event loop may take to notice rtlsdr_cancel_async() when
+ * no transfer completes, e.g. because the device stopped delivering data.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param ms maximum latency in milliseconds (default: 1000)
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_set_cancel_latency(rtlsdr_dev_t *dev, uint32_t ms);
+
+/*!
+ * Configure the event thread started by rtlsdr_start_streaming(). Failing
+ * to apply either setting is not fatal, a warning is printed instead.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param cpu CPU to pin the thread to, -1 to let the scheduler decide
+ * \param rt_priority SCHED_FIFO priority, 0 for normal scheduling
+ * \return 0 on success, -2 while streaming
+ */
+RTLSDR_API int rtlsdr_set_stream_thread(rtlsdr_dev_t *dev, int cpu,
+					int rt_priority);
+
+/*!
+ * Start streaming on an event thread owned by the library. Samples are
+ * handed to the consumers registered with rtlsdr_ring_add_consumer(), see
+ * rtlsdr_read_async_ring(). This function returns immediately.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param buf_num optional buffer count, see rtlsdr_read_async()
+ * \param buf_len optional buffer length, see rtlsdr_read_async()
+ * \return 0 on success, -2 if already streaming
+ */
+RTLSDR_API int rtlsdr_start_streaming(rtlsdr_dev_t *dev, uint32_t buf_num,
+				      uint32_t buf_len);
+
+/*!
+ * Stop streaming and wait for the event thread to exit. Consumers have to
+ * release the buffers they hold, so this must not be called from a consumer
+ * thread which still holds one.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \return result of the event loop, 0 on success
+ */
+RTLSDR_API int rtlsdr_stop_streaming(rtlsdr_dev_t *dev);
+
+/* stream statistics */
+
+#define RTLSDR_STATS_LATENCY_BINS	12
+
+typedef struct rtlsdr_stream_stats {
+	uint64_t transfers;		/* completed bulk transfers */
+	uint64_t bytes;			/* bytes delivered */
+	uint64_t short_transfers;	/* transfers shorter than requested */
+	/* failed transfers, by libusb transfer status */
+	uint64_t err_error;
+	uint64_t err_timed_out;
+	uint64_t err_stall;
+	uint64_t err_no_device;
+	uint64_t err_overflow;
+	/* time the application held a buffer, bin n counts latencies below
+	 * (16 << n) us, the last bin counts everything above */
+	uint64_t latency_hist[RTLSDR_STATS_LATENCY_BINS];
+	uint32_t latency_max_us;
+	/* time between two transfer completions */
+	uint32_t interval_min_us;
+	uint32_t interval_max_us;
+	uint32_t interval_avg_us;
+	/* most buffers held by ring consumers at once, out of buf_num */
+	uint32_t queued_max;
+	uint32_t buf_num;
+} rtlsdr_stream_stats_t;
+
+/*!
+ * Get the streaming statistics of the device. The counters are reset
+ * whenever asynchronous streaming is started, synchronous reads are counted
+ * as well.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param stats returns a snapshot of the counters
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_get_stream_stats(rtlsdr_dev_t *dev,
+				       rtlsdr_stream_stats_t *stats);
+
+/*!
+ * Reset the streaming statistics of the device.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_reset_stream_stats(rtlsdr_dev_t *dev);
+
+/*!
+ * Format streaming statistics as one line of text, without a newline.
+ * The same layout is printed by the tools' stats options.
+ *
+ * \param stats counters given by rtlsdr_get_stream_stats()
+ * \param buf returns the text, truncated to fit
+ * \param len size of buf
+ * \return length of the full text, -1 on error
+ */
+RTLSDR_API int rtlsdr_format_stream_stats(const rtlsdr_stream_stats_t *stats,
+					  char *buf, uint32_t len);
+
+/* zero-copy ring buffer interface */
+
+#define RTLSDR_RING_MAX_CONSUMERS	8
+
+/*!
+ * Register a consumer of the zero-copy sample ring. Consumers have to be
+ * registered before rtlsdr_read_async_ring() is called.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \return consumer id (>= 0) on success, -2 while streaming,
+ *	   -3 if RTLSDR_RING_MAX_CONSUMERS are already registered
+ */
+RTLSDR_API int rtlsdr_ring_add_consumer(rtlsdr_dev_t *dev);
+
+/*!
+ * Unregister a consumer of the zero-copy sample ring.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param consumer id given by rtlsdr_ring_add_consumer()
+ * \return 0 on success, -2 while streaming
+ */
+RTLSDR_API int rtlsdr_ring_remove_consumer(rtlsdr_dev_t *dev, int consumer);
+
+/*!
+ * Read samples from the device asynchronously into a ring of transfer
+ * buffers which are handed to the registered consumers in place, without
+ * copying. A transfer is resubmitted only after every consumer has released
+ * it, so the slowest consumer throttles the ring. This function will block
+ * until it is being canceled using rtlsdr_cancel_async() and all consumers
+ * have released the buffers they acquired, buffers not yet acquired at that
+ * point are discarded.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param buf_num optional buffer count, see rtlsdr_read_async()
+ * \param buf_len optional buffer length, see rtlsdr_read_async()
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_read_async_ring(rtlsdr_dev_t *dev,
+				      uint32_t buf_num,
+				      uint32_t buf_len);
+
+/*!
+ * Acquire the next sample buffer for a consumer. Each consumer sees every
+ * buffer once, in order. The buffer stays valid until it is released with
+ * rtlsdr_ring_release() and must be treated as read-only when more than one
+ * consumer is registered.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param consumer id given by rtlsdr_ring_add_consumer()
+ * \param buf returns a pointer to the samples
+ * \param len returns the number of bytes in the buffer
+ * \param timeout_ms time to wait for data, 0 to poll, negative to wait forever
+ * \return 0 on success, -2 if streaming has stopped and the ring is drained,
+ *	   -3 on timeout
+ */
+RTLSDR_API int rtlsdr_ring_acquire(rtlsdr_dev_t *dev, int consumer,
+				   unsigned char **buf, uint32_t *len,
+				   int timeout_ms);
+
+/*!
+ * Get the capture timestamp and sample counter of the buffer most recently
+ * acquired by a consumer. Must be called before that buffer is released.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param consumer id given by rtlsdr_ring_add_consumer()
+ * \param info returns the buffer information
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_ring_get_info(rtlsdr_dev_t *dev, int consumer,
+				    rtlsdr_xfer_info_t *info);
+
+/*!
+ * Release the oldest buffer acquired by a consumer. Buffers are released in
+ * the order they were acquired.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param consumer id given by rtlsdr_ring_add_consumer()
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_ring_release(rtlsdr_dev_t *dev, int consumer);
+
+/* device groups */
+
+#define RTLSDR_GROUP_MAX_DEVICES	32
+
+typedef struct rtlsdr_group rtlsdr_group_t;
+
+/*!
+ * Create a device group. Devices opened through a group share one libusb
+ * context, so all of them can be streamed from a single event loop.
+ *
+ * \param group returns the group handle
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_group_create(rtlsdr_group_t **group);
+
+/*!
+ * Destroy a device group, closing any member device still open.
+ *
+ * \param group the group handle given by rtlsdr_group_create()
+ * \return 0 on success, -2 if the group is streaming
+ */
+RTLSDR_API int rtlsdr_group_destroy(rtlsdr_group_t *group);
+
+/*!
+ * Open a device on the shared context of a group. The returned handle is
+ * used with all other functions as usual and may be closed with
+ * rtlsdr_close() while the group is not streaming.
+ *
+ * \param group the group handle given by rtlsdr_group_create()
+ * \param dev returns the device handle
+ * \param index the device index, see rtlsdr_open()
+ * \return 0 on success, -2 if the group is streaming or full
+ */
+RTLSDR_API int rtlsdr_group_open(rtlsdr_group_t *group, rtlsdr_dev_t **dev,
+				 uint32_t index);
+
+/*!
+ * Set the callback a group member delivers its samples to while the group
+ * is streaming. Members without a callback are not streamed.
+ *
+ * \param dev the device handle given by rtlsdr_group_open()
+ * \param cb callback function to return received samples
+ * \param ctx user specific context to pass via the callback function
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_group_set_callback(rtlsdr_dev_t *dev,
+					 rtlsdr_read_async_cb_t cb,
+					 void *ctx);
+
+/*!
+ * Read samples from all members of a group asynchronously, servicing their
+ * transfers from one event loop in the calling thread. This function will
+ * block until every member has been canceled, either one at a time with
+ * rtlsdr_cancel_async() or all at once with rtlsdr_group_cancel_async().
+ *
+ * \param group the group handle given by rtlsdr_group_create()
+ * \param buf_num optional buffer count per device, see rtlsdr_read_async()
+ * \param buf_len optional buffer length, see rtlsdr_read_async()
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_group_read_async(rtlsdr_group_t *group,
+				       uint32_t buf_num,
+				       uint32_t buf_len);
+
+/*!
+ * Cancel all streaming members of a group.
+ *
+ * \param group the group handle given by rtlsdr_group_create()
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_group_cancel_async(rtlsdr_group_t *group);
+
 #ifdef __cplusplus
 }
 #endif
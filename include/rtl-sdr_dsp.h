@@ -0,0 +1,401 @@
+/*
+ * rtl-sdr, turns your Realtek RTL2832 based DVB dongle into a SDR receiver
+ * Copyright (C) 2012 by Steve Markgraf <steve@steve-m.de>
+ * Copyright (C) 2012 by Dimitri Stolnikov <horiz0n@gmx.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RTL_SDR_DSP_H
+#define __RTL_SDR_DSP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <rtl-sdr_export.h>
+
+/*
+ * Sample conversion helpers for the interleaved offset binary I/Q the
+ * device delivers, I first. Lengths count values, not complex samples.
+ *
+ * The kernels are picked at runtime for the best instruction set the CPU
+ * supports. Results do not depend on the instruction set, except for
+ * float rounding in rtlsdr_dsp_dc_remove_f32(),
+ * rtlsdr_dsp_fir_decimate_f32(), rtlsdr_dsp_resamp_s16() and the
+ * RTLSDR_DSP_DISC_DERIV discriminator.
+ */
+
+enum rtlsdr_dsp_simd {
+	RTLSDR_DSP_GENERIC = 0,
+	RTLSDR_DSP_SSE2,
+	RTLSDR_DSP_AVX2,
+	RTLSDR_DSP_NEON
+};
+
+/*!
+ * Get the instruction set the kernels currently use.
+ *
+ * \return one of enum rtlsdr_dsp_simd
+ */
+RTLSDR_API int rtlsdr_dsp_get_simd(void);
+
+/*!
+ * Force the kernels of an instruction set, mainly for benchmarking.
+ *
+ * \param simd one of enum rtlsdr_dsp_simd
+ * \return 0 on success, -1 if the CPU or the build does not support it
+ */
+RTLSDR_API int rtlsdr_dsp_set_simd(int simd);
+
+/*!
+ * Convert to signed 16 bit, (x - 127.5) * 256. The result is symmetric
+ * around zero, so negating it is exact.
+ *
+ * \param in samples as read from the device
+ * \param out converted samples, may not overlap in
+ * \param len number of values
+ */
+RTLSDR_API void rtlsdr_dsp_u8_to_s16(const uint8_t *in, int16_t *out,
+				     uint32_t len);
+
+/*!
+ * Convert to float, (x - 127.5) / 127.5.
+ *
+ * \param in samples as read from the device
+ * \param out converted samples in the range [-1, 1]
+ * \param len number of values
+ */
+RTLSDR_API void rtlsdr_dsp_u8_to_f32(const uint8_t *in, float *out,
+				     uint32_t len);
+
+/*!
+ * Shift the spectrum up by a quarter of the sample rate, in place. The
+ * samples are multiplied by 1, j, -1, -j in turn, starting over with every
+ * call, so buffers should hold a multiple of four complex samples.
+ *
+ * \param buf samples as read from the device
+ * \param len number of values
+ */
+RTLSDR_API void rtlsdr_dsp_rotate_90_u8(uint8_t *buf, uint32_t len);
+
+/*!
+ * Same as rtlsdr_dsp_rotate_90_u8() for converted samples.
+ *
+ * \param buf samples given by rtlsdr_dsp_u8_to_s16()
+ * \param len number of values
+ */
+RTLSDR_API void rtlsdr_dsp_rotate_90_s16(int16_t *buf, uint32_t len);
+
+/*!
+ * Compute the magnitude of every complex sample, scaled so that a full
+ * scale corner gives 255: sqrt(I^2 + Q^2) * sqrt(2), I and Q as in
+ * rtlsdr_dsp_u8_to_s16() over 256, rounded.
+ *
+ * \param in samples as read from the device
+ * \param out len / 2 magnitudes, may be in for an in place conversion
+ * \param len number of values, an odd last one is ignored
+ */
+RTLSDR_API void rtlsdr_dsp_magnitude_u8(const uint8_t *in, uint8_t *out,
+					uint32_t len);
+
+/*!
+ * Find the first offset i where the magnitudes match a pulse pattern of
+ * 16 samples: every in[i + k] with bit k of pattern set is larger than
+ * every one with the bit clear. Many offsets are screened at once, which
+ * suits preamble detection.
+ *
+ * \param in magnitudes, e.g. from rtlsdr_dsp_magnitude_u8()
+ * \param len number of values, offsets up to len - 16 are tested
+ * \param pattern bit k set for a pulse at in[i + k], 0x0285 for the
+ *	  Mode S preamble at 2 Msps
+ * \return the offset, or -1 if there is none
+ */
+RTLSDR_API int rtlsdr_dsp_pulse_find_u8(const uint8_t *in, uint32_t len,
+					uint16_t pattern);
+
+/* DC removal */
+
+typedef struct rtlsdr_dsp_dc {
+	float i;	/* current offset estimate */
+	float q;
+	/* weight of every new buffer mean in the estimate, 1 removes the
+	 * mean of each buffer on its own */
+	float weight;
+} rtlsdr_dsp_dc_t;
+
+/*!
+ * Reset the DC offset estimate.
+ *
+ * \param dc estimator state
+ * \param weight see rtlsdr_dsp_dc_t, in (0, 1]
+ */
+RTLSDR_API void rtlsdr_dsp_dc_init(rtlsdr_dsp_dc_t *dc, float weight);
+
+/*!
+ * Update the DC offset estimate with the mean of a buffer and subtract
+ * it, in place. Results saturate.
+ *
+ * \param dc estimator state
+ * \param buf converted samples
+ * \param len number of values
+ */
+RTLSDR_API void rtlsdr_dsp_dc_remove_s16(rtlsdr_dsp_dc_t *dc, int16_t *buf,
+					 uint32_t len);
+
+/*!
+ * Same as rtlsdr_dsp_dc_remove_s16() for float samples.
+ *
+ * \param dc estimator state
+ * \param buf converted samples
+ * \param len number of values
+ */
+RTLSDR_API void rtlsdr_dsp_dc_remove_f32(rtlsdr_dsp_dc_t *dc, float *buf,
+					 uint32_t len);
+
+/* decimating FIR */
+
+typedef struct rtlsdr_dsp_fir rtlsdr_dsp_fir_t;
+
+/*!
+ * Design a low pass decimator for complex samples. The filter is a Blackman
+ * windowed sinc, of which only every decim'th output is computed.
+ *
+ * \param fir pointer to the created state
+ * \param decim decimation factor
+ * \param taps_per_phase filter length in output samples, the filter has
+ *	  decim * taps_per_phase taps
+ * \param cutoff -6 dB point as a fraction of the output Nyquist frequency,
+ *	  in (0, 1]
+ * \param gain gain at DC
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_dsp_fir_create(rtlsdr_dsp_fir_t **fir, int decim,
+				     int taps_per_phase, float cutoff,
+				     float gain);
+
+/*!
+ * Free the decimator state.
+ *
+ * \param fir state given by rtlsdr_dsp_fir_create()
+ */
+RTLSDR_API void rtlsdr_dsp_fir_destroy(rtlsdr_dsp_fir_t *fir);
+
+/*!
+ * Clear the filter history, e.g. after a retune. The next output is
+ * computed at the first sample given.
+ *
+ * \param fir state given by rtlsdr_dsp_fir_create()
+ */
+RTLSDR_API void rtlsdr_dsp_fir_reset(rtlsdr_dsp_fir_t *fir);
+
+/*!
+ * Filter and decimate. The history and the decimation phase carry over
+ * between calls, so buffers of any length give the same result as one
+ * long buffer. A state should be used with one sample format only.
+ *
+ * The taps are quantized to 16 bit at the largest power of two scale that
+ * fits, results saturate.
+ *
+ * \param fir state given by rtlsdr_dsp_fir_create()
+ * \param in converted samples
+ * \param len number of values, an odd last one is ignored
+ * \param out room for 2 * (len / (2 * decim) + 1) values
+ * \return number of values written to out, -1 on error
+ */
+RTLSDR_API int rtlsdr_dsp_fir_decimate_s16(rtlsdr_dsp_fir_t *fir,
+					   const int16_t *in, uint32_t len,
+					   int16_t *out);
+
+/*!
+ * Same as rtlsdr_dsp_fir_decimate_s16() for float samples.
+ *
+ * \param fir state given by rtlsdr_dsp_fir_create()
+ * \param in converted samples
+ * \param len number of values, an odd last one is ignored
+ * \param out room for 2 * (len / (2 * decim) + 1) values
+ * \return number of values written to out, -1 on error
+ */
+RTLSDR_API int rtlsdr_dsp_fir_decimate_f32(rtlsdr_dsp_fir_t *fir,
+					   const float *in, uint32_t len,
+					   float *out);
+
+/* polyphase FFT channelizer */
+
+typedef struct rtlsdr_dsp_chan rtlsdr_dsp_chan_t;
+
+/*!
+ * Set up a filter bank which splits complex samples into bins evenly
+ * spaced by rate / bins. Bin k is centered at k * rate / bins, the upper
+ * half of the bins holds the negative frequencies. Every bin is sampled at
+ * twice its spacing, so a channel of up to half the spacing anywhere
+ * within half a bin of its center passes without aliasing.
+ *
+ * \param ch pointer to the created state
+ * \param bins number of bins, a power of two
+ * \param taps_per_bin prototype filter length in frames, 12 or more keep
+ *	  the aliases below -55 dB
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_dsp_chan_create(rtlsdr_dsp_chan_t **ch, int bins,
+				      int taps_per_bin);
+
+/*!
+ * Free the channelizer state.
+ *
+ * \param ch state given by rtlsdr_dsp_chan_create()
+ */
+RTLSDR_API void rtlsdr_dsp_chan_destroy(rtlsdr_dsp_chan_t *ch);
+
+/*!
+ * Split float samples into bins. A frame of all bins is produced for every
+ * bins / 2 input samples, the history carries over between calls.
+ *
+ * \param ch state given by rtlsdr_dsp_chan_create()
+ * \param in converted samples
+ * \param len number of values, an odd last one is ignored
+ * \param out frames of 2 * bins values, room for len / bins + 1 frames
+ * \return number of frames written to out, -1 on error
+ */
+RTLSDR_API int rtlsdr_dsp_chan_process(rtlsdr_dsp_chan_t *ch,
+				       const float *in, uint32_t len,
+				       float *out);
+
+/* FM discriminator */
+
+enum rtlsdr_dsp_disc_method {
+	RTLSDR_DSP_DISC_ATAN2 = 0,	/* atan2() in double, the reference */
+	RTLSDR_DSP_DISC_TABLE,		/* atan lookup table, octant folded */
+	RTLSDR_DSP_DISC_POLY,		/* vectorized polynomial atan, within
+					 * 1 LSB, 0.19 LSB rms */
+	RTLSDR_DSP_DISC_DERIV		/* cross product over the mean power of
+					 * the buffer, no atan and no per sample
+					 * division, for strong constant
+					 * envelope signals only */
+};
+
+typedef struct rtlsdr_dsp_disc rtlsdr_dsp_disc_t;
+
+/*!
+ * Set up a discriminator, which gives the phase step between successive
+ * complex samples.
+ *
+ * \param disc pointer to the created state
+ * \param method one of enum rtlsdr_dsp_disc_method
+ * \param table_bits log2 of the RTLSDR_DSP_DISC_TABLE size over one octant,
+ *	  4 to 16, 0 for the default of 10
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_dsp_disc_create(rtlsdr_dsp_disc_t **disc, int method,
+				      int table_bits);
+
+/*!
+ * Free the discriminator state.
+ *
+ * \param disc state given by rtlsdr_dsp_disc_create()
+ */
+RTLSDR_API void rtlsdr_dsp_disc_destroy(rtlsdr_dsp_disc_t *disc);
+
+/*!
+ * Demodulate. out[k] is the angle of in[k] * conj(in[k - 1]) with pi
+ * scaled to 1 << 14, the last sample of a buffer is kept for the next call.
+ *
+ * \param disc state given by rtlsdr_dsp_disc_create()
+ * \param in complex samples
+ * \param len number of values, an odd last one is ignored
+ * \param out room for len / 2 values
+ * \return number of values written to out, -1 on error
+ */
+RTLSDR_API int rtlsdr_dsp_disc_process(rtlsdr_dsp_disc_t *disc,
+				       const int16_t *in, uint32_t len,
+				       int16_t *out);
+
+/* resampler */
+
+enum rtlsdr_dsp_resamp_mode {
+	RTLSDR_DSP_RESAMP_AUTO = 0,	/* rational when it can be */
+	RTLSDR_DSP_RESAMP_RATIONAL,	/* polyphase, exact ratio of whole rates */
+	RTLSDR_DSP_RESAMP_FARROW	/* polynomial taps, any ratio */
+};
+
+typedef struct rtlsdr_dsp_resamp rtlsdr_dsp_resamp_t;
+
+/*!
+ * Set up a resampler for real samples. Whole rates whose ratio reduces to
+ * at most 1024 output phases are converted exactly by a polyphase filter,
+ * other ratios by a Farrow filter with piecewise cubic taps. Both use a
+ * Blackman windowed sinc low pass below the lower of the two rates.
+ *
+ * \param rs pointer to the created state
+ * \param in_rate input sample rate
+ * \param out_rate output sample rate
+ * \param mode one of enum rtlsdr_dsp_resamp_mode
+ * \param taps filter length in samples of the lower rate
+ * \param cutoff -6 dB point as a fraction of the lower Nyquist frequency,
+ *	  in (0, 1]
+ * \param gain gain at DC
+ * \return 0 on success, -1 if the ratio does not suit the mode
+ */
+RTLSDR_API int rtlsdr_dsp_resamp_create(rtlsdr_dsp_resamp_t **rs,
+					double in_rate, double out_rate,
+					int mode, int taps, float cutoff,
+					float gain);
+
+/*!
+ * Free the resampler state.
+ *
+ * \param rs state given by rtlsdr_dsp_resamp_create()
+ */
+RTLSDR_API void rtlsdr_dsp_resamp_destroy(rtlsdr_dsp_resamp_t *rs);
+
+/*!
+ * Clear the history and restart the output clock at the next sample.
+ *
+ * \param rs state given by rtlsdr_dsp_resamp_create()
+ */
+RTLSDR_API void rtlsdr_dsp_resamp_reset(rtlsdr_dsp_resamp_t *rs);
+
+/*!
+ * Get the reduced ratio of a polyphase resampler.
+ *
+ * \param rs state given by rtlsdr_dsp_resamp_create()
+ * \param interp output samples per decim input samples
+ * \param decim input samples per interp output samples
+ * \return 0 on success, -1 for a Farrow resampler
+ */
+RTLSDR_API int rtlsdr_dsp_resamp_get_ratio(rtlsdr_dsp_resamp_t *rs,
+					   uint32_t *interp, uint32_t *decim);
+
+/*!
+ * Resample. The history and the output clock carry over between calls,
+ * so buffers of any length give the same result as one long buffer.
+ * Results saturate.
+ *
+ * \param rs state given by rtlsdr_dsp_resamp_create()
+ * \param in samples at the input rate
+ * \param len number of samples
+ * \param out room for len * out_rate / in_rate + 2 samples, may not
+ *	  overlap in
+ * \return number of samples written to out, -1 on error
+ */
+RTLSDR_API int rtlsdr_dsp_resamp_s16(rtlsdr_dsp_resamp_t *rs,
+				     const int16_t *in, uint32_t len,
+				     int16_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RTL_SDR_DSP_H */
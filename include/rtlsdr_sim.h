@@ -0,0 +1,41 @@
+/*
+ * rtl-sdr, turns your Realtek RTL2832 based DVB dongle into a SDR receiver
+ * Register model of the RTL2832U and its tuners
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RTLSDR_SIM_H
+#define __RTLSDR_SIM_H
+
+#include <stdint.h>
+
+#include "rtl-sdr.h"
+
+/*
+ * Register model of an RTL2832U with one tuner on its I2C bus, enough for
+ * the drivers to probe, initialize and tune it without hardware.
+ */
+struct rtl2832_sim;
+
+/* RTLSDR_TUNER_UNKNOWN leaves the bus empty */
+struct rtl2832_sim *rtl2832_sim_create(enum rtlsdr_tuner tuner);
+void rtl2832_sim_destroy(struct rtl2832_sim *sim);
+
+/* answers a vendor control transfer like the chip would, returns the bytes
+ * transferred or a libusb error code */
+int rtl2832_sim_ctrl(struct rtl2832_sim *sim, uint8_t type, uint16_t value,
+		     uint16_t index, unsigned char *data, uint16_t len);
+
+#endif
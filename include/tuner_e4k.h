@@ -196,6 +196,7 @@ struct e4k_state {
 	enum e4k_band band;
 	struct e4k_pll_params vco;
 	void *rtl_dev;
+	int write_all; /* don't skip writes that would not change a register */
 };
 
 int e4k_init(struct e4k_state *e4k);
@@ -7,6 +7,10 @@
 
 #define R820T_IF_FREQ		3570000
 
+/* the RTL2832 I2C repeater forwards at most this many bytes per message,
+ * register address included */
+#define R820T_I2C_MAX_LEN	8
+
 //***************************************************************
 //*                       INCLUDES.H
 //***************************************************************
@@ -58,10 +62,6 @@ extern UINT8 R828_ADDRESS;
 #define IMR_TRIAL    9
 #define VCO_pwr_ref   0x02
 
-extern UINT32 R828_IF_khz;
-extern UINT32 R828_CAL_LO_khz;
-extern UINT8  R828_IMR_point_num;
-extern UINT8  R828_IMR_done_flag;
 extern UINT8  Rafael_Chip;
 
 typedef enum _R828_Standard_Type  //Don't remove standand list!!
@@ -94,8 +94,6 @@ typedef enum _R828_Standard_Type  //Don't remove standand list!!
 	STD_SIZE
 }R828_Standard_Type;
 
-extern UINT8  R828_Fil_Cal_flag[STD_SIZE];
-
 typedef enum _R828_SetFreq_Type
 {
 	FAST_MODE = TRUE,
@@ -163,33 +161,143 @@ typedef struct _R828_I2C_TYPE
 	UINT8 RegAddr;
 	UINT8 Data;
 }R828_I2C_TYPE;
+
+typedef struct _R828_SectType
+{
+	UINT8 Phase_Y;
+	UINT8 Gain_X;
+	UINT16 Value;
+}R828_SectType;
+
+typedef enum _BW_Type
+{
+	BW_6M = 0,
+	BW_7M,
+	BW_8M,
+	BW_1_7M,
+	BW_10M,
+	BW_200K
+}BW_Type;
+
+typedef struct _Sys_Info_Type
+{
+	UINT16		IF_KHz;
+	BW_Type		BW;
+	UINT32		FILT_CAL_LO;
+	UINT8		FILT_GAIN;
+	UINT8		IMG_R;
+	UINT8		FILT_Q;
+	UINT8		HP_COR;
+	UINT8       EXT_ENABLE;
+	UINT8       LOOP_THROUGH;
+	UINT8       LT_ATT;
+	UINT8       FLT_EXT_WIDEST;
+	UINT8       POLYFIL_CUR;
+}Sys_Info_Type;
+
+typedef struct _Freq_Info_Type
+{
+	UINT8		OPEN_D;
+	UINT8		RF_MUX_PLOY;
+	UINT8		TF_C;
+	UINT8		XTAL_CAP20P;
+	UINT8		XTAL_CAP10P;
+	UINT8		XTAL_CAP0P;
+	UINT8		IMR_MEM;
+}Freq_Info_Type;
+
+typedef struct _SysFreq_Info_Type
+{
+	UINT8		LNA_TOP;
+	UINT8		LNA_VTH_L;
+	UINT8		MIXER_TOP;
+	UINT8		MIXER_VTH_L;
+	UINT8      AIR_CABLE1_IN;
+	UINT8      CABLE2_IN;
+	UINT8		PRE_DECT;
+	UINT8      LNA_DISCHARGE;
+	UINT8      CP_CUR;
+	UINT8      DIV_BUF_CUR;
+	UINT8      FILTER_CUR;
+}SysFreq_Info_Type;
+
+/* calibration results that stay valid across opens of the same tuner */
+typedef struct _R828_Cal_Type
+{
+	UINT8 Xtal_cap_sel;
+	UINT8 IMR_done_flag;
+	R828_SectType IMR_Data[5];
+	UINT8 Fil_Cal_flag[STD_SIZE];
+	UINT8 Fil_Cal_code[STD_SIZE];
+}R828_Cal_Type;
+
+/* registers 0x05 - 0x1F are mirrored */
+#define R828_REG_BASE	0x05
+#define R828_REG_NUM	27
+
+/* per device driver state, kept in the rtlsdr device */
+struct r820t_state {
+	void *rtl_dev;
+
+	UINT8 R828_Arry[R828_REG_NUM];
+	R828_SectType IMR_Data[5]; //Please keep this array data for standby mode.
+	R828_I2C_TYPE R828_I2C;
+	R828_I2C_LEN_TYPE R828_I2C_Len;
+
+	UINT32 R828_IF_khz;
+	UINT32 R828_CAL_LO_khz;
+	UINT8  R828_IMR_point_num;
+	UINT8  R828_IMR_done_flag;
+	UINT8  R828_Fil_Cal_flag[STD_SIZE];
+	UINT8  R828_Fil_Cal_code[STD_SIZE];
+
+	UINT8 Xtal_cap_sel;
+	UINT8 Xtal_cap_sel_tmp;
+	UINT8 R828_Cal_restored;	/* set by R828_SetCal(), consumed by R828_Init() */
+
+	SysFreq_Info_Type SysFreq_Info1;
+	Sys_Info_Type Sys_Info1;
+	Freq_Info_Type Freq_Info1;
+
+	/* register mirror, see R828_Flush() */
+	UINT8 R828_Chip[R828_REG_NUM];	/* last value written to the chip */
+	UINT32 R828_Chip_Valid;		/* mask of known R828_Chip entries */
+	UINT8 R828_Pend[R828_REG_NUM];	/* deferred writes */
+	UINT32 R828_Dirty;		/* mask of valid R828_Pend entries */
+	int R828_Deferred;
+};
+
 //----------------------------------------------------------//
 //                   R828 Function                         //
 //----------------------------------------------------------//
-R828_ErrCode R828_Init(void *pTuner);
-R828_ErrCode R828_Standby(void *pTuner, R828_LoopThrough_Type R828_LoopSwitch);
-R828_ErrCode R828_GPIO(void *pTuner, R828_GPIO_Type R828_GPIO_Conrl);
-R828_ErrCode R828_SetStandard(void *pTuner, R828_Standard_Type RT_Standard);
-R828_ErrCode R828_SetFrequency(void *pTuner, R828_Set_Info R828_INFO, R828_SetFreq_Type R828_SetFreqMode);
-R828_ErrCode R828_GetRfGain(void *pTuner, R828_RF_Gain_Info *pR828_rf_gain);
-R828_ErrCode R828_SetRfGain(void *pTuner, int gain);
-R828_ErrCode R828_RfGainMode(void *pTuner, int manual);
+R828_ErrCode R828_Init(struct r820t_state *priv);
+R828_ErrCode R828_Standby(struct r820t_state *priv, R828_LoopThrough_Type R828_LoopSwitch);
+R828_ErrCode R828_GPIO(struct r820t_state *priv, R828_GPIO_Type R828_GPIO_Conrl);
+R828_ErrCode R828_SetStandard(struct r820t_state *priv, R828_Standard_Type RT_Standard);
+R828_ErrCode R828_SetFrequency(struct r820t_state *priv, R828_Set_Info R828_INFO, R828_SetFreq_Type R828_SetFreqMode);
+R828_ErrCode R828_GetRfGain(struct r820t_state *priv, R828_RF_Gain_Info *pR828_rf_gain);
+R828_ErrCode R828_SetRfGain(struct r820t_state *priv, int gain);
+R828_ErrCode R828_RfGainMode(struct r820t_state *priv, int manual);
+R828_ErrCode R828_Flush(struct r820t_state *priv);
+R828_ErrCode R828_GetLockStatus(struct r820t_state *priv, int *pLocked);
+R828_ErrCode R828_GetCal(struct r820t_state *priv, R828_Cal_Type *pCal);
+R828_ErrCode R828_SetCal(struct r820t_state *priv, const R828_Cal_Type *pCal);
 
 int
 r820t_SetRfFreqHz(
-	void *pTuner,
+	struct r820t_state *priv,
 	unsigned long RfFreqHz
 	);
 
 int
 r820t_SetStandardMode(
-	void *pTuner,
+	struct r820t_state *priv,
 	int StandardMode
 	);
 
 int
 r820t_SetStandby(
-	void *pTuner,
+	struct r820t_state *priv,
 	int LoopThroughType
 	);
 
@@ -17,16 +17,35 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef __linux__
+#define _GNU_SOURCE /* pthread_setaffinity_np() */
+#endif
+
+#include <ctype.h>
 #include <errno.h>
 #include <signal.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #ifndef _WIN32
 #include <unistd.h>
+#include <sys/time.h>
 #define min(a, b) (((a) < (b)) ? (a) : (b))
+#else
+#include <sys/timeb.h>
+#include <direct.h>
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#define getpid _getpid
 #endif
 
+#include <pthread.h>
+#include <sched.h>
+
 #include <libusb.h>
 
 /*
@@ -42,7 +61,25 @@
 /* two raised to the power of n */
 #define TWO_POW(n)		((double)(1ULL<<(n)))
 
+#define TWO_PI			6.283185307179586
+#define SQRT_2			1.4142135623730951
+
+/* atomic primitives used by the lock-free sample ring */
+#ifdef _MSC_VER
+#define rtlsdr_atomic_inc(p)	InterlockedIncrement((volatile LONG *)(p))
+#define rtlsdr_atomic_dec(p)	InterlockedDecrement((volatile LONG *)(p))
+#define rtlsdr_barrier()	MemoryBarrier()
+#define rtlsdr_atomic_cas(p, o, n) \
+	(InterlockedCompareExchange((volatile LONG *)(p), (n), (o)) == (LONG)(o))
+#else
+#define rtlsdr_atomic_inc(p)	__sync_add_and_fetch((p), 1)
+#define rtlsdr_atomic_dec(p)	__sync_sub_and_fetch((p), 1)
+#define rtlsdr_barrier()	__sync_synchronize()
+#define rtlsdr_atomic_cas(p, o, n)	__sync_bool_compare_and_swap((p), (o), (n))
+#endif
+
 #include "rtl-sdr.h"
+#include "rtlsdr_sim.h"
 #include "tuner_e4k.h"
 #include "tuner_fc0012.h"
 #include "tuner_fc0013.h"
@@ -66,16 +103,207 @@ enum rtlsdr_async_status {
 	RTLSDR_RUNNING
 };
 
+struct rtlsdr_ring_slot {
+	struct libusb_transfer *xfer;
+	uint32_t len;
+	volatile long refs; /* consumers which still hold this slot */
+	uint64_t stamp; /* us, time of completion */
+	rtlsdr_xfer_info_t info;
+};
+
+/* sample clock recovered from transfer completion times */
+struct rtlsdr_clock {
+	uint32_t rate; /* Hz, nominal rate the loop was seeded with */
+	double t_end; /* s, filtered capture time of the last sample */
+	double period; /* s, filtered sample period */
+	uint64_t samples; /* samples delivered or lost so far */
+};
+
+struct rtlsdr_group_member {
+	rtlsdr_dev_t *dev;
+	rtlsdr_read_async_cb_t cb;
+	void *cb_ctx;
+	int done; /* transfers torn down after a cancel */
+};
+
+#define BATCH_MAX_REQS	64
+#define BATCH_MAX_RUN	32	/* bytes coalesced into one demod write */
+
+#define PLAN_OP_MAX_LEN	16	/* longest register write a plan records */
+
+/* queued control transfer of a register write batch */
+struct rtlsdr_ctrl_req {
+	uint8_t type;
+	uint16_t value;
+	uint16_t index;
+	uint16_t len;
+	uint8_t data[BATCH_MAX_RUN];
+	int actual; /* bytes transferred, or a libusb error */
+	rtlsdr_dev_t *dev; /* for the completion callback */
+};
+
+struct rtlsdr_batch {
+	int active;
+	int run; /* request an adjacent demod write may extend, or -1 */
+	uint32_t nreq;
+	struct rtlsdr_ctrl_req req[BATCH_MAX_REQS];
+	volatile long pending; /* submitted but not completed */
+	int completed;
+	int error;
+};
+
+/* public calls a trace accounts control transfers to */
+enum rtlsdr_trace_api {
+	TRACE_API_OTHER = 0,
+	TRACE_API_OPEN,
+	TRACE_API_CLOSE,
+	TRACE_API_SET_CENTER_FREQ,
+	TRACE_API_SET_SAMPLE_RATE,
+	TRACE_API_SET_FREQ_CORRECTION,
+	TRACE_API_SET_XTAL_FREQ,
+	TRACE_API_SET_TUNER_GAIN,
+	TRACE_API_SET_TUNER_IF_GAIN,
+	TRACE_API_SET_TUNER_GAIN_MODE,
+	TRACE_API_SET_AGC_MODE,
+	TRACE_API_SET_TESTMODE,
+	TRACE_API_SET_DIRECT_SAMPLING,
+	TRACE_API_SET_OFFSET_TUNING,
+	TRACE_API_RESET_BUFFER,
+	TRACE_API_PLAN_CREATE,
+	TRACE_API_PLAN_APPLY,
+	TRACE_API_NUM
+};
+
+struct rtlsdr_trace {
+	pthread_mutex_t lock;
+	int active;
+	uint64_t start_us;
+	rtlsdr_trace_rec_t *rec; /* ring of size records */
+	uint32_t size;
+	uint64_t total; /* records ever added */
+	rtlsdr_trace_api_stats_t api[TRACE_API_NUM];
+	int depth; /* nesting of traced calls */
+	uint8_t cur; /* outermost call in progress */
+	uint64_t call_start_us;
+	char *path; /* dumped at close, from RTLSDR_TRACE */
+};
+
+/* what register accesses and samples travel over: USB, a capture file or
+ * the register model, everything above is the same for all of them */
+struct rtlsdr_transport {
+	/* returns the bytes transferred or a libusb error code */
+	int (*ctrl)(rtlsdr_dev_t *dev, uint8_t type, uint16_t value,
+		    uint16_t index, unsigned char *data, uint16_t len);
+	/* optional, all requests with a single wait, returns 0 or an error,
+	 * sets the actual of every request */
+	int (*ctrl_batch)(rtlsdr_dev_t *dev, struct rtlsdr_ctrl_req *req,
+			  uint32_t n);
+	/* blocking sample read, actual is 0 at the end of the stream */
+	int (*bulk)(rtlsdr_dev_t *dev, unsigned char *buf, int len,
+		    int *actual);
+	void (*close)(rtlsdr_dev_t *dev);
+	int soft_stream; /* async transfers are served by bulk(), not libusb */
+};
+
+#define SHADOW_DEMOD_PAGES	2	/* demod pages 0 and 1 hold the configuration */
+
+/* shadow of one page of 256 byte wide registers */
+struct rtlsdr_reg_page {
+	uint8_t val[256];
+	uint8_t valid[256 / 8];
+};
+
+/* devices sharing one libusb context and event loop */
+struct rtlsdr_group {
+	libusb_context *ctx;
+	struct rtlsdr_group_member member[RTLSDR_GROUP_MAX_DEVICES];
+	uint32_t ndev;
+	int running;
+};
+
+/* register write recorded for a retune plan */
+enum rtlsdr_plan_op_kind {
+	PLAN_OP_ARRAY = 0,	/* rtlsdr_write_array(), tuner I2C */
+	PLAN_OP_REG,		/* rtlsdr_write_reg() */
+	PLAN_OP_DEMOD		/* rtlsdr_demod_write_reg() */
+};
+
+struct rtlsdr_plan_op {
+	uint8_t kind;
+	uint8_t block; /* demod page for PLAN_OP_DEMOD */
+	uint16_t addr;
+	uint16_t val;
+	uint8_t len;
+	uint8_t data[PLAN_OP_MAX_LEN];
+};
+
+struct rtlsdr_plan_hop {
+	uint32_t freq; /* Hz */
+	uint32_t first_op;
+	uint32_t nops;
+	int complete; /* every write fit into the plan */
+};
+
+struct rtlsdr_retune_plan {
+	rtlsdr_dev_t *dev;
+	uint32_t gen; /* dev->plan_gen the writes were recorded with */
+	uint32_t count;
+	struct rtlsdr_plan_hop *hop;
+	struct rtlsdr_plan_op *op;
+	uint32_t nops;
+	uint32_t ops_size;
+	size_t state_len;
+	uint8_t *state; /* tuner driver state after each hop */
+};
+
 struct rtlsdr_dev {
 	libusb_context *ctx;
+	struct rtlsdr_group *group; /* NULL if the context is private */
+	struct rtlsdr_batch batch;
+	/* register shadow */
+	struct rtlsdr_reg_page demod_shadow[SHADOW_DEMOD_PAGES];
+	struct rtlsdr_reg_page usb_shadow[2]; /* 0x2000 - 0x21ff */
+	struct rtlsdr_reg_page sys_shadow; /* 0x3000 - 0x30ff */
 	struct libusb_device_handle *devh;
 	uint32_t xfer_buf_num;
 	uint32_t xfer_buf_len;
 	struct libusb_transfer **xfer;
 	unsigned char **xfer_buf;
 	rtlsdr_read_async_cb_t cb;
+	rtlsdr_read_async_ex_cb_t cb_ex;
 	void *cb_ctx;
+	struct rtlsdr_clock clk;
 	enum rtlsdr_async_status async_status;
+	volatile long xfer_inflight; /* transfers owned by libusb */
+	uint32_t cancel_latency_ms;
+	/* event thread */
+	pthread_t stream_thread;
+	int stream_active;
+	int stream_cpu;
+	int stream_rt_prio;
+	uint32_t stream_buf_num;
+	uint32_t stream_buf_len;
+	int stream_result;
+	/* zero-copy sample ring */
+	int ring_mode;
+	uint32_t ring_consumers; /* bitmask of registered consumers */
+	long ring_nconsumers;
+	struct rtlsdr_ring_slot *ring_slot;
+	volatile uint32_t ring_head; /* sequence number of the next slot */
+	volatile uint32_t ring_acq[RTLSDR_RING_MAX_CONSUMERS];
+	volatile uint32_t ring_rel[RTLSDR_RING_MAX_CONSUMERS];
+	volatile long ring_held; /* slots published but not yet released */
+	volatile long ring_waiters;
+	volatile long ring_busy; /* consumers inside acquire or release */
+	volatile int ring_stopped;
+	pthread_mutex_t ring_lock;
+	pthread_cond_t ring_cond;
+	/* stream statistics */
+	rtlsdr_stream_stats_t stats;
+	uint64_t stats_last_us; /* time of the previous completion */
+	uint64_t stats_interval_sum;
+	uint64_t stats_intervals;
+	pthread_mutex_t stats_lock;
 	/* rtl demod context */
 	uint32_t rate; /* Hz */
 	uint32_t rtl_xtal; /* Hz */
@@ -89,9 +317,41 @@ struct rtlsdr_dev {
 	int corr; /* ppm */
 	int gain; /* tenth dB */
 	struct e4k_state e4k_s;
+	struct r820t_state r820t_s;
+	/* retune plans */
+	uint32_t plan_gen; /* bumped by settings recorded plans depend on */
+	struct rtlsdr_retune_plan *plan_rec; /* plan being recorded */
+	/* retune tagging */
+	pthread_mutex_t tune_lock;
+	uint32_t tune_freq; /* Hz, target of the latest retune */
+	uint64_t tune_settle_us; /* when the tuner settled, 0 while tuning */
+	int tune_pending; /* settled_index not resolved yet */
+	uint64_t settled_index;
+	/* transport */
+	const struct rtlsdr_transport *xport;
+	uint32_t xport_latency_us; /* added to every round trip */
+	rtlsdr_transport_stats_t xport_stats;
+	struct rtl2832_sim *sim; /* register model, see rtlsdr_open_sim() */
+	struct rtlsdr_trace *trace; /* see rtlsdr_trace_start() */
+	/* capture file replay, see rtlsdr_open_replay() */
+	FILE *replay;
+	int replay_flags;
+	/* streaming without libusb, see _rtlsdr_soft_step() */
+	uint64_t soft_start_us; /* when the stream started, 0 before */
+	uint64_t soft_bytes; /* delivered since the stream started */
+	uint64_t soft_due; /* us, arrival time of the latest buffer */
+	struct libusb_transfer **soft_q; /* transfers waiting for samples */
+	uint32_t soft_q_head;
+	uint32_t soft_q_len;
+	pthread_mutex_t soft_lock;
+	pthread_cond_t soft_cond;
 };
 
 void rtlsdr_set_gpio_bit(rtlsdr_dev_t *dev, uint8_t gpio, int val);
+static uint64_t _rtlsdr_now_us(void);
+static void _rtlsdr_sleep_us(uint32_t us);
+static int _rtlsdr_cal_load(rtlsdr_dev_t *dev, void *cal, uint32_t len);
+static int _rtlsdr_cal_store(rtlsdr_dev_t *dev, const void *cal, uint32_t len);
 
 /* generic tuner interface functions, shall be moved to the tuner implementations */
 int e4000_init(void *dev) {
@@ -173,15 +433,40 @@ int fc2580_set_gain(void *dev, int gain) { return 0; }
 int fc2580_set_gain_mode(void *dev, int manual) { return 0; }
 
 int r820t_init(void *dev) {
-	int r = R828_Init(dev);
-	r820t_SetStandardMode(dev, DVB_T_6M);
+	rtlsdr_dev_t* devt = (rtlsdr_dev_t*)dev;
+	R828_Cal_Type cal;
+	int cached = 0;
+	int r;
+
+	devt->r820t_s.rtl_dev = dev;
+
+	if (!_rtlsdr_cal_load(devt, &cal, sizeof(cal)))
+		cached = (R828_SetCal(&devt->r820t_s, &cal) == RT_Success);
+
+	r = R828_Init(&devt->r820t_s);
+	r |= r820t_SetStandardMode(&devt->r820t_s, DVB_T_6M);
+
+	if (!r && !cached) {
+		R828_GetCal(&devt->r820t_s, &cal);
+		_rtlsdr_cal_store(devt, &cal, sizeof(cal));
+	}
+
 	return r;
 }
 int r820t_exit(void *dev) { return 0; }
-int r820t_set_freq(void *dev, uint32_t freq) { return r820t_SetRfFreqHz(dev, freq); }
+int r820t_set_freq(void *dev, uint32_t freq) {
+	rtlsdr_dev_t* devt = (rtlsdr_dev_t*)dev;
+	return r820t_SetRfFreqHz(&devt->r820t_s, freq);
+}
 int r820t_set_bw(void *dev, int bw) { return 0; }
-int r820t_set_gain(void *dev, int gain) { return R828_SetRfGain(dev, gain); }
-int r820t_set_gain_mode(void *dev, int manual) { return R828_RfGainMode(dev, manual); }
+int r820t_set_gain(void *dev, int gain) {
+	rtlsdr_dev_t* devt = (rtlsdr_dev_t*)dev;
+	return R828_SetRfGain(&devt->r820t_s, gain);
+}
+int r820t_set_gain_mode(void *dev, int manual) {
+	rtlsdr_dev_t* devt = (rtlsdr_dev_t*)dev;
+	return R828_RfGainMode(&devt->r820t_s, manual);
+}
 
 /* definition order must match enum rtlsdr_tuner */
 static rtlsdr_tuner_iface_t tuners[] = {
@@ -215,6 +500,13 @@ static rtlsdr_tuner_iface_t tuners[] = {
 	},
 };
 
+/* stands in for the tuner of a replayed capture, see rtlsdr_open_replay() */
+static int replay_set_freq(void *dev, uint32_t freq) { return 0; }
+
+static rtlsdr_tuner_iface_t replay_tuner = {
+	NULL, NULL, replay_set_freq, NULL, NULL, NULL, NULL
+};
+
 typedef struct rtlsdr_dongle {
 	uint16_t vid;
 	uint16_t pid;
@@ -260,6 +552,26 @@ static rtlsdr_dongle_t known_devices[] = {
 #define DEFAULT_BUF_NUMBER	32
 #define DEFAULT_BUF_LENGTH	(16 * 32 * 512)
 
+#define DEFAULT_CANCEL_LATENCY	1000	/* ms */
+
+#define CLOCK_LOOP_BW		0.5	/* Hz, sample clock recovery bandwidth */
+
+#define TUNE_SETTLE_US		1000	/* tuners without a lock indicator */
+#define TUNE_LOCK_POLLS		20	/* lock reads after replaying a hop */
+
+#define ENUM_CACHE_TIMEOUT	1000	/* ms, without hotplug support */
+
+#define REPLAY_ENV		"RTLSDR_REPLAY"
+#define REPLAY_PATH_MAX		1024
+
+#define SIM_ENV			"RTLSDR_SIM"
+
+#define TRACE_ENV		"RTLSDR_TRACE"
+#define TRACE_DEFAULT_RECS	16384
+#define TRACE_MAGIC		0x43525452	/* "RTRC" */
+#define TRACE_VERSION		1
+#define TRACE_NAME_LEN		32
+
 #define DEF_RTL_XTAL_FREQ	28800000
 #define MIN_RTL_XTAL_FREQ	(DEF_RTL_XTAL_FREQ - 1000)
 #define MAX_RTL_XTAL_FREQ	(DEF_RTL_XTAL_FREQ + 1000)
@@ -310,1354 +622,4561 @@ enum blocks {
 	IICB			= 6,
 };
 
-int rtlsdr_read_array(rtlsdr_dev_t *dev, uint8_t block, uint16_t addr, uint8_t *array, uint8_t len)
+/*
+ * Register shadow: the last value written to or read from each
+ * configuration register is remembered, writes which would not change it
+ * are skipped and reads of non-volatile registers are answered from it.
+ */
+static struct rtlsdr_reg_page *_rtlsdr_shadow_block(rtlsdr_dev_t *dev,
+						    uint8_t block,
+						    uint16_t addr, uint8_t len)
 {
-	int r;
-	uint16_t index = (block << 8);
+	if ((addr & 0xff) + len > 256)
+		return NULL;
 
-	r = libusb_control_transfer(dev->devh, CTRL_IN, 0, addr, index, array, len, CTRL_TIMEOUT);
-#if 0
-	if (r < 0)
-		fprintf(stderr, "%s failed with %d\n", __FUNCTION__, r);
-#endif
-	return r;
+	switch (block) {
+	case USBB:
+		if (addr >= 0x2000 && addr < 0x2200)
+			return &dev->usb_shadow[(addr >> 8) & 1];
+		break;
+	case SYSB:
+		if ((addr >> 8) == 0x30)
+			return &dev->sys_shadow;
+		break;
+	}
+
+	return NULL;
 }
 
-int rtlsdr_write_array(rtlsdr_dev_t *dev, uint8_t block, uint16_t addr, uint8_t *array, uint8_t len)
+static struct rtlsdr_reg_page *_rtlsdr_shadow_demod(rtlsdr_dev_t *dev,
+						    uint8_t page,
+						    uint16_t addr, uint8_t len)
 {
-	int r;
-	uint16_t index = (block << 8) | 0x10;
+	if (page >= SHADOW_DEMOD_PAGES || addr + len > 256)
+		return NULL;
 
-	r = libusb_control_transfer(dev->devh, CTRL_OUT, 0, addr, index, array, len, CTRL_TIMEOUT);
-#if 0
-	if (r < 0)
-		fprintf(stderr, "%s failed with %d\n", __FUNCTION__, r);
-#endif
-	return r;
+	return &dev->demod_shadow[page];
 }
 
-int rtlsdr_i2c_write_reg(rtlsdr_dev_t *dev, uint8_t i2c_addr, uint8_t reg, uint8_t val)
+/* status registers the hardware updates on its own, and strobes */
+static int _rtlsdr_reg_volatile(uint8_t block, uint16_t addr)
 {
-	uint16_t addr = i2c_addr;
-	uint8_t data[2];
+	if (SYSB == block)
+		return addr == GPI || addr == SYSINTS || addr == SYSINTS_1;
 
-	data[0] = reg;
-	data[1] = val;
-	return rtlsdr_write_array(dev, IICB, addr, (uint8_t *)&data, 2);
+	if (USBB == block)
+		return addr == USB_STAT || addr == USB_EPA_CTL;
+
+	return 0;
 }
 
-uint8_t rtlsdr_i2c_read_reg(rtlsdr_dev_t *dev, uint8_t i2c_addr, uint8_t reg)
+static int _rtlsdr_shadow_match(struct rtlsdr_reg_page *p, uint8_t reg,
+				const uint8_t *data, uint8_t len)
 {
-	uint16_t addr = i2c_addr;
-	uint8_t data = 0;
+	int i;
 
-	rtlsdr_write_array(dev, IICB, addr, &reg, 1);
-	rtlsdr_read_array(dev, IICB, addr, &data, 1);
+	if (!p)
+		return 0;
 
-	return data;
-}
+	for (i = reg; i < reg + len; i++) {
+		if (!(p->valid[i >> 3] & (1 << (i & 7))))
+			return 0;
 
-/* TODO clean this up again */
-int e4k_reg_write(struct e4k_state *e4k, uint8_t reg, uint8_t val)
-{
-	return rtlsdr_i2c_write_reg((rtlsdr_dev_t*)e4k->rtl_dev, e4k->i2c_addr, reg, val);}
+		if (p->val[i] != data[i - reg])
+			return 0;
+	}
 
-uint8_t e4k_reg_read(struct e4k_state *e4k, uint8_t reg)
-{
-	return rtlsdr_i2c_read_reg((rtlsdr_dev_t*)e4k->rtl_dev, e4k->i2c_addr, reg);
+	return 1;
 }
 
-int rtlsdr_i2c_write(rtlsdr_dev_t *dev, uint8_t i2c_addr, uint8_t *buffer, int len)
+static int _rtlsdr_shadow_load(struct rtlsdr_reg_page *p, uint8_t reg,
+			       uint8_t *data, uint8_t len)
 {
-	uint16_t addr = i2c_addr;
+	int i;
 
-	if (!dev)
-		return -1;
+	if (!p)
+		return 0;
 
-	return rtlsdr_write_array(dev, IICB, addr, buffer, len);
+	for (i = reg; i < reg + len; i++) {
+		if (!(p->valid[i >> 3] & (1 << (i & 7))))
+			return 0;
+	}
+
+	memcpy(data, &p->val[reg], len);
+
+	return 1;
 }
 
-int rtlsdr_i2c_read(rtlsdr_dev_t *dev, uint8_t i2c_addr, uint8_t *buffer, int len)
+static void _rtlsdr_shadow_store(struct rtlsdr_reg_page *p, uint8_t reg,
+				 const uint8_t *data, uint8_t len)
 {
-	uint16_t addr = i2c_addr;
+	int i;
 
-	if (!dev)
-		return -1;
+	if (!p)
+		return;
 
-	return rtlsdr_read_array(dev, IICB, addr, buffer, len);
+	for (i = reg; i < reg + len; i++) {
+		p->val[i] = data[i - reg];
+		p->valid[i >> 3] |= 1 << (i & 7);
+	}
 }
 
-uint16_t rtlsdr_read_reg(rtlsdr_dev_t *dev, uint8_t block, uint16_t addr, uint8_t len)
+static void _rtlsdr_shadow_invalidate(struct rtlsdr_reg_page *p, uint8_t reg,
+				      uint8_t len)
 {
-	int r;
-	unsigned char data[2];
-	uint16_t index = (block << 8);
-	uint16_t reg;
+	int i;
 
-	r = libusb_control_transfer(dev->devh, CTRL_IN, 0, addr, index, data, len, CTRL_TIMEOUT);
+	if (!p)
+		return;
 
-	if (r < 0)
-		fprintf(stderr, "%s failed with %d\n", __FUNCTION__, r);
+	for (i = reg; i < reg + len; i++)
+		p->valid[i >> 3] &= ~(1 << (i & 7));
+}
 
-	reg = (data[1] << 8) | data[0];
+static void _rtlsdr_shadow_clear(rtlsdr_dev_t *dev)
+{
+	unsigned int i;
 
-	return reg;
+	for (i = 0; i < SHADOW_DEMOD_PAGES; i++)
+		memset(dev->demod_shadow[i].valid, 0,
+		       sizeof(dev->demod_shadow[i].valid));
+
+	memset(dev->usb_shadow[0].valid, 0, sizeof(dev->usb_shadow[0].valid));
+	memset(dev->usb_shadow[1].valid, 0, sizeof(dev->usb_shadow[1].valid));
+	memset(dev->sys_shadow.valid, 0, sizeof(dev->sys_shadow.valid));
 }
 
-int rtlsdr_write_reg(rtlsdr_dev_t *dev, uint8_t block, uint16_t addr, uint16_t val, uint8_t len)
+/*
+ * Register write batching: while a batch is open, register writes are
+ * queued instead of being sent one round-trip at a time. Writes to adjacent
+ * demod registers of the same page are coalesced into one multi-byte write,
+ * everything else is submitted as asynchronous control transfers, which the
+ * default pipe executes in order. Any read flushes the batch first.
+ */
+static int _rtlsdr_batch_flush(rtlsdr_dev_t *dev);
+
+static struct rtlsdr_ctrl_req *_rtlsdr_batch_add(rtlsdr_dev_t *dev,
+						 uint8_t type, uint16_t value,
+						 uint16_t index,
+						 const uint8_t *data,
+						 uint16_t len)
 {
-	int r;
-	unsigned char data[2];
+	struct rtlsdr_batch *b = &dev->batch;
+	struct rtlsdr_ctrl_req *req;
 
-	uint16_t index = (block << 8) | 0x10;
+	/* keep room for the read closing a demod run */
+	if (b->nreq + 2 > BATCH_MAX_REQS)
+		_rtlsdr_batch_flush(dev);
 
-	if (len == 1)
-		data[0] = val & 0xff;
-	else
-		data[0] = val >> 8;
+	req = &b->req[b->nreq++];
+	req->type = type;
+	req->value = value;
+	req->index = index;
+	req->len = len;
 
-	data[1] = val & 0xff;
+	if (data)
+		memcpy(req->data, data, len);
 
-	r = libusb_control_transfer(dev->devh, CTRL_OUT, 0, addr, index, data, len, CTRL_TIMEOUT);
+	return req;
+}
 
-	if (r < 0)
-		fprintf(stderr, "%s failed with %d\n", __FUNCTION__, r);
+static void _rtlsdr_batch_close_run(rtlsdr_dev_t *dev)
+{
+	if (dev->batch.run < 0)
+		return;
 
-	return r;
+	dev->batch.run = -1;
+
+	/* read back once per run, as rtlsdr_demod_write_reg() does per write */
+	_rtlsdr_batch_add(dev, CTRL_IN, (0x01 << 8) | 0x20, 0x0a, NULL, 1);
 }
 
-uint16_t rtlsdr_demod_read_reg(rtlsdr_dev_t *dev, uint8_t page, uint16_t addr, uint8_t len)
+static void _rtlsdr_batch_write_reg(rtlsdr_dev_t *dev, uint16_t addr,
+				    uint16_t index, const uint8_t *data,
+				    uint8_t len)
 {
-	int r;
-	unsigned char data[2];
+	_rtlsdr_batch_close_run(dev);
+	_rtlsdr_batch_add(dev, CTRL_OUT, addr, index, data, len);
+}
 
-	uint16_t index = page;
-	uint16_t reg;
-	addr = (addr << 8) | 0x20;
+static void _rtlsdr_batch_demod_write_reg(rtlsdr_dev_t *dev, uint8_t page,
+					  uint16_t addr, const uint8_t *data,
+					  uint8_t len)
+{
+	struct rtlsdr_batch *b = &dev->batch;
+	struct rtlsdr_ctrl_req *req;
+	uint16_t index = 0x10 | page;
 
-	r = libusb_control_transfer(dev->devh, CTRL_IN, 0, addr, index, data, len, CTRL_TIMEOUT);
+	if (b->run >= 0) {
+		req = &b->req[b->run];
 
-	if (r < 0)
-		fprintf(stderr, "%s failed with %d\n", __FUNCTION__, r);
+		if (req->index == index &&
+		    (req->value >> 8) + req->len == addr &&
+		    req->len + len <= BATCH_MAX_RUN) {
+			memcpy(req->data + req->len, data, len);
+			req->len += len;
+			return;
+		}
+	}
 
-	reg = (data[1] << 8) | data[0];
+	_rtlsdr_batch_close_run(dev);
 
-	return reg;
+	req = _rtlsdr_batch_add(dev, CTRL_OUT, (addr << 8) | 0x20, index,
+				data, len);
+	b->run = req - b->req;
 }
 
-int rtlsdr_demod_write_reg(rtlsdr_dev_t *dev, uint8_t page, uint16_t addr, uint16_t val, uint8_t len)
+/* records one control transfer, round_trip once per wait for the device */
+static void _rtlsdr_trace_add(rtlsdr_dev_t *dev, uint64_t t0, uint64_t t1,
+			      uint8_t type, uint16_t value, uint16_t index,
+			      const unsigned char *data, uint16_t len,
+			      uint8_t flags, int round_trip)
 {
-	int r;
-	unsigned char data[2];
-	uint16_t index = 0x10 | page;
-	addr = (addr << 8) | 0x20;
+	struct rtlsdr_trace *tr = dev->trace;
+	rtlsdr_trace_api_stats_t *api;
+	rtlsdr_trace_rec_t *rec;
+	uint8_t block = index >> 8;
+
+	pthread_mutex_lock(&tr->lock);
+
+	if (tr->active) {
+		rec = &tr->rec[tr->total++ % tr->size];
+		rec->time_us = (uint32_t)(t0 - tr->start_us);
+		rec->dur_us = (uint32_t)(t1 - t0);
+		rec->len = len;
+		rec->block = block;
+		rec->flags = flags;
+		rec->api = tr->cur;
+
+		if (CTRL_IN == type)
+			rec->flags |= RTLSDR_TRACE_READ;
+
+		if (DEMODB == block && (value & 0xff) == 0x20) {
+			rec->addr = value >> 8;
+			rec->sub = index & 0x0f;
+		} else {
+			rec->addr = value;
+			rec->sub = (IICB == block && CTRL_OUT == type && len) ?
+				   data[0] : 0;
+		}
 
-	if (len == 1)
-		data[0] = val & 0xff;
-	else
-		data[0] = val >> 8;
+		api = &tr->api[tr->cur];
+		api->transfers++;
+		api->bytes += len;
+		if (round_trip) {
+			api->round_trips++;
+			api->transfer_us += t1 - t0;
+		}
+	}
 
-	data[1] = val & 0xff;
+	pthread_mutex_unlock(&tr->lock);
+}
+
+/* transfers until the matching leave count for the outermost public call */
+static void _rtlsdr_trace_enter(rtlsdr_dev_t *dev, uint8_t api)
+{
+	struct rtlsdr_trace *tr = dev->trace;
 
-	r = libusb_control_transfer(dev->devh, CTRL_OUT, 0, addr, index, data, len, CTRL_TIMEOUT);
+	if (!tr)
+		return;
 
-	if (r < 0)
-		fprintf(stderr, "%s failed with %d\n", __FUNCTION__, r);
+	pthread_mutex_lock(&tr->lock);
 
-	rtlsdr_demod_read_reg(dev, 0x0a, 0x01, 1);
+	if (!tr->depth++) {
+		tr->cur = api;
+		tr->call_start_us = _rtlsdr_now_us();
+	}
 
-	return (r == len) ? 0 : -1;
+	pthread_mutex_unlock(&tr->lock);
 }
 
-void rtlsdr_set_gpio_bit(rtlsdr_dev_t *dev, uint8_t gpio, int val)
+static void _rtlsdr_trace_leave(rtlsdr_dev_t *dev)
 {
-	uint8_t r;
+	struct rtlsdr_trace *tr = dev->trace;
+	rtlsdr_trace_api_stats_t *api;
 
-	gpio = 1 << gpio;
-	r = rtlsdr_read_reg(dev, SYSB, GPO, 1);
-	r = val ? (r | gpio) : (r & ~gpio);
-	rtlsdr_write_reg(dev, SYSB, GPO, r, 1);
+	if (!tr)
+		return;
+
+	pthread_mutex_lock(&tr->lock);
+
+	if (tr->depth && !--tr->depth) {
+		if (tr->active) {
+			api = &tr->api[tr->cur];
+			api->calls++;
+			api->call_us += _rtlsdr_now_us() - tr->call_start_us;
+		}
+		tr->cur = TRACE_API_OTHER;
+	}
+
+	pthread_mutex_unlock(&tr->lock);
 }
 
-void rtlsdr_set_gpio_output(rtlsdr_dev_t *dev, uint8_t gpio)
+/* every register access passes here, see rtlsdr_get_transport_stats() */
+static int _rtlsdr_ctrl_transfer(rtlsdr_dev_t *dev, uint8_t type,
+				 uint16_t value, uint16_t index,
+				 unsigned char *data, uint16_t len)
 {
+	rtlsdr_transport_stats_t *st = &dev->xport_stats;
+	uint64_t t0 = _rtlsdr_now_us();
+	uint64_t t1;
 	int r;
-	gpio = 1 << gpio;
 
-	r = rtlsdr_read_reg(dev, SYSB, GPD, 1);
-	rtlsdr_write_reg(dev, SYSB, GPO, r & ~gpio, 1);
-	r = rtlsdr_read_reg(dev, SYSB, GPOE, 1);
-	rtlsdr_write_reg(dev, SYSB, GPOE, r | gpio, 1);
-}
+	if (dev->xport_latency_us)
+		_rtlsdr_sleep_us(dev->xport_latency_us);
 
-void rtlsdr_set_i2c_repeater(rtlsdr_dev_t *dev, int on)
-{
-	rtlsdr_demod_write_reg(dev, 1, 0x01, on ? 0x18 : 0x10, 1);
+	r = dev->xport->ctrl(dev, type, value, index, data, len);
+	t1 = _rtlsdr_now_us();
+
+	/* control calls may come from several threads at once */
+	pthread_mutex_lock(&dev->stats_lock);
+	if (CTRL_IN == type)
+		st->ctrl_in++;
+	else
+		st->ctrl_out++;
+	st->round_trips++;
+	if (r > 0)
+		st->bytes += r;
+	st->time_us += t1 - t0;
+	pthread_mutex_unlock(&dev->stats_lock);
+
+	if (dev->trace)
+		_rtlsdr_trace_add(dev, t0, t1, type, value, index, data, len,
+				  r < 0 ? RTLSDR_TRACE_ERROR : 0, 1);
+
+	return r;
 }
 
-void rtlsdr_init_baseband(rtlsdr_dev_t *dev)
+/* a batch costs one round trip, however many requests it holds */
+static int _rtlsdr_ctrl_batch(rtlsdr_dev_t *dev, struct rtlsdr_ctrl_req *req,
+			      uint32_t n)
 {
-	unsigned int i;
+	rtlsdr_transport_stats_t *st = &dev->xport_stats;
+	uint64_t t0 = _rtlsdr_now_us();
+	uint64_t t1;
+	uint32_t i;
+	int r = 0;
 
-	/* default FIR coefficients used for DAB/FM by the Windows driver,
-	 * the DVB driver uses different ones */
-	uint8_t fir_coeff[] = {
-		0xca, 0xdc, 0xd7, 0xd8, 0xe0, 0xf2, 0x0e, 0x35, 0x06, 0x50,
-		0x9c, 0x0d, 0x71, 0x11, 0x14, 0x71, 0x74, 0x19, 0x41, 0xa5,
-	};
+	if (dev->xport_latency_us)
+		_rtlsdr_sleep_us(dev->xport_latency_us);
 
-	/* initialize USB */
-	rtlsdr_write_reg(dev, USBB, USB_SYSCTL, 0x09, 1);
-	rtlsdr_write_reg(dev, USBB, USB_EPA_MAXPKT, 0x0002, 2);
-	rtlsdr_write_reg(dev, USBB, USB_EPA_CTL, 0x1002, 2);
+	if (dev->xport->ctrl_batch) {
+		r = dev->xport->ctrl_batch(dev, req, n);
+	} else {
+		for (i = 0; i < n; i++) {
+			int rr = dev->xport->ctrl(dev, req[i].type,
+						  req[i].value, req[i].index,
+						  req[i].data, req[i].len);
+			req[i].actual = rr;
+			if (rr < 0 && !r)
+				r = rr;
+		}
+	}
 
-	/* poweron demod */
-	rtlsdr_write_reg(dev, SYSB, DEMOD_CTL_1, 0x22, 1);
-	rtlsdr_write_reg(dev, SYSB, DEMOD_CTL, 0xe8, 1);
+	t1 = _rtlsdr_now_us();
 
-	/* reset demod (bit 3, soft_rst) */
-	rtlsdr_demod_write_reg(dev, 1, 0x01, 0x14, 1);
-	rtlsdr_demod_write_reg(dev, 1, 0x01, 0x10, 1);
+	pthread_mutex_lock(&dev->stats_lock);
+	for (i = 0; i < n; i++) {
+		if (CTRL_IN == req[i].type)
+			st->ctrl_in++;
+		else
+			st->ctrl_out++;
+		if (req[i].actual > 0)
+			st->bytes += req[i].actual;
+	}
+	st->round_trips++;
+	st->time_us += t1 - t0;
+	pthread_mutex_unlock(&dev->stats_lock);
+
+	if (dev->trace) {
+		for (i = 0; i < n; i++)
+			_rtlsdr_trace_add(dev, t0, t1, req[i].type,
+					  req[i].value, req[i].index,
+					  req[i].data, req[i].len,
+					  RTLSDR_TRACE_BATCH |
+					  (req[i].actual < 0 ?
+					   RTLSDR_TRACE_ERROR : 0), !i);
+	}
 
-	/* disable spectrum inversion and adjacent channel rejection */
-	rtlsdr_demod_write_reg(dev, 1, 0x15, 0x00, 1);
-	rtlsdr_demod_write_reg(dev, 1, 0x16, 0x0000, 2);
+	return r;
+}
 
-	/* clear both DDC shift and IF frequency registers  */
-	for (i = 0; i < 6; i++)
-		rtlsdr_demod_write_reg(dev, 1, 0x16 + i, 0x00, 1);
+static void LIBUSB_CALL _rtlsdr_batch_callback(struct libusb_transfer *xfer)
+{
+	struct rtlsdr_ctrl_req *req = (struct rtlsdr_ctrl_req *)xfer->user_data;
+	rtlsdr_dev_t *dev = req->dev;
 
-	/* set FIR coefficients */
-	for (i = 0; i < sizeof (fir_coeff); i++)
-		rtlsdr_demod_write_reg(dev, 1, 0x1c + i, fir_coeff[i], 1);
+	if (LIBUSB_TRANSFER_COMPLETED == xfer->status) {
+		req->actual = xfer->actual_length;
+	} else {
+		req->actual = LIBUSB_ERROR_IO;
+		dev->batch.error = LIBUSB_ERROR_IO;
+	}
 
-	/* enable SDR mode, disable DAGC (bit 5) */
-	rtlsdr_demod_write_reg(dev, 0, 0x19, 0x05, 1);
+	if (!rtlsdr_atomic_dec(&dev->batch.pending))
+		dev->batch.completed = 1;
 
-	/* init FSM state-holding register */
-	rtlsdr_demod_write_reg(dev, 1, 0x93, 0xf0, 1);
-	rtlsdr_demod_write_reg(dev, 1, 0x94, 0x0f, 1);
+	libusb_free_transfer(xfer);
+}
 
-	/* disable AGC (en_dagc, bit 0) (this seems to have no effect) */
-	rtlsdr_demod_write_reg(dev, 1, 0x11, 0x00, 1);
+static int _rtlsdr_usb_ctrl_batch(rtlsdr_dev_t *dev,
+				  struct rtlsdr_ctrl_req *reqs, uint32_t n)
+{
+	struct rtlsdr_batch *b = &dev->batch;
+	struct rtlsdr_ctrl_req *req;
+	struct libusb_transfer *xfer;
+	unsigned char *buf;
+	struct timeval tv = { 1, 0 };
+	uint32_t i;
+	int r;
 
-	/* disable RF and IF AGC loop */
-	rtlsdr_demod_write_reg(dev, 1, 0x04, 0x00, 1);
+	b->pending = 0;
+	b->completed = 0;
+	b->error = 0;
 
-	/* disable PID filter (enable_PID = 0) */
-	rtlsdr_demod_write_reg(dev, 0, 0x61, 0x60, 1);
+	for (i = 0; i < n; i++) {
+		reqs[i].actual = 0;
+		reqs[i].dev = dev;
+	}
 
-	/* opt_adc_iq = 0, default ADC_I/ADC_Q datapath */
-	rtlsdr_demod_write_reg(dev, 0, 0x06, 0x80, 1);
+	for (i = 0; i < n; i++) {
+		req = &reqs[i];
 
-	/* Enable Zero-IF mode (en_bbin bit), DC cancellation (en_dc_est),
-	 * IQ estimation/compensation (en_iq_comp, en_iq_est) */
-	rtlsdr_demod_write_reg(dev, 1, 0xb1, 0x1b, 1);
+		xfer = libusb_alloc_transfer(0);
+		buf = xfer ? malloc(LIBUSB_CONTROL_SETUP_SIZE + req->len) : NULL;
+		if (!buf) {
+			libusb_free_transfer(xfer);
+			break;
+		}
 
-	/* disable 4.096 MHz clock output on pin TP_CK0 */
-	rtlsdr_demod_write_reg(dev, 0, 0x0d, 0x83, 1);
+		libusb_fill_control_setup(buf, req->type, 0, req->value,
+					  req->index, req->len);
+		if (CTRL_OUT == req->type)
+			memcpy(buf + LIBUSB_CONTROL_SETUP_SIZE, req->data,
+			       req->len);
+
+		libusb_fill_control_transfer(xfer, dev->devh, buf,
+					     _rtlsdr_batch_callback,
+					     (void *)req, CTRL_TIMEOUT);
+		xfer->flags = LIBUSB_TRANSFER_FREE_BUFFER;
+
+		rtlsdr_atomic_inc(&b->pending);
+		if (libusb_submit_transfer(xfer) < 0) {
+			rtlsdr_atomic_dec(&b->pending);
+			libusb_free_transfer(xfer);
+			break;
+		}
+	}
+
+	/* a single wait for everything submitted */
+	while (b->pending) {
+		r = libusb_handle_events_timeout_completed(dev->ctx, &tv,
+							   &b->completed);
+		if (r < 0 && r != LIBUSB_ERROR_INTERRUPTED) {
+			b->error = r;
+			break;
+		}
+	}
+
+	/* what could not be submitted goes out synchronously, in order */
+	for (; i < n; i++) {
+		req = &reqs[i];
+
+		r = libusb_control_transfer(dev->devh, req->type, 0,
+					    req->value, req->index, req->data,
+					    req->len, CTRL_TIMEOUT);
+		req->actual = r;
+		if (r < 0)
+			b->error = r;
+	}
+
+	return b->error;
 }
 
-int rtlsdr_deinit_baseband(rtlsdr_dev_t *dev)
+static int _rtlsdr_batch_flush(rtlsdr_dev_t *dev)
 {
-	int r = 0;
+	struct rtlsdr_batch *b = &dev->batch;
+	uint32_t n;
+	int r;
 
-	if (!dev)
-		return -1;
+	_rtlsdr_batch_close_run(dev);
 
-	if (dev->tuner && dev->tuner->exit) {
-		rtlsdr_set_i2c_repeater(dev, 1);
-		r = dev->tuner->exit(dev); /* deinitialize tuner */
-		rtlsdr_set_i2c_repeater(dev, 0);
+	n = b->nreq;
+	b->nreq = 0;
+	if (!n)
+		return 0;
+
+	r = _rtlsdr_ctrl_batch(dev, b->req, n);
+	if (r) {
+		fprintf(stderr, "%s failed with %d\n", __FUNCTION__, r);
+
+		/* the shadow assumed every queued write succeeded */
+		_rtlsdr_shadow_clear(dev);
 	}
 
-	/* poweroff demodulator and ADCs */
-	rtlsdr_write_reg(dev, SYSB, DEMOD_CTL, 0x20, 1);
+	return r;
+}
+
+static void _rtlsdr_batch_begin(rtlsdr_dev_t *dev)
+{
+	dev->batch.active = 1;
+	dev->batch.run = -1;
+	dev->batch.nreq = 0;
+}
+
+static int _rtlsdr_batch_end(rtlsdr_dev_t *dev)
+{
+	int r = _rtlsdr_batch_flush(dev);
+
+	dev->batch.active = 0;
 
 	return r;
 }
 
-int rtlsdr_set_if_freq(rtlsdr_dev_t *dev, uint32_t freq)
+/*
+ * Retune plan recording: while a plan is compiled every register write is
+ * appended to the hop being recorded, before the shadow gets a chance to
+ * skip it, so the hop can later be replayed from any state.
+ */
+static void _rtlsdr_plan_record(rtlsdr_dev_t *dev, uint8_t kind, uint8_t block,
+				uint16_t addr, uint16_t val,
+				const uint8_t *data, uint8_t len)
+{
+	struct rtlsdr_retune_plan *plan = dev->plan_rec;
+	struct rtlsdr_plan_hop *hop = &plan->hop[plan->count];
+	struct rtlsdr_plan_op *op;
+	void *tmp;
+
+	if (len > PLAN_OP_MAX_LEN) {
+		hop->complete = 0;
+		return;
+	}
+
+	if (plan->nops == plan->ops_size) {
+		tmp = realloc(plan->op, 2 * plan->ops_size * sizeof(*plan->op));
+		if (!tmp) {
+			hop->complete = 0;
+			return;
+		}
+		plan->op = tmp;
+		plan->ops_size *= 2;
+	}
+
+	op = &plan->op[plan->nops++];
+	op->kind = kind;
+	op->block = block;
+	op->addr = addr;
+	op->val = val;
+	op->len = len;
+	if (data)
+		memcpy(op->data, data, len);
+
+	hop->nops++;
+}
+
+int rtlsdr_read_array(rtlsdr_dev_t *dev, uint8_t block, uint16_t addr, uint8_t *array, uint8_t len)
+{
+	int r;
+	uint16_t index = (block << 8);
+
+	if (dev->batch.active)
+		_rtlsdr_batch_flush(dev);
+
+	r = _rtlsdr_ctrl_transfer(dev, CTRL_IN, addr, index, array, len);
+#if 0
+	if (r < 0)
+		fprintf(stderr, "%s failed with %d\n", __FUNCTION__, r);
+#endif
+	return r;
+}
+
+int rtlsdr_write_array(rtlsdr_dev_t *dev, uint8_t block, uint16_t addr, uint8_t *array, uint8_t len)
 {
-	uint32_t rtl_xtal;
-	int32_t if_freq;
-	uint8_t tmp;
 	int r;
+	uint16_t index = (block << 8) | 0x10;
+
+	if (dev->plan_rec)
+		_rtlsdr_plan_record(dev, PLAN_OP_ARRAY, block, addr, 0, array, len);
+
+	if (dev->batch.active) {
+		if (len <= BATCH_MAX_RUN) {
+			_rtlsdr_batch_write_reg(dev, addr, index, array, len);
+			return len;
+		}
+		_rtlsdr_batch_flush(dev);
+	}
+
+	r = _rtlsdr_ctrl_transfer(dev, CTRL_OUT, addr, index, array, len);
+#if 0
+	if (r < 0)
+		fprintf(stderr, "%s failed with %d\n", __FUNCTION__, r);
+#endif
+	return r;
+}
+
+int rtlsdr_i2c_write_reg(rtlsdr_dev_t *dev, uint8_t i2c_addr, uint8_t reg, uint8_t val)
+{
+	uint16_t addr = i2c_addr;
+	uint8_t data[2];
+
+	data[0] = reg;
+	data[1] = val;
+	return rtlsdr_write_array(dev, IICB, addr, (uint8_t *)&data, 2);
+}
+
+uint8_t rtlsdr_i2c_read_reg(rtlsdr_dev_t *dev, uint8_t i2c_addr, uint8_t reg)
+{
+	uint16_t addr = i2c_addr;
+	uint8_t data = 0;
+
+	rtlsdr_write_array(dev, IICB, addr, &reg, 1);
+	rtlsdr_read_array(dev, IICB, addr, &data, 1);
+
+	return data;
+}
+
+/* TODO clean this up again */
+int e4k_reg_write(struct e4k_state *e4k, uint8_t reg, uint8_t val)
+{
+	return rtlsdr_i2c_write_reg((rtlsdr_dev_t*)e4k->rtl_dev, e4k->i2c_addr, reg, val);}
+
+uint8_t e4k_reg_read(struct e4k_state *e4k, uint8_t reg)
+{
+	return rtlsdr_i2c_read_reg((rtlsdr_dev_t*)e4k->rtl_dev, e4k->i2c_addr, reg);
+}
+
+int rtlsdr_i2c_write(rtlsdr_dev_t *dev, uint8_t i2c_addr, uint8_t *buffer, int len)
+{
+	uint16_t addr = i2c_addr;
 
 	if (!dev)
 		return -1;
 
-	/* read corrected clock value */
-	if (rtlsdr_get_xtal_freq(dev, &rtl_xtal, NULL))
-		return -2;
+	return rtlsdr_write_array(dev, IICB, addr, buffer, len);
+}
 
-	if_freq = ((freq * TWO_POW(22)) / rtl_xtal) * (-1);
+int rtlsdr_i2c_read(rtlsdr_dev_t *dev, uint8_t i2c_addr, uint8_t *buffer, int len)
+{
+	uint16_t addr = i2c_addr;
 
-	tmp = (if_freq >> 16) & 0x3f;
-	r = rtlsdr_demod_write_reg(dev, 1, 0x19, tmp, 1);
-	tmp = (if_freq >> 8) & 0xff;
-	r |= rtlsdr_demod_write_reg(dev, 1, 0x1a, tmp, 1);
-	tmp = if_freq & 0xff;
-	r |= rtlsdr_demod_write_reg(dev, 1, 0x1b, tmp, 1);
+	if (!dev)
+		return -1;
+
+	return rtlsdr_read_array(dev, IICB, addr, buffer, len);
+}
+
+uint16_t rtlsdr_read_reg(rtlsdr_dev_t *dev, uint8_t block, uint16_t addr, uint8_t len)
+{
+	int r;
+	unsigned char data[2] = { 0, 0 };
+	uint16_t index = (block << 8);
+	uint16_t reg;
+	struct rtlsdr_reg_page *p = NULL;
+
+	if (!_rtlsdr_reg_volatile(block, addr))
+		p = _rtlsdr_shadow_block(dev, block, addr, len);
+
+	/* the shadow already reflects writes still queued in a batch */
+	if (_rtlsdr_shadow_load(p, addr & 0xff, data, len))
+		return (data[1] << 8) | data[0];
+
+	if (dev->batch.active)
+		_rtlsdr_batch_flush(dev);
+
+	r = _rtlsdr_ctrl_transfer(dev, CTRL_IN, addr, index, data, len);
+
+	if (r < 0)
+		fprintf(stderr, "%s failed with %d\n", __FUNCTION__, r);
+	else if (r == len)
+		_rtlsdr_shadow_store(p, addr & 0xff, data, len);
+
+	reg = (data[1] << 8) | data[0];
+
+	return reg;
+}
+
+int rtlsdr_write_reg(rtlsdr_dev_t *dev, uint8_t block, uint16_t addr, uint16_t val, uint8_t len)
+{
+	int r;
+	unsigned char data[2];
+	struct rtlsdr_reg_page *p;
+
+	uint16_t index = (block << 8) | 0x10;
+
+	if (len == 1)
+		data[0] = val & 0xff;
+	else
+		data[0] = val >> 8;
+
+	data[1] = val & 0xff;
+
+	if (dev->plan_rec)
+		_rtlsdr_plan_record(dev, PLAN_OP_REG, block, addr, val, NULL, len);
+
+	p = NULL;
+	if (!_rtlsdr_reg_volatile(block, addr))
+		p = _rtlsdr_shadow_block(dev, block, addr, len);
+
+	if (_rtlsdr_shadow_match(p, addr & 0xff, data, len))
+		return len;
+
+	if (dev->batch.active) {
+		_rtlsdr_batch_write_reg(dev, addr, index, data, len);
+		_rtlsdr_shadow_store(p, addr & 0xff, data, len);
+		return len;
+	}
+
+	r = _rtlsdr_ctrl_transfer(dev, CTRL_OUT, addr, index, data, len);
+
+	if (r < 0)
+		fprintf(stderr, "%s failed with %d\n", __FUNCTION__, r);
+
+	if (r == len)
+		_rtlsdr_shadow_store(p, addr & 0xff, data, len);
+	else
+		_rtlsdr_shadow_invalidate(p, addr & 0xff, len);
+
+	return r;
+}
+
+uint16_t rtlsdr_demod_read_reg(rtlsdr_dev_t *dev, uint8_t page, uint16_t addr, uint8_t len)
+{
+	int r;
+	unsigned char data[2] = { 0, 0 };
+	struct rtlsdr_reg_page *p;
+
+	uint16_t index = page;
+	uint16_t reg;
+
+	p = _rtlsdr_shadow_demod(dev, page, addr, len);
+	if (_rtlsdr_shadow_load(p, addr, data, len))
+		return (data[1] << 8) | data[0];
+
+	if (dev->batch.active)
+		_rtlsdr_batch_flush(dev);
+
+	r = _rtlsdr_ctrl_transfer(dev, CTRL_IN, (addr << 8) | 0x20, index, data, len);
+
+	if (r < 0)
+		fprintf(stderr, "%s failed with %d\n", __FUNCTION__, r);
+	else if (r == len)
+		_rtlsdr_shadow_store(p, addr, data, len);
+
+	reg = (data[1] << 8) | data[0];
+
+	return reg;
+}
+
+int rtlsdr_demod_write_reg(rtlsdr_dev_t *dev, uint8_t page, uint16_t addr, uint16_t val, uint8_t len)
+{
+	int r;
+	unsigned char data[2];
+	uint16_t index = 0x10 | page;
+	struct rtlsdr_reg_page *p;
+
+	if (len == 1)
+		data[0] = val & 0xff;
+	else
+		data[0] = val >> 8;
+
+	data[1] = val & 0xff;
+
+	if (dev->plan_rec)
+		_rtlsdr_plan_record(dev, PLAN_OP_DEMOD, page, addr, val, NULL, len);
+
+	/* unchanged, skip both the write and the read back */
+	p = _rtlsdr_shadow_demod(dev, page, addr, len);
+	if (_rtlsdr_shadow_match(p, addr, data, len))
+		return 0;
+
+	if (dev->batch.active) {
+		_rtlsdr_batch_demod_write_reg(dev, page, addr, data, len);
+		_rtlsdr_shadow_store(p, addr, data, len);
+		return 0;
+	}
+
+	r = _rtlsdr_ctrl_transfer(dev, CTRL_OUT, (addr << 8) | 0x20, index, data, len);
+
+	if (r < 0)
+		fprintf(stderr, "%s failed with %d\n", __FUNCTION__, r);
+
+	if (r == len)
+		_rtlsdr_shadow_store(p, addr, data, len);
+	else
+		_rtlsdr_shadow_invalidate(p, addr, len);
+
+	rtlsdr_demod_read_reg(dev, 0x0a, 0x01, 1);
+
+	return (r == len) ? 0 : -1;
+}
+
+void rtlsdr_set_gpio_bit(rtlsdr_dev_t *dev, uint8_t gpio, int val)
+{
+	uint8_t r;
+
+	gpio = 1 << gpio;
+	r = rtlsdr_read_reg(dev, SYSB, GPO, 1);
+	r = val ? (r | gpio) : (r & ~gpio);
+	rtlsdr_write_reg(dev, SYSB, GPO, r, 1);
+}
+
+void rtlsdr_set_gpio_output(rtlsdr_dev_t *dev, uint8_t gpio)
+{
+	int r;
+	gpio = 1 << gpio;
+
+	r = rtlsdr_read_reg(dev, SYSB, GPD, 1);
+	rtlsdr_write_reg(dev, SYSB, GPO, r & ~gpio, 1);
+	r = rtlsdr_read_reg(dev, SYSB, GPOE, 1);
+	rtlsdr_write_reg(dev, SYSB, GPOE, r | gpio, 1);
+}
+
+void rtlsdr_set_i2c_repeater(rtlsdr_dev_t *dev, int on)
+{
+	rtlsdr_demod_write_reg(dev, 1, 0x01, on ? 0x18 : 0x10, 1);
+}
+
+void rtlsdr_init_baseband(rtlsdr_dev_t *dev)
+{
+	unsigned int i;
+
+	/* default FIR coefficients used for DAB/FM by the Windows driver,
+	 * the DVB driver uses different ones */
+	uint8_t fir_coeff[] = {
+		0xca, 0xdc, 0xd7, 0xd8, 0xe0, 0xf2, 0x0e, 0x35, 0x06, 0x50,
+		0x9c, 0x0d, 0x71, 0x11, 0x14, 0x71, 0x74, 0x19, 0x41, 0xa5,
+	};
+
+	/* queue the whole sequence, adjacent demod writes are coalesced */
+	_rtlsdr_batch_begin(dev);
+
+	/* initialize USB */
+	rtlsdr_write_reg(dev, USBB, USB_SYSCTL, 0x09, 1);
+	rtlsdr_write_reg(dev, USBB, USB_EPA_MAXPKT, 0x0002, 2);
+	rtlsdr_write_reg(dev, USBB, USB_EPA_CTL, 0x1002, 2);
+
+	/* poweron demod */
+	rtlsdr_write_reg(dev, SYSB, DEMOD_CTL_1, 0x22, 1);
+	rtlsdr_write_reg(dev, SYSB, DEMOD_CTL, 0xe8, 1);
+
+	/* reset demod (bit 3, soft_rst) */
+	rtlsdr_demod_write_reg(dev, 1, 0x01, 0x14, 1);
+	rtlsdr_demod_write_reg(dev, 1, 0x01, 0x10, 1);
+
+	/* disable spectrum inversion and adjacent channel rejection */
+	rtlsdr_demod_write_reg(dev, 1, 0x15, 0x00, 1);
+	rtlsdr_demod_write_reg(dev, 1, 0x16, 0x0000, 2);
+
+	/* clear both DDC shift and IF frequency registers  */
+	for (i = 0; i < 6; i++)
+		rtlsdr_demod_write_reg(dev, 1, 0x16 + i, 0x00, 1);
+
+	/* set FIR coefficients */
+	for (i = 0; i < sizeof (fir_coeff); i++)
+		rtlsdr_demod_write_reg(dev, 1, 0x1c + i, fir_coeff[i], 1);
+
+	/* enable SDR mode, disable DAGC (bit 5) */
+	rtlsdr_demod_write_reg(dev, 0, 0x19, 0x05, 1);
+
+	/* init FSM state-holding register */
+	rtlsdr_demod_write_reg(dev, 1, 0x93, 0xf0, 1);
+	rtlsdr_demod_write_reg(dev, 1, 0x94, 0x0f, 1);
+
+	/* disable AGC (en_dagc, bit 0) (this seems to have no effect) */
+	rtlsdr_demod_write_reg(dev, 1, 0x11, 0x00, 1);
+
+	/* disable RF and IF AGC loop */
+	rtlsdr_demod_write_reg(dev, 1, 0x04, 0x00, 1);
+
+	/* disable PID filter (enable_PID = 0) */
+	rtlsdr_demod_write_reg(dev, 0, 0x61, 0x60, 1);
+
+	/* opt_adc_iq = 0, default ADC_I/ADC_Q datapath */
+	rtlsdr_demod_write_reg(dev, 0, 0x06, 0x80, 1);
+
+	/* Enable Zero-IF mode (en_bbin bit), DC cancellation (en_dc_est),
+	 * IQ estimation/compensation (en_iq_comp, en_iq_est) */
+	rtlsdr_demod_write_reg(dev, 1, 0xb1, 0x1b, 1);
+
+	/* disable 4.096 MHz clock output on pin TP_CK0 */
+	rtlsdr_demod_write_reg(dev, 0, 0x0d, 0x83, 1);
+
+	_rtlsdr_batch_end(dev);
+}
+
+int rtlsdr_deinit_baseband(rtlsdr_dev_t *dev)
+{
+	int r = 0;
+
+	if (!dev)
+		return -1;
+
+	if (dev->tuner && dev->tuner->exit) {
+		rtlsdr_set_i2c_repeater(dev, 1);
+		r = dev->tuner->exit(dev); /* deinitialize tuner */
+		rtlsdr_set_i2c_repeater(dev, 0);
+	}
+
+	/* poweroff demodulator and ADCs */
+	rtlsdr_write_reg(dev, SYSB, DEMOD_CTL, 0x20, 1);
+
+	return r;
+}
+
+int rtlsdr_set_if_freq(rtlsdr_dev_t *dev, uint32_t freq)
+{
+	uint32_t rtl_xtal;
+	int32_t if_freq;
+	uint8_t tmp;
+	int r;
+
+	if (!dev)
+		return -1;
+
+	/* read corrected clock value */
+	if (rtlsdr_get_xtal_freq(dev, &rtl_xtal, NULL))
+		return -2;
+
+	if_freq = ((freq * TWO_POW(22)) / rtl_xtal) * (-1);
+
+	tmp = (if_freq >> 16) & 0x3f;
+	r = rtlsdr_demod_write_reg(dev, 1, 0x19, tmp, 1);
+	tmp = (if_freq >> 8) & 0xff;
+	r |= rtlsdr_demod_write_reg(dev, 1, 0x1a, tmp, 1);
+	tmp = if_freq & 0xff;
+	r |= rtlsdr_demod_write_reg(dev, 1, 0x1b, tmp, 1);
+
+	return r;
+}
+
+int rtlsdr_set_sample_freq_correction(rtlsdr_dev_t *dev, int ppm)
+{
+	int r = 0;
+	uint8_t tmp;
+	int16_t offs = ppm * (-1) * TWO_POW(24) / 1000000;
+
+	tmp = offs & 0xff;
+	r |= rtlsdr_demod_write_reg(dev, 1, 0x3f, tmp, 1);
+	tmp = (offs >> 8) & 0x3f;
+	r |= rtlsdr_demod_write_reg(dev, 1, 0x3e, tmp, 1);
+
+	return r;
+}
+
+int rtlsdr_set_xtal_freq(rtlsdr_dev_t *dev, uint32_t rtl_freq, uint32_t tuner_freq)
+{
+	int r = 0;
+
+	if (!dev)
+		return -1;
+
+	if (rtl_freq > 0 &&
+		(rtl_freq < MIN_RTL_XTAL_FREQ || rtl_freq > MAX_RTL_XTAL_FREQ))
+		return -2;
+
+	dev->plan_gen++;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_SET_XTAL_FREQ);
+
+	if (rtl_freq > 0 && dev->rtl_xtal != rtl_freq) {
+		dev->rtl_xtal = rtl_freq;
+
+		/* update xtal-dependent settings */
+		if (dev->rate)
+			r = rtlsdr_set_sample_rate(dev, dev->rate);
+	}
+
+	if (dev->tun_xtal != tuner_freq) {
+		if (0 == tuner_freq)
+			dev->tun_xtal = dev->rtl_xtal;
+		else
+			dev->tun_xtal = tuner_freq;
+
+		/* read corrected clock value into e4k structure */
+		if (rtlsdr_get_xtal_freq(dev, NULL, &dev->e4k_s.vco.fosc))
+			r = -3;
+		else if (dev->freq) /* update xtal-dependent settings */
+			r = rtlsdr_set_center_freq(dev, dev->freq);
+	}
+
+	_rtlsdr_trace_leave(dev);
+
+	return r;
+}
+
+int rtlsdr_get_xtal_freq(rtlsdr_dev_t *dev, uint32_t *rtl_freq, uint32_t *tuner_freq)
+{
+	if (!dev)
+		return -1;
+
+	#define APPLY_PPM_CORR(val,ppm) (((val) * (1.0 + (ppm) / 1e6)))
+
+	if (rtl_freq)
+		*rtl_freq = (uint32_t) APPLY_PPM_CORR(dev->rtl_xtal, dev->corr);
+
+	if (tuner_freq)
+		*tuner_freq = (uint32_t) APPLY_PPM_CORR(dev->tun_xtal, dev->corr);
+
+	return 0;
+}
+
+int rtlsdr_get_usb_strings(rtlsdr_dev_t *dev, char *manufact, char *product,
+			    char *serial)
+{
+	struct libusb_device_descriptor dd;
+	libusb_device *device = NULL;
+	const int buf_max = 256;
+	int r = 0;
+
+	if (!dev || !dev->devh)
+		return -1;
+
+	device = libusb_get_device(dev->devh);
+
+	r = libusb_get_device_descriptor(device, &dd);
+	if (r < 0)
+		return -1;
+
+	if (manufact) {
+		memset(manufact, 0, buf_max);
+		libusb_get_string_descriptor_ascii(dev->devh, dd.iManufacturer,
+						   (unsigned char *)manufact,
+						   buf_max);
+	}
+
+	if (product) {
+		memset(product, 0, buf_max);
+		libusb_get_string_descriptor_ascii(dev->devh, dd.iProduct,
+						   (unsigned char *)product,
+						   buf_max);
+	}
+
+	if (serial) {
+		memset(serial, 0, buf_max);
+		libusb_get_string_descriptor_ascii(dev->devh, dd.iSerialNumber,
+						   (unsigned char *)serial,
+						   buf_max);
+	}
+
+	return 0;
+}
+
+int rtlsdr_write_eeprom(rtlsdr_dev_t *dev, uint8_t *data, uint8_t offset, uint16_t len)
+{
+	int r = 0;
+	int i;
+	uint8_t cmd[2];
+
+	if (!dev)
+		return -1;
+
+	if ((len + offset) > 256)
+		return -2;
+
+	for (i = 0; i < len; i++) {
+		cmd[0] = i + offset;
+		r = rtlsdr_write_array(dev, IICB, EEPROM_ADDR, cmd, 1);
+		r = rtlsdr_read_array(dev, IICB, EEPROM_ADDR, &cmd[1], 1);
+
+		/* only write the byte if it differs */
+		if (cmd[1] == data[i])
+			continue;
+
+		cmd[1] = data[i];
+		r = rtlsdr_write_array(dev, IICB, EEPROM_ADDR, cmd, 2);
+		if (r != sizeof(cmd))
+			return -3;
+
+		/* for some EEPROMs (e.g. ATC 240LC02) we need a delay
+		 * between write operations, otherwise they will fail */
+#ifdef _WIN32
+		Sleep(5);
+#else
+		usleep(5000);
+#endif
+	}
+
+	return 0;
+}
+
+int rtlsdr_read_eeprom(rtlsdr_dev_t *dev, uint8_t *data, uint8_t offset, uint16_t len)
+{
+	int r = 0;
+	int i;
+
+	if (!dev)
+		return -1;
+
+	if ((len + offset) > 256)
+		return -2;
+
+	r = rtlsdr_write_array(dev, IICB, EEPROM_ADDR, &offset, 1);
+	if (r < 0)
+		return -3;
+
+	for (i = 0; i < len; i++) {
+		r = rtlsdr_read_array(dev, IICB, EEPROM_ADDR, data + i, 1);
+
+		if (r < 0)
+			return -3;
+	}
+
+	return r;
+}
+
+/* tuners whose PLL lock state can be read back */
+static int _rtlsdr_tuner_has_lock(rtlsdr_dev_t *dev)
+{
+	if (dev->replay)
+		return 1;
+
+	if (dev->direct_sampling)
+		return 0;
+
+	return dev->tuner_type == RTLSDR_TUNER_E4000 ||
+	       dev->tuner_type == RTLSDR_TUNER_R820T;
+}
+
+/* needs the I2C repeater enabled */
+static int _rtlsdr_tuner_locked(rtlsdr_dev_t *dev)
+{
+	int locked = dev->replay != NULL; /* settles at once */
+
+	switch (dev->tuner_type) {
+	case RTLSDR_TUNER_E4000:
+		locked = e4k_reg_read(&dev->e4k_s, E4K_REG_SYNTH1) & 0x01;
+		break;
+	case RTLSDR_TUNER_R820T:
+		if (R828_GetLockStatus(&dev->r820t_s, &locked) != RT_Success)
+			locked = 0;
+		break;
+	default:
+		break;
+	}
+
+	return locked;
+}
+
+/*
+ * Retune tagging: from the start of a retune every sample counts as
+ * unsettled, until the tuner settles. The event thread then maps the time
+ * it settled onto the sample counter of the stream, see _rtlsdr_tune_tag().
+ */
+static void _rtlsdr_tune_begin(rtlsdr_dev_t *dev, uint32_t freq)
+{
+	pthread_mutex_lock(&dev->tune_lock);
+	dev->tune_freq = freq;
+	dev->tune_settle_us = 0;
+	dev->tune_pending = 1;
+	pthread_mutex_unlock(&dev->tune_lock);
+}
+
+static void _rtlsdr_tune_end(rtlsdr_dev_t *dev, uint32_t settle_us)
+{
+	uint64_t now = _rtlsdr_now_us();
+
+	pthread_mutex_lock(&dev->tune_lock);
+	dev->tune_settle_us = now + settle_us;
+	pthread_mutex_unlock(&dev->tune_lock);
+}
+
+int rtlsdr_set_center_freq(rtlsdr_dev_t *dev, uint32_t freq)
+{
+	int r = -1;
+
+	if (!dev || !dev->tuner)
+		return -1;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_SET_CENTER_FREQ);
+	_rtlsdr_tune_begin(dev, freq);
+
+	if (dev->direct_sampling) {
+		r = rtlsdr_set_if_freq(dev, freq);
+	} else if (dev->tuner && dev->tuner->set_freq) {
+		rtlsdr_set_i2c_repeater(dev, 1);
+		r = dev->tuner->set_freq(dev, freq - dev->offs_freq);
+		rtlsdr_set_i2c_repeater(dev, 0);
+	}
+
+	/* the E4K and R820T drivers fail unless their PLL locked */
+	_rtlsdr_tune_end(dev, (dev->direct_sampling ||
+			       _rtlsdr_tuner_has_lock(dev)) ? 0 : TUNE_SETTLE_US);
+
+	if (!r)
+		dev->freq = freq;
+	else
+		dev->freq = 0;
+
+	_rtlsdr_trace_leave(dev);
+
+	return r;
+}
+
+uint32_t rtlsdr_get_center_freq(rtlsdr_dev_t *dev)
+{
+	if (!dev)
+		return 0;
+
+	return dev->freq;
+}
+
+/* tuner driver state a recorded hop has to bring back */
+static void *_rtlsdr_tuner_state(rtlsdr_dev_t *dev, size_t *len)
+{
+	switch (dev->tuner_type) {
+	case RTLSDR_TUNER_E4000:
+		*len = sizeof(dev->e4k_s);
+		return &dev->e4k_s;
+	case RTLSDR_TUNER_R820T:
+		*len = sizeof(dev->r820t_s);
+		return &dev->r820t_s;
+	default:
+		*len = 0;
+		return NULL;
+	}
+}
+
+/* record the writes of one hop by tuning there */
+static int _rtlsdr_plan_record_hop(rtlsdr_dev_t *dev,
+				   struct rtlsdr_retune_plan *plan,
+				   uint32_t freq)
+{
+	struct rtlsdr_plan_hop *hop = &plan->hop[plan->count];
+	size_t len;
+	void *state;
+	int r;
+
+	hop->freq = freq;
+	hop->first_op = plan->nops;
+	hop->nops = 0;
+	hop->complete = 1;
+
+	/* make the drivers emit every write, not just what changed since
+	 * the previous hop */
+	dev->r820t_s.R828_Chip_Valid = 0;
+	dev->e4k_s.write_all = 1;
+
+	dev->plan_rec = plan;
+	r = rtlsdr_set_center_freq(dev, freq);
+	dev->plan_rec = NULL;
+
+	dev->e4k_s.write_all = 0;
+
+	state = _rtlsdr_tuner_state(dev, &len);
+	if (state)
+		memcpy(plan->state + plan->count * len, state, len);
+
+	return r;
+}
+
+int rtlsdr_retune_plan_create(rtlsdr_dev_t *dev,
+			      rtlsdr_retune_plan_t **out_plan,
+			      const uint32_t *freqs, uint32_t count)
+{
+	struct rtlsdr_retune_plan *plan;
+	uint32_t freq;
+	uint32_t i;
+	int r = 0;
+
+	if (!dev || !dev->tuner || !out_plan || !freqs || !count)
+		return -1;
+
+	plan = calloc(1, sizeof(struct rtlsdr_retune_plan));
+	if (!plan)
+		return -ENOMEM;
+
+	plan->dev = dev;
+	plan->ops_size = 16 * count;
+	plan->hop = calloc(count, sizeof(*plan->hop));
+	plan->op = malloc(plan->ops_size * sizeof(*plan->op));
+	_rtlsdr_tuner_state(dev, &plan->state_len);
+	plan->state = malloc(plan->state_len * count + 1);
+
+	if (!plan->hop || !plan->op || !plan->state) {
+		rtlsdr_retune_plan_destroy(plan);
+		return -ENOMEM;
+	}
+
+	freq = dev->freq;
+	plan->gen = dev->plan_gen;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_PLAN_CREATE);
+
+	for (i = 0; i < count; i++) {
+		r = _rtlsdr_plan_record_hop(dev, plan, freqs[i]);
+		if (r)
+			break;
+
+		plan->count++;
+	}
+
+	/* go back where we were */
+	if (freq)
+		rtlsdr_set_center_freq(dev, freq);
+
+	_rtlsdr_trace_leave(dev);
+
+	if (r) {
+		rtlsdr_retune_plan_destroy(plan);
+		return r;
+	}
+
+	*out_plan = plan;
+
+	return 0;
+}
+
+/* write only the R820T registers the chip does not hold already */
+static int _rtlsdr_plan_write_r820t(rtlsdr_dev_t *dev,
+				    struct rtlsdr_plan_op *op)
+{
+	struct r820t_state *priv = &dev->r820t_s;
+	uint8_t first = op->data[0];
+	uint8_t buf[PLAN_OP_MAX_LEN];
+	int start, end, i, idx;
+
+	for (start = 1, end = op->len; start < end; start++) {
+		idx = first + start - 1 - R828_REG_BASE;
+		if (idx < 0 || idx >= R828_REG_NUM ||
+		    !(priv->R828_Chip_Valid & (1 << idx)) ||
+		    priv->R828_Chip[idx] != op->data[start])
+			break;
+	}
+
+	for (; end > start; end--) {
+		idx = first + end - 2 - R828_REG_BASE;
+		if (idx < 0 || idx >= R828_REG_NUM ||
+		    !(priv->R828_Chip_Valid & (1 << idx)) ||
+		    priv->R828_Chip[idx] != op->data[end - 1])
+			break;
+	}
+
+	if (start == end)
+		return 0;
+
+	buf[0] = first + start - 1;
+	memcpy(buf + 1, op->data + start, end - start);
+
+	for (i = start; i < end; i++) {
+		idx = first + i - 1 - R828_REG_BASE;
+		if (idx >= 0 && idx < R828_REG_NUM) {
+			priv->R828_Chip[idx] = op->data[i];
+			priv->R828_Chip_Valid |= 1 << idx;
+		}
+	}
+
+	return rtlsdr_write_array(dev, op->block, op->addr, buf,
+				  end - start + 1);
+}
+
+static int _rtlsdr_plan_apply(rtlsdr_dev_t *dev, rtlsdr_retune_plan_t *plan,
+			      uint32_t index)
+{
+	struct rtlsdr_plan_hop *hop;
+	struct rtlsdr_plan_op *op;
+	size_t len;
+	void *state;
+	uint32_t i;
+	int locked;
+	int r;
+
+	hop = &plan->hop[index];
+
+	/* recorded under different settings, tune the slow way */
+	if (plan->gen != dev->plan_gen || !hop->complete)
+		return rtlsdr_set_center_freq(dev, hop->freq);
+
+	_rtlsdr_tune_begin(dev, hop->freq);
+	_rtlsdr_batch_begin(dev);
+
+	for (i = 0; i < hop->nops; i++) {
+		op = &plan->op[hop->first_op + i];
+
+		switch (op->kind) {
+		case PLAN_OP_ARRAY:
+			/* I2C register pointer for a read, nothing to replay */
+			if (op->block == IICB && op->len < 2)
+				break;
+
+			if (dev->tuner_type == RTLSDR_TUNER_R820T &&
+			    op->block == IICB && op->addr == R820T_I2C_ADDR)
+				_rtlsdr_plan_write_r820t(dev, op);
+			else
+				rtlsdr_write_array(dev, op->block, op->addr,
+						   op->data, op->len);
+			break;
+		case PLAN_OP_REG:
+			rtlsdr_write_reg(dev, op->block, op->addr, op->val,
+					 op->len);
+			break;
+		case PLAN_OP_DEMOD:
+			rtlsdr_demod_write_reg(dev, op->block, op->addr,
+					       op->val, op->len);
+			break;
+		}
+	}
+
+	r = _rtlsdr_batch_end(dev);
+
+	state = _rtlsdr_tuner_state(dev, &len);
+	if (state)
+		memcpy(state, plan->state + index * len, len);
+
+	if (r) {
+		/* whatever the tuner holds now is unknown */
+		dev->r820t_s.R828_Chip_Valid = 0;
+		dev->freq = 0;
+		_rtlsdr_tune_end(dev, 0);
+		return r;
+	}
+
+	/* nothing was read back so far, wait for the PLL here */
+	if (_rtlsdr_tuner_has_lock(dev)) {
+		rtlsdr_set_i2c_repeater(dev, 1);
+		for (i = 0, locked = 0; i < TUNE_LOCK_POLLS && !locked; i++)
+			locked = _rtlsdr_tuner_locked(dev);
+		rtlsdr_set_i2c_repeater(dev, 0);
+
+		/* let the driver sort it out */
+		if (!locked)
+			return rtlsdr_set_center_freq(dev, hop->freq);
+	}
+
+	_rtlsdr_tune_end(dev, _rtlsdr_tuner_has_lock(dev) ||
+			      dev->direct_sampling ? 0 : TUNE_SETTLE_US);
+
+	dev->freq = hop->freq;
+
+	return 0;
+}
+
+int rtlsdr_retune_plan_apply(rtlsdr_dev_t *dev, rtlsdr_retune_plan_t *plan,
+			     uint32_t index)
+{
+	int r;
+
+	if (!dev || !plan || plan->dev != dev || index >= plan->count)
+		return -1;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_PLAN_APPLY);
+	r = _rtlsdr_plan_apply(dev, plan, index);
+	_rtlsdr_trace_leave(dev);
+
+	return r;
+}
+
+int rtlsdr_retune_plan_destroy(rtlsdr_retune_plan_t *plan)
+{
+	if (!plan)
+		return -1;
+
+	free(plan->hop);
+	free(plan->op);
+	free(plan->state);
+	free(plan);
+
+	return 0;
+}
+
+int rtlsdr_set_freq_correction(rtlsdr_dev_t *dev, int ppm)
+{
+	int r = 0;
+
+	if (!dev)
+		return -1;
+
+	if (dev->corr == ppm)
+		return -2;
+
+	dev->corr = ppm;
+	dev->plan_gen++;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_SET_FREQ_CORRECTION);
+
+	r |= rtlsdr_set_sample_freq_correction(dev, ppm);
+
+	/* read corrected clock value into e4k structure */
+	if (rtlsdr_get_xtal_freq(dev, NULL, &dev->e4k_s.vco.fosc))
+		r = -3;
+	else if (dev->freq) /* retune to apply new correction value */
+		r |= rtlsdr_set_center_freq(dev, dev->freq);
+
+	_rtlsdr_trace_leave(dev);
+
+	return r;
+}
+
+int rtlsdr_get_freq_correction(rtlsdr_dev_t *dev)
+{
+	if (!dev)
+		return 0;
+
+	return dev->corr;
+}
+
+enum rtlsdr_tuner rtlsdr_get_tuner_type(rtlsdr_dev_t *dev)
+{
+	if (!dev)
+		return RTLSDR_TUNER_UNKNOWN;
+
+	return dev->tuner_type;
+}
+
+int rtlsdr_get_tuner_gains(rtlsdr_dev_t *dev, int *gains)
+{
+	/* all gain values are expressed in tenths of a dB */
+	const int e4k_gains[] = { -10, 15, 40, 65, 90, 115, 140, 165, 190, 215,
+				  240, 290, 340, 420 };
+	const int fc0012_gains[] = { -99, -40, 71, 179, 192 };
+	const int fc0013_gains[] = { -99, -73, -65, -63, -60, -58, -54, 58, 61,
+				       63, 65, 67, 68, 70, 71, 179, 181, 182,
+				       184, 186, 188, 191, 197 };
+	const int fc2580_gains[] = { 0 /* no gain values */ };
+	const int r820t_gains[] = { 0, 9, 14, 27, 37, 77, 87, 125, 144, 157,
+				     166, 197, 207, 229, 254, 280, 297, 328,
+				     338, 364, 372, 386, 402, 421, 434, 439,
+				     445, 480, 496 };
+	const int unknown_gains[] = { 0 /* no gain values */ };
+
+	int *ptr = NULL;
+	int len = 0;
+
+	if (!dev)
+		return -1;
+
+	switch (dev->tuner_type) {
+	case RTLSDR_TUNER_E4000:
+		ptr = (int *)e4k_gains; len = sizeof(e4k_gains);
+		break;
+	case RTLSDR_TUNER_FC0012:
+		ptr = (int *)fc0012_gains; len = sizeof(fc0012_gains);
+		break;
+	case RTLSDR_TUNER_FC0013:
+		ptr = (int *)fc0013_gains; len = sizeof(fc0013_gains);
+		break;
+	case RTLSDR_TUNER_FC2580:
+		ptr = (int *)fc2580_gains; len = sizeof(fc2580_gains);
+		break;
+	case RTLSDR_TUNER_R820T:
+		ptr = (int *)r820t_gains; len = sizeof(r820t_gains);
+		break;
+	default:
+		ptr = (int *)unknown_gains; len = sizeof(unknown_gains);
+		break;
+	}
+
+	if (!gains) { /* no buffer provided, just return the count */
+		return len / sizeof(int);
+	} else {
+		if (len)
+			memcpy(gains, ptr, len);
+
+		return len / sizeof(int);
+	}
+}
+
+int rtlsdr_set_tuner_gain(rtlsdr_dev_t *dev, int gain)
+{
+	int r = 0;
+
+	if (!dev || !dev->tuner)
+		return -1;
+
+	dev->plan_gen++;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_SET_TUNER_GAIN);
+
+	if (dev->tuner->set_gain) {
+		rtlsdr_set_i2c_repeater(dev, 1);
+		r = dev->tuner->set_gain((void *)dev, gain);
+		rtlsdr_set_i2c_repeater(dev, 0);
+	}
+
+	_rtlsdr_trace_leave(dev);
+
+	if (!r)
+		dev->gain = gain;
+	else
+		dev->gain = 0;
+
+	return r;
+}
+
+int rtlsdr_get_tuner_gain(rtlsdr_dev_t *dev)
+{
+	if (!dev)
+		return 0;
+
+	return dev->gain;
+}
+
+int rtlsdr_set_tuner_if_gain(rtlsdr_dev_t *dev, int stage, int gain)
+{
+	int r = 0;
+
+	if (!dev || !dev->tuner)
+		return -1;
+
+	dev->plan_gen++;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_SET_TUNER_IF_GAIN);
+
+	if (dev->tuner->set_if_gain) {
+		rtlsdr_set_i2c_repeater(dev, 1);
+		r = dev->tuner->set_if_gain(dev, stage, gain);
+		rtlsdr_set_i2c_repeater(dev, 0);
+	}
+
+	_rtlsdr_trace_leave(dev);
+
+	return r;
+}
+
+int rtlsdr_set_tuner_gain_mode(rtlsdr_dev_t *dev, int mode)
+{
+	int r = 0;
+
+	if (!dev || !dev->tuner)
+		return -1;
+
+	dev->plan_gen++;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_SET_TUNER_GAIN_MODE);
+
+	if (dev->tuner->set_gain_mode) {
+		rtlsdr_set_i2c_repeater(dev, 1);
+		r = dev->tuner->set_gain_mode((void *)dev, mode);
+		rtlsdr_set_i2c_repeater(dev, 0);
+	}
+
+	_rtlsdr_trace_leave(dev);
+
+	return r;
+}
+
+int rtlsdr_set_sample_rate(rtlsdr_dev_t *dev, uint32_t samp_rate)
+{
+	int r = 0;
+	uint16_t tmp;
+	uint32_t rsamp_ratio;
+	double real_rate;
+	uint32_t rtl_freq = dev->rtl_xtal;
+
+	if (!dev)
+		return -1;
+
+	/* check for the maximum rate the resampler supports */
+	if (samp_rate > MAX_SAMP_RATE)
+		samp_rate = MAX_SAMP_RATE;
+
+	dev->plan_gen++;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_SET_SAMPLE_RATE);
+
+	rsamp_ratio = (rtl_freq * TWO_POW(22)) / samp_rate;
+	rsamp_ratio &= ~3;
+
+	real_rate = (rtl_freq * TWO_POW(22)) / rsamp_ratio;
+
+	if ( ((double)samp_rate) != real_rate )
+		fprintf(stderr, "Exact sample rate is: %f Hz\n", real_rate);
+
+	if (dev->tuner && dev->tuner->set_bw) {
+		rtlsdr_set_i2c_repeater(dev, 1);
+		dev->tuner->set_bw(dev, (int)real_rate);
+		rtlsdr_set_i2c_repeater(dev, 0);
+	}
+
+	dev->rate = (uint32_t)real_rate;
+
+	tmp = (rsamp_ratio >> 16);
+	r |= rtlsdr_demod_write_reg(dev, 1, 0x9f, tmp, 2);
+	tmp = rsamp_ratio & 0xffff;
+	r |= rtlsdr_demod_write_reg(dev, 1, 0xa1, tmp, 2);
+
+	r |= rtlsdr_set_sample_freq_correction(dev, dev->corr);
+
+	/* reset demod (bit 3, soft_rst) */
+	r |= rtlsdr_demod_write_reg(dev, 1, 0x01, 0x14, 1);
+	r |= rtlsdr_demod_write_reg(dev, 1, 0x01, 0x10, 1);
+
+	/* recalculate offset frequency if offset tuning is enabled */
+	if (dev->offs_freq)
+		rtlsdr_set_offset_tuning(dev, 1);
+
+	_rtlsdr_trace_leave(dev);
+
+	return r;
+}
+
+uint32_t rtlsdr_get_sample_rate(rtlsdr_dev_t *dev)
+{
+	if (!dev)
+		return 0;
+
+	return dev->rate;
+}
+
+int rtlsdr_set_testmode(rtlsdr_dev_t *dev, int on)
+{
+	int r;
+
+	if (!dev)
+		return -1;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_SET_TESTMODE);
+	r = rtlsdr_demod_write_reg(dev, 0, 0x19, on ? 0x03 : 0x05, 1);
+	_rtlsdr_trace_leave(dev);
+
+	return r;
+}
+
+int rtlsdr_set_agc_mode(rtlsdr_dev_t *dev, int on)
+{
+	int r;
+
+	if (!dev)
+		return -1;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_SET_AGC_MODE);
+	r = rtlsdr_demod_write_reg(dev, 0, 0x19, on ? 0x25 : 0x05, 1);
+	_rtlsdr_trace_leave(dev);
+
+	return r;
+}
+
+int rtlsdr_set_direct_sampling(rtlsdr_dev_t *dev, int on)
+{
+	int r = 0;
+
+	if (!dev)
+		return -1;
+
+	dev->plan_gen++;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_SET_DIRECT_SAMPLING);
+
+	if (on) {
+		if (dev->tuner && dev->tuner->exit) {
+			rtlsdr_set_i2c_repeater(dev, 1);
+			r = dev->tuner->exit(dev);
+			rtlsdr_set_i2c_repeater(dev, 0);
+		}
+
+		/* disable Zero-IF mode */
+		r |= rtlsdr_demod_write_reg(dev, 1, 0xb1, 0x1a, 1);
+
+		/* disable spectrum inversion */
+		r |= rtlsdr_demod_write_reg(dev, 1, 0x15, 0x00, 1);
+
+		/* only enable In-phase ADC input */
+		r |= rtlsdr_demod_write_reg(dev, 0, 0x08, 0x4d, 1);
+
+		/* swap I and Q ADC, this allows to select between two inputs */
+		r |= rtlsdr_demod_write_reg(dev, 0, 0x06, (on > 1) ? 0x90 : 0x80, 1);
+
+		fprintf(stderr, "Enabled direct sampling mode, input %i\n", on);
+		dev->direct_sampling = on;
+	} else {
+		if (dev->tuner && dev->tuner->init) {
+			rtlsdr_set_i2c_repeater(dev, 1);
+			r |= dev->tuner->init(dev);
+			rtlsdr_set_i2c_repeater(dev, 0);
+		}
+
+		if (dev->tuner_type == RTLSDR_TUNER_R820T) {
+			r |= rtlsdr_set_if_freq(dev, R820T_IF_FREQ);
+
+			/* enable spectrum inversion */
+			r |= rtlsdr_demod_write_reg(dev, 1, 0x15, 0x01, 1);
+		} else {
+			r |= rtlsdr_set_if_freq(dev, 0);
+
+			/* enable In-phase + Quadrature ADC input */
+			r |= rtlsdr_demod_write_reg(dev, 0, 0x08, 0xcd, 1);
+
+			/* Enable Zero-IF mode */
+			r |= rtlsdr_demod_write_reg(dev, 1, 0xb1, 0x1b, 1);
+		}
+
+		/* opt_adc_iq = 0, default ADC_I/ADC_Q datapath */
+		r |= rtlsdr_demod_write_reg(dev, 0, 0x06, 0x80, 1);
+
+		fprintf(stderr, "Disabled direct sampling mode\n");
+		dev->direct_sampling = 0;
+	}
+
+	r |= rtlsdr_set_center_freq(dev, dev->freq);
+
+	_rtlsdr_trace_leave(dev);
+
+	return r;
+}
+
+int rtlsdr_get_direct_sampling(rtlsdr_dev_t *dev)
+{
+	if (!dev)
+		return -1;
+
+	return dev->direct_sampling;
+}
+
+int rtlsdr_set_offset_tuning(rtlsdr_dev_t *dev, int on)
+{
+	int r = 0;
+
+	if (!dev)
+		return -1;
+
+	if (dev->tuner_type == RTLSDR_TUNER_R820T)
+		return -2;
+
+	if (dev->direct_sampling)
+		return -3;
+
+	dev->plan_gen++;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_SET_OFFSET_TUNING);
+
+	/* based on keenerds 1/f noise measurements */
+	dev->offs_freq = on ? ((dev->rate / 2) * 170 / 100) : 0;
+	r |= rtlsdr_set_if_freq(dev, dev->offs_freq);
+
+	if (dev->tuner && dev->tuner->set_bw) {
+		rtlsdr_set_i2c_repeater(dev, 1);
+		dev->tuner->set_bw(dev, on ? (2 * dev->offs_freq) : dev->rate);
+		rtlsdr_set_i2c_repeater(dev, 0);
+	}
+
+	if (dev->freq > dev->offs_freq)
+		r |= rtlsdr_set_center_freq(dev, dev->freq);
+
+	_rtlsdr_trace_leave(dev);
+
+	return r;
+}
+
+int rtlsdr_get_offset_tuning(rtlsdr_dev_t *dev)
+{
+	if (!dev)
+		return -1;
+
+	return (dev->offs_freq) ? 1 : 0;
+}
+
+static rtlsdr_dongle_t *find_known_device(uint16_t vid, uint16_t pid)
+{
+	unsigned int i;
+	rtlsdr_dongle_t *device = NULL;
+
+	for (i = 0; i < sizeof(known_devices)/sizeof(rtlsdr_dongle_t); i++ ) {
+		if (known_devices[i].vid == vid && known_devices[i].pid == pid) {
+			device = &known_devices[i];
+			break;
+		}
+	}
+
+	return device;
+}
+
+/* enumeration cache, shared by all device queries of the process */
+struct rtlsdr_enum_entry {
+	libusb_device *device;
+	rtlsdr_dongle_t *known;
+	int has_strings;
+	char manufact[256];
+	char product[256];
+	char serial[256];
+};
+
+static struct rtlsdr_enum {
+	pthread_mutex_t lock;
+	libusb_context *ctx;
+	int hotplug; /* the cache is refreshed by hotplug events */
+	volatile int dirty;
+	uint64_t stamp; /* us, time of the last scan */
+	struct rtlsdr_enum_entry *entry;
+	uint32_t count;
+} rtlsdr_enum = { PTHREAD_MUTEX_INITIALIZER, NULL, 0, 1, 0, NULL, 0 };
+
+#ifdef LIBUSB_HOTPLUG_MATCH_ANY
+static int LIBUSB_CALL _rtlsdr_enum_hotplug(libusb_context *ctx,
+					    libusb_device *device,
+					    libusb_hotplug_event event,
+					    void *user_data)
+{
+	rtlsdr_enum.dirty = 1;
+
+	return 0; /* stay registered */
+}
+#endif
+
+static void _rtlsdr_enum_clear(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < rtlsdr_enum.count; i++)
+		libusb_unref_device(rtlsdr_enum.entry[i].device);
+
+	free(rtlsdr_enum.entry);
+	rtlsdr_enum.entry = NULL;
+	rtlsdr_enum.count = 0;
+}
+
+/* bring the cache up to date, called with the enumeration lock held */
+static int _rtlsdr_enum_update(void)
+{
+	int i;
+	libusb_device **list;
+	struct libusb_device_descriptor dd;
+	rtlsdr_dongle_t *known;
+	struct rtlsdr_enum_entry *e;
+	struct timeval tv = { 0, 0 };
+	ssize_t cnt;
+
+	if (!rtlsdr_enum.ctx) {
+		if (libusb_init(&rtlsdr_enum.ctx) < 0) {
+			rtlsdr_enum.ctx = NULL;
+			return -1;
+		}
+
+#ifdef LIBUSB_HOTPLUG_MATCH_ANY
+		if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG) &&
+		    LIBUSB_SUCCESS == libusb_hotplug_register_callback(
+				rtlsdr_enum.ctx,
+				LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED |
+				LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT,
+				LIBUSB_HOTPLUG_NO_FLAGS,
+				LIBUSB_HOTPLUG_MATCH_ANY,
+				LIBUSB_HOTPLUG_MATCH_ANY,
+				LIBUSB_HOTPLUG_MATCH_ANY,
+				_rtlsdr_enum_hotplug, NULL, NULL))
+			rtlsdr_enum.hotplug = 1;
+#endif
+	}
+
+	if (rtlsdr_enum.hotplug) {
+		/* deliver pending hotplug events without blocking */
+		libusb_handle_events_timeout(rtlsdr_enum.ctx, &tv);
+	} else if (_rtlsdr_now_us() - rtlsdr_enum.stamp >
+		   ENUM_CACHE_TIMEOUT * 1000) {
+		/* no notifications, so only trust a recent scan */
+		rtlsdr_enum.dirty = 1;
+	}
+
+	if (!rtlsdr_enum.dirty)
+		return 0;
+
+	/* cleared first, an event arriving during the scan triggers another */
+	rtlsdr_enum.dirty = 0;
+
+	_rtlsdr_enum_clear();
+
+	cnt = libusb_get_device_list(rtlsdr_enum.ctx, &list);
+	if (cnt < 0) {
+		rtlsdr_enum.dirty = 1;
+		return -1;
+	}
+
+	rtlsdr_enum.entry = calloc(cnt ? cnt : 1,
+				   sizeof(struct rtlsdr_enum_entry));
+	if (!rtlsdr_enum.entry) {
+		libusb_free_device_list(list, 1);
+		rtlsdr_enum.dirty = 1;
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		libusb_get_device_descriptor(list[i], &dd);
+
+		known = find_known_device(dd.idVendor, dd.idProduct);
+		if (!known)
+			continue;
+
+		e = &rtlsdr_enum.entry[rtlsdr_enum.count++];
+		e->device = libusb_ref_device(list[i]);
+		e->known = known;
+	}
+
+	libusb_free_device_list(list, 1);
+
+	rtlsdr_enum.stamp = _rtlsdr_now_us();
+
+	return 0;
+}
+
+/* fetch the usb strings of a cached device, opening it on first use */
+static int _rtlsdr_enum_strings(struct rtlsdr_enum_entry *e)
+{
+	int r;
+	rtlsdr_dev_t devt;
+
+	if (e->has_strings)
+		return 0;
+
+	r = libusb_open(e->device, &devt.devh);
+	if (r)
+		return r;
+
+	r = rtlsdr_get_usb_strings(&devt, e->manufact, e->product, e->serial);
+	libusb_close(devt.devh);
+
+	if (!r)
+		e->has_strings = 1;
+
+	return r;
+}
+
+/*
+ * RTLSDR_REPLAY names a capture file offered as an extra device, options
+ * are appended with commas: "capture.bin,fast,loop"
+ */
+static int _rtlsdr_replay_env(char *path, size_t len, int *flags)
+{
+	const char *env = getenv(REPLAY_ENV);
+	char *opt;
+
+	if (!env || !*env || strlen(env) >= len)
+		return 0;
+
+	strcpy(path, env);
+	*flags = 0;
+
+	while ((opt = strrchr(path, ','))) {
+		if (!strcmp(opt + 1, "fast"))
+			*flags |= RTLSDR_REPLAY_UNTHROTTLED;
+		else if (!strcmp(opt + 1, "loop"))
+			*flags |= RTLSDR_REPLAY_LOOP;
+		else if (strcmp(opt + 1, "realtime"))
+			break; /* part of the file name */
+
+		*opt = '\0';
+	}
+
+	return 1;
+}
+
+static const char *rtlsdr_sim_tuners[] = {
+	"none", "e4000", "fc0012", "fc0013", "fc2580", "r820t"
+};
+
+/*
+ * RTLSDR_SIM offers the register model as an extra device, the tuner on its
+ * bus and optionally a latency per round trip in us: "r820t,125"
+ */
+static int _rtlsdr_sim_env(enum rtlsdr_tuner *tuner, uint32_t *latency_us)
+{
+	const char *env = getenv(SIM_ENV);
+	const char *opt;
+	size_t len;
+	unsigned i, n = sizeof(rtlsdr_sim_tuners) / sizeof(rtlsdr_sim_tuners[0]);
+
+	if (!env || !*env)
+		return 0;
+
+	opt = strchr(env, ',');
+	len = opt ? (size_t)(opt - env) : strlen(env);
+
+	for (i = 0; i < n; i++) {
+		if (strlen(rtlsdr_sim_tuners[i]) == len &&
+		    !strncmp(env, rtlsdr_sim_tuners[i], len))
+			break;
+	}
+
+	if (i == n)
+		return 0;
+
+	*tuner = (enum rtlsdr_tuner)i;
+	*latency_us = opt ? (uint32_t)strtoul(opt + 1, NULL, 10) : 0;
+
+	return 1;
+}
+
+enum rtlsdr_virtual_dev {
+	VIRTUAL_REPLAY,
+	VIRTUAL_SIM
+};
+
+static const struct {
+	const char *name;
+	const char *serial;
+} rtlsdr_virtual[] = {
+	{ "Capture file replay", "replay" },
+	{ "Simulated RTL2832U", "sim" },
+};
+
+/* virtual devices follow the dongles, returns which one n is or -1 */
+static int _rtlsdr_virtual_dev(uint32_t n)
+{
+	char path[REPLAY_PATH_MAX];
+	enum rtlsdr_tuner tuner;
+	uint32_t latency_us;
+	int flags;
+
+	if (_rtlsdr_replay_env(path, sizeof(path), &flags) && !n--)
+		return VIRTUAL_REPLAY;
+
+	if (_rtlsdr_sim_env(&tuner, &latency_us) && !n--)
+		return VIRTUAL_SIM;
+
+	return -1;
+}
+
+static uint32_t _rtlsdr_virtual_count(void)
+{
+	uint32_t n = 0;
+
+	while (_rtlsdr_virtual_dev(n) >= 0)
+		n++;
+
+	return n;
+}
+
+static uint32_t _rtlsdr_usb_device_count(void)
+{
+	uint32_t device_count = 0;
+
+	pthread_mutex_lock(&rtlsdr_enum.lock);
+
+	if (!_rtlsdr_enum_update())
+		device_count = rtlsdr_enum.count;
+
+	pthread_mutex_unlock(&rtlsdr_enum.lock);
+
+	return device_count;
+}
+
+uint32_t rtlsdr_get_device_count(void)
+{
+	return _rtlsdr_usb_device_count() + _rtlsdr_virtual_count();
+}
+
+const char *rtlsdr_get_device_name(uint32_t index)
+{
+	const char *name = "";
+	int v = -1;
+
+	pthread_mutex_lock(&rtlsdr_enum.lock);
+
+	if (!_rtlsdr_enum_update() && index < rtlsdr_enum.count)
+		name = rtlsdr_enum.entry[index].known->name;
+	else if (index >= rtlsdr_enum.count)
+		v = _rtlsdr_virtual_dev(index - rtlsdr_enum.count);
+
+	pthread_mutex_unlock(&rtlsdr_enum.lock);
+
+	if (v >= 0)
+		name = rtlsdr_virtual[v].name;
+
+	return name;
+}
+
+int rtlsdr_get_device_usb_strings(uint32_t index, char *manufact,
+				   char *product, char *serial)
+{
+	int r = -2;
+	struct rtlsdr_enum_entry *e;
+	int v = -1;
+
+	pthread_mutex_lock(&rtlsdr_enum.lock);
+
+	if (!_rtlsdr_enum_update() && index < rtlsdr_enum.count) {
+		e = &rtlsdr_enum.entry[index];
+
+		r = _rtlsdr_enum_strings(e);
+		if (!r) {
+			if (manufact)
+				strcpy(manufact, e->manufact);
+			if (product)
+				strcpy(product, e->product);
+			if (serial)
+				strcpy(serial, e->serial);
+		}
+	} else if (index >= rtlsdr_enum.count) {
+		v = _rtlsdr_virtual_dev(index - rtlsdr_enum.count);
+	}
+
+	pthread_mutex_unlock(&rtlsdr_enum.lock);
+
+	if (v >= 0) {
+		r = 0;
+		if (manufact)
+			strcpy(manufact, "librtlsdr");
+		if (product)
+			strcpy(product, rtlsdr_virtual[v].name);
+		if (serial)
+			strcpy(serial, rtlsdr_virtual[v].serial);
+	}
+
+	return r;
+}
+
+int rtlsdr_get_index_by_serial(const char *serial)
+{
+	int r = -2;
+	uint32_t i, count = 0;
+	int v;
+
+	if (!serial)
+		return -1;
+
+	pthread_mutex_lock(&rtlsdr_enum.lock);
+
+	if (!_rtlsdr_enum_update() && rtlsdr_enum.count) {
+		r = -3;
+		count = rtlsdr_enum.count;
+
+		for (i = 0; i < rtlsdr_enum.count; i++) {
+			if (_rtlsdr_enum_strings(&rtlsdr_enum.entry[i]))
+				continue;
+
+			if (!strcmp(serial, rtlsdr_enum.entry[i].serial)) {
+				r = i;
+				break;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&rtlsdr_enum.lock);
+
+	if (r >= 0)
+		return r;
+
+	for (i = 0; (v = _rtlsdr_virtual_dev(i)) >= 0; i++) {
+		if (!strcmp(serial, rtlsdr_virtual[v].serial))
+			return count + i;
+	}
+
+	return (r == -2 && i) ? -3 : r;
+}
+
+#define CAL_CACHE_MAGIC		0x4c414352	/* "RCAL" */
+#define CAL_CACHE_VERSION	1
+
+struct rtlsdr_cal_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t tuner_type;
+	uint32_t len;
+};
+
+static struct rtlsdr_cal_cache {
+	pthread_mutex_t lock;
+	int mode;
+	char dir[256];
+} rtlsdr_cal_cache = { PTHREAD_MUTEX_INITIALIZER, RTLSDR_CAL_CACHE_USE, "" };
+
+int rtlsdr_set_cal_cache(const char *dir, int mode)
+{
+	if (mode < RTLSDR_CAL_CACHE_USE || mode > RTLSDR_CAL_CACHE_OFF)
+		return -1;
+
+	if (dir && strlen(dir) >= sizeof(rtlsdr_cal_cache.dir))
+		return -1;
+
+	pthread_mutex_lock(&rtlsdr_cal_cache.lock);
+	rtlsdr_cal_cache.mode = mode;
+	strcpy(rtlsdr_cal_cache.dir, dir ? dir : "");
+	pthread_mutex_unlock(&rtlsdr_cal_cache.lock);
+
+	return 0;
+}
+
+static int _rtlsdr_mkdir(const char *path)
+{
+#ifdef _WIN32
+	return _mkdir(path);
+#else
+	return mkdir(path, 0755);
+#endif
+}
+
+/* serials dongles ship with, shared by many different devices */
+static const char *rtlsdr_factory_serials[] = {
+	"00000001", "00000000", "0"
+};
+
+/* cache file of the device, creates the directory on the way */
+static int _rtlsdr_cal_path(rtlsdr_dev_t *dev, char *path, size_t len)
+{
+	struct libusb_device_descriptor dd;
+	char serial[256];
+	const char *base;
+	char dir[256];
+	int mode;
+	size_t i;
+
+	pthread_mutex_lock(&rtlsdr_cal_cache.lock);
+	mode = rtlsdr_cal_cache.mode;
+	strcpy(dir, rtlsdr_cal_cache.dir);
+	pthread_mutex_unlock(&rtlsdr_cal_cache.lock);
+
+	if (mode == RTLSDR_CAL_CACHE_OFF)
+		return -1;
+
+	if (!dir[0]) {
+		if ((base = getenv("RTLSDR_CACHE_DIR"))) {
+			snprintf(dir, sizeof(dir), "%s", base);
+		} else if ((base = getenv("XDG_CACHE_HOME"))) {
+			snprintf(dir, sizeof(dir), "%s/rtl-sdr", base);
+		} else if ((base = getenv("HOME"))) {
+			snprintf(dir, sizeof(dir), "%s/.cache", base);
+			_rtlsdr_mkdir(dir);
+			snprintf(dir, sizeof(dir), "%s/.cache/rtl-sdr", base);
+		} else if ((base = getenv("LOCALAPPDATA"))) {
+			snprintf(dir, sizeof(dir), "%s\\rtl-sdr", base);
+		} else {
+			return -1;
+		}
+		_rtlsdr_mkdir(dir);
+	}
+
+	/* without a serial number there is nothing to tell devices apart */
+	if (rtlsdr_get_usb_strings(dev, NULL, NULL, serial) || !serial[0])
+		return -1;
+
+	/* nor with one that came from the factory, another dongle could
+	 * load our results */
+	for (i = 0; i < sizeof(rtlsdr_factory_serials) /
+			sizeof(rtlsdr_factory_serials[0]); i++) {
+		if (!strcmp(serial, rtlsdr_factory_serials[i]))
+			return -1;
+	}
+
+	for (i = 0; serial[i]; i++) {
+		if (!isalnum((unsigned char)serial[i]) && serial[i] != '-')
+			serial[i] = '_';
+	}
+
+	libusb_get_device_descriptor(libusb_get_device(dev->devh), &dd);
+
+	if (snprintf(path, len, "%s/%04x_%04x_%s.cal", dir, dd.idVendor,
+		     dd.idProduct, serial) >= (int)len)
+		return -1;
+
+	return mode;
+}
+
+static int _rtlsdr_cal_load(rtlsdr_dev_t *dev, void *cal, uint32_t len)
+{
+	struct rtlsdr_cal_hdr hdr;
+	char path[512];
+	FILE *f;
+	int r = -1;
+
+	if (_rtlsdr_cal_path(dev, path, sizeof(path)) != RTLSDR_CAL_CACHE_USE)
+		return -1;
+
+	f = fopen(path, "rb");
+	if (!f)
+		return -1;
+
+	if (fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+	    hdr.magic == CAL_CACHE_MAGIC &&
+	    hdr.version == CAL_CACHE_VERSION &&
+	    hdr.tuner_type == (uint32_t)dev->tuner_type &&
+	    hdr.len == len &&
+	    fread(cal, len, 1, f) == 1)
+		r = 0;
+
+	fclose(f);
+
+	return r;
+}
+
+static int _rtlsdr_cal_store(rtlsdr_dev_t *dev, const void *cal, uint32_t len)
+{
+	struct rtlsdr_cal_hdr hdr;
+	char path[512];
+	char tmp[528];
+	FILE *f;
+	int r;
+
+	if (_rtlsdr_cal_path(dev, path, sizeof(path)) < 0)
+		return -1;
+
+	hdr.magic = CAL_CACHE_MAGIC;
+	hdr.version = CAL_CACHE_VERSION;
+	hdr.tuner_type = dev->tuner_type;
+	hdr.len = len;
+
+	/* write a private copy and move it in place, so concurrent opens
+	 * never see a partial file */
+	snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long)getpid());
+	f = fopen(tmp, "wb");
+	if (!f)
+		return -1;
+
+	r = (fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+	     fwrite(cal, len, 1, f) == 1) ? 0 : -1;
+
+	if (fclose(f))
+		r = -1;
+
+#ifdef _WIN32
+	if (!r)
+		remove(path);
+#endif
+	if (r || rename(tmp, path)) {
+		remove(tmp);
+		return -1;
+	}
+
+	return 0;
+}
+
+static const char *rtlsdr_trace_api_names[TRACE_API_NUM] = {
+	"other",
+	"rtlsdr_open",
+	"rtlsdr_close",
+	"rtlsdr_set_center_freq",
+	"rtlsdr_set_sample_rate",
+	"rtlsdr_set_freq_correction",
+	"rtlsdr_set_xtal_freq",
+	"rtlsdr_set_tuner_gain",
+	"rtlsdr_set_tuner_if_gain",
+	"rtlsdr_set_tuner_gain_mode",
+	"rtlsdr_set_agc_mode",
+	"rtlsdr_set_testmode",
+	"rtlsdr_set_direct_sampling",
+	"rtlsdr_set_offset_tuning",
+	"rtlsdr_reset_buffer",
+	"rtlsdr_retune_plan_create",
+	"rtlsdr_retune_plan_apply",
+};
+
+int rtlsdr_trace_start(rtlsdr_dev_t *dev, uint32_t entries)
+{
+	struct rtlsdr_trace *tr;
+	rtlsdr_trace_rec_t *rec;
+	int i;
+
+	if (!dev)
+		return -1;
+
+	if (!entries)
+		entries = TRACE_DEFAULT_RECS;
+
+	if (!dev->trace) {
+		tr = calloc(1, sizeof(struct rtlsdr_trace));
+		if (!tr)
+			return -ENOMEM;
+
+		pthread_mutex_init(&tr->lock, NULL);
+		dev->trace = tr;
+	}
+
+	tr = dev->trace;
+
+	pthread_mutex_lock(&tr->lock);
+
+	if (tr->size != entries) {
+		rec = realloc(tr->rec, entries * sizeof(rtlsdr_trace_rec_t));
+		if (!rec) {
+			pthread_mutex_unlock(&tr->lock);
+			return -ENOMEM;
+		}
+
+		tr->rec = rec;
+		tr->size = entries;
+	}
+
+	tr->total = 0;
+	memset(tr->api, 0, sizeof(tr->api));
+	for (i = 0; i < TRACE_API_NUM; i++)
+		tr->api[i].api = rtlsdr_trace_api_names[i];
+
+	tr->start_us = _rtlsdr_now_us();
+	tr->active = 1;
+
+	pthread_mutex_unlock(&tr->lock);
+
+	return 0;
+}
+
+int rtlsdr_trace_stop(rtlsdr_dev_t *dev)
+{
+	if (!dev || !dev->trace)
+		return -1;
+
+	pthread_mutex_lock(&dev->trace->lock);
+	dev->trace->active = 0;
+	pthread_mutex_unlock(&dev->trace->lock);
+
+	return 0;
+}
+
+static void _rtlsdr_trace_dump_json(struct rtlsdr_trace *tr, FILE *f,
+				    int tuner, uint64_t first)
+{
+	rtlsdr_trace_api_stats_t *api;
+	rtlsdr_trace_rec_t *rec;
+	uint64_t i;
+	int n = 0;
+
+	fprintf(f, "{\n\"tuner\": %d,\n\"dropped\": %llu,\n\"apis\": [",
+		tuner, (unsigned long long)first);
+
+	for (i = 0; i < TRACE_API_NUM; i++) {
+		api = &tr->api[i];
+		if (!api->calls && !api->transfers)
+			continue;
+
+		fprintf(f, "%s\n  {\"api\": \"%s\", \"calls\": %u, "
+			"\"transfers\": %u, \"round_trips\": %u, "
+			"\"bytes\": %llu, \"transfer_us\": %llu, "
+			"\"call_us\": %llu}", n++ ? "," : "", api->api,
+			api->calls, api->transfers, api->round_trips,
+			(unsigned long long)api->bytes,
+			(unsigned long long)api->transfer_us,
+			(unsigned long long)api->call_us);
+	}
+
+	fprintf(f, "\n],\n\"records\": [");
+
+	for (i = first; i < tr->total; i++) {
+		rec = &tr->rec[i % tr->size];
+
+		fprintf(f, "%s\n  {\"t\": %u, \"dur\": %u, \"api\": \"%s\", "
+			"\"block\": %u, \"addr\": %u, \"sub\": %u, "
+			"\"len\": %u, \"dir\": \"%s\", \"batch\": %d, "
+			"\"error\": %d}", i > first ? "," : "", rec->time_us,
+			rec->dur_us, rtlsdr_trace_api_names[rec->api],
+			rec->block, rec->addr, rec->sub, rec->len,
+			(rec->flags & RTLSDR_TRACE_READ) ? "in" : "out",
+			!!(rec->flags & RTLSDR_TRACE_BATCH),
+			!!(rec->flags & RTLSDR_TRACE_ERROR));
+	}
+
+	fprintf(f, "\n]\n}\n");
+}
+
+static void _rtlsdr_trace_dump_bin(struct rtlsdr_trace *tr, FILE *f,
+				   int tuner, uint64_t first)
+{
+	uint32_t hdr[5];
+	char name[TRACE_NAME_LEN];
+	uint64_t i;
+
+	hdr[0] = TRACE_MAGIC;
+	hdr[1] = TRACE_VERSION;
+	hdr[2] = (uint32_t)(tr->total - first);
+	hdr[3] = TRACE_API_NUM;
+	hdr[4] = tuner;
+	fwrite(hdr, sizeof(hdr), 1, f);
+
+	for (i = 0; i < TRACE_API_NUM; i++) {
+		memset(name, 0, sizeof(name));
+		strncpy(name, rtlsdr_trace_api_names[i], sizeof(name) - 1);
+		fwrite(name, sizeof(name), 1, f);
+	}
+
+	/* oldest first, the ring may have wrapped */
+	for (i = first; i < tr->total; i++)
+		fwrite(&tr->rec[i % tr->size], sizeof(rtlsdr_trace_rec_t), 1, f);
+}
+
+int rtlsdr_trace_dump(rtlsdr_dev_t *dev, const char *path,
+		      enum rtlsdr_trace_format format)
+{
+	struct rtlsdr_trace *tr;
+	uint64_t first;
+	FILE *f;
+	int r = 0;
+
+	if (!dev || !dev->trace || !path)
+		return -1;
+
+	f = fopen(path, format == RTLSDR_TRACE_JSON ? "w" : "wb");
+	if (!f)
+		return -2;
+
+	tr = dev->trace;
+
+	pthread_mutex_lock(&tr->lock);
+
+	first = tr->total > tr->size ? tr->total - tr->size : 0;
+	if (format == RTLSDR_TRACE_JSON)
+		_rtlsdr_trace_dump_json(tr, f, dev->tuner_type, first);
+	else
+		_rtlsdr_trace_dump_bin(tr, f, dev->tuner_type, first);
+
+	pthread_mutex_unlock(&tr->lock);
+
+	if (ferror(f))
+		r = -3;
+	if (fclose(f))
+		r = -3;
+
+	return r;
+}
+
+int rtlsdr_trace_get_summary(rtlsdr_dev_t *dev,
+			     rtlsdr_trace_api_stats_t *stats, uint32_t n)
+{
+	rtlsdr_trace_api_stats_t *api;
+	uint32_t count = 0;
+	int i;
+
+	if (!dev || !dev->trace)
+		return -1;
+
+	pthread_mutex_lock(&dev->trace->lock);
+
+	for (i = 0; i < TRACE_API_NUM; i++) {
+		api = &dev->trace->api[i];
+		if (!api->calls && !api->transfers)
+			continue;
+
+		if (stats) {
+			if (count == n)
+				break;
+			stats[count] = *api;
+		}
+		count++;
+	}
+
+	pthread_mutex_unlock(&dev->trace->lock);
+
+	return count;
+}
+
+/* RTLSDR_TRACE names the file a trace of the whole session goes to */
+static void _rtlsdr_trace_env(rtlsdr_dev_t *dev)
+{
+	const char *env = getenv(TRACE_ENV);
+
+	if (!env || !*env || rtlsdr_trace_start(dev, 0))
+		return;
+
+	dev->trace->path = strdup(env);
+}
+
+static void _rtlsdr_trace_close(rtlsdr_dev_t *dev)
+{
+	struct rtlsdr_trace *tr = dev->trace;
+	rtlsdr_trace_api_stats_t *api;
+	size_t len;
+	int i;
+
+	if (!tr || !tr->path)
+		return;
+
+	len = strlen(tr->path);
+	if (rtlsdr_trace_dump(dev, tr->path, (len > 5 &&
+			      !strcmp(tr->path + len - 5, ".json")) ?
+			      RTLSDR_TRACE_JSON : RTLSDR_TRACE_BINARY))
+		fprintf(stderr, "Failed to write trace %s\n", tr->path);
+
+	fprintf(stderr, "%-28s %6s %9s %11s %10s\n", "Control traffic",
+		"calls", "transfers", "round trips", "us");
+
+	for (i = 0; i < TRACE_API_NUM; i++) {
+		api = &tr->api[i];
+		if (!api->calls && !api->transfers)
+			continue;
+
+		fprintf(stderr, "%-28s %6u %9u %11u %10llu\n", api->api,
+			api->calls, api->transfers, api->round_trips,
+			(unsigned long long)api->transfer_us);
+	}
+}
+
+static void _rtlsdr_trace_free(rtlsdr_dev_t *dev)
+{
+	struct rtlsdr_trace *tr = dev->trace;
+
+	if (!tr)
+		return;
+
+	pthread_mutex_destroy(&tr->lock);
+	free(tr->path);
+	free(tr->rec);
+	free(tr);
+}
+
+static void _rtlsdr_sleep_us(uint32_t us)
+{
+#ifdef _WIN32
+	Sleep(us / 1000);
+#else
+	usleep(us);
+#endif
+}
+
+static int _rtlsdr_usb_ctrl(rtlsdr_dev_t *dev, uint8_t type, uint16_t value,
+			   uint16_t index, unsigned char *data, uint16_t len)
+{
+	return libusb_control_transfer(dev->devh, type, 0, value, index,
+				       data, len, CTRL_TIMEOUT);
+}
+
+static int _rtlsdr_usb_bulk(rtlsdr_dev_t *dev, unsigned char *buf, int len,
+			    int *actual)
+{
+	return libusb_bulk_transfer(dev->devh, 0x81, buf, len, actual,
+				    BULK_TIMEOUT);
+}
+
+static void _rtlsdr_usb_close(rtlsdr_dev_t *dev)
+{
+	libusb_release_interface(dev->devh, 0);
+	libusb_close(dev->devh);
+}
+
+static const struct rtlsdr_transport usb_transport = {
+	_rtlsdr_usb_ctrl, _rtlsdr_usb_ctrl_batch, _rtlsdr_usb_bulk,
+	_rtlsdr_usb_close, 0
+};
+
+/* a replayed capture has no registers behind it, reads return zeros */
+static int _rtlsdr_replay_ctrl(rtlsdr_dev_t *dev, uint8_t type,
+			       uint16_t value, uint16_t index,
+			       unsigned char *data, uint16_t len)
+{
+	if (CTRL_IN == type)
+		memset(data, 0, len);
+
+	return len;
+}
+
+/* next len bytes of the capture, short only at its end */
+static int _rtlsdr_replay_bulk(rtlsdr_dev_t *dev, unsigned char *buf, int len,
+			       int *actual)
+{
+	int n = 0;
+	size_t got;
+	int rewound = 0;
+
+	while (n < len) {
+		got = fread(buf + n, 1, len - n, dev->replay);
+		n += (int)got;
+		if (got) {
+			rewound = 0;
+			continue;
+		}
+
+		/* an empty file must not rewind forever */
+		if (!(dev->replay_flags & RTLSDR_REPLAY_LOOP) || rewound ||
+		    fseek(dev->replay, 0, SEEK_SET))
+			break;
+
+		rewound = 1;
+	}
+
+	*actual = n;
+
+	return 0;
+}
+
+static void _rtlsdr_replay_close(rtlsdr_dev_t *dev)
+{
+	if (dev->replay != stdin)
+		fclose(dev->replay);
+}
+
+static const struct rtlsdr_transport replay_transport = {
+	_rtlsdr_replay_ctrl, NULL, _rtlsdr_replay_bulk,
+	_rtlsdr_replay_close, 1
+};
+
+static int _rtlsdr_sim_ctrl(rtlsdr_dev_t *dev, uint8_t type, uint16_t value,
+			    uint16_t index, unsigned char *data, uint16_t len)
+{
+	return rtl2832_sim_ctrl(dev->sim, type, value, index, data, len);
+}
+
+/* the model has no antenna, samples sit at mid scale */
+static int _rtlsdr_sim_bulk(rtlsdr_dev_t *dev, unsigned char *buf, int len,
+			    int *actual)
+{
+	memset(buf, 127, len);
+	*actual = len;
+
+	return 0;
+}
+
+static void _rtlsdr_sim_close(rtlsdr_dev_t *dev)
+{
+	rtl2832_sim_destroy(dev->sim);
+}
+
+static const struct rtlsdr_transport sim_transport = {
+	_rtlsdr_sim_ctrl, NULL, _rtlsdr_sim_bulk, _rtlsdr_sim_close, 1
+};
+
+static rtlsdr_dev_t *_rtlsdr_alloc_dev(void)
+{
+	rtlsdr_dev_t *dev;
+
+	dev = malloc(sizeof(rtlsdr_dev_t));
+	if (NULL == dev)
+		return NULL;
+
+	memset(dev, 0, sizeof(rtlsdr_dev_t));
+
+	pthread_mutex_init(&dev->ring_lock, NULL);
+	pthread_cond_init(&dev->ring_cond, NULL);
+	pthread_mutex_init(&dev->stats_lock, NULL);
+	pthread_mutex_init(&dev->tune_lock, NULL);
+	pthread_mutex_init(&dev->soft_lock, NULL);
+	pthread_cond_init(&dev->soft_cond, NULL);
+
+	dev->cancel_latency_ms = DEFAULT_CANCEL_LATENCY;
+	dev->stream_cpu = -1;
+
+	_rtlsdr_trace_env(dev);
+
+	return dev;
+}
+
+static void _rtlsdr_free_dev(rtlsdr_dev_t *dev)
+{
+	pthread_cond_destroy(&dev->ring_cond);
+	pthread_mutex_destroy(&dev->ring_lock);
+	pthread_mutex_destroy(&dev->stats_lock);
+	pthread_mutex_destroy(&dev->tune_lock);
+	pthread_cond_destroy(&dev->soft_cond);
+	pthread_mutex_destroy(&dev->soft_lock);
+
+	_rtlsdr_trace_free(dev);
+	free(dev);
+}
+
+/* brings up the baseband, then probes and initializes the tuner */
+static void _rtlsdr_init_dev(rtlsdr_dev_t *dev)
+{
+	uint8_t reg;
+
+	_rtlsdr_trace_enter(dev, TRACE_API_OPEN);
+
+	dev->rtl_xtal = DEF_RTL_XTAL_FREQ;
+
+	rtlsdr_init_baseband(dev);
+
+	/* Probe tuners */
+	rtlsdr_set_i2c_repeater(dev, 1);
+
+	reg = rtlsdr_i2c_read_reg(dev, E4K_I2C_ADDR, E4K_CHECK_ADDR);
+	if (reg == E4K_CHECK_VAL) {
+		fprintf(stderr, "Found Elonics E4000 tuner\n");
+		dev->tuner_type = RTLSDR_TUNER_E4000;
+		goto found;
+	}
+
+	reg = rtlsdr_i2c_read_reg(dev, FC0013_I2C_ADDR, FC0013_CHECK_ADDR);
+	if (reg == FC0013_CHECK_VAL) {
+		fprintf(stderr, "Found Fitipower FC0013 tuner\n");
+		dev->tuner_type = RTLSDR_TUNER_FC0013;
+		goto found;
+	}
+
+	reg = rtlsdr_i2c_read_reg(dev, R820T_I2C_ADDR, R820T_CHECK_ADDR);
+	if (reg == R820T_CHECK_VAL) {
+		fprintf(stderr, "Found Rafael Micro R820T tuner\n");
+		dev->tuner_type = RTLSDR_TUNER_R820T;
+
+		/* disable Zero-IF mode */
+		rtlsdr_demod_write_reg(dev, 1, 0xb1, 0x1a, 1);
+
+		/* only enable In-phase ADC input */
+		rtlsdr_demod_write_reg(dev, 0, 0x08, 0x4d, 1);
+
+		/* the R820T uses 3.57 MHz IF for the DVB-T 6 MHz mode, and
+		 * 4.57 MHz for the 8 MHz mode */
+		rtlsdr_set_if_freq(dev, R820T_IF_FREQ);
+
+		/* enable spectrum inversion */
+		rtlsdr_demod_write_reg(dev, 1, 0x15, 0x01, 1);
+
+		goto found;
+	}
+
+	/* initialise GPIOs */
+	rtlsdr_set_gpio_output(dev, 5);
+
+	/* reset tuner before probing */
+	rtlsdr_set_gpio_bit(dev, 5, 1);
+	rtlsdr_set_gpio_bit(dev, 5, 0);
+
+	reg = rtlsdr_i2c_read_reg(dev, FC2580_I2C_ADDR, FC2580_CHECK_ADDR);
+	if ((reg & 0x7f) == FC2580_CHECK_VAL) {
+		fprintf(stderr, "Found FCI 2580 tuner\n");
+		dev->tuner_type = RTLSDR_TUNER_FC2580;
+		goto found;
+	}
+
+	reg = rtlsdr_i2c_read_reg(dev, FC0012_I2C_ADDR, FC0012_CHECK_ADDR);
+	if (reg == FC0012_CHECK_VAL) {
+		fprintf(stderr, "Found Fitipower FC0012 tuner\n");
+		rtlsdr_set_gpio_output(dev, 6);
+		dev->tuner_type = RTLSDR_TUNER_FC0012;
+		goto found;
+	}
+
+found:
+	if (dev->tuner_type == RTLSDR_TUNER_UNKNOWN) {
+		fprintf(stderr, "No supported tuner found\n");
+		rtlsdr_set_direct_sampling(dev, 1);
+	}
+
+	dev->tuner = &tuners[dev->tuner_type];
+	dev->tun_xtal = dev->rtl_xtal; /* use the rtl clock value by default */
+
+	if (dev->tuner->init)
+		dev->tuner->init(dev);
+
+	rtlsdr_set_i2c_repeater(dev, 0);
+
+	_rtlsdr_trace_leave(dev);
+}
+
+static int _rtlsdr_open(rtlsdr_dev_t **out_dev, uint32_t index,
+			struct rtlsdr_group *group)
+{
+	int r;
+	int i;
+	libusb_device **list;
+	rtlsdr_dev_t *dev = NULL;
+	libusb_device *device = NULL;
+	uint32_t device_count = 0;
+	struct libusb_device_descriptor dd;
+	ssize_t cnt;
+
+	dev = _rtlsdr_alloc_dev();
+	if (NULL == dev)
+		return -ENOMEM;
+
+	if (group) {
+		dev->ctx = group->ctx;
+		dev->group = group;
+	} else {
+		libusb_init(&dev->ctx);
+	}
+
+	cnt = libusb_get_device_list(dev->ctx, &list);
+
+	for (i = 0; i < cnt; i++) {
+		device = list[i];
+
+		libusb_get_device_descriptor(list[i], &dd);
+
+		if (find_known_device(dd.idVendor, dd.idProduct)) {
+			device_count++;
+		}
+
+		if (index == device_count - 1)
+			break;
+
+		device = NULL;
+	}
+
+	if (!device) {
+		r = -1;
+		goto err;
+	}
+
+	r = libusb_open(device, &dev->devh);
+	if (r < 0) {
+		libusb_free_device_list(list, 1);
+		fprintf(stderr, "usb_open error %d\n", r);
+		goto err;
+	}
+
+	libusb_free_device_list(list, 1);
+
+	r = libusb_claim_interface(dev->devh, 0);
+	if (r < 0) {
+		fprintf(stderr, "usb_claim_interface error %d\n", r);
+		goto err;
+	}
+
+	dev->xport = &usb_transport;
+	_rtlsdr_init_dev(dev);
+
+	*out_dev = dev;
+
+	return 0;
+err:
+	if (dev) {
+		if (dev->ctx && !dev->group)
+			libusb_exit(dev->ctx);
+
+		_rtlsdr_free_dev(dev);
+	}
 
 	return r;
 }
 
-int rtlsdr_set_sample_freq_correction(rtlsdr_dev_t *dev, int ppm)
+int rtlsdr_open(rtlsdr_dev_t **out_dev, uint32_t index)
 {
-	int r = 0;
-	uint8_t tmp;
-	int16_t offs = ppm * (-1) * TWO_POW(24) / 1000000;
-
-	tmp = offs & 0xff;
-	r |= rtlsdr_demod_write_reg(dev, 1, 0x3f, tmp, 1);
-	tmp = (offs >> 8) & 0x3f;
-	r |= rtlsdr_demod_write_reg(dev, 1, 0x3e, tmp, 1);
-
-	return r;
+	char path[REPLAY_PATH_MAX];
+	enum rtlsdr_tuner tuner;
+	uint32_t usb_count, latency_us = 0;
+	int flags = 0, r;
+
+	usb_count = _rtlsdr_usb_device_count();
+	if (index < usb_count)
+		return _rtlsdr_open(out_dev, index, NULL);
+
+	switch (_rtlsdr_virtual_dev(index - usb_count)) {
+	case VIRTUAL_REPLAY:
+		_rtlsdr_replay_env(path, sizeof(path), &flags);
+		return rtlsdr_open_replay(out_dev, path, flags);
+	case VIRTUAL_SIM:
+		_rtlsdr_sim_env(&tuner, &latency_us);
+		r = rtlsdr_open_sim(out_dev, tuner);
+		if (!r)
+			rtlsdr_set_transport_latency(*out_dev, latency_us);
+		return r;
+	default:
+		return -1;
+	}
 }
 
-int rtlsdr_set_xtal_freq(rtlsdr_dev_t *dev, uint32_t rtl_freq, uint32_t tuner_freq)
+int rtlsdr_open_replay(rtlsdr_dev_t **out_dev, const char *path, int flags)
 {
-	int r = 0;
+	rtlsdr_dev_t *dev;
 
-	if (!dev)
+	if (!out_dev || !path)
 		return -1;
 
-	if (rtl_freq > 0 &&
-		(rtl_freq < MIN_RTL_XTAL_FREQ || rtl_freq > MAX_RTL_XTAL_FREQ))
-		return -2;
-
-	if (rtl_freq > 0 && dev->rtl_xtal != rtl_freq) {
-		dev->rtl_xtal = rtl_freq;
+	dev = _rtlsdr_alloc_dev();
+	if (NULL == dev)
+		return -ENOMEM;
 
-		/* update xtal-dependent settings */
-		if (dev->rate)
-			r = rtlsdr_set_sample_rate(dev, dev->rate);
+	dev->replay = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+#ifdef _WIN32
+	if (dev->replay == stdin)
+		_setmode(_fileno(stdin), _O_BINARY);
+#endif
+	if (!dev->replay) {
+		fprintf(stderr, "Failed to open capture file %s\n", path);
+		_rtlsdr_free_dev(dev);
+		return -1;
 	}
 
-	if (dev->tun_xtal != tuner_freq) {
-		if (0 == tuner_freq)
-			dev->tun_xtal = dev->rtl_xtal;
-		else
-			dev->tun_xtal = tuner_freq;
+	dev->xport = &replay_transport;
+	dev->replay_flags = flags;
+	dev->rtl_xtal = DEF_RTL_XTAL_FREQ;
+	dev->tun_xtal = dev->rtl_xtal;
 
-		/* read corrected clock value into e4k structure */
-		if (rtlsdr_get_xtal_freq(dev, NULL, &dev->e4k_s.vco.fosc))
-			return -3;
+	/* register writes only reach the shadow, which keeps reading back
+	 * the settings consistent */
+	_rtlsdr_trace_enter(dev, TRACE_API_OPEN);
+	rtlsdr_init_baseband(dev);
+	_rtlsdr_trace_leave(dev);
 
-		/* update xtal-dependent settings */
-		if (dev->freq)
-			r = rtlsdr_set_center_freq(dev, dev->freq);
-	}
+	fprintf(stderr, "Replaying capture file %s\n", path);
+	dev->tuner_type = RTLSDR_TUNER_UNKNOWN;
+	dev->tuner = &replay_tuner;
 
-	return r;
+	*out_dev = dev;
+
+	return 0;
 }
 
-int rtlsdr_get_xtal_freq(rtlsdr_dev_t *dev, uint32_t *rtl_freq, uint32_t *tuner_freq)
+int rtlsdr_open_sim(rtlsdr_dev_t **out_dev, enum rtlsdr_tuner tuner)
 {
-	if (!dev)
+	rtlsdr_dev_t *dev;
+
+	if (!out_dev)
 		return -1;
 
-	#define APPLY_PPM_CORR(val,ppm) (((val) * (1.0 + (ppm) / 1e6)))
+	dev = _rtlsdr_alloc_dev();
+	if (NULL == dev)
+		return -ENOMEM;
 
-	if (rtl_freq)
-		*rtl_freq = (uint32_t) APPLY_PPM_CORR(dev->rtl_xtal, dev->corr);
+	dev->sim = rtl2832_sim_create(tuner);
+	if (!dev->sim) {
+		_rtlsdr_free_dev(dev);
+		return -ENOMEM;
+	}
 
-	if (tuner_freq)
-		*tuner_freq = (uint32_t) APPLY_PPM_CORR(dev->tun_xtal, dev->corr);
+	dev->xport = &sim_transport;
+	_rtlsdr_init_dev(dev);
+
+	*out_dev = dev;
 
 	return 0;
 }
 
-int rtlsdr_get_usb_strings(rtlsdr_dev_t *dev, char *manufact, char *product,
-			    char *serial)
+int rtlsdr_set_transport_latency(rtlsdr_dev_t *dev, uint32_t us)
 {
-	struct libusb_device_descriptor dd;
-	libusb_device *device = NULL;
-	const int buf_max = 256;
-	int r = 0;
-
-	if (!dev || !dev->devh)
+	if (!dev)
 		return -1;
 
-	device = libusb_get_device(dev->devh);
+	dev->xport_latency_us = us;
 
-	r = libusb_get_device_descriptor(device, &dd);
-	if (r < 0)
+	return 0;
+}
+
+int rtlsdr_get_transport_stats(rtlsdr_dev_t *dev,
+			       rtlsdr_transport_stats_t *stats)
+{
+	if (!dev || !stats)
 		return -1;
 
-	if (manufact) {
-		memset(manufact, 0, buf_max);
-		libusb_get_string_descriptor_ascii(dev->devh, dd.iManufacturer,
-						   (unsigned char *)manufact,
-						   buf_max);
-	}
+	pthread_mutex_lock(&dev->stats_lock);
+	*stats = dev->xport_stats;
+	pthread_mutex_unlock(&dev->stats_lock);
 
-	if (product) {
-		memset(product, 0, buf_max);
-		libusb_get_string_descriptor_ascii(dev->devh, dd.iProduct,
-						   (unsigned char *)product,
-						   buf_max);
-	}
+	return 0;
+}
 
-	if (serial) {
-		memset(serial, 0, buf_max);
-		libusb_get_string_descriptor_ascii(dev->devh, dd.iSerialNumber,
-						   (unsigned char *)serial,
-						   buf_max);
-	}
+int rtlsdr_reset_transport_stats(rtlsdr_dev_t *dev)
+{
+	if (!dev)
+		return -1;
+
+	pthread_mutex_lock(&dev->stats_lock);
+	memset(&dev->xport_stats, 0, sizeof(dev->xport_stats));
+	pthread_mutex_unlock(&dev->stats_lock);
 
 	return 0;
 }
 
-int rtlsdr_write_eeprom(rtlsdr_dev_t *dev, uint8_t *data, uint8_t offset, uint16_t len)
+int rtlsdr_close(rtlsdr_dev_t *dev)
 {
-	int r = 0;
-	int i;
-	uint8_t cmd[2];
+	struct rtlsdr_group *group;
+	uint32_t i;
 
 	if (!dev)
 		return -1;
 
-	if ((len + offset) > 256)
+	group = dev->group;
+	if (group && group->running)
 		return -2;
 
-	for (i = 0; i < len; i++) {
-		cmd[0] = i + offset;
-		r = rtlsdr_write_array(dev, IICB, EEPROM_ADDR, cmd, 1);
-		r = rtlsdr_read_array(dev, IICB, EEPROM_ADDR, &cmd[1], 1);
-
-		/* only write the byte if it differs */
-		if (cmd[1] == data[i])
-			continue;
+	if (dev->stream_active)
+		rtlsdr_stop_streaming(dev);
 
-		cmd[1] = data[i];
-		r = rtlsdr_write_array(dev, IICB, EEPROM_ADDR, cmd, 2);
-		if (r != sizeof(cmd))
-			return -3;
-
-		/* for some EEPROMs (e.g. ATC 240LC02) we need a delay
-		 * between write operations, otherwise they will fail */
+	/* block until all async operations have been completed (if any) */
+	while (RTLSDR_INACTIVE != dev->async_status) {
 #ifdef _WIN32
-		Sleep(5);
+		Sleep(1);
 #else
-		usleep(5000);
+		usleep(1000);
 #endif
 	}
 
+	_rtlsdr_trace_enter(dev, TRACE_API_CLOSE);
+	rtlsdr_deinit_baseband(dev);
+	_rtlsdr_trace_leave(dev);
+	_rtlsdr_trace_close(dev);
+
+	dev->xport->close(dev);
+
+	if (group) {
+		for (i = 0; i < group->ndev; i++) {
+			if (group->member[i].dev != dev)
+				continue;
+
+			group->member[i] = group->member[--group->ndev];
+			break;
+		}
+	} else if (dev->ctx) {
+		libusb_exit(dev->ctx);
+	}
+
+	_rtlsdr_free_dev(dev);
+
 	return 0;
 }
 
-int rtlsdr_read_eeprom(rtlsdr_dev_t *dev, uint8_t *data, uint8_t offset, uint16_t len)
+int rtlsdr_reset_buffer(rtlsdr_dev_t *dev)
 {
-	int r = 0;
-	int i;
-
 	if (!dev)
 		return -1;
 
-	if ((len + offset) > 256)
-		return -2;
-
-	r = rtlsdr_write_array(dev, IICB, EEPROM_ADDR, &offset, 1);
-	if (r < 0)
-		return -3;
-
-	for (i = 0; i < len; i++) {
-		r = rtlsdr_read_array(dev, IICB, EEPROM_ADDR, data + i, 1);
+	_rtlsdr_trace_enter(dev, TRACE_API_RESET_BUFFER);
+	rtlsdr_write_reg(dev, USBB, USB_EPA_CTL, 0x1002, 2);
+	rtlsdr_write_reg(dev, USBB, USB_EPA_CTL, 0x0000, 2);
+	_rtlsdr_trace_leave(dev);
 
-		if (r < 0)
-			return -3;
-	}
+	/* a replayed stream starts over at real time */
+	dev->soft_start_us = 0;
+	dev->soft_bytes = 0;
 
-	return r;
+	return 0;
 }
 
-int rtlsdr_set_center_freq(rtlsdr_dev_t *dev, uint32_t freq)
+static uint64_t _rtlsdr_now_us(void)
 {
-	int r = -1;
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
 
-	if (!dev || !dev->tuner)
-		return -1;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
 
-	if (dev->direct_sampling) {
-		r = rtlsdr_set_if_freq(dev, freq);
-	} else if (dev->tuner && dev->tuner->set_freq) {
-		rtlsdr_set_i2c_repeater(dev, 1);
-		r = dev->tuner->set_freq(dev, freq - dev->offs_freq);
-		rtlsdr_set_i2c_repeater(dev, 0);
-	}
+	return (uint64_t)(count.QuadPart / freq.QuadPart) * 1000000 +
+	       (uint64_t)(count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
 
-	if (!r)
-		dev->freq = freq;
-	else
-		dev->freq = 0;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
 
-	return r;
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
 }
 
-uint32_t rtlsdr_get_center_freq(rtlsdr_dev_t *dev)
+static void _rtlsdr_stats_xfer(rtlsdr_dev_t *dev, int status, int len,
+			       int actual_length, uint64_t now)
 {
-	if (!dev)
-		return 0;
+	rtlsdr_stream_stats_t *st = &dev->stats;
+	uint32_t dt;
+
+	pthread_mutex_lock(&dev->stats_lock);
+
+	switch (status) {
+	case LIBUSB_TRANSFER_COMPLETED:
+		st->transfers++;
+		st->bytes += actual_length;
+		if (actual_length < len)
+			st->short_transfers++;
+
+		if (dev->stats_last_us) {
+			dt = (uint32_t)(now - dev->stats_last_us);
+			if (!dev->stats_intervals || dt < st->interval_min_us)
+				st->interval_min_us = dt;
+			if (dt > st->interval_max_us)
+				st->interval_max_us = dt;
+			dev->stats_interval_sum += dt;
+			dev->stats_intervals++;
+		}
+		dev->stats_last_us = now;
+		break;
+	case LIBUSB_TRANSFER_CANCELLED:
+		break;
+	case LIBUSB_TRANSFER_TIMED_OUT:
+		st->err_timed_out++;
+		break;
+	case LIBUSB_TRANSFER_STALL:
+		st->err_stall++;
+		break;
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		st->err_no_device++;
+		break;
+	case LIBUSB_TRANSFER_OVERFLOW:
+		st->err_overflow++;
+		break;
+	default:
+		st->err_error++;
+		break;
+	}
 
-	return dev->freq;
+	pthread_mutex_unlock(&dev->stats_lock);
 }
 
-int rtlsdr_set_freq_correction(rtlsdr_dev_t *dev, int ppm)
+static void _rtlsdr_stats_latency(rtlsdr_dev_t *dev, uint64_t latency_us)
 {
-	int r = 0;
+	rtlsdr_stream_stats_t *st = &dev->stats;
+	int bin = 0;
 
-	if (!dev)
-		return -1;
+	while (bin < RTLSDR_STATS_LATENCY_BINS - 1 &&
+	       latency_us >= (uint64_t)(16 << bin))
+		bin++;
 
-	if (dev->corr == ppm)
-		return -2;
+	pthread_mutex_lock(&dev->stats_lock);
 
-	dev->corr = ppm;
+	st->latency_hist[bin]++;
+	if (latency_us > st->latency_max_us)
+		st->latency_max_us = (uint32_t)latency_us;
 
-	r |= rtlsdr_set_sample_freq_correction(dev, ppm);
+	pthread_mutex_unlock(&dev->stats_lock);
+}
 
-	/* read corrected clock value into e4k structure */
-	if (rtlsdr_get_xtal_freq(dev, NULL, &dev->e4k_s.vco.fosc))
-		return -3;
+int rtlsdr_get_stream_stats(rtlsdr_dev_t *dev, rtlsdr_stream_stats_t *stats)
+{
+	if (!dev || !stats)
+		return -1;
 
-	if (dev->freq) /* retune to apply new correction value */
-		r |= rtlsdr_set_center_freq(dev, dev->freq);
+	pthread_mutex_lock(&dev->stats_lock);
 
-	return r;
+	memcpy(stats, &dev->stats, sizeof(rtlsdr_stream_stats_t));
+	if (dev->stats_intervals)
+		stats->interval_avg_us = (uint32_t)(dev->stats_interval_sum /
+						    dev->stats_intervals);
+	stats->buf_num = dev->xfer_buf_num;
+
+	pthread_mutex_unlock(&dev->stats_lock);
+
+	return 0;
 }
 
-int rtlsdr_get_freq_correction(rtlsdr_dev_t *dev)
+int rtlsdr_reset_stream_stats(rtlsdr_dev_t *dev)
 {
 	if (!dev)
-		return 0;
+		return -1;
 
-	return dev->corr;
+	pthread_mutex_lock(&dev->stats_lock);
+
+	memset(&dev->stats, 0, sizeof(rtlsdr_stream_stats_t));
+	dev->stats_last_us = 0;
+	dev->stats_interval_sum = 0;
+	dev->stats_intervals = 0;
+
+	pthread_mutex_unlock(&dev->stats_lock);
+
+	return 0;
 }
 
-enum rtlsdr_tuner rtlsdr_get_tuner_type(rtlsdr_dev_t *dev)
+int rtlsdr_format_stream_stats(const rtlsdr_stream_stats_t *st,
+			       char *buf, uint32_t len)
 {
-	if (!dev)
-		return RTLSDR_TUNER_UNKNOWN;
+	uint32_t n;
+	int r, i;
 
-	return dev->tuner_type;
+	if (!st || (!buf && len))
+		return -1;
+
+	r = snprintf(buf, len, "%llu transfers, %llu bytes, %llu short, "
+		     "%llu errors, interval %u/%u/%u us, latency max %u us, "
+		     "hist",
+		     (unsigned long long)st->transfers,
+		     (unsigned long long)st->bytes,
+		     (unsigned long long)st->short_transfers,
+		     (unsigned long long)(st->err_error + st->err_timed_out +
+		     st->err_stall + st->err_no_device + st->err_overflow),
+		     st->interval_min_us, st->interval_avg_us,
+		     st->interval_max_us, st->latency_max_us);
+	if (r < 0)
+		return -1;
+	n = r;
+
+	for (i = 0; i < RTLSDR_STATS_LATENCY_BINS; i++) {
+		r = snprintf(n < len ? buf + n : NULL, n < len ? len - n : 0,
+			     " %llu", (unsigned long long)st->latency_hist[i]);
+		if (r < 0)
+			return -1;
+		n += r;
+	}
+
+	return (int)n;
 }
 
-int rtlsdr_get_tuner_gains(rtlsdr_dev_t *dev, int *gains)
-{
-	/* all gain values are expressed in tenths of a dB */
-	const int e4k_gains[] = { -10, 15, 40, 65, 90, 115, 140, 165, 190, 215,
-				  240, 290, 340, 420 };
-	const int fc0012_gains[] = { -99, -40, 71, 179, 192 };
-	const int fc0013_gains[] = { -99, -73, -65, -63, -60, -58, -54, 58, 61,
-				       63, 65, 67, 68, 70, 71, 179, 181, 182,
-				       184, 186, 188, 191, 197 };
-	const int fc2580_gains[] = { 0 /* no gain values */ };
-	const int r820t_gains[] = { 0, 9, 14, 27, 37, 77, 87, 125, 144, 157,
-				     166, 197, 207, 229, 254, 280, 297, 328,
-				     338, 364, 372, 386, 402, 421, 434, 439,
-				     445, 480, 496 };
-	const int unknown_gains[] = { 0 /* no gain values */ };
+/*
+ * Holds len replayed bytes back until a dongle running at the configured
+ * sample rate would have delivered them, returns that time in us.
+ */
+static uint64_t _rtlsdr_soft_pace(rtlsdr_dev_t *dev, uint32_t len)
+{
+	uint64_t now = _rtlsdr_now_us();
+	uint64_t due;
 
-	int *ptr = NULL;
-	int len = 0;
+	if (!dev->soft_start_us)
+		dev->soft_start_us = now;
+
+	if (!dev->rate)
+		return now;
+
+	dev->soft_bytes += len;
+	due = dev->soft_start_us + dev->soft_bytes * 500000 / dev->rate;
+
+	if (dev->replay_flags & RTLSDR_REPLAY_UNTHROTTLED)
+		return due;
+
+	/* in slices, a cancel must not wait for a slow stream */
+	while (now < due && RTLSDR_CANCELING != dev->async_status) {
+		_rtlsdr_sleep_us((uint32_t)min(due - now,
+				 dev->cancel_latency_ms * 1000ULL));
+		now = _rtlsdr_now_us();
+	}
+
+	return due;
+}
+
+int rtlsdr_read_sync(rtlsdr_dev_t *dev, void *buf, int len, int *n_read)
+{
+	int r, status, actual = 0;
 
 	if (!dev)
 		return -1;
 
-	switch (dev->tuner_type) {
-	case RTLSDR_TUNER_E4000:
-		ptr = (int *)e4k_gains; len = sizeof(e4k_gains);
+	r = dev->xport->bulk(dev, buf, len, &actual);
+	if (dev->xport->soft_stream)
+		_rtlsdr_soft_pace(dev, actual);
+	if (n_read)
+		*n_read = actual;
+
+	switch (r) {
+	case 0:
+		status = LIBUSB_TRANSFER_COMPLETED;
 		break;
-	case RTLSDR_TUNER_FC0012:
-		ptr = (int *)fc0012_gains; len = sizeof(fc0012_gains);
+	case LIBUSB_ERROR_TIMEOUT:
+		status = LIBUSB_TRANSFER_TIMED_OUT;
 		break;
-	case RTLSDR_TUNER_FC0013:
-		ptr = (int *)fc0013_gains; len = sizeof(fc0013_gains);
+	case LIBUSB_ERROR_PIPE:
+		status = LIBUSB_TRANSFER_STALL;
 		break;
-	case RTLSDR_TUNER_FC2580:
-		ptr = (int *)fc2580_gains; len = sizeof(fc2580_gains);
+	case LIBUSB_ERROR_NO_DEVICE:
+		status = LIBUSB_TRANSFER_NO_DEVICE;
 		break;
-	case RTLSDR_TUNER_R820T:
-		ptr = (int *)r820t_gains; len = sizeof(r820t_gains);
+	case LIBUSB_ERROR_OVERFLOW:
+		status = LIBUSB_TRANSFER_OVERFLOW;
 		break;
 	default:
-		ptr = (int *)unknown_gains; len = sizeof(unknown_gains);
+		status = LIBUSB_TRANSFER_ERROR;
 		break;
 	}
+	_rtlsdr_stats_xfer(dev, status, len, actual, _rtlsdr_now_us());
 
-	if (!gains) { /* no buffer provided, just return the count */
-		return len / sizeof(int);
-	} else {
-		if (len)
-			memcpy(gains, ptr, len);
+	return r;
+}
 
-		return len / sizeof(int);
+/* runs on the event thread for every buffer, see _rtlsdr_tune_begin() */
+static void _rtlsdr_tune_tag(rtlsdr_dev_t *dev, rtlsdr_xfer_info_t *info,
+			     uint32_t n, double period)
+{
+	uint64_t index = info->sample_index;
+	double t;
+
+	pthread_mutex_lock(&dev->tune_lock);
+
+	if (dev->tune_pending) {
+		if (!dev->tune_settle_us) {
+			/* still tuning, nothing in this buffer is usable */
+			index += n;
+		} else {
+			/* ns from the first sample of the buffer to settling */
+			t = dev->tune_settle_us * 1e3 - (double)info->timestamp;
+			if (t > 0 && period > 0)
+				index += (uint64_t)(t / (period * 1e9)) + 1;
+
+			dev->tune_pending = 0;
+		}
+
+		if (index > dev->settled_index)
+			dev->settled_index = index;
 	}
+
+	info->freq = dev->tune_freq;
+	info->settled_index = dev->settled_index;
+
+	pthread_mutex_unlock(&dev->tune_lock);
 }
 
-int rtlsdr_set_tuner_gain(rtlsdr_dev_t *dev, int gain)
+static void _rtlsdr_clock_update(rtlsdr_dev_t *dev, uint32_t len, uint64_t now,
+				 rtlsdr_xfer_info_t *info)
 {
-	int r = 0;
+	struct rtlsdr_clock *clk = &dev->clk;
+	uint32_t n = len / 2; /* I/Q sample pairs */
+	double t = now * 1e-6;
+	double dur, lag, e, w;
+	uint64_t lost = 0;
+
+	if (!dev->rate || !n) {
+		info->timestamp = now * 1000;
+		info->sample_index = clk->samples;
+		info->dropped = 0;
+		_rtlsdr_tune_tag(dev, info, n, 0);
+		clk->samples += n;
+		return;
+	}
 
-	if (!dev || !dev->tuner)
-		return -1;
+	/* (re)seed the loop with the nominal rate */
+	if (clk->rate != dev->rate) {
+		clk->rate = dev->rate;
+		clk->period = 1.0 / dev->rate;
+		clk->t_end = t - n * clk->period;
+	}
 
-	if (dev->tuner->set_gain) {
-		rtlsdr_set_i2c_repeater(dev, 1);
-		r = dev->tuner->set_gain((void *)dev, gain);
-		rtlsdr_set_i2c_repeater(dev, 0);
+	dur = n * clk->period;
+	e = t - (clk->t_end + dur);
+
+	/* the transfer queue can not hold data older than this, so a larger
+	 * lag means samples were lost while no transfer was submitted */
+	lag = dev->xfer_buf_num * dur;
+	if (e > lag) {
+		lost = (uint64_t)((e - lag) / clk->period + 0.5);
+		clk->t_end += lost * clk->period;
+		clk->samples += lost;
+		e -= lost * clk->period;
 	}
 
-	if (!r)
-		dev->gain = gain;
-	else
-		dev->gain = 0;
+	/* second order DLL, scheduling jitter is clamped to one buffer */
+	if (e > dur)
+		e = dur;
+	else if (e < -dur)
+		e = -dur;
 
-	return r;
+	w = TWO_PI * CLOCK_LOOP_BW * dur;
+	clk->t_end += dur + SQRT_2 * w * e;
+	clk->period += w * w * e / n;
+
+	/* samples can not have been captured after their completion */
+	if (clk->t_end > t)
+		clk->t_end = t;
+
+	info->timestamp = (uint64_t)((clk->t_end - n * clk->period) * 1e9);
+	info->sample_index = clk->samples;
+	info->dropped = (uint32_t)lost;
+	_rtlsdr_tune_tag(dev, info, n, clk->period);
+
+	clk->samples += n;
 }
 
-int rtlsdr_get_tuner_gain(rtlsdr_dev_t *dev)
+static void _rtlsdr_abstime(struct timespec *ts, int timeout_ms)
 {
-	if (!dev)
-		return 0;
+#ifdef _WIN32
+	struct _timeb tb;
 
-	return dev->gain;
+	_ftime(&tb);
+	ts->tv_sec = tb.time;
+	ts->tv_nsec = tb.millitm * 1000000L;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	ts->tv_sec = tv.tv_sec;
+	ts->tv_nsec = tv.tv_usec * 1000L;
+#endif
+	ts->tv_sec += timeout_ms / 1000;
+	ts->tv_nsec += (timeout_ms % 1000) * 1000000L;
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
 }
 
-int rtlsdr_set_tuner_if_gain(rtlsdr_dev_t *dev, int stage, int gain)
+static void _rtlsdr_ring_wake(rtlsdr_dev_t *dev)
 {
-	int r = 0;
+	rtlsdr_barrier();
 
-	if (!dev || !dev->tuner)
-		return -1;
+	/* only take the lock if somebody is actually sleeping */
+	if (dev->ring_waiters) {
+		pthread_mutex_lock(&dev->ring_lock);
+		pthread_cond_broadcast(&dev->ring_cond);
+		pthread_mutex_unlock(&dev->ring_lock);
+	}
+}
 
-	if (dev->tuner->set_if_gain) {
-		rtlsdr_set_i2c_repeater(dev, 1);
-		r = dev->tuner->set_if_gain(dev, stage, gain);
-		rtlsdr_set_i2c_repeater(dev, 0);
+/* queue a transfer for _rtlsdr_soft_step(), any thread may resubmit */
+static void _rtlsdr_soft_push(rtlsdr_dev_t *dev, struct libusb_transfer *xfer)
+{
+	pthread_mutex_lock(&dev->soft_lock);
+	dev->soft_q[(dev->soft_q_head + dev->soft_q_len++) %
+		     dev->xfer_buf_num] = xfer;
+	pthread_cond_signal(&dev->soft_cond);
+	pthread_mutex_unlock(&dev->soft_lock);
+}
+
+static struct libusb_transfer *_rtlsdr_soft_pop(rtlsdr_dev_t *dev,
+						int timeout_ms)
+{
+	struct libusb_transfer *xfer = NULL;
+	struct timespec ts;
+
+	pthread_mutex_lock(&dev->soft_lock);
+
+	if (!dev->soft_q_len && timeout_ms) {
+		_rtlsdr_abstime(&ts, timeout_ms);
+		pthread_cond_timedwait(&dev->soft_cond, &dev->soft_lock,
+				       &ts);
 	}
 
-	return r;
+	if (dev->soft_q_len) {
+		xfer = dev->soft_q[dev->soft_q_head];
+		dev->soft_q_head = (dev->soft_q_head + 1) %
+				    dev->xfer_buf_num;
+		dev->soft_q_len--;
+	}
+
+	pthread_mutex_unlock(&dev->soft_lock);
+
+	return xfer;
 }
 
-int rtlsdr_set_tuner_gain_mode(rtlsdr_dev_t *dev, int mode)
+static int _rtlsdr_submit_transfer(rtlsdr_dev_t *dev, struct libusb_transfer *xfer)
 {
-	int r = 0;
+	int r;
 
-	if (!dev || !dev->tuner)
-		return -1;
+	rtlsdr_atomic_inc(&dev->xfer_inflight);
 
-	if (dev->tuner->set_gain_mode) {
-		rtlsdr_set_i2c_repeater(dev, 1);
-		r = dev->tuner->set_gain_mode((void *)dev, mode);
-		rtlsdr_set_i2c_repeater(dev, 0);
+	if (dev->xport->soft_stream) {
+		_rtlsdr_soft_push(dev, xfer);
+		return 0;
 	}
 
+	r = libusb_submit_transfer(xfer);
+	if (r < 0)
+		rtlsdr_atomic_dec(&dev->xfer_inflight);
+
 	return r;
 }
 
-int rtlsdr_set_sample_rate(rtlsdr_dev_t *dev, uint32_t samp_rate)
+static void _rtlsdr_ring_publish(rtlsdr_dev_t *dev, struct libusb_transfer *xfer,
+				 uint64_t now, const rtlsdr_xfer_info_t *info)
 {
-	int r = 0;
-	uint16_t tmp;
-	uint32_t rsamp_ratio;
-	double real_rate;
-	uint32_t rtl_freq = dev->rtl_xtal;
+	struct rtlsdr_ring_slot *slot;
+	long held;
 
-	if (!dev)
-		return -1;
+	/* retire the transfer, the ring is being torn down */
+	if (dev->ring_stopped)
+		return;
 
-	/* check for the maximum rate the resampler supports */
-	if (samp_rate > MAX_SAMP_RATE)
-		samp_rate = MAX_SAMP_RATE;
+	if (!dev->ring_nconsumers) {
+		_rtlsdr_submit_transfer(dev, xfer); /* nobody listening, drop it */
+		return;
+	}
 
-	rsamp_ratio = (rtl_freq * TWO_POW(22)) / samp_rate;
-	rsamp_ratio &= ~3;
+	/* consumers release in order, so this slot is free again by now */
+	slot = &dev->ring_slot[dev->ring_head % dev->xfer_buf_num];
+	slot->xfer = xfer;
+	slot->len = xfer->actual_length;
+	slot->refs = dev->ring_nconsumers;
+	slot->stamp = now;
+	slot->info = *info;
+	held = rtlsdr_atomic_inc(&dev->ring_held);
 
-	real_rate = (rtl_freq * TWO_POW(22)) / rsamp_ratio;
+	pthread_mutex_lock(&dev->stats_lock);
+	if ((uint32_t)held > dev->stats.queued_max)
+		dev->stats.queued_max = held;
+	pthread_mutex_unlock(&dev->stats_lock);
 
-	if ( ((double)samp_rate) != real_rate )
-		fprintf(stderr, "Exact sample rate is: %f Hz\n", real_rate);
+	rtlsdr_barrier(); /* slot contents must be visible before the head */
+	dev->ring_head++;
 
-	if (dev->tuner && dev->tuner->set_bw) {
-		rtlsdr_set_i2c_repeater(dev, 1);
-		dev->tuner->set_bw(dev, (int)real_rate);
-		rtlsdr_set_i2c_repeater(dev, 0);
+	_rtlsdr_ring_wake(dev);
+}
+
+static int _rtlsdr_ring_idle(rtlsdr_dev_t *dev)
+{
+	int i;
+
+	if (dev->ring_busy)
+		return 0;
+
+	for (i = 0; i < RTLSDR_RING_MAX_CONSUMERS; i++) {
+		if ((dev->ring_consumers & (1 << i)) &&
+		    dev->ring_rel[i] != dev->ring_acq[i])
+			return 0;
 	}
 
-	dev->rate = (uint32_t)real_rate;
+	return 1;
+}
 
-	tmp = (rsamp_ratio >> 16);
-	r |= rtlsdr_demod_write_reg(dev, 1, 0x9f, tmp, 2);
-	tmp = rsamp_ratio & 0xffff;
-	r |= rtlsdr_demod_write_reg(dev, 1, 0xa1, tmp, 2);
+static void _rtlsdr_ring_stop(rtlsdr_dev_t *dev)
+{
+	struct timespec ts;
+
+	/* from now on consumers see the end of the stream and released
+	 * transfers are no longer resubmitted */
+	dev->ring_stopped = 1;
+	_rtlsdr_ring_wake(dev);
+
+	/* wait for consumers which are inside acquire or release */
+	pthread_mutex_lock(&dev->ring_lock);
+	rtlsdr_atomic_inc(&dev->ring_waiters);
+	while (dev->ring_busy) {
+		_rtlsdr_abstime(&ts, 10);
+		pthread_cond_timedwait(&dev->ring_cond, &dev->ring_lock, &ts);
+	}
+	rtlsdr_atomic_dec(&dev->ring_waiters);
+	pthread_mutex_unlock(&dev->ring_lock);
+}
 
-	r |= rtlsdr_set_sample_freq_correction(dev, dev->corr);
+static void _rtlsdr_ring_drain(rtlsdr_dev_t *dev)
+{
+	struct timespec ts;
+
+	if (!dev->ring_stopped)
+		_rtlsdr_ring_stop(dev);
+
+	/* transfer buffers must not be freed while a consumer reads them,
+	 * unacquired buffers are simply discarded */
+	pthread_mutex_lock(&dev->ring_lock);
+	rtlsdr_atomic_inc(&dev->ring_waiters);
+	while (!_rtlsdr_ring_idle(dev)) {
+		_rtlsdr_abstime(&ts, 10);
+		pthread_cond_timedwait(&dev->ring_cond, &dev->ring_lock, &ts);
+	}
+	rtlsdr_atomic_dec(&dev->ring_waiters);
+	pthread_mutex_unlock(&dev->ring_lock);
 
-	/* reset demod (bit 3, soft_rst) */
-	r |= rtlsdr_demod_write_reg(dev, 1, 0x01, 0x14, 1);
-	r |= rtlsdr_demod_write_reg(dev, 1, 0x01, 0x10, 1);
+	free(dev->ring_slot);
+	dev->ring_slot = NULL;
+	dev->ring_mode = 0;
+}
 
-	/* recalculate offset frequency if offset tuning is enabled */
-	if (dev->offs_freq)
-		rtlsdr_set_offset_tuning(dev, 1);
+static void LIBUSB_CALL _libusb_callback(struct libusb_transfer *xfer)
+{
+	rtlsdr_dev_t *dev = (rtlsdr_dev_t *)xfer->user_data;
+	uint64_t now = _rtlsdr_now_us();
+	rtlsdr_xfer_info_t info;
 
-	return r;
+	_rtlsdr_stats_xfer(dev, xfer->status, xfer->length,
+			   xfer->actual_length, now);
+
+	if (LIBUSB_TRANSFER_COMPLETED == xfer->status) {
+		/* samples streamed in software carry their nominal arrival */
+		_rtlsdr_clock_update(dev, xfer->actual_length,
+				     dev->xport->soft_stream ? dev->soft_due : now,
+				     &info);
+
+		if (dev->ring_mode) {
+			_rtlsdr_ring_publish(dev, xfer, now, &info);
+		} else {
+			if (dev->cb_ex)
+				dev->cb_ex(xfer->buffer, xfer->actual_length,
+					   &info, dev->cb_ctx);
+			else if (dev->cb)
+				dev->cb(xfer->buffer, xfer->actual_length,
+					dev->cb_ctx);
+
+			_rtlsdr_stats_latency(dev, _rtlsdr_now_us() - now);
+
+			_rtlsdr_submit_transfer(dev, xfer); /* resubmit transfer */
+		}
+	} else if (LIBUSB_TRANSFER_CANCELLED == xfer->status) {
+		/* nothing to do */
+	} else {
+		/*fprintf(stderr, "transfer status: %d\n", xfer->status);*/
+	}
+
+	/* last, a control transfer wait on another thread may run this
+	 * callback while the event thread already tears the stream down */
+	rtlsdr_atomic_dec(&dev->xfer_inflight);
 }
 
-uint32_t rtlsdr_get_sample_rate(rtlsdr_dev_t *dev)
+/* completes the next queued transfer from the transport */
+static int _rtlsdr_soft_step(rtlsdr_dev_t *dev)
 {
-	if (!dev)
+	struct libusb_transfer *xfer;
+	int n = 0;
+
+	xfer = _rtlsdr_soft_pop(dev, dev->cancel_latency_ms);
+	if (!xfer)
 		return 0;
 
-	return dev->rate;
+	if (dev->xport->bulk(dev, xfer->buffer, xfer->length, &n) < 0)
+		n = 0;
+	xfer->actual_length = n;
+	xfer->status = LIBUSB_TRANSFER_COMPLETED;
+
+	if (!n) {
+		/* end of the stream, the transfer retires and once the
+		 * consumers are through the ring the stream stops like a
+		 * cancel would */
+		xfer->status = LIBUSB_TRANSFER_CANCELLED;
+		_libusb_callback(xfer);
+
+		if (!dev->ring_mode || !dev->ring_held)
+			rtlsdr_atomic_cas(&dev->async_status, RTLSDR_RUNNING,
+					  RTLSDR_CANCELING);
+		return 0;
+	}
+
+	dev->soft_due = _rtlsdr_soft_pace(dev, n);
+	_libusb_callback(xfer);
+
+	return 0;
 }
 
-int rtlsdr_set_testmode(rtlsdr_dev_t *dev, int on)
+/* retires every queued transfer, returns 1 once nothing is in flight */
+static int _rtlsdr_soft_cancel(rtlsdr_dev_t *dev)
 {
-	if (!dev)
-		return -1;
+	struct libusb_transfer *xfer;
+
+	while ((xfer = _rtlsdr_soft_pop(dev, 0))) {
+		xfer->actual_length = 0;
+		xfer->status = LIBUSB_TRANSFER_CANCELLED;
+		_libusb_callback(xfer);
+	}
 
-	return rtlsdr_demod_write_reg(dev, 0, 0x19, on ? 0x03 : 0x05, 1);
+	return !dev->xfer_inflight;
 }
 
-int rtlsdr_set_agc_mode(rtlsdr_dev_t *dev, int on)
+int rtlsdr_wait_async(rtlsdr_dev_t *dev, rtlsdr_read_async_cb_t cb, void *ctx)
 {
-	if (!dev)
-		return -1;
-
-	return rtlsdr_demod_write_reg(dev, 0, 0x19, on ? 0x25 : 0x05, 1);
+	return rtlsdr_read_async(dev, cb, ctx, 0, 0);
 }
 
-int rtlsdr_set_direct_sampling(rtlsdr_dev_t *dev, int on)
+static int _rtlsdr_alloc_async_buffers(rtlsdr_dev_t *dev)
 {
-	int r = 0;
+	unsigned int i;
 
 	if (!dev)
 		return -1;
 
-	if (on) {
-		if (dev->tuner && dev->tuner->exit) {
-			rtlsdr_set_i2c_repeater(dev, 1);
-			r = dev->tuner->exit(dev);
-			rtlsdr_set_i2c_repeater(dev, 0);
-		}
+	if (!dev->xfer) {
+		dev->xfer = malloc(dev->xfer_buf_num *
+				   sizeof(struct libusb_transfer *));
 
-		/* disable Zero-IF mode */
-		r |= rtlsdr_demod_write_reg(dev, 1, 0xb1, 0x1a, 1);
+		for(i = 0; i < dev->xfer_buf_num; ++i)
+			dev->xfer[i] = libusb_alloc_transfer(0);
+	}
 
-		/* disable spectrum inversion */
-		r |= rtlsdr_demod_write_reg(dev, 1, 0x15, 0x00, 1);
+	if (!dev->xfer_buf) {
+		dev->xfer_buf = malloc(dev->xfer_buf_num *
+					   sizeof(unsigned char *));
 
-		/* only enable In-phase ADC input */
-		r |= rtlsdr_demod_write_reg(dev, 0, 0x08, 0x4d, 1);
+		for(i = 0; i < dev->xfer_buf_num; ++i)
+			dev->xfer_buf[i] = malloc(dev->xfer_buf_len);
+	}
 
-		/* swap I and Q ADC, this allows to select between two inputs */
-		r |= rtlsdr_demod_write_reg(dev, 0, 0x06, (on > 1) ? 0x90 : 0x80, 1);
+	if (dev->xport->soft_stream && !dev->soft_q) {
+		dev->soft_q = malloc(dev->xfer_buf_num *
+				     sizeof(struct libusb_transfer *));
+		if (!dev->soft_q)
+			return -ENOMEM;
+		dev->soft_q_head = 0;
+		dev->soft_q_len = 0;
+	}
 
-		fprintf(stderr, "Enabled direct sampling mode, input %i\n", on);
-		dev->direct_sampling = on;
-	} else {
-		if (dev->tuner && dev->tuner->init) {
-			rtlsdr_set_i2c_repeater(dev, 1);
-			r |= dev->tuner->init(dev);
-			rtlsdr_set_i2c_repeater(dev, 0);
-		}
+	return 0;
+}
 
-		if (dev->tuner_type == RTLSDR_TUNER_R820T) {
-			r |= rtlsdr_set_if_freq(dev, R820T_IF_FREQ);
+static int _rtlsdr_free_async_buffers(rtlsdr_dev_t *dev)
+{
+	unsigned int i;
 
-			/* enable spectrum inversion */
-			r |= rtlsdr_demod_write_reg(dev, 1, 0x15, 0x01, 1);
-		} else {
-			r |= rtlsdr_set_if_freq(dev, 0);
+	if (!dev)
+		return -1;
 
-			/* enable In-phase + Quadrature ADC input */
-			r |= rtlsdr_demod_write_reg(dev, 0, 0x08, 0xcd, 1);
+	if (dev->xfer) {
+		for(i = 0; i < dev->xfer_buf_num; ++i) {
+			if (dev->xfer[i]) {
+				libusb_free_transfer(dev->xfer[i]);
+			}
+		}
 
-			/* Enable Zero-IF mode */
-			r |= rtlsdr_demod_write_reg(dev, 1, 0xb1, 0x1b, 1);
+		free(dev->xfer);
+		dev->xfer = NULL;
+	}
+
+	if (dev->xfer_buf) {
+		for(i = 0; i < dev->xfer_buf_num; ++i) {
+			if (dev->xfer_buf[i])
+				free(dev->xfer_buf[i]);
 		}
 
-		/* opt_adc_iq = 0, default ADC_I/ADC_Q datapath */
-		r |= rtlsdr_demod_write_reg(dev, 0, 0x06, 0x80, 1);
-
-		fprintf(stderr, "Disabled direct sampling mode\n");
-		dev->direct_sampling = 0;
+		free(dev->xfer_buf);
+		dev->xfer_buf = NULL;
 	}
 
-	r |= rtlsdr_set_center_freq(dev, dev->freq);
+	free(dev->soft_q);
+	dev->soft_q = NULL;
 
-	return r;
+	return 0;
 }
 
-int rtlsdr_get_direct_sampling(rtlsdr_dev_t *dev)
+/* runs the event loop, the caller has already moved the device from
+ * RTLSDR_INACTIVE to RTLSDR_RUNNING */
+static int _rtlsdr_async_begin(rtlsdr_dev_t *dev, rtlsdr_read_async_cb_t cb,
+			       rtlsdr_read_async_ex_cb_t cb_ex, void *ctx,
+			       uint32_t buf_num, uint32_t buf_len, int ring)
 {
-	if (!dev)
-		return -1;
-
-	return dev->direct_sampling;
-}
+	unsigned int i;
 
-int rtlsdr_set_offset_tuning(rtlsdr_dev_t *dev, int on)
-{
-	int r = 0;
+	dev->cb = cb;
+	dev->cb_ex = cb_ex;
+	dev->cb_ctx = ctx;
 
-	if (!dev)
-		return -1;
+	if (buf_num > 0)
+		dev->xfer_buf_num = buf_num;
+	else
+		dev->xfer_buf_num = DEFAULT_BUF_NUMBER;
 
-	if (dev->tuner_type == RTLSDR_TUNER_R820T)
-		return -2;
+	if (buf_len > 0 && buf_len % 512 == 0) /* len must be multiple of 512 */
+		dev->xfer_buf_len = buf_len;
+	else
+		dev->xfer_buf_len = DEFAULT_BUF_LENGTH;
 
-	if (dev->direct_sampling)
-		return -3;
+	rtlsdr_reset_stream_stats(dev);
+	memset(&dev->clk, 0, sizeof(dev->clk));
+	dev->soft_start_us = 0;
+	dev->soft_bytes = 0;
+
+	if (ring) {
+		dev->ring_slot = calloc(dev->xfer_buf_num,
+					sizeof(struct rtlsdr_ring_slot));
+		if (!dev->ring_slot) {
+			/* let consumers already waiting see the end */
+			dev->ring_stopped = 1;
+			_rtlsdr_ring_wake(dev);
+			dev->async_status = RTLSDR_INACTIVE;
+			return -ENOMEM;
+		}
 
-	/* based on keenerds 1/f noise measurements */
-	dev->offs_freq = on ? ((dev->rate / 2) * 170 / 100) : 0;
-	r |= rtlsdr_set_if_freq(dev, dev->offs_freq);
+		dev->ring_head = 0;
+		memset((void *)dev->ring_acq, 0, sizeof(dev->ring_acq));
+		memset((void *)dev->ring_rel, 0, sizeof(dev->ring_rel));
+		dev->ring_held = 0;
+		dev->ring_stopped = 0;
+		dev->ring_mode = 1;
+	}
 
-	if (dev->tuner && dev->tuner->set_bw) {
-		rtlsdr_set_i2c_repeater(dev, 1);
-		dev->tuner->set_bw(dev, on ? (2 * dev->offs_freq) : dev->rate);
-		rtlsdr_set_i2c_repeater(dev, 0);
+	if (_rtlsdr_alloc_async_buffers(dev) < 0) {
+		_rtlsdr_free_async_buffers(dev);
+		if (ring) {
+			dev->ring_mode = 0;
+			free(dev->ring_slot);
+			dev->ring_slot = NULL;
+			dev->ring_stopped = 1;
+			_rtlsdr_ring_wake(dev);
+		}
+		dev->async_status = RTLSDR_INACTIVE;
+		return -ENOMEM;
 	}
 
-	if (dev->freq > dev->offs_freq)
-		r |= rtlsdr_set_center_freq(dev, dev->freq);
+	dev->xfer_inflight = 0;
 
-	return r;
-}
+	for(i = 0; i < dev->xfer_buf_num; ++i) {
+		libusb_fill_bulk_transfer(dev->xfer[i],
+					  dev->devh,
+					  0x81,
+					  dev->xfer_buf[i],
+					  dev->xfer_buf_len,
+					  _libusb_callback,
+					  (void *)dev,
+					  BULK_TIMEOUT);
 
-int rtlsdr_get_offset_tuning(rtlsdr_dev_t *dev)
-{
-	if (!dev)
-		return -1;
+		_rtlsdr_submit_transfer(dev, dev->xfer[i]);
+	}
 
-	return (dev->offs_freq) ? 1 : 0;
+	return 0;
 }
 
-static rtlsdr_dongle_t *find_known_device(uint16_t vid, uint16_t pid)
+/* one round of the cancel handshake, returns 1 once nothing is in flight */
+static int _rtlsdr_async_cancel(rtlsdr_dev_t *dev, int ring)
 {
 	unsigned int i;
-	rtlsdr_dongle_t *device = NULL;
 
-	for (i = 0; i < sizeof(known_devices)/sizeof(rtlsdr_dongle_t); i++ ) {
-		if (known_devices[i].vid == vid && known_devices[i].pid == pid) {
-			device = &known_devices[i];
-			break;
-		}
-	}
+	if (!dev->xfer)
+		return 1;
 
-	return device;
-}
+	if (ring && !dev->ring_stopped)
+		_rtlsdr_ring_stop(dev);
 
-uint32_t rtlsdr_get_device_count(void)
-{
-	int i;
-	libusb_context *ctx;
-	libusb_device **list;
-	uint32_t device_count = 0;
-	struct libusb_device_descriptor dd;
-	ssize_t cnt;
+	/* transfers parked in the ring or retired by a failed
+	 * resubmission are not in flight any more */
+	if (!dev->xfer_inflight)
+		return 1;
 
-	libusb_init(&ctx);
+	if (dev->xport->soft_stream)
+		return _rtlsdr_soft_cancel(dev);
+
+	for(i = 0; i < dev->xfer_buf_num; ++i) {
+		if (!dev->xfer[i])
+			continue;
 
-	cnt = libusb_get_device_list(ctx, &list);
+		if (LIBUSB_TRANSFER_CANCELLED != dev->xfer[i]->status)
+			libusb_cancel_transfer(dev->xfer[i]);
+	}
 
-	for (i = 0; i < cnt; i++) {
-		libusb_get_device_descriptor(list[i], &dd);
+	return 0;
+}
 
-		if (find_known_device(dd.idVendor, dd.idProduct))
-			device_count++;
+static void _rtlsdr_async_end(rtlsdr_dev_t *dev, int ring,
+			      enum rtlsdr_async_status next_status)
+{
+	if (ring) {
+		/* a forced cancel leaves the loop without stopping the ring */
+		if (!dev->ring_stopped)
+			_rtlsdr_ring_stop(dev);
+
+		_rtlsdr_ring_drain(dev);
 	}
 
-	libusb_free_device_list(list, 1);
+	_rtlsdr_free_async_buffers(dev);
 
-	libusb_exit(ctx);
+	/* nothing left in flight, so the device is idle whichever way the
+	 * loop was left */
+	if (!dev->xfer_inflight)
+		next_status = RTLSDR_INACTIVE;
 
-	return device_count;
+	dev->async_status = next_status;
 }
 
-const char *rtlsdr_get_device_name(uint32_t index)
+static int _rtlsdr_run_async(rtlsdr_dev_t *dev, rtlsdr_read_async_cb_t cb,
+			     rtlsdr_read_async_ex_cb_t cb_ex, void *ctx,
+			     uint32_t buf_num, uint32_t buf_len, int ring)
 {
-	int i;
-	libusb_context *ctx;
-	libusb_device **list;
-	struct libusb_device_descriptor dd;
-	rtlsdr_dongle_t *device = NULL;
-	uint32_t device_count = 0;
-	ssize_t cnt;
-
-	libusb_init(&ctx);
+	int r = 0;
+	struct timeval tv;
+	enum rtlsdr_async_status next_status = RTLSDR_INACTIVE;
 
-	cnt = libusb_get_device_list(ctx, &list);
+	r = _rtlsdr_async_begin(dev, cb, cb_ex, ctx, buf_num, buf_len, ring);
+	if (r < 0)
+		return r;
 
-	for (i = 0; i < cnt; i++) {
-		libusb_get_device_descriptor(list[i], &dd);
+	while (RTLSDR_INACTIVE != dev->async_status) {
+		/* the timeout bounds how long a cancel may go unnoticed */
+		tv.tv_sec = dev->cancel_latency_ms / 1000;
+		tv.tv_usec = (dev->cancel_latency_ms % 1000) * 1000;
 
-		device = find_known_device(dd.idVendor, dd.idProduct);
+		if (dev->xport->soft_stream)
+			r = _rtlsdr_soft_step(dev);
+		else
+			r = libusb_handle_events_timeout(dev->ctx, &tv);
+		if (r < 0) {
+			/*fprintf(stderr, "handle_events returned: %d\n", r);*/
+			if (r == LIBUSB_ERROR_INTERRUPTED) /* stray signal */
+				continue;
+			break;
+		}
 
-		if (device) {
-			device_count++;
+		if (RTLSDR_CANCELING == dev->async_status) {
+			next_status = RTLSDR_INACTIVE;
 
-			if (index == device_count - 1)
+			if (_rtlsdr_async_cancel(dev, ring))
 				break;
+
+			next_status = RTLSDR_CANCELING;
 		}
 	}
 
-	libusb_free_device_list(list, 1);
-
-	libusb_exit(ctx);
+	_rtlsdr_async_end(dev, ring, next_status);
 
-	if (device)
-		return device->name;
-	else
-		return "";
+	return r;
 }
 
-int rtlsdr_get_device_usb_strings(uint32_t index, char *manufact,
-				   char *product, char *serial)
+static int _rtlsdr_read_async(rtlsdr_dev_t *dev, rtlsdr_read_async_cb_t cb,
+			      rtlsdr_read_async_ex_cb_t cb_ex, void *ctx,
+			      uint32_t buf_num, uint32_t buf_len, int ring)
 {
-	int r = -2;
-	int i;
-	libusb_context *ctx;
-	libusb_device **list;
-	struct libusb_device_descriptor dd;
-	rtlsdr_dongle_t *device = NULL;
-	rtlsdr_dev_t devt;
-	uint32_t device_count = 0;
-	ssize_t cnt;
+	if (!dev)
+		return -1;
 
-	libusb_init(&ctx);
+	if (RTLSDR_INACTIVE != dev->async_status)
+		return -2;
 
-	cnt = libusb_get_device_list(ctx, &list);
+	dev->async_status = RTLSDR_RUNNING;
 
-	for (i = 0; i < cnt; i++) {
-		libusb_get_device_descriptor(list[i], &dd);
+	return _rtlsdr_run_async(dev, cb, cb_ex, ctx, buf_num, buf_len, ring);
+}
 
-		device = find_known_device(dd.idVendor, dd.idProduct);
+int rtlsdr_read_async(rtlsdr_dev_t *dev, rtlsdr_read_async_cb_t cb, void *ctx,
+			  uint32_t buf_num, uint32_t buf_len)
+{
+	return _rtlsdr_read_async(dev, cb, NULL, ctx, buf_num, buf_len, 0);
+}
 
-		if (device) {
-			device_count++;
+int rtlsdr_read_async_ex(rtlsdr_dev_t *dev, rtlsdr_read_async_ex_cb_t cb,
+			 void *ctx, uint32_t buf_num, uint32_t buf_len)
+{
+	return _rtlsdr_read_async(dev, NULL, cb, ctx, buf_num, buf_len, 0);
+}
 
-			if (index == device_count - 1) {
-				r = libusb_open(list[i], &devt.devh);
-				if (!r) {
-					r = rtlsdr_get_usb_strings(&devt,
-								   manufact,
-								   product,
-								   serial);
-					libusb_close(devt.devh);
-				}
-				break;
-			}
-		}
-	}
+int rtlsdr_read_async_ring(rtlsdr_dev_t *dev, uint32_t buf_num, uint32_t buf_len)
+{
+	return _rtlsdr_read_async(dev, NULL, NULL, NULL, buf_num, buf_len, 1);
+}
 
-	libusb_free_device_list(list, 1);
+int rtlsdr_set_cancel_latency(rtlsdr_dev_t *dev, uint32_t ms)
+{
+	if (!dev || !ms)
+		return -1;
 
-	libusb_exit(ctx);
+	dev->cancel_latency_ms = ms;
 
-	return r;
+	return 0;
 }
 
-int rtlsdr_get_index_by_serial(const char *serial)
+int rtlsdr_set_stream_thread(rtlsdr_dev_t *dev, int cpu, int rt_priority)
 {
-	int i, cnt, r;
-	char str[256];
-
-	if (!serial)
+	if (!dev || rt_priority < 0)
 		return -1;
 
-	cnt = rtlsdr_get_device_count();
-
-	if (!cnt)
+	if (dev->stream_active)
 		return -2;
 
-	for (i = 0; i < cnt; i++) {
-		r = rtlsdr_get_device_usb_strings(i, NULL, NULL, str);
-		if (!r && !strcmp(serial, str))
-			return i;
-	}
+	dev->stream_cpu = cpu;
+	dev->stream_rt_prio = rt_priority;
 
-	return -3;
+	return 0;
 }
 
-int rtlsdr_open(rtlsdr_dev_t **out_dev, uint32_t index)
+static void *_rtlsdr_stream_thread_fn(void *arg)
 {
+	rtlsdr_dev_t *dev = (rtlsdr_dev_t *)arg;
+#if !defined(_WIN32) && !defined(__APPLE__)
+	struct sched_param param;
+#endif
+#ifdef __linux__
+	cpu_set_t cpus;
+#endif
 	int r;
-	int i;
-	libusb_device **list;
-	rtlsdr_dev_t *dev = NULL;
-	libusb_device *device = NULL;
-	uint32_t device_count = 0;
-	struct libusb_device_descriptor dd;
-	uint8_t reg;
-	ssize_t cnt;
 
-	dev = malloc(sizeof(rtlsdr_dev_t));
-	if (NULL == dev)
-		return -ENOMEM;
+	if (dev->stream_cpu >= 0) {
+#if defined(__linux__)
+		CPU_ZERO(&cpus);
+		CPU_SET(dev->stream_cpu, &cpus);
+		r = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#elif defined(_WIN32)
+		r = SetThreadAffinityMask(GetCurrentThread(),
+					  (DWORD_PTR)1 << dev->stream_cpu) ? 0 : -1;
+#else
+		r = -1;
+#endif
+		if (r)
+			fprintf(stderr, "Failed to pin event thread to CPU %d\n",
+				dev->stream_cpu);
+	}
 
-	memset(dev, 0, sizeof(rtlsdr_dev_t));
+	if (dev->stream_rt_prio > 0) {
+#if defined(_WIN32)
+		r = SetThreadPriority(GetCurrentThread(),
+				      THREAD_PRIORITY_TIME_CRITICAL) ? 0 : -1;
+#elif defined(__APPLE__)
+		r = -1;
+#else
+		param.sched_priority = dev->stream_rt_prio;
+		r = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+#endif
+		if (r)
+			fprintf(stderr, "Failed to enable realtime scheduling "
+				"for the event thread\n");
+	}
 
-	libusb_init(&dev->ctx);
+	dev->stream_result = _rtlsdr_run_async(dev, NULL, NULL, NULL,
+					       dev->stream_buf_num,
+					       dev->stream_buf_len, 1);
 
-	cnt = libusb_get_device_list(dev->ctx, &list);
+	return NULL;
+}
 
-	for (i = 0; i < cnt; i++) {
-		device = list[i];
+int rtlsdr_start_streaming(rtlsdr_dev_t *dev, uint32_t buf_num, uint32_t buf_len)
+{
+	if (!dev)
+		return -1;
 
-		libusb_get_device_descriptor(list[i], &dd);
+	if (dev->stream_active || RTLSDR_INACTIVE != dev->async_status)
+		return -2;
 
-		if (find_known_device(dd.idVendor, dd.idProduct)) {
-			device_count++;
-		}
+	/* claim the device before the thread runs, so a cancel issued right
+	 * after this call is not lost */
+	dev->async_status = RTLSDR_RUNNING;
+	dev->ring_stopped = 0;
+	dev->stream_buf_num = buf_num;
+	dev->stream_buf_len = buf_len;
+
+	if (pthread_create(&dev->stream_thread, NULL,
+			   _rtlsdr_stream_thread_fn, dev)) {
+		dev->ring_stopped = 1;
+		_rtlsdr_ring_wake(dev);
+		dev->async_status = RTLSDR_INACTIVE;
+		return -3;
+	}
 
-		if (index == device_count - 1)
-			break;
+	dev->stream_active = 1;
 
-		device = NULL;
-	}
+	return 0;
+}
 
-	if (!device) {
-		r = -1;
-		goto err;
-	}
+int rtlsdr_stop_streaming(rtlsdr_dev_t *dev)
+{
+	if (!dev)
+		return -1;
 
-	r = libusb_open(device, &dev->devh);
-	if (r < 0) {
-		libusb_free_device_list(list, 1);
-		fprintf(stderr, "usb_open error %d\n", r);
-		goto err;
-	}
+	if (!dev->stream_active)
+		return -2;
 
-	libusb_free_device_list(list, 1);
+	/* a signal handler may cancel concurrently; a second cancel would
+	 * force the state and skip the teardown */
+	rtlsdr_atomic_cas(&dev->async_status, RTLSDR_RUNNING, RTLSDR_CANCELING);
 
-	r = libusb_claim_interface(dev->devh, 0);
-	if (r < 0) {
-		fprintf(stderr, "usb_claim_interface error %d\n", r);
-		goto err;
-	}
+	pthread_join(dev->stream_thread, NULL);
+	dev->stream_active = 0;
 
-	dev->rtl_xtal = DEF_RTL_XTAL_FREQ;
+	return dev->stream_result;
+}
 
-	rtlsdr_init_baseband(dev);
+int rtlsdr_ring_add_consumer(rtlsdr_dev_t *dev)
+{
+	int i;
 
-	/* Probe tuners */
-	rtlsdr_set_i2c_repeater(dev, 1);
+	if (!dev)
+		return -1;
+
+	/* the consumer set is fixed while streaming */
+	if (RTLSDR_INACTIVE != dev->async_status)
+		return -2;
+
+	for (i = 0; i < RTLSDR_RING_MAX_CONSUMERS; i++) {
+		if (dev->ring_consumers & (1 << i))
+			continue;
+
+		dev->ring_consumers |= 1 << i;
+		dev->ring_nconsumers++;
+		dev->ring_acq[i] = dev->ring_rel[i] = dev->ring_head;
 
-	reg = rtlsdr_i2c_read_reg(dev, E4K_I2C_ADDR, E4K_CHECK_ADDR);
-	if (reg == E4K_CHECK_VAL) {
-		fprintf(stderr, "Found Elonics E4000 tuner\n");
-		dev->tuner_type = RTLSDR_TUNER_E4000;
-		goto found;
+		return i;
 	}
 
-	reg = rtlsdr_i2c_read_reg(dev, FC0013_I2C_ADDR, FC0013_CHECK_ADDR);
-	if (reg == FC0013_CHECK_VAL) {
-		fprintf(stderr, "Found Fitipower FC0013 tuner\n");
-		dev->tuner_type = RTLSDR_TUNER_FC0013;
-		goto found;
-	}
+	return -3;
+}
 
-	reg = rtlsdr_i2c_read_reg(dev, R820T_I2C_ADDR, R820T_CHECK_ADDR);
-	if (reg == R820T_CHECK_VAL) {
-		fprintf(stderr, "Found Rafael Micro R820T tuner\n");
-		dev->tuner_type = RTLSDR_TUNER_R820T;
+int rtlsdr_ring_remove_consumer(rtlsdr_dev_t *dev, int consumer)
+{
+	if (!dev || consumer < 0 || consumer >= RTLSDR_RING_MAX_CONSUMERS)
+		return -1;
 
-		/* disable Zero-IF mode */
-		rtlsdr_demod_write_reg(dev, 1, 0xb1, 0x1a, 1);
+	if (!(dev->ring_consumers & (1 << consumer)))
+		return -1;
 
-		/* only enable In-phase ADC input */
-		rtlsdr_demod_write_reg(dev, 0, 0x08, 0x4d, 1);
+	if (RTLSDR_INACTIVE != dev->async_status)
+		return -2;
 
-		/* the R820T uses 3.57 MHz IF for the DVB-T 6 MHz mode, and
-		 * 4.57 MHz for the 8 MHz mode */
-		rtlsdr_set_if_freq(dev, R820T_IF_FREQ);
+	dev->ring_consumers &= ~(1 << consumer);
+	dev->ring_nconsumers--;
 
-		/* enable spectrum inversion */
-		rtlsdr_demod_write_reg(dev, 1, 0x15, 0x01, 1);
+	return 0;
+}
 
-		goto found;
-	}
+int rtlsdr_ring_acquire(rtlsdr_dev_t *dev, int consumer, unsigned char **buf,
+			uint32_t *len, int timeout_ms)
+{
+	struct rtlsdr_ring_slot *slot;
+	struct timespec ts;
+	int r = 0;
 
-	/* initialise GPIOs */
-	rtlsdr_set_gpio_output(dev, 5);
+	if (!dev || !buf || consumer < 0 || consumer >= RTLSDR_RING_MAX_CONSUMERS)
+		return -1;
 
-	/* reset tuner before probing */
-	rtlsdr_set_gpio_bit(dev, 5, 1);
-	rtlsdr_set_gpio_bit(dev, 5, 0);
+	if (!(dev->ring_consumers & (1 << consumer)))
+		return -1;
 
-	reg = rtlsdr_i2c_read_reg(dev, FC2580_I2C_ADDR, FC2580_CHECK_ADDR);
-	if ((reg & 0x7f) == FC2580_CHECK_VAL) {
-		fprintf(stderr, "Found FCI 2580 tuner\n");
-		dev->tuner_type = RTLSDR_TUNER_FC2580;
-		goto found;
-	}
+	/* announce ourselves before looking at the stop flag, the teardown
+	 * does it the other way round */
+	rtlsdr_atomic_inc(&dev->ring_busy);
 
-	reg = rtlsdr_i2c_read_reg(dev, FC0012_I2C_ADDR, FC0012_CHECK_ADDR);
-	if (reg == FC0012_CHECK_VAL) {
-		fprintf(stderr, "Found Fitipower FC0012 tuner\n");
-		rtlsdr_set_gpio_output(dev, 6);
-		dev->tuner_type = RTLSDR_TUNER_FC0012;
-		goto found;
+	if (dev->ring_stopped) {
+		r = -2;
+		goto out;
 	}
 
-found:
-	if (dev->tuner_type == RTLSDR_TUNER_UNKNOWN) {
-		fprintf(stderr, "No supported tuner found\n");
-		rtlsdr_set_direct_sampling(dev, 1);
-	}
+	if (dev->ring_acq[consumer] == dev->ring_head) {
+		if (!timeout_ms) {
+			r = -3;
+			goto out;
+		}
 
-	dev->tuner = &tuners[dev->tuner_type];
-	dev->tun_xtal = dev->rtl_xtal; /* use the rtl clock value by default */
+		if (timeout_ms > 0)
+			_rtlsdr_abstime(&ts, timeout_ms);
+
+		pthread_mutex_lock(&dev->ring_lock);
+		rtlsdr_atomic_inc(&dev->ring_waiters);
+		while (dev->ring_acq[consumer] == dev->ring_head &&
+		       !dev->ring_stopped && !r) {
+			if (timeout_ms > 0)
+				r = pthread_cond_timedwait(&dev->ring_cond,
+							   &dev->ring_lock, &ts);
+			else
+				pthread_cond_wait(&dev->ring_cond,
+						  &dev->ring_lock);
+		}
+		rtlsdr_atomic_dec(&dev->ring_waiters);
+		pthread_mutex_unlock(&dev->ring_lock);
 
-	if (dev->tuner->init)
-		r = dev->tuner->init(dev);
+		if (dev->ring_stopped) {
+			r = -2;
+			goto out;
+		}
 
-	rtlsdr_set_i2c_repeater(dev, 0);
+		if (dev->ring_acq[consumer] == dev->ring_head) {
+			r = -3;
+			goto out;
+		}
 
-	*out_dev = dev;
+		r = 0;
+	}
 
-	return 0;
-err:
-	if (dev) {
-		if (dev->ctx)
-			libusb_exit(dev->ctx);
+	rtlsdr_barrier(); /* head must be read before the slot contents */
 
-		free(dev);
-	}
+	slot = &dev->ring_slot[dev->ring_acq[consumer] % dev->xfer_buf_num];
+	*buf = slot->xfer->buffer;
+	if (len)
+		*len = slot->len;
+	dev->ring_acq[consumer]++;
+
+out:
+	rtlsdr_atomic_dec(&dev->ring_busy);
+	if (dev->ring_stopped)
+		_rtlsdr_ring_wake(dev);
 
 	return r;
 }
 
-int rtlsdr_close(rtlsdr_dev_t *dev)
+int rtlsdr_ring_get_info(rtlsdr_dev_t *dev, int consumer,
+			 rtlsdr_xfer_info_t *info)
 {
-	if (!dev)
+	if (!dev || !info || consumer < 0 || consumer >= RTLSDR_RING_MAX_CONSUMERS)
 		return -1;
 
-	/* block until all async operations have been completed (if any) */
-	while (RTLSDR_INACTIVE != dev->async_status) {
-#ifdef _WIN32
-		Sleep(1);
-#else
-		usleep(1000);
-#endif
-	}
-
-	rtlsdr_deinit_baseband(dev);
-
-	libusb_release_interface(dev->devh, 0);
-	libusb_close(dev->devh);
-
-	libusb_exit(dev->ctx);
+	/* nothing acquired */
+	if (dev->ring_rel[consumer] == dev->ring_acq[consumer])
+		return -1;
 
-	free(dev);
+	*info = dev->ring_slot[(dev->ring_acq[consumer] - 1) %
+			       dev->xfer_buf_num].info;
 
 	return 0;
 }
 
-int rtlsdr_reset_buffer(rtlsdr_dev_t *dev)
+int rtlsdr_ring_release(rtlsdr_dev_t *dev, int consumer)
 {
-	if (!dev)
+	struct rtlsdr_ring_slot *slot;
+
+	if (!dev || consumer < 0 || consumer >= RTLSDR_RING_MAX_CONSUMERS)
 		return -1;
 
-	rtlsdr_write_reg(dev, USBB, USB_EPA_CTL, 0x1002, 2);
-	rtlsdr_write_reg(dev, USBB, USB_EPA_CTL, 0x0000, 2);
+	/* nothing acquired */
+	if (dev->ring_rel[consumer] == dev->ring_acq[consumer])
+		return -1;
+
+	rtlsdr_atomic_inc(&dev->ring_busy);
+
+	slot = &dev->ring_slot[dev->ring_rel[consumer]++ % dev->xfer_buf_num];
+	if (!rtlsdr_atomic_dec(&slot->refs)) {
+		/* the last consumer out hands the transfer back */
+		_rtlsdr_stats_latency(dev, _rtlsdr_now_us() - slot->stamp);
+		rtlsdr_atomic_dec(&dev->ring_held);
+
+		if (!dev->ring_stopped)
+			_rtlsdr_submit_transfer(dev, slot->xfer);
+	}
+
+	rtlsdr_atomic_dec(&dev->ring_busy);
+	if (dev->ring_stopped)
+		_rtlsdr_ring_wake(dev);
 
 	return 0;
 }
 
-int rtlsdr_read_sync(rtlsdr_dev_t *dev, void *buf, int len, int *n_read)
+int rtlsdr_cancel_async(rtlsdr_dev_t *dev)
 {
 	if (!dev)
 		return -1;
 
-	return libusb_bulk_transfer(dev->devh, 0x81, buf, len, n_read, BULK_TIMEOUT);
+	/* if streaming, try to cancel gracefully */
+	if (rtlsdr_atomic_cas(&dev->async_status, RTLSDR_RUNNING,
+			      RTLSDR_CANCELING))
+		return 0;
+
+	/* the event thread always runs its teardown to completion */
+	if (dev->stream_active && RTLSDR_INACTIVE != dev->async_status)
+		return 0;
+
+	/* if called while in pending state, change the state forcefully */
+	if (RTLSDR_INACTIVE != dev->async_status) {
+		dev->async_status = RTLSDR_INACTIVE;
+		return 0;
+	}
+
+	return -2;
 }
 
-static void LIBUSB_CALL _libusb_callback(struct libusb_transfer *xfer)
+int rtlsdr_group_create(rtlsdr_group_t **out_group)
 {
-	rtlsdr_dev_t *dev = (rtlsdr_dev_t *)xfer->user_data;
+	struct rtlsdr_group *group;
 
-	if (LIBUSB_TRANSFER_COMPLETED == xfer->status) {
-		if (dev->cb)
-			dev->cb(xfer->buffer, xfer->actual_length, dev->cb_ctx);
+	if (!out_group)
+		return -1;
 
-		libusb_submit_transfer(xfer); /* resubmit transfer */
-	} else if (LIBUSB_TRANSFER_CANCELLED == xfer->status) {
-		/* nothing to do */
-	} else {
-		/*fprintf(stderr, "transfer status: %d\n", xfer->status);*/
+	group = malloc(sizeof(struct rtlsdr_group));
+	if (NULL == group)
+		return -ENOMEM;
+
+	memset(group, 0, sizeof(struct rtlsdr_group));
+
+	if (libusb_init(&group->ctx) < 0) {
+		free(group);
+		return -1;
 	}
+
+	*out_group = group;
+
+	return 0;
 }
 
-int rtlsdr_wait_async(rtlsdr_dev_t *dev, rtlsdr_read_async_cb_t cb, void *ctx)
+int rtlsdr_group_destroy(rtlsdr_group_t *group)
 {
-	return rtlsdr_read_async(dev, cb, ctx, 0, 0);
+	if (!group)
+		return -1;
+
+	if (group->running)
+		return -2;
+
+	/* rtlsdr_close() removes the device from the member list */
+	while (group->ndev)
+		rtlsdr_close(group->member[0].dev);
+
+	libusb_exit(group->ctx);
+	free(group);
+
+	return 0;
 }
 
-static int _rtlsdr_alloc_async_buffers(rtlsdr_dev_t *dev)
+int rtlsdr_group_open(rtlsdr_group_t *group, rtlsdr_dev_t **dev,
+		      uint32_t index)
 {
-	unsigned int i;
+	int r;
 
-	if (!dev)
+	if (!group || !dev)
 		return -1;
 
-	if (!dev->xfer) {
-		dev->xfer = malloc(dev->xfer_buf_num *
-				   sizeof(struct libusb_transfer *));
-
-		for(i = 0; i < dev->xfer_buf_num; ++i)
-			dev->xfer[i] = libusb_alloc_transfer(0);
-	}
+	if (group->running || group->ndev >= RTLSDR_GROUP_MAX_DEVICES)
+		return -2;
 
-	if (!dev->xfer_buf) {
-		dev->xfer_buf = malloc(dev->xfer_buf_num *
-					   sizeof(unsigned char *));
+	r = _rtlsdr_open(dev, index, group);
+	if (r < 0)
+		return r;
 
-		for(i = 0; i < dev->xfer_buf_num; ++i)
-			dev->xfer_buf[i] = malloc(dev->xfer_buf_len);
-	}
+	memset(&group->member[group->ndev], 0,
+	       sizeof(struct rtlsdr_group_member));
+	group->member[group->ndev++].dev = *dev;
 
 	return 0;
 }
 
-static int _rtlsdr_free_async_buffers(rtlsdr_dev_t *dev)
+int rtlsdr_group_set_callback(rtlsdr_dev_t *dev, rtlsdr_read_async_cb_t cb,
+			      void *ctx)
 {
-	unsigned int i;
+	struct rtlsdr_group *group;
+	uint32_t i;
 
-	if (!dev)
+	if (!dev || !dev->group)
 		return -1;
 
-	if (dev->xfer) {
-		for(i = 0; i < dev->xfer_buf_num; ++i) {
-			if (dev->xfer[i]) {
-				libusb_free_transfer(dev->xfer[i]);
-			}
-		}
-
-		free(dev->xfer);
-		dev->xfer = NULL;
-	}
+	group = dev->group;
+	if (group->running)
+		return -2;
 
-	if (dev->xfer_buf) {
-		for(i = 0; i < dev->xfer_buf_num; ++i) {
-			if (dev->xfer_buf[i])
-				free(dev->xfer_buf[i]);
-		}
+	for (i = 0; i < group->ndev; i++) {
+		if (group->member[i].dev != dev)
+			continue;
 
-		free(dev->xfer_buf);
-		dev->xfer_buf = NULL;
+		group->member[i].cb = cb;
+		group->member[i].cb_ctx = ctx;
+		return 0;
 	}
 
-	return 0;
+	return -1;
 }
 
-int rtlsdr_read_async(rtlsdr_dev_t *dev, rtlsdr_read_async_cb_t cb, void *ctx,
-			  uint32_t buf_num, uint32_t buf_len)
+int rtlsdr_group_read_async(rtlsdr_group_t *group, uint32_t buf_num,
+			    uint32_t buf_len)
 {
-	unsigned int i;
-	int r = 0;
-	struct timeval tv = { 1, 0 };
-	enum rtlsdr_async_status next_status = RTLSDR_INACTIVE;
-
-	if (!dev)
+	struct rtlsdr_group_member *m;
+	rtlsdr_dev_t *dev;
+	struct timeval tv;
+	uint32_t i, latency_ms = DEFAULT_CANCEL_LATENCY;
+	int active = 0;
+	int r = 0, err;
+
+	if (!group)
 		return -1;
 
-	if (RTLSDR_INACTIVE != dev->async_status)
+	if (group->running)
 		return -2;
 
-	dev->async_status = RTLSDR_RUNNING;
+	for (i = 0; i < group->ndev; i++) {
+		m = &group->member[i];
 
-	dev->cb = cb;
-	dev->cb_ctx = ctx;
+		if (m->cb && RTLSDR_INACTIVE != m->dev->async_status)
+			return -2;
+	}
 
-	if (buf_num > 0)
-		dev->xfer_buf_num = buf_num;
-	else
-		dev->xfer_buf_num = DEFAULT_BUF_NUMBER;
+	group->running = 1;
 
-	if (buf_len > 0 && buf_len % 512 == 0) /* len must be multiple of 512 */
-		dev->xfer_buf_len = buf_len;
-	else
-		dev->xfer_buf_len = DEFAULT_BUF_LENGTH;
+	for (i = 0; i < group->ndev; i++) {
+		m = &group->member[i];
+		dev = m->dev;
+		m->done = 1;
 
-	_rtlsdr_alloc_async_buffers(dev);
+		if (!m->cb)
+			continue;
 
-	for(i = 0; i < dev->xfer_buf_num; ++i) {
-		libusb_fill_bulk_transfer(dev->xfer[i],
-					  dev->devh,
-					  0x81,
-					  dev->xfer_buf[i],
-					  dev->xfer_buf_len,
-					  _libusb_callback,
-					  (void *)dev,
-					  BULK_TIMEOUT);
+		dev->async_status = RTLSDR_RUNNING;
+
+		r = _rtlsdr_async_begin(dev, m->cb, NULL, m->cb_ctx,
+					buf_num, buf_len, 0);
+		if (r < 0)
+			break;
 
-		libusb_submit_transfer(dev->xfer[i]);
+		m->done = 0;
+		active++;
+
+		if (dev->cancel_latency_ms < latency_ms)
+			latency_ms = dev->cancel_latency_ms;
 	}
 
-	while (RTLSDR_INACTIVE != dev->async_status) {
-		r = libusb_handle_events_timeout(dev->ctx, &tv);
+	/* tear down the members already started if one failed to start */
+	err = r;
+	if (err < 0)
+		rtlsdr_group_cancel_async(group);
+
+	tv.tv_sec = latency_ms / 1000;
+	tv.tv_usec = (latency_ms % 1000) * 1000;
+
+	while (active) {
+		r = libusb_handle_events_timeout(group->ctx, &tv);
 		if (r < 0) {
-			/*fprintf(stderr, "handle_events returned: %d\n", r);*/
 			if (r == LIBUSB_ERROR_INTERRUPTED) /* stray signal */
 				continue;
 			break;
 		}
 
-		if (RTLSDR_CANCELING == dev->async_status) {
-			next_status = RTLSDR_INACTIVE;
+		/* members are canceled individually, the loop keeps servicing
+		 * the others */
+		for (i = 0; i < group->ndev; i++) {
+			m = &group->member[i];
+			dev = m->dev;
 
-			if (!dev->xfer)
-				break;
+			if (m->done)
+				continue;
 
-			for(i = 0; i < dev->xfer_buf_num; ++i) {
-				if (!dev->xfer[i])
-					continue;
+			if (RTLSDR_RUNNING == dev->async_status)
+				continue;
 
-				if (LIBUSB_TRANSFER_CANCELLED !=
-						dev->xfer[i]->status) {
-					libusb_cancel_transfer(dev->xfer[i]);
-					next_status = RTLSDR_CANCELING;
-				}
-			}
+			if (RTLSDR_CANCELING == dev->async_status &&
+			    !_rtlsdr_async_cancel(dev, 0))
+				continue;
 
-			if (RTLSDR_INACTIVE == next_status)
-				break;
+			_rtlsdr_async_end(dev, 0, RTLSDR_INACTIVE);
+			m->done = 1;
+			active--;
 		}
 	}
 
-	_rtlsdr_free_async_buffers(dev);
+	for (i = 0; i < group->ndev; i++) {
+		m = &group->member[i];
 
-	dev->async_status = next_status;
+		if (m->done)
+			continue;
 
-	return r;
+		_rtlsdr_async_end(m->dev, 0, RTLSDR_INACTIVE);
+		m->done = 1;
+	}
+
+	group->running = 0;
+
+	return err < 0 ? err : r;
 }
 
-int rtlsdr_cancel_async(rtlsdr_dev_t *dev)
+int rtlsdr_group_cancel_async(rtlsdr_group_t *group)
 {
-	if (!dev)
+	uint32_t i;
+
+	if (!group)
 		return -1;
 
-	/* if streaming, try to cancel gracefully */
-	if (RTLSDR_RUNNING == dev->async_status) {
-		dev->async_status = RTLSDR_CANCELING;
-		return 0;
-	}
+	if (!group->running)
+		return -2;
 
-	/* if called while in pending state, change the state forcefully */
-	if (RTLSDR_INACTIVE != dev->async_status) {
-		dev->async_status = RTLSDR_INACTIVE;
-		return 0;
-	}
+	for (i = 0; i < group->ndev; i++)
+		rtlsdr_atomic_cas(&group->member[i].dev->async_status,
+				  RTLSDR_RUNNING, RTLSDR_CANCELING);
 
-	return -2;
+	return 0;
 }
 
 uint32_t rtlsdr_get_tuner_clock(void *dev)
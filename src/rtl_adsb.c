@@ -36,16 +36,13 @@
 #include "getopt/getopt.h"
 #endif
 
-#include <semaphore.h>
-#include <pthread.h>
 #include <libusb.h>
 
 #include "rtl-sdr.h"
+#include "rtl-sdr_dsp.h"
 
 #ifdef _WIN32
 #define sleep Sleep
-#undef min
-#undef max
 #endif
 
 #define ADSB_RATE			2000000
@@ -54,22 +51,62 @@
 #define DEFAULT_BUF_LENGTH		(128 * 16384)
 #define AUTO_GAIN			-100
 
-static pthread_t demod_thread;
-static sem_t data_ready;
 static volatile int do_exit = 0;
 static rtlsdr_dev_t *dev = NULL;
 
 /* todo, bundle these up in a struct */
-uint8_t *buffer;
 int raw_output = 0;
 int short_output = 0;
+int mlat_output = 0;
+uint64_t buf_sample_index;
+uint64_t frame_sample_index;
 int allowed_errors = 5;
+int crc_check = 1;
+int fix_bits = 1;
 FILE *file;
-int adsb_frame[14];
+unsigned char adsb_frame[14];
+uint32_t frame_icao;
 #define preamble_len		16
+#define preamble_pattern	0x0285	/* pulses at 0, 1, 3.5 and 4.5 us */
 #define long_frame		112
 #define short_frame		56
 
+/* Mode S parity, x^24 + x^23 + ... + x^12 + x^10 + x^3 + 1 */
+#define MODES_POLY		0xfff409
+#define MAX_FIX_BITS		2
+#define ICAO_CACHE_SIZE		1024	/* power of two */
+#define ICAO_PROBES		4
+#define ICAO_TTL		(60ULL * ADSB_RATE)	/* samples */
+
+/* slice-by-8, table k is a byte followed by k zero bytes */
+uint32_t crc_table[8][256];
+
+struct fix_entry
+{
+	uint32_t syndrome;
+	int bit[MAX_FIX_BITS];	/* -1 when unused */
+};
+
+/* syndromes of every correctable error pattern, sorted */
+struct fix_table
+{
+	struct fix_entry *fix;
+	int len;
+};
+
+struct fix_table fix_short, fix_long;
+
+struct icao_entry
+{
+	uint32_t addr;
+	uint64_t seen;	/* sample index + 1, zero is an empty slot */
+};
+
+struct icao_entry icao_cache[ICAO_CACHE_SIZE];
+
+/* frames that passed, were corrected and were dropped */
+uint64_t frames_good, frames_fixed, frames_bad;
+
 void usage(void)
 {
 	fprintf(stderr,
@@ -78,7 +115,10 @@ void usage(void)
 		"\t[-d device_index (default: 0)]\n"
 		"\t[-R output raw bitstream (default: off)]\n"
 		"\t[-S show short frames (default: off)]\n"
+		"\t[-T prefix raw frames with a 12 MHz MLAT timestamp (default: off)]\n"
 		"\t[-e allowed_errors (default: 5)]\n"
+		"\t[-c crc_fix_bits, 0 to 2 (default: 1)]\n"
+		"\t[-N output frames without checking the CRC (default: off)]\n"
 		"\t[-g tuner_gain (default: automatic)]\n"
 		"\t[-p ppm_error (default: 0)]\n"
 		"\tfilename (a '-' dumps samples to stdout)\n"
@@ -111,11 +151,20 @@ static void sighandler(int signum)
 }
 #endif
 
-void display(int *frame, int len)
+void display(unsigned char *frame, int len)
 {
 	int i;
 	if (!short_output && len <= short_frame) {
 		return;}
+	if (raw_output && mlat_output) {
+		/* AVR-MLAT format, 48 bit counter of 12 MHz ticks */
+		fprintf(file, "@%012llx", (unsigned long long)
+			((frame_sample_index * (12000000 / ADSB_RATE)) & 0xffffffffffffULL));
+		for (i=0; i<((len+7)/8); i++) {
+			fprintf(file, "%02x", frame[i]);}
+		fprintf(file, ";\r\n");
+		return;
+	}
 	if (raw_output) {
 		fprintf(file, "*");
 		for (i=0; i<((len+7)/8); i++) {
@@ -125,7 +174,7 @@ void display(int *frame, int len)
 	}
 	fprintf(file, "----------\n");
 	fprintf(file, "DF=%x CA=%x\n", (frame[0] >> 3) & 0x1f, frame[0] & 0x07);
-	fprintf(file, "ICAO Address=%06x\n", frame[1] << 16 | frame[2] << 8 | frame[3]);
+	fprintf(file, "ICAO Address=%06x\n", frame_icao);
 	if (len <= short_frame) {
 		return;}
 	fprintf(file, "PI=0x%06x\n",  frame[11] << 16 | frame[12] << 8 | frame[13]);
@@ -135,13 +184,7 @@ void display(int *frame, int len)
 int magnitute(unsigned char *buf, int len)
 /* takes i/q, changes buf in place, returns new len */
 {
-	int i, mag;
-	for (i=0; i<len; i+=2) {
-		mag = abs((int)buf[i]-128) + abs((int)buf[i+1]-128);
-		if (mag > 255) {  // todo, compression
-			mag = 255;}
-		buf[i/2] = (unsigned char)mag;
-	}
+	rtlsdr_dsp_magnitude_u8(buf, buf, len);
 	return len/2;
 }
 
@@ -162,62 +205,27 @@ inline unsigned char single_manchester(unsigned char a, unsigned char b, unsigne
 	return 255;
 }
 
-inline unsigned char min(unsigned char a, unsigned char b)
-{
-	return a<b ? a : b;
-}
-
-inline unsigned char max(unsigned char a, unsigned char b)
-{
-	return a>b ? a : b;
-}
-
-inline int preamble(unsigned char *buf, int len, int i)
-/* returns 0/1 for preamble at index i */
-{
-	int i2;
-	unsigned char low  = 0;
-	unsigned char high = 255;
-	for (i2=0; i2<preamble_len; i2++) {
-		switch (i2) {
-			case 0:
-			case 2:
-			case 7:
-			case 9:
-				high = min(high, buf[i+i2]);
-				break;
-			default:
-				low  = max(low,  buf[i+i2]);
-				break;
-		}
-		if (high <= low) {
-			return 0;}
-	}
-	return 1;
-}
-
 void manchester(unsigned char *buf, int len)
 /* overwrites magnitude buffer with valid bits (255 on errors) */
 {
 	/* a and b hold old values to verify local manchester */
 	unsigned char a=0, b=0;
 	unsigned char bit;
-	int i, i2, start, errors;
+	int i, i2, start, errors, found;
 	// todo, allow wrap across buffers
 	i = 0;
 	while (i < len) {
-		/* find preamble */
-		for ( ; i < (len - preamble_len); i++) {
-			if (!preamble(buf, len, i)) {
-				continue;}
-			a = buf[i];
-			b = buf[i+1];
-			for (i2=0; i2<preamble_len; i2++) {
-				buf[i+i2] = 253;}
-			i += preamble_len;
-			//printf("preamble found\n");
-			break;
-		}
+		/* find preamble, many offsets are screened at once */
+		found = rtlsdr_dsp_pulse_find_u8(buf + i, len - i, preamble_pattern);
+		if (found < 0) {
+			break;}
+		i += found;
+		a = buf[i];
+		b = buf[i+1];
+		for (i2=0; i2<preamble_len; i2++) {
+			buf[i+i2] = 253;}
+		i += preamble_len;
+		//printf("preamble found\n");
 		i2 = start = i;
 		errors = 0;
 		/* mark bits until encoding breaks */
@@ -244,6 +252,200 @@ void manchester(unsigned char *buf, int len)
 	}
 }
 
+void crc_init(void)
+{
+	uint32_t c;
+	int i, j;
+	for (i=0; i<256; i++) {
+		c = (uint32_t)i << 16;
+		for (j=0; j<8; j++) {
+			c = (c & 0x800000) ? (c << 1) ^ MODES_POLY : c << 1;}
+		crc_table[0][i] = c & 0xffffff;
+	}
+	for (j=1; j<8; j++) {
+		for (i=0; i<256; i++) {
+			c = crc_table[j-1][i];
+			crc_table[j][i] = ((c << 8) & 0xffffff) ^ crc_table[0][c >> 16];
+		}
+	}
+}
+
+uint32_t crc24(unsigned char *data, int len)
+/* remainder of len bytes, eight at a time while possible */
+{
+	uint32_t c = 0;
+	for (; len >= 8; data += 8, len -= 8) {
+		c = crc_table[7][data[0] ^ (c >> 16)] ^
+		    crc_table[6][data[1] ^ ((c >> 8) & 0xff)] ^
+		    crc_table[5][data[2] ^ (c & 0xff)] ^
+		    crc_table[4][data[3]] ^ crc_table[3][data[4]] ^
+		    crc_table[2][data[5]] ^ crc_table[1][data[6]] ^
+		    crc_table[0][data[7]];
+	}
+	for (; len > 0; data++, len--) {
+		c = ((c << 8) & 0xffffff) ^ crc_table[0][*data ^ (c >> 16)];}
+	return c;
+}
+
+uint32_t syndrome(unsigned char *frame, int bits)
+/* zero for an intact DF11/17/18, the address for AP overlaid frames */
+{
+	int bytes = bits / 8;
+	return crc24(frame, bytes-3) ^
+		(frame[bytes-3] << 16 | frame[bytes-2] << 8 | frame[bytes-1]);
+}
+
+int fix_cmp(const void *a, const void *b)
+{
+	uint32_t sa = ((const struct fix_entry*)a)->syndrome;
+	uint32_t sb = ((const struct fix_entry*)b)->syndrome;
+	return (sa > sb) - (sa < sb);
+}
+
+void fix_table_init(struct fix_table *t, int bits)
+/* the code is linear, so a pattern's syndrome is the xor of its bits' */
+{
+	unsigned char frame[14];
+	uint32_t single[long_frame];
+	int i, j, n;
+	for (i=0; i<bits; i++) {
+		memset(frame, 0, sizeof(frame));
+		frame[i/8] = (unsigned char)(0x80 >> (i%8));
+		single[i] = syndrome(frame, bits);
+	}
+	/* the downlink format is never corrected, a fix there changes the frame */
+	n = (bits-5) + (bits-5)*(bits-6)/2;
+	t->fix = malloc(n * sizeof(struct fix_entry));
+	t->len = 0;
+	for (i=5; i<bits; i++) {
+		t->fix[t->len].syndrome = single[i];
+		t->fix[t->len].bit[0] = i;
+		t->fix[t->len].bit[1] = -1;
+		t->len++;
+		for (j=i+1; j<bits; j++) {
+			t->fix[t->len].syndrome = single[i] ^ single[j];
+			t->fix[t->len].bit[0] = i;
+			t->fix[t->len].bit[1] = j;
+			t->len++;
+		}
+	}
+	qsort(t->fix, t->len, sizeof(struct fix_entry), fix_cmp);
+	/* patterns sharing a syndrome can not be told apart */
+	for (i=1; i<t->len; i++) {
+		if (t->fix[i].syndrome != t->fix[i-1].syndrome) {
+			continue;}
+		t->fix[i].bit[0] = t->fix[i-1].bit[0] = -1;
+	}
+}
+
+int fix_frame(unsigned char *frame, int bits, uint32_t s, int max)
+/* flips up to max bits behind syndrome s, returns how many or 0 */
+{
+	struct fix_table *t = bits == long_frame ? &fix_long : &fix_short;
+	struct fix_entry key, *f;
+	int i, n;
+	key.syndrome = s;
+	f = bsearch(&key, t->fix, t->len, sizeof(struct fix_entry), fix_cmp);
+	if (!f || f->bit[0] < 0) {
+		return 0;}
+	n = f->bit[1] < 0 ? 1 : 2;
+	if (n > max) {
+		return 0;}
+	for (i=0; i<n; i++) {
+		frame[f->bit[i]/8] ^= (unsigned char)(0x80 >> (f->bit[i]%8));}
+	return n;
+}
+
+struct icao_entry *icao_slot(uint32_t addr, int i)
+{
+	uint32_t h = (addr * 2654435761U) >> 22;
+	return &icao_cache[(h + i) & (ICAO_CACHE_SIZE-1)];
+}
+
+void icao_add(uint32_t addr)
+/* refreshes the aircraft, or evicts the stalest one near its slot */
+{
+	struct icao_entry *e, *old;
+	int i;
+	old = icao_slot(addr, 0);
+	for (i=0; i<ICAO_PROBES; i++) {
+		e = icao_slot(addr, i);
+		if (e->seen && e->addr == addr) {
+			old = e;
+			break;
+		}
+		if (e->seen < old->seen) {
+			old = e;}
+	}
+	old->addr = addr;
+	old->seen = frame_sample_index + 1;
+}
+
+int icao_recent(uint32_t addr)
+{
+	struct icao_entry *e;
+	int i;
+	for (i=0; i<ICAO_PROBES; i++) {
+		e = icao_slot(addr, i);
+		if (e->seen && e->addr == addr) {
+			return frame_sample_index + 1 - e->seen < ICAO_TTL;}
+	}
+	return 0;
+}
+
+int check_frame(unsigned char *frame, int bits)
+/* validates and maybe repairs a frame, sets frame_icao, returns 1 if good */
+{
+	uint32_t s;
+	int df, fixed = 0;
+	df = (frame[0] >> 3) & 0x1f;
+	frame_icao = frame[1] << 16 | frame[2] << 8 | frame[3];
+	if (!crc_check) {
+		return 1;}
+	s = syndrome(frame, bits);
+	switch (df) {
+	case 11:
+		/* all call reply, parity is overlaid with the interrogator code,
+		 * only trust single bit fixes for the short frame */
+		if (s & ~0x7fU) {
+			fixed = fix_frame(frame, bits, s, fix_bits < 1 ? fix_bits : 1);}
+		if ((s & ~0x7fU) && !fixed) {
+			break;}
+		frame_icao = frame[1] << 16 | frame[2] << 8 | frame[3];
+		icao_add(frame_icao);
+		frames_good++;
+		frames_fixed += fixed > 0;
+		return 1;
+	case 17:
+	case 18:
+		if (s) {
+			fixed = fix_frame(frame, bits, s, fix_bits);}
+		if (s && !fixed) {
+			break;}
+		frame_icao = frame[1] << 16 | frame[2] << 8 | frame[3];
+		icao_add(frame_icao);
+		frames_good++;
+		frames_fixed += fixed > 0;
+		return 1;
+	case 0:
+	case 4:
+	case 5:
+	case 16:
+	case 20:
+	case 21:
+		/* address/parity, only an aircraft heard before explains s */
+		if (!icao_recent(s)) {
+			break;}
+		frame_icao = s;
+		frames_good++;
+		return 1;
+	default:
+		break;
+	}
+	frames_bad++;
+	return 0;
+}
+
 void messages(unsigned char *buf, int len)
 {
 	int i, i2, start, preamble_found;
@@ -271,40 +473,18 @@ void messages(unsigned char *buf, int len)
 					frame_len = short_frame;}
 			}
 		}
-		// todo, check CRC
 		if (data_i < (frame_len-1)) {
 			continue;}
+		/* bits are packed in place, their index is where the data begins */
+		frame_sample_index = buf_sample_index + (i - data_i) - preamble_len;
+		if (!check_frame(adsb_frame, frame_len)) {
+			continue;}
 		//fprintf(file, "bits: %i\n", data_i);
 		display(adsb_frame, frame_len);
 		fflush(file);
 	}
 }
 
-static void rtlsdr_callback(unsigned char *buf, uint32_t len, void *ctx)
-{
-	int dr_val;
-	if (do_exit) {
-		return;}
-	memcpy(buffer, buf, len);
-	sem_getvalue(&data_ready, &dr_val);
-	if (dr_val <= 0) {
-		sem_post(&data_ready);}
-}
-
-static void *demod_thread_fn(void *arg)
-{
-	int len;
-	while (!do_exit) {
-		sem_wait(&data_ready);
-		len = magnitute(buffer, DEFAULT_BUF_LENGTH);
-		manchester(buffer, len);
-		messages(buffer, len);
-		//fsync(file);
-	}
-	rtlsdr_cancel_async(dev);
-	return 0;
-}
-
 int main(int argc, char **argv)
 {
 #ifndef _WIN32
@@ -317,9 +497,12 @@ int main(int argc, char **argv)
 	int device_count;
 	int ppm_error = 0;
 	char vendor[256], product[256], serial[256];
-	sem_init(&data_ready, 0, 0);
+	int consumer;
+	unsigned char *buf;
+	uint32_t len;
+	rtlsdr_xfer_info_t info;
 
-	while ((opt = getopt(argc, argv, "g:p:e:RS")) != -1)
+	while ((opt = getopt(argc, argv, "g:p:e:c:NRST")) != -1)
 	{
 		switch (opt) {
 		case 'd':
@@ -337,15 +520,30 @@ int main(int argc, char **argv)
 		case 'S':
 			short_output = 1;
 			break;
+		case 'T':
+			mlat_output = 1;
+			break;
 		case 'e':
 			allowed_errors = atoi(optarg);
 			break;
+		case 'c':
+			fix_bits = atoi(optarg);
+			if (fix_bits < 0 || fix_bits > MAX_FIX_BITS) {
+				usage();}
+			break;
+		case 'N':
+			crc_check = 0;
+			break;
 		default:
 			usage();
 			return 0;
 		}
 	}
 
+	crc_init();
+	fix_table_init(&fix_short, short_frame);
+	fix_table_init(&fix_long, long_frame);
+
 	if (argc <= optind) {
 		//usage();
 		filename = "-";
@@ -353,8 +551,6 @@ int main(int argc, char **argv)
 		filename = argv[optind];
 	}
 
-	buffer = malloc(DEFAULT_BUF_LENGTH * sizeof(uint8_t));
-
 	device_count = rtlsdr_get_device_count();
 	if (!device_count) {
 		fprintf(stderr, "No supported devices found.\n");
@@ -441,23 +637,38 @@ int main(int argc, char **argv)
 	sleep(1);
 	rtlsdr_read_sync(dev, NULL, 4096, NULL);
 
-	pthread_create(&demod_thread, NULL, demod_thread_fn, (void *)(NULL));
-	rtlsdr_read_async(dev, rtlsdr_callback, (void *)(NULL),
-			      DEFAULT_ASYNC_BUF_NUMBER,
-			      DEFAULT_BUF_LENGTH);
-
+	consumer = rtlsdr_ring_add_consumer(dev);
+	r = rtlsdr_start_streaming(dev, DEFAULT_ASYNC_BUF_NUMBER,
+				   DEFAULT_BUF_LENGTH);
+	if (r < 0) {
+		fprintf(stderr, "Failed to start streaming.\n");}
+
+	/* the only consumer, so the ring buffer may be demodulated in place */
+	while (r >= 0 && !do_exit && rtlsdr_ring_acquire(dev, consumer, &buf, &len, -1) == 0) {
+		rtlsdr_ring_get_info(dev, consumer, &info);
+		buf_sample_index = info.sample_index;
+		len = magnitute(buf, len);
+		manchester(buf, len);
+		messages(buf, len);
+		rtlsdr_ring_release(dev, consumer);
+	}
+	if (r >= 0) {
+		r = rtlsdr_stop_streaming(dev);}
 
 	if (do_exit) {
 		fprintf(stderr, "\nUser cancel, exiting...\n");}
 	else {
 		fprintf(stderr, "\nLibrary error %d, exiting...\n", r);}
-	rtlsdr_cancel_async(dev);
+
+	if (crc_check) {
+		fprintf(stderr, "%llu frames passed the CRC, %llu of them corrected, %llu dropped.\n",
+			(unsigned long long)frames_good, (unsigned long long)frames_fixed,
+			(unsigned long long)frames_bad);}
 
 	if (file != stdout) {
 		fclose(file);}
 
 	rtlsdr_close(dev);
-	free(buffer);
 	return r >= 0 ? r : -r;
 }
 
@@ -18,7 +18,6 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-
 /*
  * written because people could not do real time
  * FM demod on Atom hardware with GNU radio
@@ -41,6 +40,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <time.h>
 
 #ifndef _WIN32
 #include <unistd.h>
@@ -53,11 +53,12 @@
 #define round(x) (x > 0.0 ? floor(x + 0.5): ceil(x - 0.5))
 #endif
 
-#include <semaphore.h>
-#include <pthread.h>
 #include <libusb.h>
 
 #include "rtl-sdr.h"
+#include "rtl-sdr_dsp.h"
+
+#include <pthread.h>
 
 #define DEFAULT_SAMPLE_RATE		24000
 #define DEFAULT_ASYNC_BUF_NUMBER	32
@@ -65,20 +66,33 @@
 #define MAXIMUM_OVERSAMPLE		16
 #define MAXIMUM_BUF_LENGTH		(MAXIMUM_OVERSAMPLE * DEFAULT_BUF_LENGTH)
 #define AUTO_GAIN			-100
+#define FIR_TAPS			16  /* per output sample */
+#define FIR_TAPS_HQ			48
+#define FIR_CUTOFF			0.8f
+#define RESAMP_TAPS			16  /* per output sample */
+#define RESAMP_CUTOFF			0.9f
+#define CHAN_TAPS			12  /* per channelizer bin */
+#define CHAN_MAX_RATE			2400000
+#define PIPE_DEPTH			8  /* blocks in flight, power of two */
+
+#ifdef _WIN32
+#define fm_barrier()			MemoryBarrier()
+#else
+#define fm_barrier()			__sync_synchronize()
+#endif
 
-static pthread_t demod_thread;
-static sem_t data_ready;
-static int do_exit = 0;
+#ifndef M_PI
+#define M_PI				3.14159265358979323846
+#endif
+
+static volatile int do_exit = 0;
 static rtlsdr_dev_t *dev = NULL;
+static int stats_interval = 0;
+static time_t stats_next = 0;
 static int lcm_post[17] = {1,1,1,3,1,5,3,7,1,9,5,11,3,13,7,15,1};
 
 struct fm_state
 {
-	int      now_r;
-	int      now_j;
-	int      pre_r;
-	int      pre_j;
-	int      prev_index;
 	int      downsample;    /* min 1, max 256 */
 	int      post_downsample;
 	int      output_scale;
@@ -87,10 +101,10 @@ struct fm_state
 	int      squelch_hits;
 	int      terminate_on_squelch;
 	int      exit_flag;
-	uint8_t  buf[MAXIMUM_BUF_LENGTH];
+	uint8_t  *buf;  /* ring buffer, demodulated in place */
 	uint32_t buf_len;
-	int      signal[MAXIMUM_BUF_LENGTH];  /* 16 bit signed i/q pairs */
-	int16_t  signal2[MAXIMUM_BUF_LENGTH]; /* signal has lowpass, signal2 has demod */
+	int16_t  *signal;  /* 16 bit signed i/q pairs */
+	int16_t  *signal2; /* signal has lowpass, signal2 has demod */
 	int      signal_len;
 	int      signal2_len;
 	FILE     *file;
@@ -98,16 +112,19 @@ struct fm_state
 	uint32_t freqs[1000];
 	int      freq_len;
 	int      freq_now;
+	rtlsdr_retune_plan_t *plan;  /* precompiled hops for scanning */
 	uint32_t sample_rate;
-	int      output_rate;
+	double   output_rate;
 	int      fir_enable;
-	int      fir[256];  /* fir_len == downsample */
-	int      fir_sum;
-	int      custom_atan;
+	rtlsdr_dsp_fir_t *fir;  /* decimates by downsample */
+	rtlsdr_dsp_disc_t *disc;
+	int      disc_method;
+	int      disc_bits;
 	int      deemph;
 	int      deemph_a;
-	int      now_lpr;
-	int      prev_lpr_index;
+	int      deemph_avg;
+	rtlsdr_dsp_resamp_t *resamp;  /* to the output rate */
+	int      resamp_chunk;  /* most input whose output fits signal */
 	void     (*mode_demod)(struct fm_state*);
 };
 
@@ -140,9 +157,17 @@ void usage(void)
 		"\t[-U enables USB mode (default: off)]\n"
 		//"\t[-D enables DSB mode (default: off)]\n"
 		"\t[-R enables raw mode (default: off, 2x16 bit output)]\n"
-		"\t[-F enables high quality FIR (default: off/square)]\n"
+		"\t[-C demodulates all -f frequencies at once (default: off)]\n"
+		"\t (filename is a prefix, the frequency is appended per channel)\n"
+		"\t[-F enables high quality FIR (default: off/short)]\n"
 		"\t[-D enables de-emphasis (default: off)]\n"
-		"\t[-A enables high speed arctan (default: off)]\n\n"
+		"\t[-A enables high speed arctan (default: off)]\n"
+		"\t[-a fm_discriminator (default: atan2)]\n"
+		"\t (atan2, table[:bits], poly, deriv; -A is poly)\n"
+		"\t[-B benchmarks the discriminators and exits]\n"
+		"\t[-P pipeline_depth (default: 8 on multi-core, 0 = off)]\n"
+		"\t (filter, demod and output on their own threads, single -f only)\n"
+		"\t[-i print stream statistics every n seconds (default: 0, off)]\n\n"
 		"Produces signed 16 bit ints, use Sox or aplay to hear them.\n"
 		"\trtl_fm ... - | play -t raw -r 24k -e signed-integer -b 16 -c 1 -V1 -\n"
 		"\t             | aplay -r 24k -f S16_LE -t raw -c 1\n"
@@ -171,197 +196,34 @@ static void sighandler(int signum)
 }
 #endif
 
-void rotate_90(unsigned char *buf, uint32_t len)
-/* 90 rotation is 1+0j, 0+1j, -1+0j, 0-1j
-   or [0, 1, -3, 2, -4, -5, 7, -6] */
-{
-	uint32_t i;
-	unsigned char tmp;
-	for (i=0; i<len; i+=8) {
-		/* uint8_t negation = 255 - x */
-		tmp = 255 - buf[i+3];
-		buf[i+3] = buf[i+2];
-		buf[i+2] = tmp;
-
-		buf[i+4] = 255 - buf[i+4];
-		buf[i+5] = 255 - buf[i+5];
-
-		tmp = 255 - buf[i+6];
-		buf[i+6] = buf[i+7];
-		buf[i+7] = tmp;
-	}
-}
-
 void low_pass(struct fm_state *fm, unsigned char *buf, uint32_t len)
-/* simple square window FIR */
-{
-	int i=0, i2=0;
-	while (i < (int)len) {
-		fm->now_r += ((int)buf[i]   - 128);
-		fm->now_j += ((int)buf[i+1] - 128);
-		i += 2;
-		fm->prev_index++;
-		if (fm->prev_index < fm->downsample) {
-			continue;
-		}
-		fm->signal[i2]   = fm->now_r * fm->output_scale;
-		fm->signal[i2+1] = fm->now_j * fm->output_scale;
-		fm->prev_index = 0;
-		fm->now_r = 0;
-		fm->now_j = 0;
-		i2 += 2;
-	}
-	fm->signal_len = i2;
-}
-
-void build_fir(struct fm_state *fm)
-/* for now, a simple triangle 
- * fancy FIRs are equally expensive, so use one */
-/* point = sum(sample[i] * fir[i] * fir_len / fir_sum) */
-{
-	int i, len;
-	len = fm->downsample;
-	for(i = 0; i < (len/2); i++) {
-		fm->fir[i] = i;
-	}
-	for(i = len-1; i >= (len/2); i--) {
-		fm->fir[i] = len - i;
-	}
-	fm->fir_sum = 0;
-	for(i = 0; i < len; i++) {
-		fm->fir_sum += fm->fir[i];
-	}
-}
-
-void low_pass_fir(struct fm_state *fm, unsigned char *buf, uint32_t len)
-/* perform an arbitrary FIR, doubles CPU use */
-// possibly bugged, or overflowing
+/* polyphase windowed sinc, the history carries over between buffers */
 {
-	int i=0, i2=0, i3=0;
-	while (i < (int)len) {
-		i3 = fm->prev_index;
-		fm->now_r += ((int)buf[i]   - 128) * fm->fir[i3] * fm->downsample / fm->fir_sum;
-		fm->now_j += ((int)buf[i+1] - 128) * fm->fir[i3] * fm->downsample / fm->fir_sum;
-		i += 2;
-		fm->prev_index++;
-		if (fm->prev_index < fm->downsample) {
-			continue;
-		}
-		fm->signal[i2]   = fm->now_r * fm->output_scale;
-		fm->signal[i2+1] = fm->now_j * fm->output_scale;
-		fm->prev_index = 0;
-		fm->now_r = 0;
-		fm->now_j = 0;
-		i2 += 2;
+	int16_t chunk[4096];
+	uint32_t i, n;
+	int i2 = 0;
+	for (i=0; i<len; i+=n) {
+		n = len - i;
+		if (n > sizeof(chunk)/sizeof(chunk[0])) {
+			n = sizeof(chunk)/sizeof(chunk[0]);}
+		rtlsdr_dsp_u8_to_s16(buf + i, chunk, n);
+		i2 += rtlsdr_dsp_fir_decimate_s16(fm->fir, chunk, n, fm->signal + i2);
 	}
 	fm->signal_len = i2;
 }
 
-int low_pass_simple(int16_t *signal2, int len, int step)
-// no wrap around, length must be multiple of step
+int build_fir(struct fm_state *fm)
+/* the gain of the old square window keeps the squelch levels */
 {
-	int i, i2, sum;
-	for(i=0; i < len; i+=step) {
-		sum = 0;
-		for(i2=0; i2<step; i2++) {
-			sum += (int)signal2[i + i2];
-		}
-		//signal2[i/step] = (int16_t)(sum / step);
-		signal2[i/step] = (int16_t)(sum);
-	}
-	signal2[i/step + 1] = signal2[i/step];
-	return len / step;
-}
-
-void low_pass_real(struct fm_state *fm)
-/* simple square window FIR */
-// add support for upsampling?
-{
-	int i=0, i2=0;
-	int fast = (int)fm->sample_rate / fm->post_downsample;
-	int slow = fm->output_rate;
-	while (i < fm->signal2_len) {
-		fm->now_lpr += fm->signal2[i];
-		i++;
-		fm->prev_lpr_index += slow;
-		if (fm->prev_lpr_index < fast) {
-			continue;
-		}
-		fm->signal2[i2] = (int16_t)(fm->now_lpr / (fast/slow));
-		fm->prev_lpr_index -= fast;
-		fm->now_lpr = 0;
-		i2 += 1;
-	}
-	fm->signal2_len = i2;
-}
-
-/* define our own complex math ops
-   because ARMv5 has no hardware float */
-
-void multiply(int ar, int aj, int br, int bj, int *cr, int *cj)
-{
-	*cr = ar*br - aj*bj;
-	*cj = aj*br + ar*bj;
-}
-
-int polar_discriminant(int ar, int aj, int br, int bj)
-{
-	int cr, cj;
-	double angle;
-	multiply(ar, aj, br, -bj, &cr, &cj);
-	angle = atan2((double)cj, (double)cr);
-	return (int)(angle / 3.14159 * (1<<14));
-}
-
-int fast_atan2(int y, int x)
-/* pre scaled for int16 */
-{
-	int yabs, angle;
-	int pi4=(1<<12), pi34=3*(1<<12);  // note pi = 1<<14
-	if (x==0 && y==0) {
-		return 0;
-	}
-	yabs = y;
-	if (yabs < 0) {
-		yabs = -yabs;
-	}
-	if (x >= 0) {
-		angle = pi4  - pi4 * (x-yabs) / (x+yabs);
-	} else {
-		angle = pi34 - pi4 * (x+yabs) / (yabs-x);
-	}
-	if (y < 0) {
-		return -angle;
-	}
-	return angle;
-}
-
-int polar_disc_fast(int ar, int aj, int br, int bj)
-{
-	int cr, cj;
-	multiply(ar, aj, br, -bj, &cr, &cj);
-	return fast_atan2(cj, cr);
+	int taps = fm->fir_enable ? FIR_TAPS_HQ : FIR_TAPS;
+	return rtlsdr_dsp_fir_create(&fm->fir, fm->downsample, taps,
+		FIR_CUTOFF, (float)fm->downsample / 256);
 }
 
 void fm_demod(struct fm_state *fm)
 {
-	int i, pcm;
-	pcm = polar_discriminant(fm->signal[0], fm->signal[1],
-		fm->pre_r, fm->pre_j);
-	fm->signal2[0] = (int16_t)pcm;
-	for (i = 2; i < (fm->signal_len); i += 2) {
-		if (fm->custom_atan) {
-			pcm = polar_disc_fast(fm->signal[i], fm->signal[i+1],
-				fm->signal[i-2], fm->signal[i-1]);
-		} else {
-			pcm = polar_discriminant(fm->signal[i], fm->signal[i+1],
-				fm->signal[i-2], fm->signal[i-1]);
-		}
-		fm->signal2[i/2] = (int16_t)pcm;
-	}
-	fm->pre_r = fm->signal[fm->signal_len - 2];
-	fm->pre_j = fm->signal[fm->signal_len - 1];
-	fm->signal2_len = fm->signal_len/2;
+	fm->signal2_len = rtlsdr_dsp_disc_process(fm->disc, fm->signal,
+		fm->signal_len, fm->signal2);
 }
 
 void am_demod(struct fm_state *fm)
@@ -409,24 +271,23 @@ void raw_demod(struct fm_state *fm)
 	fm->signal2_len = fm->signal_len;
 }
 
-void deemph_filter(struct fm_state *fm)
+void deemph_filter(struct fm_state *fm, int16_t *buf, int len)
 {
-	static int avg;  // cheating...
 	int i, d;
 	// de-emph IIR
 	// avg = avg * (1 - alpha) + sample * alpha;
-	for (i = 0; i < fm->signal2_len; i++) {
-		d = fm->signal2[i] - avg;
+	for (i = 0; i < len; i++) {
+		d = buf[i] - fm->deemph_avg;
 		if (d > 0) {
-			avg += (d + fm->deemph_a/2) / fm->deemph_a;
+			fm->deemph_avg += (d + fm->deemph_a/2) / fm->deemph_a;
 		} else {
-			avg += (d - fm->deemph_a/2) / fm->deemph_a;
+			fm->deemph_avg += (d - fm->deemph_a/2) / fm->deemph_a;
 		}
-		fm->signal2[i] = (int16_t)avg;
+		buf[i] = (int16_t)fm->deemph_avg;
 	}
 }
 
-int mad(int *samples, int len, int step)
+int mad(int16_t *samples, int len, int step)
 /* mean average deviation */
 {
 	int i=0, sum=0, ave=0;
@@ -460,20 +321,64 @@ int post_squelch(struct fm_state *fm)
 	return 0;
 }
 
+static double audio_rate(struct fm_state *fm)
+{
+	if (fm->output_rate > 0) {
+		return fm->output_rate;}
+	return (double)fm->sample_rate / fm->post_downsample;
+}
+
+int build_resamp(struct fm_state *fm)
+/* the gain of post_downsample keeps the levels of the old summing decimator */
+{
+	double n;
+	fm->resamp = NULL;
+	if (fm->mode_demod == &raw_demod || audio_rate(fm) == fm->sample_rate) {
+		return 0;}
+	/* the output of a piece may take up to two samples more than its share */
+	n = floor((MAXIMUM_BUF_LENGTH - 2) * fm->sample_rate / audio_rate(fm));
+	fm->resamp_chunk = n < 1 ? 1 : (n > MAXIMUM_BUF_LENGTH ? MAXIMUM_BUF_LENGTH : (int)n);
+	return rtlsdr_dsp_resamp_create(&fm->resamp, fm->sample_rate,
+		audio_rate(fm), RTLSDR_DSP_RESAMP_AUTO, RESAMP_TAPS,
+		RESAMP_CUTOFF, (float)fm->post_downsample);
+}
+
+static void print_resamp(struct fm_state *fm)
+{
+	uint32_t interp, decim;
+	if (!fm->resamp) {
+		return;}
+	if (rtlsdr_dsp_resamp_get_ratio(fm->resamp, &interp, &decim) == 0) {
+		fprintf(stderr, "Resampling by %u/%u.\n", interp, decim);}
+	else {
+		fprintf(stderr, "Resampling by %0.6f, fractional.\n",
+			audio_rate(fm) / fm->sample_rate);}
+}
+
+static int capture_freq(struct fm_state *fm, int freq)
+{
+	int capture_freq, capture_rate;
+	capture_rate = fm->downsample * fm->sample_rate;
+	capture_freq = fm->freqs[freq] + capture_rate/4;
+	capture_freq += fm->edge * fm->sample_rate / 2;
+	return capture_freq;
+}
+
 static void optimal_settings(struct fm_state *fm, int freq, int hopping)
 {
-	int r, capture_freq, capture_rate;
+	int r, capture_rate;
 	fm->downsample = (1000000 / fm->sample_rate) + 1;
 	fm->freq_now = freq;
 	capture_rate = fm->downsample * fm->sample_rate;
-	capture_freq = fm->freqs[freq] + capture_rate/4;
-	capture_freq += fm->edge * fm->sample_rate / 2;
 	fm->output_scale = (1<<15) / (128 * fm->downsample);
 	if (fm->output_scale < 1) {
 		fm->output_scale = 1;}
 	fm->output_scale = 1;
 	/* Set the frequency */
-	r = rtlsdr_set_center_freq(dev, (uint32_t)capture_freq);
+	if (hopping && fm->plan) {
+		rtlsdr_retune_plan_apply(dev, fm->plan, freq);
+		return;}
+	r = rtlsdr_set_center_freq(dev, (uint32_t)capture_freq(fm, freq));
 	if (hopping) {
 		return;}
 	fprintf(stderr, "Oversampling input by: %ix.\n", fm->downsample);
@@ -483,34 +388,24 @@ static void optimal_settings(struct fm_state *fm, int freq, int hopping)
 	if (r < 0) {
 		fprintf(stderr, "WARNING: Failed to set center freq.\n");}
 	else {
-		fprintf(stderr, "Tuned to %u Hz.\n", capture_freq);}
+		fprintf(stderr, "Tuned to %u Hz.\n", capture_freq(fm, freq));}
 
 	/* Set the sample rate */
 	fprintf(stderr, "Sampling at %u Hz.\n", capture_rate);
-	if (fm->output_rate > 0) {
-		fprintf(stderr, "Output at %u Hz.\n", fm->output_rate);
-	} else {
-		fprintf(stderr, "Output at %u Hz.\n", fm->sample_rate/fm->post_downsample);}
+	fprintf(stderr, "Output at %0.0f Hz.\n", audio_rate(fm));
 	r = rtlsdr_set_sample_rate(dev, (uint32_t)capture_rate);
 	if (r < 0) {
 		fprintf(stderr, "WARNING: Failed to set sample rate.\n");}
 
 }
 
-void full_demod(struct fm_state *fm)
+static int squelch_demod(struct fm_state *fm)
+/* demodulates fm->signal to fm->signal2, returns 1 when it is time to hop */
 {
-	int i, sr, freq_next, hop = 0;
-	rotate_90(fm->buf, fm->buf_len);
-	if (fm->fir_enable) {
-		low_pass_fir(fm, fm->buf, fm->buf_len);
-	} else {
-		low_pass(fm, fm->buf, fm->buf_len);
-	}
+	int i, sr, hop = 0;
 	fm->mode_demod(fm);
-        if (fm->mode_demod == &raw_demod) {
-		fwrite(fm->signal2, 2, fm->signal2_len, fm->file);
-		return;
-	}
+	if (fm->mode_demod == &raw_demod) {
+		return 0;}
 	sr = post_squelch(fm);
 	if (!sr && fm->squelch_hits > fm->conseq_squelch) {
 		if (fm->terminate_on_squelch) {
@@ -522,55 +417,642 @@ void full_demod(struct fm_state *fm)
 		else {
 			hop = 1;}
 	}
-	if (fm->post_downsample > 1) {
-		fm->signal2_len = low_pass_simple(fm->signal2, fm->signal2_len, fm->post_downsample);}
-	if (fm->output_rate > 0) {
-		low_pass_real(fm);
+	return hop;
+}
+
+static void post_output(struct fm_state *fm)
+/* resamples, de-emphasizes and writes fm->signal2 */
+{
+	int i, n, len;
+	if (fm->mode_demod == &raw_demod) {
+		fwrite(fm->signal2, 2, fm->signal2_len, fm->file);
+		return;}
+	if (!fm->resamp) {
+		if (fm->deemph) {
+			deemph_filter(fm, fm->signal2, fm->signal2_len);}
+		/* ignore under runs for now */
+		fwrite(fm->signal2, 2, fm->signal2_len, fm->file);
+		return;}
+	/* fm->signal is free once demodulated, pieces are sized so that
+	 * their output fits it whatever the ratio */
+	for (i=0; i<fm->signal2_len; i+=n) {
+		n = fm->signal2_len - i;
+		if (n > fm->resamp_chunk) {
+			n = fm->resamp_chunk;}
+		len = rtlsdr_dsp_resamp_s16(fm->resamp, fm->signal2 + i, n, fm->signal);
+		if (len <= 0) {
+			continue;}
+		if (fm->deemph) {
+			deemph_filter(fm, fm->signal, len);}
+		fwrite(fm->signal, 2, len, fm->file);
 	}
-	if (fm->deemph) {
-		deemph_filter(fm);}
-	/* ignore under runs for now */
-	fwrite(fm->signal2, 2, fm->signal2_len, fm->file);
-	if (hop) {
+}
+
+static int output_demod(struct fm_state *fm)
+/* demodulates fm->signal to the file, returns 1 when it is time to hop */
+{
+	int hop = squelch_demod(fm);
+	post_output(fm);
+	return hop;
+}
+
+void full_demod(struct fm_state *fm)
+{
+	int freq_next;
+	rtlsdr_dsp_rotate_90_u8(fm->buf, fm->buf_len);
+	low_pass(fm, fm->buf, fm->buf_len);
+	if (output_demod(fm)) {
 		freq_next = (fm->freq_now + 1) % fm->freq_len;
 		optimal_settings(fm, freq_next, 1);
+		rtlsdr_dsp_fir_reset(fm->fir);
 		fm->squelch_hits = fm->conseq_squelch + 1;  /* hair trigger */
-		/* wait for settling and flush buffer */
-		usleep(5000);
-		rtlsdr_read_sync(dev, NULL, 4096, NULL);
+		/* unsettled samples are dropped by skip_unsettled() */
 	}
 }
 
-static void rtlsdr_callback(unsigned char *buf, uint32_t len, void *ctx)
+static int skip_unsettled(struct fm_state *fm, int consumer, uint32_t freq)
+/* returns 1 if the whole buffer predates the tuner settling on freq */
 {
-	struct fm_state *fm2 = ctx;
-	int dr_val;
-	if (do_exit) {
-		return;}
-	if (!ctx) {
+	rtlsdr_xfer_info_t info;
+	uint64_t skip;
+	if (rtlsdr_ring_get_info(dev, consumer, &info) < 0) {
+		return 0;}
+	if (info.freq != freq) {
+		return 1;}
+	if (info.settled_index <= info.sample_index) {
+		return 0;}
+	/* whole i/q quads, the rotation works on 4 samples at a time */
+	skip = ((info.settled_index - info.sample_index + 3) & ~3ULL) * 2;
+	if (skip >= fm->buf_len) {
+		return 1;}
+	fm->buf += skip;
+	fm->buf_len -= (uint32_t)skip;
+	return 0;
+}
+
+struct channel
+{
+	struct fm_state *fm;
+	int      bin;
+	float    nco_r;  /* mixes the offset from the bin center to DC */
+	float    nco_j;
+	float    step_r;
+	float    step_j;
+	float    *samples;
+	float    *decimated;
+};
+
+struct channelizer
+{
+	rtlsdr_dsp_chan_t *pfb;
+	int      bins;
+	int      decim;  /* bin rate / channel rate */
+	uint32_t capture_rate;
+	uint32_t center;
+	float    *input;
+	float    *frames;
+	int      frame_count;
+	struct channel *chans;
+	int      chan_count;
+	pthread_t *threads;
+	int      thread_count;
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	int      generation;
+	int      next;
+	int      busy;
+	int      quit;
+};
+
+static int cpu_count(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return (int)si.dwNumberOfProcessors;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+#endif
+}
+
+static int chan_plan(struct channelizer *cz, struct fm_state *fm)
+/* bins sampled at 4x the channel rate or more, wide enough for any
+ * channel within half a bin of their center */
+{
+	uint32_t lo, hi;
+	double rate;
+	int i;
+	lo = hi = fm->freqs[0];
+	for (i=1; i<fm->freq_len; i++) {
+		if (fm->freqs[i] < lo) {
+			lo = fm->freqs[i];}
+		if (fm->freqs[i] > hi) {
+			hi = fm->freqs[i];}
+	}
+	for (cz->bins=256; cz->bins>=2; cz->bins/=2) {
+		if ((double)cz->bins * 2 * fm->sample_rate <= CHAN_MAX_RATE) {
+			break;}
+	}
+	if (cz->bins < 2) {
+		return -1;}
+	for (cz->decim=4; ; cz->decim++) {
+		rate = (double)cz->bins * cz->decim * fm->sample_rate / 2;
+		if (rate > CHAN_MAX_RATE) {
+			return -1;}
+		/* keep off the roll off of the dongle */
+		if (rate >= 1000000 && (hi - lo) + 2 * rate / cz->bins <= 0.8 * rate) {
+			break;}
+	}
+	cz->capture_rate = (uint32_t)rate;
+	cz->center = lo + (hi - lo) / 2;
+	return 0;
+}
+
+static void chan_demod(struct channelizer *cz, struct channel *ch)
+{
+	struct fm_state *fm = ch->fm;
+	float *in, r, j;
+	int i, n = cz->frame_count;
+	for (i=0; i<n; i++) {
+		in = cz->frames + 2 * (i * cz->bins + ch->bin);
+		ch->samples[2*i]   = in[0] * ch->nco_r - in[1] * ch->nco_j;
+		ch->samples[2*i+1] = in[0] * ch->nco_j + in[1] * ch->nco_r;
+		r = ch->nco_r * ch->step_r - ch->nco_j * ch->step_j;
+		ch->nco_j = ch->nco_r * ch->step_j + ch->nco_j * ch->step_r;
+		ch->nco_r = r;
+	}
+	/* keep the mixer on the unit circle */
+	r = 1.0f / sqrtf(ch->nco_r * ch->nco_r + ch->nco_j * ch->nco_j);
+	ch->nco_r *= r;
+	ch->nco_j *= r;
+	n = rtlsdr_dsp_fir_decimate_f32(fm->fir, ch->samples, 2*n, ch->decimated);
+	for (i=0; i<n; i++) {
+		j = ch->decimated[i];
+		if (j > 32767.0f) {
+			j = 32767.0f;}
+		if (j < -32768.0f) {
+			j = -32768.0f;}
+		fm->signal[i] = (int16_t)(j < 0 ? j - 0.5f : j + 0.5f);}
+	fm->signal_len = n;
+	output_demod(fm);
+}
+
+static void *chan_worker(void *arg)
+{
+	struct channelizer *cz = arg;
+	int c, seen = 0;
+	pthread_mutex_lock(&cz->lock);
+	while (1) {
+		while (!cz->quit && cz->generation == seen) {
+			pthread_cond_wait(&cz->start, &cz->lock);}
+		if (cz->quit) {
+			break;}
+		seen = cz->generation;
+		while (cz->next < cz->chan_count) {
+			c = cz->next++;
+			pthread_mutex_unlock(&cz->lock);
+			chan_demod(cz, &cz->chans[c]);
+			pthread_mutex_lock(&cz->lock);
+		}
+		cz->busy--;
+		if (!cz->busy) {
+			pthread_cond_signal(&cz->done);}
+	}
+	pthread_mutex_unlock(&cz->lock);
+	return NULL;
+}
+
+static void chan_cleanup(struct channelizer *cz)
+{
+	int c;
+	if (cz->threads) {
+		pthread_mutex_lock(&cz->lock);
+		cz->quit = 1;
+		pthread_cond_broadcast(&cz->start);
+		pthread_mutex_unlock(&cz->lock);
+		for (c=0; c<cz->thread_count; c++) {
+			pthread_join(cz->threads[c], NULL);}
+		pthread_mutex_destroy(&cz->lock);
+		pthread_cond_destroy(&cz->start);
+		pthread_cond_destroy(&cz->done);
+		free(cz->threads);
+	}
+	for (c=0; cz->chans && c<cz->chan_count; c++) {
+		if (cz->chans[c].fm) {
+			if (cz->chans[c].fm->file) {
+				fclose(cz->chans[c].fm->file);}
+			rtlsdr_dsp_fir_destroy(cz->chans[c].fm->fir);
+			rtlsdr_dsp_disc_destroy(cz->chans[c].fm->disc);
+			rtlsdr_dsp_resamp_destroy(cz->chans[c].fm->resamp);
+			free(cz->chans[c].fm->signal);
+			free(cz->chans[c].fm->signal2);
+			free(cz->chans[c].fm);
+		}
+		free(cz->chans[c].samples);
+		free(cz->chans[c].decimated);
+	}
+	free(cz->chans);
+	free(cz->input);
+	free(cz->frames);
+	rtlsdr_dsp_chan_destroy(cz->pfb);
+}
+
+static int chan_setup(struct channelizer *cz, struct fm_state *fm, char *prefix,
+	uint32_t buf_len)
+{
+	struct channel *ch;
+	char name[1024];
+	double spacing, offset;
+	int c, k, taps, frames;
+	memset(cz, 0, sizeof(struct channelizer));
+	if (chan_plan(cz, fm) < 0) {
+		fprintf(stderr, "Channels too wide or too far apart.\n");
+		goto fail;}
+	if (rtlsdr_dsp_chan_create(&cz->pfb, cz->bins, CHAN_TAPS) < 0) {
+		goto fail;}
+	frames = buf_len / cz->bins + 1;
+	cz->input = malloc(buf_len * sizeof(float));
+	cz->frames = malloc(frames * 2 * cz->bins * sizeof(float));
+	cz->chans = calloc(fm->freq_len, sizeof(struct channel));
+	if (!cz->input || !cz->frames || !cz->chans) {
+		goto fail;}
+	cz->chan_count = fm->freq_len;
+	spacing = (double)cz->capture_rate / cz->bins;
+	taps = fm->fir_enable ? FIR_TAPS_HQ : FIR_TAPS;
+	for (c=0; c<cz->chan_count; c++) {
+		ch = &cz->chans[c];
+		ch->fm = malloc(sizeof(struct fm_state));
+		if (!ch->fm) {
+			goto fail;}
+		*ch->fm = *fm;
+		/* chan_cleanup() must not free what the copy shares with fm */
+		ch->fm->file = NULL;
+		ch->fm->fir = NULL;
+		ch->fm->disc = NULL;
+		ch->fm->resamp = NULL;
+		ch->fm->signal = malloc(MAXIMUM_BUF_LENGTH * sizeof(int16_t));
+		ch->fm->signal2 = malloc(MAXIMUM_BUF_LENGTH * sizeof(int16_t));
+		ch->samples = malloc(frames * 2 * sizeof(float));
+		ch->decimated = malloc((frames / cz->decim + 1) * 2 * sizeof(float));
+		if (!ch->fm->signal || !ch->fm->signal2 || !ch->samples || !ch->decimated) {
+			goto fail;}
+		ch->fm->freqs[0] = fm->freqs[c];
+		ch->fm->freq_len = 1;
+		ch->fm->freq_now = 0;
+		ch->fm->terminate_on_squelch = 0;
+		ch->fm->plan = NULL;
+		ch->fm->downsample = cz->decim;
+		/* same levels as the single channel path */
+		if (rtlsdr_dsp_fir_create(&ch->fm->fir, cz->decim, taps, FIR_CUTOFF,
+			127.5f * cz->bins * cz->decim / 2) < 0) {
+			goto fail;}
+		if (rtlsdr_dsp_disc_create(&ch->fm->disc, fm->disc_method,
+			fm->disc_bits) < 0) {
+			goto fail;}
+		if (build_resamp(ch->fm) < 0) {
+			goto fail;}
+		offset = (double)fm->freqs[c] - cz->center;
+		k = (int)floor(offset / spacing + 0.5);
+		ch->bin = (k + cz->bins) % cz->bins;
+		offset -= k * spacing;
+		ch->nco_r = 1;
+		ch->nco_j = 0;
+		ch->step_r = (float)cos(-2 * M_PI * offset / (spacing * 2));
+		ch->step_j = (float)sin(-2 * M_PI * offset / (spacing * 2));
+		snprintf(name, sizeof(name), "%s%u", prefix, fm->freqs[c]);
+		ch->fm->file = fopen(name, "wb");
+		if (!ch->fm->file) {
+			fprintf(stderr, "Failed to open %s\n", name);
+			goto fail;}
+	}
+	cz->thread_count = cpu_count();
+	if (cz->thread_count > cz->chan_count) {
+		cz->thread_count = cz->chan_count;}
+	cz->threads = malloc(cz->thread_count * sizeof(pthread_t));
+	if (!cz->threads) {
+		goto fail;}
+	pthread_mutex_init(&cz->lock, NULL);
+	pthread_cond_init(&cz->start, NULL);
+	pthread_cond_init(&cz->done, NULL);
+	for (c=0; c<cz->thread_count; c++) {
+		pthread_create(&cz->threads[c], NULL, chan_worker, cz);}
+	fprintf(stderr, "Channelizer: %i bins of %0.0f Hz, %i channels on %i threads.\n",
+		cz->bins, spacing, cz->chan_count, cz->thread_count);
+	fprintf(stderr, "Output at %0.0f Hz.\n", audio_rate(fm));
+	print_resamp(cz->chans[0].fm);
+	return 0;
+fail:
+	chan_cleanup(cz);
+	return -1;
+}
+
+static void chan_process(struct channelizer *cz, uint8_t *buf, uint32_t len)
+/* the channelizer runs here, the demods on the workers */
+{
+	rtlsdr_dsp_u8_to_f32(buf, cz->input, len);
+	cz->frame_count = rtlsdr_dsp_chan_process(cz->pfb, cz->input, len, cz->frames);
+	pthread_mutex_lock(&cz->lock);
+	cz->next = 0;
+	cz->busy = cz->thread_count;
+	cz->generation++;
+	pthread_cond_broadcast(&cz->start);
+	while (cz->busy) {
+		pthread_cond_wait(&cz->done, &cz->lock);}
+	pthread_mutex_unlock(&cz->lock);
+}
+
+static int disc_parse(struct fm_state *fm, char *arg)
+/* atan2, table[:bits], poly or deriv */
+{
+	char *bits = strchr(arg, ':');
+	fm->disc_bits = 0;
+	if (bits) {
+		*bits++ = '\0';
+		fm->disc_bits = atoi(bits);}
+	if (strcmp(arg, "atan2") == 0) {
+		fm->disc_method = RTLSDR_DSP_DISC_ATAN2;
+	} else if (strcmp(arg, "table") == 0) {
+		fm->disc_method = RTLSDR_DSP_DISC_TABLE;
+	} else if (strcmp(arg, "poly") == 0) {
+		fm->disc_method = RTLSDR_DSP_DISC_POLY;
+	} else if (strcmp(arg, "deriv") == 0) {
+		fm->disc_method = RTLSDR_DSP_DISC_DERIV;
+	} else {
+		return -1;}
+	return 0;
+}
+
+static void disc_benchmark(int table_bits)
+/* error in LSB against atan2() on noisy FM, and speed at every simd level */
+{
+	static const char *methods[] = {"atan2", "table", "poly", "deriv"};
+	static const char *simds[] = {"generic", "sse2", "avx2", "neon"};
+	int16_t *in, *ref, *out;
+	rtlsdr_dsp_disc_t *disc;
+	double phase = 0, amp, err, max, rms, secs;
+	int n = 1 << 16, m, s, i, rounds, simd = rtlsdr_dsp_get_simd();
+	clock_t start;
+	in = malloc(2 * n * sizeof(int16_t));
+	ref = malloc(n * sizeof(int16_t));
+	out = malloc(n * sizeof(int16_t));
+	if (!in || !ref || !out) {
+		free(in);
+		free(ref);
+		free(out);
 		return;}
-	memcpy(fm2->buf, buf, len);
-	fm2->buf_len = len;
-	/* single threaded uses 25% less CPU? */
-	/* full_demod(fm2); */
-	sem_getvalue(&data_ready, &dr_val);
-	if (dr_val <= 0) {
-		sem_post(&data_ready);}
+	srand(1);
+	for (i=0; i<n; i++) {
+		/* up to ±0.7 rad per sample, a WBFM station at 4x oversampling */
+		phase += 1.4 * ((double)rand() / RAND_MAX - 0.5);
+		amp = 8000 + 2000 * ((double)rand() / RAND_MAX);
+		in[2*i]   = (int16_t)(amp * cos(phase) + rand() % 401 - 200);
+		in[2*i+1] = (int16_t)(amp * sin(phase) + rand() % 401 - 200);
+	}
+	rtlsdr_dsp_disc_create(&disc, RTLSDR_DSP_DISC_ATAN2, 0);
+	rtlsdr_dsp_disc_process(disc, in, 2*n, ref);
+	rtlsdr_dsp_disc_destroy(disc);
+	fprintf(stderr, "%-8s %-8s %9s %9s %10s\n",
+		"method", "simd", "max LSB", "rms LSB", "Msample/s");
+	for (m=RTLSDR_DSP_DISC_ATAN2; m<=RTLSDR_DSP_DISC_DERIV; m++) {
+		for (s=RTLSDR_DSP_GENERIC; s<=RTLSDR_DSP_NEON; s++) {
+			if (rtlsdr_dsp_set_simd(s) < 0) {
+				continue;}
+			if (rtlsdr_dsp_disc_create(&disc, m, table_bits) < 0) {
+				fprintf(stderr, "Bad table size.\n");
+				break;}
+			rtlsdr_dsp_disc_process(disc, in, 2*n, out);
+			max = rms = 0;
+			/* the first sample has no predecessor */
+			for (i=1; i<n; i++) {
+				err = fabs((double)out[i] - ref[i]);
+				if (err > 16384) {
+					err = 32768 - err;}
+				max = err > max ? err : max;
+				rms += err * err;
+			}
+			rounds = 0;
+			start = clock();
+			do {
+				rtlsdr_dsp_disc_process(disc, in, 2*n, out);
+				rounds++;
+				secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+			} while (secs < 0.2);
+			fprintf(stderr, "%-8s %-8s %9.0f %9.2f %10.1f\n", methods[m],
+				simds[s], max, sqrt(rms / (n - 1)), rounds * n / secs / 1e6);
+			rtlsdr_dsp_disc_destroy(disc);
+		}
+	}
+	rtlsdr_dsp_set_simd(simd);
+	free(in);
+	free(ref);
+	free(out);
+}
+
+struct fm_block
+{
+	int16_t  signal[MAXIMUM_BUF_LENGTH];
+	int16_t  signal2[MAXIMUM_BUF_LENGTH];
+	int      signal_len;
+	int      signal2_len;
+	int      quit;  /* last block, the stages exit after it */
+};
+
+struct block_queue
+/* lock-free single producer, single consumer, sleeps only when empty */
+{
+	struct fm_block *slots[PIPE_DEPTH];
+	volatile unsigned head;  /* written by the producer only */
+	volatile unsigned tail;  /* written by the consumer only */
+	volatile int sleeping;
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+};
+
+struct pipeline
+{
+	struct fm_state *filter;  /* the main thread, as ring consumer */
+	struct fm_state demod;    /* each stage has its own copy of the state */
+	struct fm_state post;
+	struct fm_block *blocks;
+	int      depth;
+	struct block_queue filtered;
+	struct block_queue demodded;
+	struct block_queue free;
+	pthread_t demod_thread;
+	pthread_t post_thread;
+	uint64_t blocks_in;
+	uint64_t dropped;  /* no free block, the output fell behind */
+	volatile int exit_flag;
+};
+
+static void queue_init(struct block_queue *q)
+{
+	q->head = q->tail = 0;
+	q->sleeping = 0;
+	pthread_mutex_init(&q->lock, NULL);
+	pthread_cond_init(&q->ready, NULL);
 }
 
-static void *demod_thread_fn(void *arg)
+static void queue_push(struct block_queue *q, struct fm_block *b)
+/* never full, there are no more blocks than slots */
 {
-	struct fm_state *fm2 = arg;
-	while (!do_exit) {
-		sem_wait(&data_ready);
-		full_demod(fm2);
-		if (fm2->exit_flag) {
-			do_exit = 1;
-			rtlsdr_cancel_async(dev);}
+	q->slots[q->head % PIPE_DEPTH] = b;
+	fm_barrier();
+	q->head++;
+	fm_barrier();
+	if (q->sleeping) {
+		pthread_mutex_lock(&q->lock);
+		pthread_cond_signal(&q->ready);
+		pthread_mutex_unlock(&q->lock);}
+}
+
+static struct fm_block *queue_pop(struct block_queue *q, int wait)
+{
+	struct fm_block *b;
+	if (q->tail == q->head) {
+		if (!wait) {
+			return NULL;}
+		pthread_mutex_lock(&q->lock);
+		q->sleeping = 1;
+		fm_barrier();
+		while (q->tail == q->head) {
+			pthread_cond_wait(&q->ready, &q->lock);}
+		q->sleeping = 0;
+		pthread_mutex_unlock(&q->lock);
 	}
+	fm_barrier();
+	b = q->slots[q->tail % PIPE_DEPTH];
+	fm_barrier();
+	q->tail++;
+	return b;
+}
+
+static void *demod_stage(void *arg)
+{
+	struct pipeline *pl = arg;
+	struct fm_block *b;
+	do {
+		b = queue_pop(&pl->filtered, 1);
+		if (!b->quit) {
+			pl->demod.signal = b->signal;
+			pl->demod.signal2 = b->signal2;
+			pl->demod.signal_len = b->signal_len;
+			/* single frequency, no hops */
+			squelch_demod(&pl->demod);
+			b->signal2_len = pl->demod.signal2_len;
+			if (pl->demod.exit_flag) {
+				pl->exit_flag = 1;}
+		}
+		queue_push(&pl->demodded, b);
+	} while (!b->quit);
+	return NULL;
+}
+
+static void *post_stage(void *arg)
+{
+	struct pipeline *pl = arg;
+	struct fm_block *b;
+	do {
+		b = queue_pop(&pl->demodded, 1);
+		if (!b->quit) {
+			pl->post.signal = b->signal;
+			pl->post.signal2 = b->signal2;
+			pl->post.signal2_len = b->signal2_len;
+			post_output(&pl->post);
+		}
+		queue_push(&pl->free, b);
+	} while (!b->quit);
+	return NULL;
+}
+
+static int pipeline_setup(struct pipeline *pl, struct fm_state *fm, int depth)
+{
+	int i;
+	memset(pl, 0, sizeof(struct pipeline));
+	if (depth > PIPE_DEPTH) {
+		depth = PIPE_DEPTH;}
+	/* one block for each stage at the least */
+	if (depth < 3) {
+		depth = 3;}
+	pl->blocks = malloc(depth * sizeof(struct fm_block));
+	if (!pl->blocks) {
+		return -1;}
+	pl->depth = depth;
+	pl->filter = fm;
+	pl->demod = *fm;
+	pl->post = *fm;
+	queue_init(&pl->filtered);
+	queue_init(&pl->demodded);
+	queue_init(&pl->free);
+	for (i=0; i<depth; i++) {
+		pl->blocks[i].quit = 0;
+		queue_push(&pl->free, &pl->blocks[i]);}
+	pthread_create(&pl->demod_thread, NULL, demod_stage, pl);
+	pthread_create(&pl->post_thread, NULL, post_stage, pl);
+	fprintf(stderr, "Pipeline: 3 stages, %i blocks deep.\n", depth);
 	return 0;
 }
 
+static void pipeline_demod(struct pipeline *pl)
+/* the filter stage, drops the buffer when the later stages are behind */
+{
+	struct fm_state *fm = pl->filter;
+	struct fm_block *b = queue_pop(&pl->free, 0);
+	int16_t *signal = fm->signal;
+	pl->blocks_in++;
+	if (!b) {
+		pl->dropped++;
+		return;}
+	fm->signal = b->signal;
+	rtlsdr_dsp_rotate_90_u8(fm->buf, fm->buf_len);
+	low_pass(fm, fm->buf, fm->buf_len);
+	b->signal_len = fm->signal_len;
+	fm->signal = signal;
+	queue_push(&pl->filtered, b);
+}
+
+static void pipeline_cleanup(struct pipeline *pl)
+/* drains the blocks in flight */
+{
+	struct fm_block *b;
+	if (!pl->blocks) {
+		return;}
+	b = queue_pop(&pl->free, 1);
+	b->quit = 1;
+	queue_push(&pl->filtered, b);
+	pthread_join(pl->demod_thread, NULL);
+	pthread_join(pl->post_thread, NULL);
+	pthread_mutex_destroy(&pl->filtered.lock);
+	pthread_cond_destroy(&pl->filtered.ready);
+	pthread_mutex_destroy(&pl->demodded.lock);
+	pthread_cond_destroy(&pl->demodded.ready);
+	pthread_mutex_destroy(&pl->free.lock);
+	pthread_cond_destroy(&pl->free.ready);
+	free(pl->blocks);
+	fprintf(stderr, "Pipeline dropped %llu of %llu buffers.\n",
+		(unsigned long long)pl->dropped, (unsigned long long)pl->blocks_in);
+}
+
+static void print_stream_stats(struct pipeline *pl)
+{
+	rtlsdr_stream_stats_t st;
+	char line[512];
+	if (!stats_interval || time(NULL) < stats_next) {
+		return;}
+	stats_next = time(NULL) + stats_interval;
+	if (rtlsdr_get_stream_stats(dev, &st) < 0) {
+		return;}
+	rtlsdr_format_stream_stats(&st, line, sizeof(line));
+	fprintf(stderr, "%s", line);
+	if (pl) {
+		fprintf(stderr, ", pipeline dropped %llu of %llu",
+			(unsigned long long)pl->dropped,
+			(unsigned long long)pl->blocks_in);}
+	fprintf(stderr, "\n");
+}
+
 double atofs(char* f)
 /* standard suffixes */
 {
@@ -617,7 +1099,11 @@ int main(int argc, char **argv)
 #endif
 	struct fm_state fm; 
 	char *filename = NULL;
-	int n_read, r, opt, wb_mode = 0;
+	int n_read, r, opt, wb_mode = 0, chan_mode = 0, benchmark = 0;
+	struct channelizer cz;
+	struct pipeline pl, *pipe = NULL;
+	int pipe_depth = -1;
+	int consumer;
 	int i, gain = AUTO_GAIN; // tenths of a dB
 	uint8_t *buffer;
 	uint32_t dev_index = 0;
@@ -632,15 +1118,21 @@ int main(int argc, char **argv)
 	fm.freq_len = 0;
 	fm.edge = 0;
 	fm.fir_enable = 0;
-	fm.prev_index = 0;
+	fm.fir = NULL;
+	fm.exit_flag = 0;
+	fm.squelch_hits = 0;
+	fm.resamp = NULL;
 	fm.post_downsample = 1;  // once this works, default = 4
-	fm.custom_atan = 0;
+	fm.disc = NULL;
+	fm.disc_method = RTLSDR_DSP_DISC_ATAN2;
+	fm.disc_bits = 0;
 	fm.deemph = 0;
+	fm.deemph_avg = 0;
 	fm.output_rate = -1;  // flag for disabled
 	fm.mode_demod = &fm_demod;
-	sem_init(&data_ready, 0, 0);
+	fm.plan = NULL;
 
-	while ((opt = getopt(argc, argv, "d:f:g:s:b:l:o:t:r:p:EFANWMULRD")) != -1) {
+	while ((opt = getopt(argc, argv, "d:f:g:s:b:l:o:t:r:p:i:a:P:EFANWMULRDCB")) != -1) {
 		switch (opt) {
 		case 'd':
 			dev_index = atoi(optarg);
@@ -664,7 +1156,7 @@ int main(int argc, char **argv)
 			fm.sample_rate = (uint32_t)atofs(optarg);
 			break;
 		case 'r':
-			fm.output_rate = (int)atofs(optarg);
+			fm.output_rate = atofs(optarg);
 			break;
 		case 'o':
 			fm.post_downsample = (int)atof(optarg);
@@ -681,6 +1173,9 @@ int main(int argc, char **argv)
 		case 'p':
 			ppm_error = atoi(optarg);
 			break;
+		case 'i':
+			stats_interval = atoi(optarg);
+			break;
 		case 'E':
 			fm.edge = 1;
 			break;
@@ -688,7 +1183,18 @@ int main(int argc, char **argv)
 			fm.fir_enable = 1;
 			break;
 		case 'A':
-			fm.custom_atan = 1;
+			fm.disc_method = RTLSDR_DSP_DISC_POLY;
+			break;
+		case 'a':
+			if (disc_parse(&fm, optarg) < 0) {
+				fprintf(stderr, "Unknown discriminator %s\n", optarg);
+				usage();}
+			break;
+		case 'B':
+			benchmark = 1;
+			break;
+		case 'P':
+			pipe_depth = atoi(optarg);
 			break;
 		case 'D':
 			fm.deemph = 1;
@@ -701,7 +1207,7 @@ int main(int argc, char **argv)
 			fm.mode_demod = &fm_demod;
 			fm.sample_rate = 170000;
 			fm.output_rate = 32000;
-			fm.custom_atan = 1;
+			fm.disc_method = RTLSDR_DSP_DISC_POLY;
 			fm.post_downsample = 4;
 			fm.deemph = 1;
 			fm.squelch_level = 0;
@@ -718,20 +1224,39 @@ int main(int argc, char **argv)
 		case 'R':
 			fm.mode_demod = &raw_demod;
 			break;
+		case 'C':
+			chan_mode = 1;
+			break;
 		default:
 			usage();
 			break;
 		}
 	}
+	if (benchmark) {
+		disc_benchmark(fm.disc_bits);
+		exit(0);}
+
 	/* quadruple sample_rate to limit to Δθ to ±π/2 */
 	fm.sample_rate *= fm.post_downsample;
 
-	if (fm.freq_len > 1) {
+	if (fm.freq_len > 1 || chan_mode) {
 		fm.terminate_on_squelch = 0;
 	}
+	if (chan_mode && fm.freq_len == 0) {
+		fm.freq_len = 1;}
+	if (pipe_depth < 0) {
+		pipe_depth = cpu_count() > 1 ? PIPE_DEPTH : 0;}
+	/* the squelch of a scan decides the next hop, it can't run behind */
+	if (fm.freq_len > 1 || chan_mode) {
+		pipe_depth = 0;}
+	fm.signal = malloc(MAXIMUM_BUF_LENGTH * sizeof(int16_t));
+	fm.signal2 = malloc(MAXIMUM_BUF_LENGTH * sizeof(int16_t));
 
 	if (argc <= optind) {
 		//usage();
+		if (chan_mode) {
+			fprintf(stderr, "Channelizer mode needs an output prefix.\n");
+			exit(1);}
 		filename = "-";
 	} else {
 		filename = argv[optind];
@@ -778,11 +1303,40 @@ int main(int argc, char **argv)
 	}
 
 	if (fm.deemph) {
-		fm.deemph_a = (int)round(1.0/((1.0-exp(-1.0/(fm.output_rate * 75e-6)))));
+		fm.deemph_a = (int)round(1.0/((1.0-exp(-1.0/(audio_rate(&fm) * 75e-6)))));
 	}
 
-	optimal_settings(&fm, 0, 0);
-	build_fir(&fm);
+	if (chan_mode) {
+		if (chan_setup(&cz, &fm, filename,
+			lcm_post[fm.post_downsample] * DEFAULT_BUF_LENGTH) < 0) {
+			fprintf(stderr, "Failed to set up the channelizer.\n");
+			exit(1);
+		}
+		r = rtlsdr_set_center_freq(dev, cz.center);
+		if (r < 0) {
+			fprintf(stderr, "WARNING: Failed to set center freq.\n");}
+		else {
+			fprintf(stderr, "Tuned to %u Hz.\n", cz.center);}
+		fprintf(stderr, "Sampling at %u Hz.\n", cz.capture_rate);
+		r = rtlsdr_set_sample_rate(dev, cz.capture_rate);
+		if (r < 0) {
+			fprintf(stderr, "WARNING: Failed to set sample rate.\n");}
+	} else {
+		optimal_settings(&fm, 0, 0);
+		if (build_fir(&fm) < 0) {
+			fprintf(stderr, "Failed to set up the low pass filter.\n");
+			exit(1);
+		}
+		if (rtlsdr_dsp_disc_create(&fm.disc, fm.disc_method, fm.disc_bits) < 0) {
+			fprintf(stderr, "Failed to set up the discriminator.\n");
+			exit(1);
+		}
+		if (build_resamp(&fm) < 0) {
+			fprintf(stderr, "Failed to set up the resampler.\n");
+			exit(1);
+		}
+		print_resamp(&fm);
+	}
 
 	/* Set the tuner gain */
 	if (gain == AUTO_GAIN) {
@@ -800,7 +1354,20 @@ int main(int argc, char **argv)
 	}
 	r = rtlsdr_set_freq_correction(dev, ppm_error);
 
-	if (strcmp(filename, "-") == 0) { /* Write samples to stdout */
+	/* precompile the scan list, hops then skip the tuner setup */
+	if (fm.freq_len > 1 && !chan_mode) {
+		uint32_t *hops = malloc(fm.freq_len * sizeof(uint32_t));
+		for (i=0; i<fm.freq_len; i++) {
+			hops[i] = (uint32_t)capture_freq(&fm, i);}
+		if (rtlsdr_retune_plan_create(dev, &fm.plan, hops, fm.freq_len) < 0) {
+			fprintf(stderr, "WARNING: Failed to precompile scan list.\n");
+			fm.plan = NULL;}
+		free(hops);
+	}
+
+	if (chan_mode) {
+		fm.file = NULL;  /* one per channel */
+	} else if (strcmp(filename, "-") == 0) { /* Write samples to stdout */
 		fm.file = stdout;
 #ifdef _WIN32
 		_setmode(_fileno(fm.file), _O_BINARY);
@@ -818,21 +1385,59 @@ int main(int argc, char **argv)
 	if (r < 0) {
 		fprintf(stderr, "WARNING: Failed to reset buffers.\n");}
 
-	pthread_create(&demod_thread, NULL, demod_thread_fn, (void *)(&fm));
-	rtlsdr_read_async(dev, rtlsdr_callback, (void *)(&fm),
-			      DEFAULT_ASYNC_BUF_NUMBER,
+	if (pipe_depth > 0) {
+		if (pipeline_setup(&pl, &fm, pipe_depth) < 0) {
+			fprintf(stderr, "Failed to set up the pipeline.\n");
+			exit(1);}
+		pipe = &pl;
+	}
+
+	consumer = rtlsdr_ring_add_consumer(dev);
+	r = rtlsdr_start_streaming(dev, DEFAULT_ASYNC_BUF_NUMBER,
 			      lcm_post[fm.post_downsample] * DEFAULT_BUF_LENGTH);
+	if (r < 0) {
+		fprintf(stderr, "Failed to start streaming.\n");}
+
+	while (r >= 0 && !do_exit && rtlsdr_ring_acquire(dev, consumer, &fm.buf, &fm.buf_len, -1) == 0) {
+		if (chan_mode) {
+			if (!skip_unsettled(&fm, consumer, cz.center)) {
+				chan_process(&cz, fm.buf, fm.buf_len);}
+		} else if (!skip_unsettled(&fm, consumer,
+			(uint32_t)capture_freq(&fm, fm.freq_now))) {
+			if (pipe) {
+				pipeline_demod(pipe);}
+			else {
+				full_demod(&fm);}
+		}
+		rtlsdr_ring_release(dev, consumer);
+		print_stream_stats(pipe);
+		if (fm.exit_flag || (pipe && pipe->exit_flag)) {
+			do_exit = 1;}
+	}
+	if (r >= 0) {
+		r = rtlsdr_stop_streaming(dev);}
 
 	if (do_exit) {
 		fprintf(stderr, "\nUser cancel, exiting...\n");}
 	else {
 		fprintf(stderr, "\nLibrary error %d, exiting...\n", r);}
-	rtlsdr_cancel_async(dev);
 
-	if (fm.file != stdout) {
+	if (pipe) {
+		pipeline_cleanup(pipe);}
+
+	if (chan_mode) {
+		chan_cleanup(&cz);}
+	else if (fm.file != stdout) {
 		fclose(fm.file);}
 
+	if (fm.plan) {
+		rtlsdr_retune_plan_destroy(fm.plan);}
+	rtlsdr_dsp_fir_destroy(fm.fir);
+	rtlsdr_dsp_disc_destroy(fm.disc);
+	rtlsdr_dsp_resamp_destroy(fm.resamp);
 	rtlsdr_close(dev);
+	free(fm.signal);
+	free(fm.signal2);
 	free (buffer);
 	return r >= 0 ? r : -r;
 }
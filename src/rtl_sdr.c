@@ -21,6 +21,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #ifndef _WIN32
 #include <unistd.h>
@@ -42,6 +43,8 @@
 static int do_exit = 0;
 static uint32_t bytes_to_read = 0;
 static rtlsdr_dev_t *dev = NULL;
+static int stats_interval = 0;
+static time_t stats_next = 0;
 
 void usage(void)
 {
@@ -54,6 +57,7 @@ void usage(void)
 		"\t[-b output_block_size (default: 16 * 16384)]\n"
 		"\t[-n number of samples to read (default: 0, infinite)]\n"
 		"\t[-S force sync output (default: async)]\n"
+		"\t[-i print stream statistics every n seconds (default: 0, off)]\n"
 		"\tfilename (a '-' dumps samples to stdout)\n\n");
 	exit(1);
 }
@@ -79,6 +83,22 @@ static void sighandler(int signum)
 }
 #endif
 
+static void print_stream_stats(void)
+{
+	rtlsdr_stream_stats_t st;
+	char line[512];
+
+	if (!stats_interval || time(NULL) < stats_next)
+		return;
+	stats_next = time(NULL) + stats_interval;
+
+	if (rtlsdr_get_stream_stats(dev, &st) < 0)
+		return;
+
+	rtlsdr_format_stream_stats(&st, line, sizeof(line));
+	fprintf(stderr, "%s\n", line);
+}
+
 static void rtlsdr_callback(unsigned char *buf, uint32_t len, void *ctx)
 {
 	if (ctx) {
@@ -98,6 +118,8 @@ static void rtlsdr_callback(unsigned char *buf, uint32_t len, void *ctx)
 
 		if (bytes_to_read > 0)
 			bytes_to_read -= len;
+
+		print_stream_stats();
 	}
 }
 
@@ -120,7 +142,7 @@ int main(int argc, char **argv)
 	int device_count;
 	char vendor[256], product[256], serial[256];
 
-	while ((opt = getopt(argc, argv, "d:f:g:s:b:n:S::")) != -1) {
+	while ((opt = getopt(argc, argv, "d:f:g:s:b:n:i:S::")) != -1) {
 		switch (opt) {
 		case 'd':
 			dev_index = atoi(optarg);
@@ -143,6 +165,9 @@ int main(int argc, char **argv)
 		case 'S':
 			sync_mode = 1;
 			break;
+		case 'i':
+			stats_interval = atoi(optarg);
+			break;
 		default:
 			usage();
 			break;
@@ -275,6 +300,8 @@ int main(int argc, char **argv)
 
 			if (bytes_to_read > 0)
 				bytes_to_read -= n_read;
+
+			print_stream_stats();
 		}
 	} else {
 		fprintf(stderr, "Reading samples in async mode...\n");
@@ -0,0 +1,592 @@
+/*
+ * rtl-sdr, turns your Realtek RTL2832 based DVB dongle into a SDR receiver
+ * Copyright (C) 2012 by Steve Markgraf <steve@steve-m.de>
+ * Copyright (C) 2012 by Hoernchen <la@tfc-server.de>
+ * Copyright (C) 2012 by Kyle Keen <keenerd@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * wideband power survey, hops the tuner across a range wider than
+ * one sample rate window and stitches averaged FFTs of every step
+ * into one spectrum
+ *
+ * the stream is never stopped, every step is tuned with a precompiled
+ * retune plan and the samples from before the tuner settled are dropped
+ * by their settled_index tag, so a step costs little more than its own
+ * samples. the FFTs of a step run while the next one is being tuned.
+ *
+ * todo: fixed point FFT for ARM
+ *       gain per step
+ *       window choices
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <Windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include "getopt/getopt.h"
+#endif
+
+#include <libusb.h>
+
+#include "rtl-sdr.h"
+#include "rtl-sdr_dsp.h"
+
+#ifndef M_PI
+#define M_PI				3.14159265358979323846
+#endif
+
+#define DEFAULT_SAMPLE_RATE		2400000
+#define DEFAULT_ASYNC_BUF_NUMBER	32
+#define DEFAULT_BUF_LENGTH		(1 * 16384)
+#define DEFAULT_CROP			0.25
+#define DEFAULT_AVERAGES		16
+#define MAXIMUM_FFT_LOG2		16
+#define AUTO_GAIN			-100
+
+#define BINARY_MAGIC			0x50575352	/* "RSWP" */
+
+static volatile int do_exit = 0;
+static rtlsdr_dev_t *dev = NULL;
+
+struct sweep_step
+{
+	uint32_t freq;		/* center Hz */
+	int      bin_lo;	/* usable FFT bins, stitched without overlap */
+	int      bin_hi;
+};
+
+struct sweep_state
+{
+	uint32_t lower;
+	uint32_t upper;
+	uint32_t sample_rate;
+	double   crop;
+	int      fft_log2;
+	int      fft_len;
+	int      samples;	/* per step, multiple of fft_len */
+	struct sweep_step *steps;
+	int      step_count;
+	rtlsdr_retune_plan_t *plan;
+	/* capture of the step being filled */
+	unsigned char *capture;
+	int      captured;
+	/* FFT */
+	float    *input;	/* one FFT worth of converted samples */
+	float    *window;
+	float    *twiddle;	/* cos/sin pairs */
+	int      *bitrev;
+	float    *work;		/* i/q pairs */
+	double   *power;
+	int      binary_output;
+	FILE     *file;
+};
+
+void usage(void)
+{
+	fprintf(stderr,
+		"rtl_sweep, a wideband spectrum survey tool\n\n"
+		"Use:\trtl_sweep -f lower:upper:bin_size [-options] [filename]\n"
+		"\t-f frequency range [Hz], bin_size is rounded down to a power of two FFT\n"
+		"\t (suffixes k, M and G are supported, -f 88M:108M:10k)\n"
+		"\t[-s sample_rate (default: 2.4M)]\n"
+		"\t[-d device_index (default: 0)]\n"
+		"\t[-g tuner_gain (default: automatic)]\n"
+		"\t[-p ppm_error (default: 0)]\n"
+		"\t[-n samples per step (default: 16 FFTs)]\n"
+		"\t[-c crop fraction, band edges dropped per step (default: 0.25)]\n"
+		"\t[-N sweeps, 0 runs until interrupted (default: 1)]\n"
+		"\t[-b binary output (default: csv)]\n"
+		"\tfilename (a '-' dumps samples to stdout)\n"
+		"\t (omitting the filename also uses stdout)\n\n"
+		"CSV output, one line per step:\n"
+		"\tdate, time, Hz low, Hz high, Hz step, samples, dB, dB, ...\n"
+		"Binary output, one frame per step, native byte order:\n"
+		"\tuint32 magic 0x%08x, uint32 sweep, uint32 bins,\n"
+		"\tuint32 samples, double Hz low, double Hz step, float dB[bins]\n"
+		"\n", BINARY_MAGIC);
+	exit(1);
+}
+
+#ifdef _WIN32
+BOOL WINAPI
+sighandler(int signum)
+{
+	if (CTRL_C_EVENT == signum) {
+		fprintf(stderr, "Signal caught, exiting!\n");
+		do_exit = 1;
+		rtlsdr_cancel_async(dev);
+		return TRUE;
+	}
+	return FALSE;
+}
+#else
+static void sighandler(int signum)
+{
+	fprintf(stderr, "Signal caught, exiting!\n");
+	do_exit = 1;
+	rtlsdr_cancel_async(dev);
+}
+#endif
+
+double atofs(char* f)
+/* standard suffixes */
+{
+	char* chop;
+	double suff = 1.0;
+	chop = malloc((strlen(f)+1)*sizeof(char));
+	strncpy(chop, f, strlen(f)-1);
+	chop[strlen(f)-1] = '\0';
+	switch (f[strlen(f)-1]) {
+		case 'G':
+			suff *= 1e3;
+			/* fall through */
+		case 'M':
+			suff *= 1e3;
+			/* fall through */
+		case 'k':
+			suff *= 1e3;
+			suff *= atof(chop);}
+	free(chop);
+	if (suff != 1.0) {
+		return suff;}
+	return atof(f);
+}
+
+int frequency_range(struct sweep_state *s, char *arg, double *bin_size)
+{
+	char *start, *stop, *step;
+	start = arg;
+	stop = strchr(start, ':');
+	if (!stop) {
+		return -1;}
+	*stop++ = '\0';
+	step = strchr(stop, ':');
+	if (!step) {
+		return -1;}
+	*step++ = '\0';
+	s->lower = (uint32_t)atofs(start);
+	s->upper = (uint32_t)atofs(stop);
+	*bin_size = atofs(step);
+	return 0;
+}
+
+int plan_steps(struct sweep_state *s)
+/* equally spaced steps, each keeps the middle (1 - crop) of its band */
+{
+	int i, usable_bins, half;
+	double bin_hz, usable_hz;
+	bin_hz = (double)s->sample_rate / s->fft_len;
+	usable_bins = (int)(s->fft_len * (1.0 - s->crop));
+	if (usable_bins < 1) {
+		usable_bins = 1;}
+	usable_hz = usable_bins * bin_hz;
+	s->step_count = (int)ceil((s->upper - s->lower) / usable_hz);
+	if (s->step_count < 1) {
+		s->step_count = 1;}
+	s->steps = calloc(s->step_count, sizeof(struct sweep_step));
+	if (!s->steps) {
+		return -1;}
+	half = usable_bins / 2;
+	for (i=0; i<s->step_count; i++) {
+		/* bin 0 of the shifted FFT sits at freq - sample_rate/2 */
+		s->steps[i].freq = (uint32_t)(s->lower + (i * usable_bins + half) * bin_hz);
+		s->steps[i].bin_lo = s->fft_len/2 - half;
+		s->steps[i].bin_hi = s->steps[i].bin_lo + usable_bins;
+	}
+	/* the last step stops at the upper edge */
+	i = s->step_count - 1;
+	s->steps[i].bin_hi = s->steps[i].bin_lo +
+		(int)ceil((s->upper - s->lower) / bin_hz) - i * usable_bins;
+	if (s->steps[i].bin_hi > s->fft_len) {
+		s->steps[i].bin_hi = s->fft_len;}
+	return 0;
+}
+
+int fft_setup(struct sweep_state *s)
+{
+	int i, j, n = s->fft_len;
+	s->window = malloc(n * sizeof(float));
+	s->twiddle = malloc(n * sizeof(float));
+	s->bitrev = malloc(n * sizeof(int));
+	s->input = malloc(2 * n * sizeof(float));
+	s->work = malloc(2 * n * sizeof(float));
+	s->power = malloc(n * sizeof(double));
+	s->capture = malloc(2 * s->samples);
+	if (!s->window || !s->twiddle || !s->bitrev || !s->input || !s->work ||
+	    !s->power || !s->capture) {
+		return -1;}
+	for (i=0; i<n; i++) {
+		/* Hann */
+		s->window[i] = (float)(0.5 - 0.5 * cos(2 * M_PI * i / n));
+		s->bitrev[i] = 0;
+		for (j=0; j<s->fft_log2; j++) {
+			s->bitrev[i] |= ((i >> j) & 1) << (s->fft_log2 - 1 - j);}
+	}
+	for (i=0; i<n/2; i++) {
+		s->twiddle[2*i]   = (float)cos(-2 * M_PI * i / n);
+		s->twiddle[2*i+1] = (float)sin(-2 * M_PI * i / n);
+	}
+	return 0;
+}
+
+void fft(struct sweep_state *s)
+/* in place radix-2, input already in bit reversed order */
+{
+	int size, half, stride, i, j;
+	float *w = s->work;
+	float tr, ti, wr, wi;
+	for (size=2; size<=s->fft_len; size<<=1) {
+		half = size >> 1;
+		stride = s->fft_len / size;
+		for (i=0; i<s->fft_len; i+=size) {
+			for (j=0; j<half; j++) {
+				wr = s->twiddle[2*j*stride];
+				wi = s->twiddle[2*j*stride+1];
+				tr = w[2*(i+j+half)] * wr - w[2*(i+j+half)+1] * wi;
+				ti = w[2*(i+j+half)] * wi + w[2*(i+j+half)+1] * wr;
+				w[2*(i+j+half)]   = w[2*(i+j)]   - tr;
+				w[2*(i+j+half)+1] = w[2*(i+j)+1] - ti;
+				w[2*(i+j)]   += tr;
+				w[2*(i+j)+1] += ti;
+			}
+		}
+	}
+}
+
+void average_power(struct sweep_state *s)
+/* averages all FFTs of the captured step into s->power, in FFT shifted order */
+{
+	int i, k, n = s->fft_len;
+	float *in = s->input;
+	memset(s->power, 0, n * sizeof(double));
+	for (k=0; k<s->samples; k+=n) {
+		rtlsdr_dsp_u8_to_f32(s->capture + 2*k, in, 2*n);
+		for (i=0; i<n; i++) {
+			s->work[2*s->bitrev[i]]   = in[2*i]   * s->window[i];
+			s->work[2*s->bitrev[i]+1] = in[2*i+1] * s->window[i];
+		}
+		fft(s);
+		for (i=0; i<n; i++) {
+			s->power[(i + n/2) % n] += s->work[2*i] * s->work[2*i]
+				+ s->work[2*i+1] * s->work[2*i+1];}
+	}
+	/* the DC spike of the tuner */
+	s->power[n/2] = (s->power[n/2-1] + s->power[n/2+1]) / 2;
+}
+
+void write_step(struct sweep_state *s, int index, int sweep)
+{
+	struct sweep_step *st = &s->steps[index];
+	double bin_hz, low, scale, db;
+	uint32_t header[4];
+	float dbf;
+	char t_str[50];
+	struct tm *cal_time;
+	time_t time_now;
+	int i;
+	bin_hz = (double)s->sample_rate / s->fft_len;
+	low = st->freq - s->sample_rate / 2.0 + st->bin_lo * bin_hz;
+	/* full scale sine at 0 dB */
+	scale = (double)(s->samples / s->fft_len) * s->fft_len * s->fft_len / 4.0;
+	if (s->binary_output) {
+		header[0] = BINARY_MAGIC;
+		header[1] = (uint32_t)sweep;
+		header[2] = (uint32_t)(st->bin_hi - st->bin_lo);
+		header[3] = (uint32_t)s->samples;
+		fwrite(header, sizeof(uint32_t), 4, s->file);
+		fwrite(&low, sizeof(double), 1, s->file);
+		fwrite(&bin_hz, sizeof(double), 1, s->file);
+		for (i=st->bin_lo; i<st->bin_hi; i++) {
+			dbf = (float)(10 * log10(s->power[i] / scale + 1e-20));
+			fwrite(&dbf, sizeof(float), 1, s->file);}
+		return;
+	}
+	time_now = time(NULL);
+	cal_time = localtime(&time_now);
+	strftime(t_str, 50, "%Y-%m-%d, %H:%M:%S", cal_time);
+	fprintf(s->file, "%s, %.0f, %.0f, %.2f, %i", t_str, low,
+		low + (st->bin_hi - st->bin_lo) * bin_hz, bin_hz, s->samples);
+	for (i=st->bin_lo; i<st->bin_hi; i++) {
+		db = 10 * log10(s->power[i] / scale + 1e-20);
+		fprintf(s->file, ", %.2f", db);}
+	fprintf(s->file, "\n");
+}
+
+int tune_step(struct sweep_state *s, int index)
+{
+	if (s->plan) {
+		return rtlsdr_retune_plan_apply(dev, s->plan, index);}
+	return rtlsdr_set_center_freq(dev, s->steps[index].freq);
+}
+
+int capture_settled(struct sweep_state *s, int index, unsigned char *buf,
+		    uint32_t len, rtlsdr_xfer_info_t *info)
+/* returns 1 once the step has all its samples */
+{
+	uint64_t skip;
+	uint32_t n;
+	if (info->freq != s->steps[index].freq) {
+		return 0;}
+	if (info->settled_index > info->sample_index) {
+		skip = (info->settled_index - info->sample_index) * 2;
+		if (skip >= len) {
+			return 0;}
+		buf += skip;
+		len -= (uint32_t)skip;
+	}
+	n = 2 * (s->samples - s->captured);
+	if (len > n) {
+		len = n;}
+	memcpy(s->capture + 2 * s->captured, buf, len);
+	s->captured += len / 2;
+	return s->captured >= s->samples;
+}
+
+int main(int argc, char **argv)
+{
+#ifndef _WIN32
+	struct sigaction sigact;
+#endif
+	char *filename = NULL;
+	int r, opt, i;
+	int gain = AUTO_GAIN; // tenths of a dB
+	int ppm_error = 0;
+	int sweeps = 1, sweep = 0, step = 0;
+	int consumer;
+	uint32_t dev_index = 0;
+	uint32_t len, *hops;
+	unsigned char *buf;
+	double bin_size = 0;
+	rtlsdr_xfer_info_t info;
+	struct sweep_state s;
+	uint64_t sweep_start = 0;
+
+	memset(&s, 0, sizeof(s));
+	s.sample_rate = DEFAULT_SAMPLE_RATE;
+	s.crop = DEFAULT_CROP;
+	while ((opt = getopt(argc, argv, "d:f:g:s:p:n:c:N:b")) != -1) {
+		switch (opt) {
+		case 'd':
+			dev_index = atoi(optarg);
+			break;
+		case 'f':
+			if (frequency_range(&s, optarg, &bin_size) < 0) {
+				usage();}
+			break;
+		case 'g':
+			gain = (int)(atof(optarg) * 10);
+			break;
+		case 's':
+			s.sample_rate = (uint32_t)atofs(optarg);
+			break;
+		case 'p':
+			ppm_error = atoi(optarg);
+			break;
+		case 'n':
+			s.samples = (int)atofs(optarg);
+			break;
+		case 'c':
+			s.crop = atof(optarg);
+			break;
+		case 'N':
+			sweeps = atoi(optarg);
+			break;
+		case 'b':
+			s.binary_output = 1;
+			break;
+		default:
+			usage();
+			break;
+		}
+	}
+
+	if (s.upper <= s.lower || bin_size <= 0 || s.crop < 0 || s.crop >= 1) {
+		fprintf(stderr, "Please specify a frequency range.\n");
+		usage();}
+
+	/* the smallest power of two FFT with bins no wider than requested */
+	for (s.fft_log2=1; s.fft_log2<MAXIMUM_FFT_LOG2; s.fft_log2++) {
+		if ((double)s.sample_rate / (1 << s.fft_log2) <= bin_size) {
+			break;}
+	}
+	s.fft_len = 1 << s.fft_log2;
+	if (s.samples <= 0) {
+		s.samples = DEFAULT_AVERAGES * s.fft_len;}
+	s.samples = (s.samples + s.fft_len - 1) / s.fft_len * s.fft_len;
+
+	if (plan_steps(&s) < 0 || fft_setup(&s) < 0) {
+		fprintf(stderr, "Out of memory.\n");
+		exit(1);
+	}
+	fprintf(stderr, "Range %u-%u Hz, %i steps of %i bins, %.2f Hz each.\n",
+		s.lower, s.upper, s.step_count, s.steps[0].bin_hi - s.steps[0].bin_lo,
+		(double)s.sample_rate / s.fft_len);
+
+	if (argc <= optind) {
+		filename = "-";
+	} else {
+		filename = argv[optind];
+	}
+
+	if (!rtlsdr_get_device_count()) {
+		fprintf(stderr, "No supported devices found.\n");
+		exit(1);
+	}
+
+	fprintf(stderr, "Using device %d: %s\n",
+		dev_index, rtlsdr_get_device_name(dev_index));
+
+	r = rtlsdr_open(&dev, dev_index);
+	if (r < 0) {
+		fprintf(stderr, "Failed to open rtlsdr device #%d.\n", dev_index);
+		exit(1);
+	}
+#ifndef _WIN32
+	sigact.sa_handler = sighandler;
+	sigemptyset(&sigact.sa_mask);
+	sigact.sa_flags = 0;
+	sigaction(SIGINT, &sigact, NULL);
+	sigaction(SIGTERM, &sigact, NULL);
+	sigaction(SIGQUIT, &sigact, NULL);
+	sigaction(SIGPIPE, &sigact, NULL);
+#else
+	SetConsoleCtrlHandler( (PHANDLER_ROUTINE) sighandler, TRUE );
+#endif
+
+	if (strcmp(filename, "-") == 0) { /* Write samples to stdout */
+		s.file = stdout;
+#ifdef _WIN32
+		_setmode(_fileno(s.file), _O_BINARY);
+#endif
+	} else {
+		s.file = fopen(filename, "wb");
+		if (!s.file) {
+			fprintf(stderr, "Failed to open %s\n", filename);
+			exit(1);
+		}
+	}
+
+	/* Set the tuner gain */
+	if (gain == AUTO_GAIN) {
+		r = rtlsdr_set_tuner_gain_mode(dev, 0);
+	} else {
+		r = rtlsdr_set_tuner_gain_mode(dev, 1);
+		r = rtlsdr_set_tuner_gain(dev, gain);
+	}
+	if (r != 0) {
+		fprintf(stderr, "WARNING: Failed to set tuner gain.\n");
+	} else if (gain == AUTO_GAIN) {
+		fprintf(stderr, "Tuner gain set to automatic.\n");
+	} else {
+		fprintf(stderr, "Tuner gain set to %0.2f dB.\n", gain/10.0);
+	}
+
+	r = rtlsdr_set_sample_rate(dev, s.sample_rate);
+	if (r < 0) {
+		fprintf(stderr, "WARNING: Failed to set sample rate.\n");}
+	r = rtlsdr_set_freq_correction(dev, ppm_error);
+
+	/* compiled last, tuning settings invalidate the plan */
+	hops = malloc(s.step_count * sizeof(uint32_t));
+	for (i=0; hops && i<s.step_count; i++) {
+		hops[i] = s.steps[i].freq;}
+	if (s.step_count > 1 && hops &&
+	    rtlsdr_retune_plan_create(dev, &s.plan, hops, s.step_count) < 0) {
+		fprintf(stderr, "WARNING: Failed to precompile the steps.\n");
+		s.plan = NULL;
+	}
+	free(hops);
+
+	r = tune_step(&s, 0);
+	if (r < 0) {
+		fprintf(stderr, "WARNING: Failed to set center freq.\n");}
+
+	/* Reset endpoint before we start reading from it (mandatory) */
+	r = rtlsdr_reset_buffer(dev);
+	if (r < 0) {
+		fprintf(stderr, "WARNING: Failed to reset buffers.\n");}
+
+	consumer = rtlsdr_ring_add_consumer(dev);
+	r = rtlsdr_start_streaming(dev, DEFAULT_ASYNC_BUF_NUMBER,
+				   DEFAULT_BUF_LENGTH);
+	if (r < 0) {
+		fprintf(stderr, "Failed to start streaming.\n");}
+
+	while (r >= 0 && !do_exit && rtlsdr_ring_acquire(dev, consumer, &buf, &len, -1) == 0) {
+		rtlsdr_ring_get_info(dev, consumer, &info);
+		if (!sweep_start) {
+			sweep_start = info.timestamp;}
+		i = capture_settled(&s, step, buf, len, &info);
+		rtlsdr_ring_release(dev, consumer);
+		if (!i) {
+			continue;}
+		/* tune the next step first, its FFTs overlap the settling */
+		i = step;
+		step = (step + 1) % s.step_count;
+		if (step == 0) {
+			sweep++;}
+		if (s.step_count > 1 && (!sweeps || sweep < sweeps)) {
+			if (tune_step(&s, step) < 0) {
+				fprintf(stderr, "WARNING: Failed to set center freq.\n");}
+		}
+		average_power(&s);
+		s.captured = 0;
+		write_step(&s, i, sweep - (step == 0));
+		if (step == 0) {
+			/* stream time of the last buffer of the sweep */
+			fprintf(stderr, "Sweep %i done in %.3f s.\n", sweep,
+				(info.timestamp - sweep_start) / 1e9);
+			sweep_start = info.timestamp;
+			fflush(s.file);
+			if (sweeps && sweep >= sweeps) {
+				break;}
+		}
+	}
+	if (r >= 0) {
+		r = rtlsdr_stop_streaming(dev);}
+
+	if (do_exit) {
+		fprintf(stderr, "\nUser cancel, exiting...\n");}
+	else if (r < 0) {
+		fprintf(stderr, "\nLibrary error %d, exiting...\n", r);}
+
+	if (s.file != stdout) {
+		fclose(s.file);}
+
+	rtlsdr_retune_plan_destroy(s.plan);
+	rtlsdr_close(dev);
+	free(s.steps);
+	free(s.window);
+	free(s.twiddle);
+	free(s.bitrev);
+	free(s.input);
+	free(s.work);
+	free(s.power);
+	free(s.capture);
+	return r >= 0 ? r : -r;
+}
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #ifndef _WIN32
 #include <unistd.h>
@@ -76,6 +77,8 @@ int global_numq = 0;
 static struct llist *ll_buffers = 0;
 
 static int do_exit = 0;
+static int stats_interval = 0;
+static time_t stats_next = 0;
 
 void usage(void)
 {
@@ -86,7 +89,8 @@ void usage(void)
 		"\t[-g gain (default: 0 for auto)]\n"
 		"\t[-s samplerate in Hz (default: 2048000 Hz)]\n"
 		"\t[-b number of buffers (default: 32, set by library)]\n"
-		"\t[-d device index (default: 0)]\n");
+		"\t[-d device index (default: 0)]\n"
+		"\t[-i print stream statistics every n seconds (default: 0, off)]\n");
 	exit(1);
 }
 
@@ -128,6 +132,22 @@ static void sighandler(int signum)
 }
 #endif
 
+static void print_stream_stats(void)
+{
+	rtlsdr_stream_stats_t st;
+	char line[512];
+
+	if (!stats_interval || time(NULL) < stats_next)
+		return;
+	stats_next = time(NULL) + stats_interval;
+
+	if (rtlsdr_get_stream_stats(dev, &st) < 0)
+		return;
+
+	rtlsdr_format_stream_stats(&st, line, sizeof(line));
+	fprintf(stderr, "%s\n", line);
+}
+
 void rtlsdr_callback(unsigned char *buf, uint32_t len, void *ctx)
 {
 	if(!do_exit) {
@@ -160,6 +180,8 @@ void rtlsdr_callback(unsigned char *buf, uint32_t len, void *ctx)
 		}
 		pthread_cond_signal(&cond);
 		pthread_mutex_unlock(&ll_mutex);
+
+		print_stream_stats();
 	}
 }
 
@@ -358,7 +380,7 @@ int main(int argc, char **argv)
 	struct sigaction sigact, sigign;
 #endif
 
-	while ((opt = getopt(argc, argv, "a:p:f:g:s:b:d:")) != -1) {
+	while ((opt = getopt(argc, argv, "a:p:f:g:s:b:d:i:")) != -1) {
 		switch (opt) {
 		case 'd':
 			dev_index = atoi(optarg);
@@ -381,6 +403,9 @@ int main(int argc, char **argv)
 		case 'b':
 			buf_num = atoi(optarg);
 			break;
+		case 'i':
+			stats_interval = atoi(optarg);
+			break;
 		default:
 			usage();
 			break;
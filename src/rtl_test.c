@@ -77,7 +77,8 @@ void usage(void)
 		"\t[-p enable PPM error measurement]\n"
 		#endif
 		"\t[-b output_block_size (default: 16 * 16384)]\n"
-		"\t[-S force sync output (default: async)]\n");
+		"\t[-S force sync output (default: async)]\n"
+		"\t[-C recalibrate the tuner and refresh its calibration cache]\n");
 	exit(1);
 }
 
@@ -221,7 +222,7 @@ int main(int argc, char **argv)
 	int real_rate;
 	int64_t ns;
 
-	while ((opt = getopt(argc, argv, "d:s:b:tpS::")) != -1) {
+	while ((opt = getopt(argc, argv, "d:s:b:tpCS::")) != -1) {
 		switch (opt) {
 		case 'd':
 			dev_index = atoi(optarg);
@@ -241,6 +242,9 @@ int main(int argc, char **argv)
 		case 'S':
 			sync_mode = 1;
 			break;
+		case 'C':
+			rtlsdr_set_cal_cache(NULL, RTLSDR_CAL_CACHE_REFRESH);
+			break;
 		default:
 			usage();
 			break;
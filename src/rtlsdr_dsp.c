@@ -0,0 +1,2724 @@
+/*
+ * rtl-sdr, turns your Realtek RTL2832 based DVB dongle into a SDR receiver
+ * Copyright (C) 2012 by Steve Markgraf <steve@steve-m.de>
+ * Copyright (C) 2012 by Dimitri Stolnikov <horiz0n@gmx.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <pthread.h>
+
+#include "rtl-sdr_dsp.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DSP_X86
+#endif
+
+/* intrinsics for instruction sets the compiler does not target by default
+ * need function attributes, which MSVC does without */
+#if defined(DSP_X86) && (defined(__GNUC__) || defined(_MSC_VER))
+#define DSP_HAVE_SSE2
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5) || \
+    (defined(_MSC_VER) && _MSC_VER >= 1800)
+#define DSP_HAVE_AVX2
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DSP_HAVE_NEON
+#endif
+
+#ifdef DSP_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#ifdef DSP_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define DSP_TARGET(isa)		__attribute__((target(isa)))
+#else
+#define DSP_TARGET(isa)
+#endif
+
+#ifndef M_PI
+#define M_PI			3.14159265358979323846
+#endif
+
+/* (x - 127.5) * 256 */
+#define S16_BIAS		32640
+
+/* discriminator output, pi is 1 << 14 */
+#define DISC_SCALE		5215.18917f
+#define DISC_PI			3.14159265f
+#define DISC_PI_2		1.57079633f
+/* keeps 0 / 0 at 0 */
+#define DISC_TINY		1e-30f
+
+/* odd polynomial for atan on [0, 1], error below 1e-5 rad */
+#define ATAN_C1			0.99986600f
+#define ATAN_C3			-0.33029950f
+#define ATAN_C5			0.18014100f
+#define ATAN_C7			-0.08513300f
+#define ATAN_C9			0.02083510f
+
+/* sums of int16 values in 32 bit lanes are flushed before they can wrap */
+#define SUM_S16_FLUSH		16384
+#define SUM_F32_FLUSH		1024
+
+struct dsp_ops {
+	void (*u8_to_s16)(const uint8_t *in, int16_t *out, uint32_t len);
+	void (*u8_to_f32)(const uint8_t *in, float *out, uint32_t len);
+	void (*rotate_90_u8)(uint8_t *buf, uint32_t len);
+	void (*rotate_90_s16)(int16_t *buf, uint32_t len);
+	void (*sum_s16)(const int16_t *buf, uint32_t len, int64_t *i, int64_t *q);
+	void (*sub_s16)(int16_t *buf, uint32_t len, int16_t i, int16_t q);
+	void (*sum_f32)(const float *buf, uint32_t len, double *i, double *q);
+	void (*sub_f32)(float *buf, uint32_t len, float i, float q);
+	void (*dot_s16)(const int16_t *taps, const int16_t *i, const int16_t *q,
+			uint32_t len, int32_t *ri, int32_t *rq);
+	void (*dot_f32)(const float *taps, const float *i, const float *q,
+			uint32_t len, float *ri, float *rq);
+	void (*disc_poly)(const int16_t *in, uint32_t n, int16_t *out);
+	void (*disc_deriv)(const int16_t *in, uint32_t n, int16_t *out,
+			   float scale);
+	void (*energy_s16)(const int16_t *buf, uint32_t len, double *sum);
+	void (*magnitude_u8)(const uint8_t *in, uint8_t *out, uint32_t len);
+	int (*pulse_find_u8)(const uint8_t *in, uint32_t len, uint16_t pattern);
+};
+
+/*
+ * Rotation by 1, j, -1, -j. Multiplying by j swaps I and Q and negates the
+ * new I, by -j it negates the new Q. On offset binary bytes the negation
+ * 255 - x is a plain x ^ 0xff. The masks cover four complex samples and
+ * are repeated to fill a vector.
+ */
+static const uint8_t rot_u8_swap[32] = {
+	0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0xff, 0xff,
+	0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0xff, 0xff,
+	0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0xff, 0xff,
+	0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t rot_u8_neg[32] = {
+	0x00, 0x00, 0xff, 0x00, 0xff, 0xff, 0x00, 0xff,
+	0x00, 0x00, 0xff, 0x00, 0xff, 0xff, 0x00, 0xff,
+	0x00, 0x00, 0xff, 0x00, 0xff, 0xff, 0x00, 0xff,
+	0x00, 0x00, 0xff, 0x00, 0xff, 0xff, 0x00, 0xff,
+};
+
+static const int16_t rot_s16_swap[16] = {
+	0, 0, -1, -1, 0, 0, -1, -1,
+	0, 0, -1, -1, 0, 0, -1, -1,
+};
+
+static const int16_t rot_s16_neg[16] = {
+	0, 0, -1, 0, -1, -1, 0, -1,
+	0, 0, -1, 0, -1, -1, 0, -1,
+};
+
+/* generic kernels, also used for the tails of the vector kernels */
+
+static void u8_to_s16_generic(const uint8_t *in, int16_t *out, uint32_t len)
+{
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+		out[i] = (int16_t)((in[i] << 8) - S16_BIAS);
+}
+
+static void u8_to_f32_generic(const uint8_t *in, float *out, uint32_t len)
+{
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+		out[i] = ((float)in[i] - 127.5f) * (1.0f / 127.5f);
+}
+
+static void rotate_90_u8_generic(uint8_t *buf, uint32_t len)
+{
+	uint32_t i;
+	uint8_t tmp;
+
+	for (i = 0; i + 1 < len; i += 2) {
+		switch ((i >> 1) & 3) {
+		case 1:
+			tmp = 255 - buf[i+1];
+			buf[i+1] = buf[i];
+			buf[i] = tmp;
+			break;
+		case 2:
+			buf[i] = 255 - buf[i];
+			buf[i+1] = 255 - buf[i+1];
+			break;
+		case 3:
+			tmp = buf[i+1];
+			buf[i+1] = 255 - buf[i];
+			buf[i] = tmp;
+			break;
+		}
+	}
+}
+
+static void rotate_90_s16_generic(int16_t *buf, uint32_t len)
+{
+	uint32_t i;
+	int16_t tmp;
+
+	for (i = 0; i + 1 < len; i += 2) {
+		switch ((i >> 1) & 3) {
+		case 1:
+			tmp = -buf[i+1];
+			buf[i+1] = buf[i];
+			buf[i] = tmp;
+			break;
+		case 2:
+			buf[i] = -buf[i];
+			buf[i+1] = -buf[i+1];
+			break;
+		case 3:
+			tmp = buf[i+1];
+			buf[i+1] = -buf[i];
+			buf[i] = tmp;
+			break;
+		}
+	}
+}
+
+static void sum_s16_generic(const int16_t *buf, uint32_t len,
+			    int64_t *i, int64_t *q)
+{
+	uint32_t n;
+
+	for (n = 0; n + 1 < len; n += 2) {
+		*i += buf[n];
+		*q += buf[n+1];
+	}
+}
+
+static int16_t sat_s16(int32_t x)
+{
+	if (x > 32767)
+		return 32767;
+	if (x < -32768)
+		return -32768;
+	return (int16_t)x;
+}
+
+static void sub_s16_generic(int16_t *buf, uint32_t len, int16_t i, int16_t q)
+{
+	uint32_t n;
+
+	for (n = 0; n + 1 < len; n += 2) {
+		buf[n] = sat_s16((int32_t)buf[n] - i);
+		buf[n+1] = sat_s16((int32_t)buf[n+1] - q);
+	}
+}
+
+static void sum_f32_generic(const float *buf, uint32_t len,
+			    double *i, double *q)
+{
+	uint32_t n;
+
+	for (n = 0; n + 1 < len; n += 2) {
+		*i += buf[n];
+		*q += buf[n+1];
+	}
+}
+
+static void sub_f32_generic(float *buf, uint32_t len, float i, float q)
+{
+	uint32_t n;
+
+	for (n = 0; n + 1 < len; n += 2) {
+		buf[n] -= i;
+		buf[n+1] -= q;
+	}
+}
+
+static void dot_s16_generic(const int16_t *taps, const int16_t *i,
+			    const int16_t *q, uint32_t len,
+			    int32_t *ri, int32_t *rq)
+{
+	int32_t si = 0, sq = 0;
+	uint32_t n;
+
+	for (n = 0; n < len; n++) {
+		si += taps[n] * i[n];
+		sq += taps[n] * q[n];
+	}
+
+	*ri = si;
+	*rq = sq;
+}
+
+static void dot_f32_generic(const float *taps, const float *i,
+			    const float *q, uint32_t len,
+			    float *ri, float *rq)
+{
+	float si = 0, sq = 0;
+	uint32_t n;
+
+	for (n = 0; n < len; n++) {
+		si += taps[n] * i[n];
+		sq += taps[n] * q[n];
+	}
+
+	*ri = si;
+	*rq = sq;
+}
+
+/*
+ * The discriminators take the angle of in[k] * conj(in[k-1]). in[-1] must
+ * be readable and hold the previous sample. Vector kernels do the same
+ * float operations in the same order, and round half away from zero, so
+ * they give the same results as the generic ones.
+ */
+
+static int16_t _round_s16(float x)
+{
+	x = x < -32768.0f ? -32768.0f : (x > 32767.0f ? 32767.0f : x);
+	return (int16_t)(x < 0 ? x - 0.5f : x + 0.5f);
+}
+
+static float _disc_atan2(float im, float re)
+{
+	float ax = re < 0 ? -re : re, ay = im < 0 ? -im : im;
+	float mn = ax < ay ? ax : ay, mx = ax < ay ? ay : ax, t, t2, p;
+
+	t = mn / (mx > DISC_TINY ? mx : DISC_TINY);
+	t2 = t * t;
+	p = ((((ATAN_C9 * t2 + ATAN_C7) * t2 + ATAN_C5) * t2 + ATAN_C3) * t2 +
+	     ATAN_C1) * t;
+	if (ay > ax)
+		p = DISC_PI_2 - p;
+	if (re < 0)
+		p = DISC_PI - p;
+	if (im < 0)
+		p = -p;
+
+	return p * DISC_SCALE;
+}
+
+static void disc_poly_generic(const int16_t *in, uint32_t n, int16_t *out)
+{
+	float ai, aq, bi, bq;
+	uint32_t k;
+
+	for (k = 0; k < n; k++, in += 2) {
+		ai = in[0];
+		aq = in[1];
+		bi = in[-2];
+		bq = in[-1];
+		out[k] = _round_s16(_disc_atan2(aq * bi - ai * bq,
+						 ai * bi + aq * bq));
+	}
+}
+
+static void disc_deriv_generic(const int16_t *in, uint32_t n, int16_t *out,
+			       float scale)
+{
+	float ai, aq, bi, bq;
+	uint32_t k;
+
+	for (k = 0; k < n; k++, in += 2) {
+		ai = in[0];
+		aq = in[1];
+		bi = in[-2];
+		bq = in[-1];
+		out[k] = _round_s16((aq * bi - ai * bq) * scale);
+	}
+}
+
+static void energy_s16_generic(const int16_t *buf, uint32_t len, double *sum)
+{
+	float x;
+	uint32_t n;
+
+	for (n = 0; n < len; n++) {
+		x = buf[n];
+		*sum += x * x;
+	}
+}
+
+/* magnitude of every I/Q byte pair, built at the first use */
+static uint8_t mag_lut[65536];
+
+/* sqrt((di^2 + dq^2) / 2) with d = 2x - 255, which is 255 at full scale.
+ * No square root of an integer lies within 1e-3 of a rounding boundary,
+ * so any float precision rounds it the same way. */
+static uint8_t _mag_u8(int i, int q)
+{
+	int di = 2 * i - 255, dq = 2 * q - 255;
+
+	return (uint8_t)(sqrtf((float)((di * di + dq * dq) / 2)) + 0.5f);
+}
+
+static void _mag_lut_init(void)
+{
+	int i, q;
+
+	for (i = 0; i < 256; i++)
+		for (q = 0; q < 256; q++)
+			mag_lut[i << 8 | q] = _mag_u8(i, q);
+}
+
+static void magnitude_u8_generic(const uint8_t *in, uint8_t *out,
+				 uint32_t len)
+{
+	uint32_t k;
+
+	for (k = 0; k < len / 2; k++)
+		out[k] = mag_lut[in[2*k] << 8 | in[2*k + 1]];
+}
+
+static int _dsp_ctz(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(x);
+#else
+	int n = 0;
+
+	while (!(x & 1)) {
+		x >>= 1;
+		n++;
+	}
+
+	return n;
+#endif
+}
+
+static int pulse_find_u8_generic(const uint8_t *in, uint32_t len,
+				 uint16_t pattern)
+{
+	uint8_t hi, lo;
+	uint32_t i;
+	int k;
+
+	for (i = 0; i + 16 <= len; i++) {
+		hi = 255;
+		lo = 0;
+
+		for (k = 0; k < 16 && hi > lo; k++) {
+			if (pattern & (1 << k))
+				hi = in[i + k] < hi ? in[i + k] : hi;
+			else
+				lo = in[i + k] > lo ? in[i + k] : lo;
+		}
+
+		if (hi > lo)
+			return (int)i;
+	}
+
+	return -1;
+}
+
+static const struct dsp_ops dsp_generic = {
+	u8_to_s16_generic,
+	u8_to_f32_generic,
+	rotate_90_u8_generic,
+	rotate_90_s16_generic,
+	sum_s16_generic,
+	sub_s16_generic,
+	sum_f32_generic,
+	sub_f32_generic,
+	dot_s16_generic,
+	dot_f32_generic,
+	disc_poly_generic,
+	disc_deriv_generic,
+	energy_s16_generic,
+	magnitude_u8_generic,
+	pulse_find_u8_generic,
+};
+
+#ifdef DSP_HAVE_SSE2
+
+DSP_TARGET("sse2")
+static void u8_to_s16_sse2(const uint8_t *in, int16_t *out, uint32_t len)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(S16_BIAS);
+	__m128i x;
+	uint32_t i;
+
+	/* unpacking below a zero byte gives x << 8 */
+	for (i = 0; i + 16 <= len; i += 16) {
+		x = _mm_loadu_si128((const __m128i *)(in + i));
+		_mm_storeu_si128((__m128i *)(out + i),
+				 _mm_sub_epi16(_mm_unpacklo_epi8(zero, x), bias));
+		_mm_storeu_si128((__m128i *)(out + i + 8),
+				 _mm_sub_epi16(_mm_unpackhi_epi8(zero, x), bias));
+	}
+
+	u8_to_s16_generic(in + i, out + i, len - i);
+}
+
+DSP_TARGET("sse2")
+static void u8_to_f32_sse2(const uint8_t *in, float *out, uint32_t len)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 bias = _mm_set1_ps(127.5f);
+	const __m128 scale = _mm_set1_ps(1.0f / 127.5f);
+	__m128i x, lo, hi;
+	uint32_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		x = _mm_loadu_si128((const __m128i *)(in + i));
+		lo = _mm_unpacklo_epi8(x, zero);
+		hi = _mm_unpackhi_epi8(x, zero);
+
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(
+			_mm_unpacklo_epi16(lo, zero)), bias), scale));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(
+			_mm_unpackhi_epi16(lo, zero)), bias), scale));
+		_mm_storeu_ps(out + i + 8, _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(
+			_mm_unpacklo_epi16(hi, zero)), bias), scale));
+		_mm_storeu_ps(out + i + 12, _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(
+			_mm_unpackhi_epi16(hi, zero)), bias), scale));
+	}
+
+	u8_to_f32_generic(in + i, out + i, len - i);
+}
+
+DSP_TARGET("sse2")
+static void rotate_90_u8_sse2(uint8_t *buf, uint32_t len)
+{
+	const __m128i swap = _mm_loadu_si128((const __m128i *)rot_u8_swap);
+	const __m128i neg = _mm_loadu_si128((const __m128i *)rot_u8_neg);
+	__m128i x, s;
+	uint32_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		x = _mm_loadu_si128((const __m128i *)(buf + i));
+		s = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+		x = _mm_or_si128(_mm_and_si128(swap, s),
+				 _mm_andnot_si128(swap, x));
+		_mm_storeu_si128((__m128i *)(buf + i), _mm_xor_si128(x, neg));
+	}
+
+	rotate_90_u8_generic(buf + i, len - i);
+}
+
+DSP_TARGET("sse2")
+static void rotate_90_s16_sse2(int16_t *buf, uint32_t len)
+{
+	const __m128i swap = _mm_loadu_si128((const __m128i *)rot_s16_swap);
+	const __m128i neg = _mm_loadu_si128((const __m128i *)rot_s16_neg);
+	__m128i x, s;
+	uint32_t i;
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		x = _mm_loadu_si128((const __m128i *)(buf + i));
+		s = _mm_or_si128(_mm_slli_epi32(x, 16), _mm_srli_epi32(x, 16));
+		x = _mm_or_si128(_mm_and_si128(swap, s),
+				 _mm_andnot_si128(swap, x));
+		/* (x ^ -1) - -1 == -x */
+		x = _mm_sub_epi16(_mm_xor_si128(x, neg), neg);
+		_mm_storeu_si128((__m128i *)(buf + i), x);
+	}
+
+	rotate_90_s16_generic(buf + i, len - i);
+}
+
+DSP_TARGET("sse2")
+static void sum_s16_sse2(const int16_t *buf, uint32_t len,
+			 int64_t *i, int64_t *q)
+{
+	__m128i x, acc_i, acc_q;
+	int32_t lanes[4];
+	uint32_t n = 0, k;
+
+	while (n + 8 <= len) {
+		acc_i = _mm_setzero_si128();
+		acc_q = _mm_setzero_si128();
+
+		for (k = 0; k < SUM_S16_FLUSH && n + 8 <= len; k++, n += 8) {
+			x = _mm_loadu_si128((const __m128i *)(buf + n));
+			acc_i = _mm_add_epi32(acc_i,
+				_mm_srai_epi32(_mm_slli_epi32(x, 16), 16));
+			acc_q = _mm_add_epi32(acc_q, _mm_srai_epi32(x, 16));
+		}
+
+		_mm_storeu_si128((__m128i *)lanes, acc_i);
+		*i += (int64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		_mm_storeu_si128((__m128i *)lanes, acc_q);
+		*q += (int64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+
+	sum_s16_generic(buf + n, len - n, i, q);
+}
+
+DSP_TARGET("sse2")
+static void sub_s16_sse2(int16_t *buf, uint32_t len, int16_t i, int16_t q)
+{
+	const __m128i d = _mm_set1_epi32((int)((uint16_t)i |
+					       ((uint32_t)(uint16_t)q << 16)));
+	__m128i x;
+	uint32_t n;
+
+	for (n = 0; n + 8 <= len; n += 8) {
+		x = _mm_loadu_si128((const __m128i *)(buf + n));
+		_mm_storeu_si128((__m128i *)(buf + n), _mm_subs_epi16(x, d));
+	}
+
+	sub_s16_generic(buf + n, len - n, i, q);
+}
+
+DSP_TARGET("sse2")
+static void sum_f32_sse2(const float *buf, uint32_t len,
+			 double *i, double *q)
+{
+	__m128 acc;
+	float lanes[4];
+	uint32_t n = 0, k;
+
+	while (n + 4 <= len) {
+		acc = _mm_setzero_ps();
+
+		for (k = 0; k < SUM_F32_FLUSH && n + 4 <= len; k++, n += 4)
+			acc = _mm_add_ps(acc, _mm_loadu_ps(buf + n));
+
+		_mm_storeu_ps(lanes, acc);
+		*i += (double)lanes[0] + lanes[2];
+		*q += (double)lanes[1] + lanes[3];
+	}
+
+	sum_f32_generic(buf + n, len - n, i, q);
+}
+
+DSP_TARGET("sse2")
+static void sub_f32_sse2(float *buf, uint32_t len, float i, float q)
+{
+	const __m128 d = _mm_setr_ps(i, q, i, q);
+	uint32_t n;
+
+	for (n = 0; n + 4 <= len; n += 4)
+		_mm_storeu_ps(buf + n, _mm_sub_ps(_mm_loadu_ps(buf + n), d));
+
+	sub_f32_generic(buf + n, len - n, i, q);
+}
+
+DSP_TARGET("sse2")
+static void dot_s16_sse2(const int16_t *taps, const int16_t *i,
+			 const int16_t *q, uint32_t len,
+			 int32_t *ri, int32_t *rq)
+{
+	__m128i t, acc_i = _mm_setzero_si128(), acc_q = _mm_setzero_si128();
+	__m128i t2, acc_i2 = _mm_setzero_si128(), acc_q2 = _mm_setzero_si128();
+	int32_t lanes[4], ti, tq;
+	uint32_t n;
+
+	/* no pair of products can wrap, the taps never reach -32768 */
+	for (n = 0; n + 16 <= len; n += 16) {
+		t = _mm_loadu_si128((const __m128i *)(taps + n));
+		t2 = _mm_loadu_si128((const __m128i *)(taps + n + 8));
+		acc_i = _mm_add_epi32(acc_i, _mm_madd_epi16(t,
+			_mm_loadu_si128((const __m128i *)(i + n))));
+		acc_q = _mm_add_epi32(acc_q, _mm_madd_epi16(t,
+			_mm_loadu_si128((const __m128i *)(q + n))));
+		acc_i2 = _mm_add_epi32(acc_i2, _mm_madd_epi16(t2,
+			_mm_loadu_si128((const __m128i *)(i + n + 8))));
+		acc_q2 = _mm_add_epi32(acc_q2, _mm_madd_epi16(t2,
+			_mm_loadu_si128((const __m128i *)(q + n + 8))));
+	}
+	acc_i = _mm_add_epi32(acc_i, acc_i2);
+	acc_q = _mm_add_epi32(acc_q, acc_q2);
+
+	dot_s16_generic(taps + n, i + n, q + n, len - n, &ti, &tq);
+	_mm_storeu_si128((__m128i *)lanes, acc_i);
+	*ri = ti + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	_mm_storeu_si128((__m128i *)lanes, acc_q);
+	*rq = tq + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+DSP_TARGET("sse2")
+static void dot_f32_sse2(const float *taps, const float *i,
+			 const float *q, uint32_t len,
+			 float *ri, float *rq)
+{
+	__m128 t, acc_i = _mm_setzero_ps(), acc_q = _mm_setzero_ps();
+	float lanes[4], ti, tq;
+	uint32_t n;
+
+	for (n = 0; n + 4 <= len; n += 4) {
+		t = _mm_loadu_ps(taps + n);
+		acc_i = _mm_add_ps(acc_i, _mm_mul_ps(t, _mm_loadu_ps(i + n)));
+		acc_q = _mm_add_ps(acc_q, _mm_mul_ps(t, _mm_loadu_ps(q + n)));
+	}
+
+	dot_f32_generic(taps + n, i + n, q + n, len - n, &ti, &tq);
+	_mm_storeu_ps(lanes, acc_i);
+	*ri = ti + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	_mm_storeu_ps(lanes, acc_q);
+	*rq = tq + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+/* interleaved int16 pairs to I and Q floats */
+DSP_TARGET("sse2")
+static void _split_sse2(__m128i x, __m128 *i, __m128 *q)
+{
+	*i = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(x, 16), 16));
+	*q = _mm_cvtepi32_ps(_mm_srai_epi32(x, 16));
+}
+
+DSP_TARGET("sse2")
+static __m128i _disc_round_sse2(__m128 x)
+{
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	__m128 half;
+
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-32768.0f)),
+		       _mm_set1_ps(32767.0f));
+	half = _mm_or_ps(_mm_and_ps(x, sign), _mm_set1_ps(0.5f));
+
+	return _mm_cvttps_epi32(_mm_add_ps(x, half));
+}
+
+DSP_TARGET("sse2")
+static __m128 _disc_atan2_sse2(__m128 im, __m128 re)
+{
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	__m128 ax = _mm_andnot_ps(sign, re), ay = _mm_andnot_ps(sign, im);
+	__m128 mn = _mm_min_ps(ax, ay), mx = _mm_max_ps(ax, ay);
+	__m128 t, t2, p, m;
+
+	t = _mm_div_ps(mn, _mm_max_ps(mx, _mm_set1_ps(DISC_TINY)));
+	t2 = _mm_mul_ps(t, t);
+	p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ATAN_C9), t2), _mm_set1_ps(ATAN_C7));
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(ATAN_C5));
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(ATAN_C3));
+	p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(ATAN_C1));
+	p = _mm_mul_ps(p, t);
+
+	m = _mm_cmpgt_ps(ay, ax);
+	p = _mm_or_ps(_mm_and_ps(m, _mm_sub_ps(_mm_set1_ps(DISC_PI_2), p)),
+		      _mm_andnot_ps(m, p));
+	m = _mm_cmplt_ps(re, _mm_setzero_ps());
+	p = _mm_or_ps(_mm_and_ps(m, _mm_sub_ps(_mm_set1_ps(DISC_PI), p)),
+		      _mm_andnot_ps(m, p));
+	m = _mm_cmplt_ps(im, _mm_setzero_ps());
+	p = _mm_xor_ps(p, _mm_and_ps(m, sign));
+
+	return _mm_mul_ps(p, _mm_set1_ps(DISC_SCALE));
+}
+
+DSP_TARGET("sse2")
+static void disc_poly_sse2(const int16_t *in, uint32_t n, int16_t *out)
+{
+	__m128 ai, aq, bi, bq, re, im;
+	__m128i r;
+	uint32_t k;
+
+	for (k = 0; k + 4 <= n; k += 4) {
+		_split_sse2(_mm_loadu_si128((const __m128i *)(in + 2*k)), &ai, &aq);
+		_split_sse2(_mm_loadu_si128((const __m128i *)(in + 2*k - 2)), &bi, &bq);
+		im = _mm_sub_ps(_mm_mul_ps(aq, bi), _mm_mul_ps(ai, bq));
+		re = _mm_add_ps(_mm_mul_ps(ai, bi), _mm_mul_ps(aq, bq));
+		r = _disc_round_sse2(_disc_atan2_sse2(im, re));
+		_mm_storel_epi64((__m128i *)(out + k), _mm_packs_epi32(r, r));
+	}
+
+	disc_poly_generic(in + 2*k, n - k, out + k);
+}
+
+DSP_TARGET("sse2")
+static void disc_deriv_sse2(const int16_t *in, uint32_t n, int16_t *out,
+			    float scale)
+{
+	const __m128 s = _mm_set1_ps(scale);
+	__m128 ai, aq, bi, bq, im;
+	__m128i r;
+	uint32_t k;
+
+	for (k = 0; k + 4 <= n; k += 4) {
+		_split_sse2(_mm_loadu_si128((const __m128i *)(in + 2*k)), &ai, &aq);
+		_split_sse2(_mm_loadu_si128((const __m128i *)(in + 2*k - 2)), &bi, &bq);
+		im = _mm_sub_ps(_mm_mul_ps(aq, bi), _mm_mul_ps(ai, bq));
+		r = _disc_round_sse2(_mm_mul_ps(im, s));
+		_mm_storel_epi64((__m128i *)(out + k), _mm_packs_epi32(r, r));
+	}
+
+	disc_deriv_generic(in + 2*k, n - k, out + k, scale);
+}
+
+DSP_TARGET("sse2")
+static void energy_s16_sse2(const int16_t *buf, uint32_t len, double *sum)
+{
+	__m128 i, q, acc;
+	float lanes[4];
+	uint32_t n = 0, k;
+
+	while (n + 8 <= len) {
+		acc = _mm_setzero_ps();
+
+		for (k = 0; k < SUM_F32_FLUSH && n + 8 <= len; k++, n += 8) {
+			_split_sse2(_mm_loadu_si128((const __m128i *)(buf + n)), &i, &q);
+			acc = _mm_add_ps(acc, _mm_add_ps(_mm_mul_ps(i, i),
+							 _mm_mul_ps(q, q)));
+		}
+
+		_mm_storeu_ps(lanes, acc);
+		*sum += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+
+	energy_s16_generic(buf + n, len - n, sum);
+}
+
+DSP_TARGET("sse2")
+static __m128i _mag_sse2(__m128i x)
+{
+	const __m128i bias = _mm_set1_epi16(255);
+	__m128i d = _mm_sub_epi16(_mm_add_epi16(x, x), bias);
+	__m128 s = _mm_cvtepi32_ps(_mm_srli_epi32(_mm_madd_epi16(d, d), 1));
+
+	return _mm_cvttps_epi32(_mm_add_ps(_mm_sqrt_ps(s), _mm_set1_ps(0.5f)));
+}
+
+DSP_TARGET("sse2")
+static void magnitude_u8_sse2(const uint8_t *in, uint8_t *out, uint32_t len)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i a, b;
+	uint32_t k;
+
+	/* the pairs of 16 bit lanes madd sums are the I/Q pairs, and out
+	 * never overtakes in */
+	for (k = 0; k + 16 <= len / 2; k += 16) {
+		a = _mm_loadu_si128((const __m128i *)(in + 2*k));
+		b = _mm_loadu_si128((const __m128i *)(in + 2*k + 16));
+		_mm_storeu_si128((__m128i *)(out + k), _mm_packus_epi16(
+			_mm_packs_epi32(_mag_sse2(_mm_unpacklo_epi8(a, zero)),
+					_mag_sse2(_mm_unpackhi_epi8(a, zero))),
+			_mm_packs_epi32(_mag_sse2(_mm_unpacklo_epi8(b, zero)),
+					_mag_sse2(_mm_unpackhi_epi8(b, zero)))));
+	}
+
+	magnitude_u8_generic(in + 2*k, out + k, len - 2*k);
+}
+
+/* screens 16 offsets at a time, the 16 samples of each are 16 loads */
+DSP_TARGET("sse2")
+static int pulse_find_u8_sse2(const uint8_t *in, uint32_t len,
+			      uint16_t pattern)
+{
+	__m128i hi, lo, v;
+	uint32_t i, m;
+	int k, r;
+
+	for (i = 0; i + 31 <= len; i += 16) {
+		hi = _mm_set1_epi8((char)0xff);
+		lo = _mm_setzero_si128();
+
+		for (k = 0; k < 16; k++) {
+			v = _mm_loadu_si128((const __m128i *)(in + i + k));
+			if (pattern & (1 << k))
+				hi = _mm_min_epu8(hi, v);
+			else
+				lo = _mm_max_epu8(lo, v);
+		}
+
+		/* hi > lo where the saturated difference is not zero */
+		m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(hi, lo),
+						     _mm_setzero_si128()));
+		m ^= 0xffff;
+		if (m)
+			return (int)i + _dsp_ctz(m);
+	}
+
+	r = pulse_find_u8_generic(in + i, len - i, pattern);
+
+	return r < 0 ? r : (int)i + r;
+}
+
+static const struct dsp_ops dsp_sse2 = {
+	u8_to_s16_sse2,
+	u8_to_f32_sse2,
+	rotate_90_u8_sse2,
+	rotate_90_s16_sse2,
+	sum_s16_sse2,
+	sub_s16_sse2,
+	sum_f32_sse2,
+	sub_f32_sse2,
+	dot_s16_sse2,
+	dot_f32_sse2,
+	disc_poly_sse2,
+	disc_deriv_sse2,
+	energy_s16_sse2,
+	magnitude_u8_sse2,
+	pulse_find_u8_sse2,
+};
+
+#endif /* DSP_HAVE_SSE2 */
+
+#ifdef DSP_HAVE_AVX2
+
+DSP_TARGET("avx2")
+static void u8_to_s16_avx2(const uint8_t *in, int16_t *out, uint32_t len)
+{
+	const __m256i bias = _mm256_set1_epi16(S16_BIAS);
+	__m256i x;
+	uint32_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		x = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(in + i)));
+		x = _mm256_sub_epi16(_mm256_slli_epi16(x, 8), bias);
+		_mm256_storeu_si256((__m256i *)(out + i), x);
+	}
+
+	u8_to_s16_generic(in + i, out + i, len - i);
+}
+
+DSP_TARGET("avx2")
+static void u8_to_f32_avx2(const uint8_t *in, float *out, uint32_t len)
+{
+	const __m256 bias = _mm256_set1_ps(127.5f);
+	const __m256 scale = _mm256_set1_ps(1.0f / 127.5f);
+	__m256i x;
+	__m256 f;
+	uint32_t i;
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		x = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(in + i)));
+		f = _mm256_sub_ps(_mm256_cvtepi32_ps(x), bias);
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(f, scale));
+	}
+
+	u8_to_f32_generic(in + i, out + i, len - i);
+}
+
+DSP_TARGET("avx2")
+static void rotate_90_u8_avx2(uint8_t *buf, uint32_t len)
+{
+	const __m256i swap = _mm256_loadu_si256((const __m256i *)rot_u8_swap);
+	const __m256i neg = _mm256_loadu_si256((const __m256i *)rot_u8_neg);
+	__m256i x, s;
+	uint32_t i;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		x = _mm256_loadu_si256((const __m256i *)(buf + i));
+		s = _mm256_or_si256(_mm256_slli_epi16(x, 8),
+				    _mm256_srli_epi16(x, 8));
+		x = _mm256_blendv_epi8(x, s, swap);
+		_mm256_storeu_si256((__m256i *)(buf + i),
+				    _mm256_xor_si256(x, neg));
+	}
+
+	rotate_90_u8_generic(buf + i, len - i);
+}
+
+DSP_TARGET("avx2")
+static void rotate_90_s16_avx2(int16_t *buf, uint32_t len)
+{
+	const __m256i swap = _mm256_loadu_si256((const __m256i *)rot_s16_swap);
+	const __m256i neg = _mm256_loadu_si256((const __m256i *)rot_s16_neg);
+	__m256i x, s;
+	uint32_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		x = _mm256_loadu_si256((const __m256i *)(buf + i));
+		s = _mm256_or_si256(_mm256_slli_epi32(x, 16),
+				    _mm256_srli_epi32(x, 16));
+		x = _mm256_blendv_epi8(x, s, swap);
+		x = _mm256_sub_epi16(_mm256_xor_si256(x, neg), neg);
+		_mm256_storeu_si256((__m256i *)(buf + i), x);
+	}
+
+	rotate_90_s16_generic(buf + i, len - i);
+}
+
+DSP_TARGET("avx2")
+static void sum_s16_avx2(const int16_t *buf, uint32_t len,
+			 int64_t *i, int64_t *q)
+{
+	__m256i x, acc_i, acc_q;
+	int32_t lanes[8];
+	uint32_t n = 0, k;
+	int j;
+
+	while (n + 16 <= len) {
+		acc_i = _mm256_setzero_si256();
+		acc_q = _mm256_setzero_si256();
+
+		for (k = 0; k < SUM_S16_FLUSH && n + 16 <= len; k++, n += 16) {
+			x = _mm256_loadu_si256((const __m256i *)(buf + n));
+			acc_i = _mm256_add_epi32(acc_i,
+				_mm256_srai_epi32(_mm256_slli_epi32(x, 16), 16));
+			acc_q = _mm256_add_epi32(acc_q, _mm256_srai_epi32(x, 16));
+		}
+
+		_mm256_storeu_si256((__m256i *)lanes, acc_i);
+		for (j = 0; j < 8; j++)
+			*i += lanes[j];
+		_mm256_storeu_si256((__m256i *)lanes, acc_q);
+		for (j = 0; j < 8; j++)
+			*q += lanes[j];
+	}
+
+	sum_s16_generic(buf + n, len - n, i, q);
+}
+
+DSP_TARGET("avx2")
+static void sub_s16_avx2(int16_t *buf, uint32_t len, int16_t i, int16_t q)
+{
+	const __m256i d = _mm256_set1_epi32((int)((uint16_t)i |
+						  ((uint32_t)(uint16_t)q << 16)));
+	__m256i x;
+	uint32_t n;
+
+	for (n = 0; n + 16 <= len; n += 16) {
+		x = _mm256_loadu_si256((const __m256i *)(buf + n));
+		_mm256_storeu_si256((__m256i *)(buf + n),
+				    _mm256_subs_epi16(x, d));
+	}
+
+	sub_s16_generic(buf + n, len - n, i, q);
+}
+
+DSP_TARGET("avx2")
+static void sum_f32_avx2(const float *buf, uint32_t len,
+			 double *i, double *q)
+{
+	__m256 acc;
+	float lanes[8];
+	uint32_t n = 0, k;
+
+	while (n + 8 <= len) {
+		acc = _mm256_setzero_ps();
+
+		for (k = 0; k < SUM_F32_FLUSH && n + 8 <= len; k++, n += 8)
+			acc = _mm256_add_ps(acc, _mm256_loadu_ps(buf + n));
+
+		_mm256_storeu_ps(lanes, acc);
+		*i += (double)lanes[0] + lanes[2] + lanes[4] + lanes[6];
+		*q += (double)lanes[1] + lanes[3] + lanes[5] + lanes[7];
+	}
+
+	sum_f32_generic(buf + n, len - n, i, q);
+}
+
+DSP_TARGET("avx2")
+static void sub_f32_avx2(float *buf, uint32_t len, float i, float q)
+{
+	const __m256 d = _mm256_setr_ps(i, q, i, q, i, q, i, q);
+	uint32_t n;
+
+	for (n = 0; n + 8 <= len; n += 8)
+		_mm256_storeu_ps(buf + n,
+				 _mm256_sub_ps(_mm256_loadu_ps(buf + n), d));
+
+	sub_f32_generic(buf + n, len - n, i, q);
+}
+
+DSP_TARGET("avx2")
+static void dot_s16_avx2(const int16_t *taps, const int16_t *i,
+			 const int16_t *q, uint32_t len,
+			 int32_t *ri, int32_t *rq)
+{
+	__m256i t, acc_i = _mm256_setzero_si256(), acc_q = _mm256_setzero_si256();
+	int32_t lanes[8], ti, tq;
+	uint32_t n;
+	int j;
+
+	for (n = 0; n + 16 <= len; n += 16) {
+		t = _mm256_loadu_si256((const __m256i *)(taps + n));
+		acc_i = _mm256_add_epi32(acc_i, _mm256_madd_epi16(t,
+			_mm256_loadu_si256((const __m256i *)(i + n))));
+		acc_q = _mm256_add_epi32(acc_q, _mm256_madd_epi16(t,
+			_mm256_loadu_si256((const __m256i *)(q + n))));
+	}
+
+	dot_s16_generic(taps + n, i + n, q + n, len - n, &ti, &tq);
+	_mm256_storeu_si256((__m256i *)lanes, acc_i);
+	for (j = 0; j < 8; j++)
+		ti += lanes[j];
+	_mm256_storeu_si256((__m256i *)lanes, acc_q);
+	for (j = 0; j < 8; j++)
+		tq += lanes[j];
+	*ri = ti;
+	*rq = tq;
+}
+
+DSP_TARGET("avx2")
+static void dot_f32_avx2(const float *taps, const float *i,
+			 const float *q, uint32_t len,
+			 float *ri, float *rq)
+{
+	__m256 t, acc_i = _mm256_setzero_ps(), acc_q = _mm256_setzero_ps();
+	float lanes[8], ti, tq;
+	uint32_t n;
+	int j;
+
+	/* no FMA, it is a separate feature bit */
+	for (n = 0; n + 8 <= len; n += 8) {
+		t = _mm256_loadu_ps(taps + n);
+		acc_i = _mm256_add_ps(acc_i, _mm256_mul_ps(t, _mm256_loadu_ps(i + n)));
+		acc_q = _mm256_add_ps(acc_q, _mm256_mul_ps(t, _mm256_loadu_ps(q + n)));
+	}
+
+	dot_f32_generic(taps + n, i + n, q + n, len - n, &ti, &tq);
+	_mm256_storeu_ps(lanes, acc_i);
+	for (j = 0; j < 8; j++)
+		ti += lanes[j];
+	_mm256_storeu_ps(lanes, acc_q);
+	for (j = 0; j < 8; j++)
+		tq += lanes[j];
+	*ri = ti;
+	*rq = tq;
+}
+
+DSP_TARGET("avx2")
+static void _split_avx2(__m256i x, __m256 *i, __m256 *q)
+{
+	*i = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(x, 16), 16));
+	*q = _mm256_cvtepi32_ps(_mm256_srai_epi32(x, 16));
+}
+
+/* rounds and packs to 8 int16 in order */
+DSP_TARGET("avx2")
+static __m128i _disc_round_avx2(__m256 x)
+{
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	__m256 half;
+	__m256i r;
+
+	x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-32768.0f)),
+			  _mm256_set1_ps(32767.0f));
+	half = _mm256_or_ps(_mm256_and_ps(x, sign), _mm256_set1_ps(0.5f));
+	r = _mm256_cvttps_epi32(_mm256_add_ps(x, half));
+
+	r = _mm256_permute4x64_epi64(_mm256_packs_epi32(r, r), 0x08);
+	return _mm256_castsi256_si128(r);
+}
+
+DSP_TARGET("avx2")
+static __m256 _disc_atan2_avx2(__m256 im, __m256 re)
+{
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	__m256 ax = _mm256_andnot_ps(sign, re), ay = _mm256_andnot_ps(sign, im);
+	__m256 mn = _mm256_min_ps(ax, ay), mx = _mm256_max_ps(ax, ay);
+	__m256 t, t2, p;
+
+	t = _mm256_div_ps(mn, _mm256_max_ps(mx, _mm256_set1_ps(DISC_TINY)));
+	t2 = _mm256_mul_ps(t, t);
+	p = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(ATAN_C9), t2),
+			  _mm256_set1_ps(ATAN_C7));
+	p = _mm256_add_ps(_mm256_mul_ps(p, t2), _mm256_set1_ps(ATAN_C5));
+	p = _mm256_add_ps(_mm256_mul_ps(p, t2), _mm256_set1_ps(ATAN_C3));
+	p = _mm256_add_ps(_mm256_mul_ps(p, t2), _mm256_set1_ps(ATAN_C1));
+	p = _mm256_mul_ps(p, t);
+
+	p = _mm256_blendv_ps(p, _mm256_sub_ps(_mm256_set1_ps(DISC_PI_2), p),
+			     _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+	p = _mm256_blendv_ps(p, _mm256_sub_ps(_mm256_set1_ps(DISC_PI), p),
+			     _mm256_cmp_ps(re, _mm256_setzero_ps(), _CMP_LT_OQ));
+	p = _mm256_xor_ps(p, _mm256_and_ps(sign,
+			  _mm256_cmp_ps(im, _mm256_setzero_ps(), _CMP_LT_OQ)));
+
+	return _mm256_mul_ps(p, _mm256_set1_ps(DISC_SCALE));
+}
+
+DSP_TARGET("avx2")
+static void disc_poly_avx2(const int16_t *in, uint32_t n, int16_t *out)
+{
+	__m256 ai, aq, bi, bq, re, im;
+	uint32_t k;
+
+	for (k = 0; k + 8 <= n; k += 8) {
+		_split_avx2(_mm256_loadu_si256((const __m256i *)(in + 2*k)), &ai, &aq);
+		_split_avx2(_mm256_loadu_si256((const __m256i *)(in + 2*k - 2)), &bi, &bq);
+		im = _mm256_sub_ps(_mm256_mul_ps(aq, bi), _mm256_mul_ps(ai, bq));
+		re = _mm256_add_ps(_mm256_mul_ps(ai, bi), _mm256_mul_ps(aq, bq));
+		_mm_storeu_si128((__m128i *)(out + k),
+				 _disc_round_avx2(_disc_atan2_avx2(im, re)));
+	}
+
+	disc_poly_generic(in + 2*k, n - k, out + k);
+}
+
+DSP_TARGET("avx2")
+static void disc_deriv_avx2(const int16_t *in, uint32_t n, int16_t *out,
+			    float scale)
+{
+	const __m256 s = _mm256_set1_ps(scale);
+	__m256 ai, aq, bi, bq, im;
+	uint32_t k;
+
+	for (k = 0; k + 8 <= n; k += 8) {
+		_split_avx2(_mm256_loadu_si256((const __m256i *)(in + 2*k)), &ai, &aq);
+		_split_avx2(_mm256_loadu_si256((const __m256i *)(in + 2*k - 2)), &bi, &bq);
+		im = _mm256_sub_ps(_mm256_mul_ps(aq, bi), _mm256_mul_ps(ai, bq));
+		_mm_storeu_si128((__m128i *)(out + k),
+				 _disc_round_avx2(_mm256_mul_ps(im, s)));
+	}
+
+	disc_deriv_generic(in + 2*k, n - k, out + k, scale);
+}
+
+DSP_TARGET("avx2")
+static void energy_s16_avx2(const int16_t *buf, uint32_t len, double *sum)
+{
+	__m256 i, q, acc;
+	float lanes[8];
+	uint32_t n = 0, k;
+	int j;
+
+	while (n + 16 <= len) {
+		acc = _mm256_setzero_ps();
+
+		for (k = 0; k < SUM_F32_FLUSH && n + 16 <= len; k++, n += 16) {
+			_split_avx2(_mm256_loadu_si256((const __m256i *)(buf + n)), &i, &q);
+			acc = _mm256_add_ps(acc, _mm256_add_ps(_mm256_mul_ps(i, i),
+							       _mm256_mul_ps(q, q)));
+		}
+
+		_mm256_storeu_ps(lanes, acc);
+		for (j = 0; j < 8; j++)
+			*sum += lanes[j];
+	}
+
+	energy_s16_generic(buf + n, len - n, sum);
+}
+
+DSP_TARGET("avx2")
+static __m256i _mag_avx2(__m128i x)
+{
+	const __m256i bias = _mm256_set1_epi16(255);
+	__m256i w = _mm256_cvtepu8_epi16(x);
+	__m256i d = _mm256_sub_epi16(_mm256_add_epi16(w, w), bias);
+	__m256 s = _mm256_cvtepi32_ps(_mm256_srli_epi32(_mm256_madd_epi16(d, d), 1));
+
+	return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_sqrt_ps(s),
+						 _mm256_set1_ps(0.5f)));
+}
+
+DSP_TARGET("avx2")
+static void magnitude_u8_avx2(const uint8_t *in, uint8_t *out, uint32_t len)
+{
+	__m256i m;
+	uint32_t k;
+
+	for (k = 0; k + 16 <= len / 2; k += 16) {
+		m = _mm256_packs_epi32(
+			_mag_avx2(_mm_loadu_si128((const __m128i *)(in + 2*k))),
+			_mag_avx2(_mm_loadu_si128((const __m128i *)(in + 2*k + 16))));
+		/* packs works within 128 bit lanes */
+		m = _mm256_permute4x64_epi64(m, 0xd8);
+		_mm_storeu_si128((__m128i *)(out + k),
+				 _mm_packus_epi16(_mm256_castsi256_si128(m),
+						  _mm256_extracti128_si256(m, 1)));
+	}
+
+	magnitude_u8_generic(in + 2*k, out + k, len - 2*k);
+}
+
+DSP_TARGET("avx2")
+static int pulse_find_u8_avx2(const uint8_t *in, uint32_t len,
+			      uint16_t pattern)
+{
+	__m256i hi, lo, v;
+	uint32_t i, m;
+	int k, r;
+
+	for (i = 0; i + 47 <= len; i += 32) {
+		hi = _mm256_set1_epi8((char)0xff);
+		lo = _mm256_setzero_si256();
+
+		for (k = 0; k < 16; k++) {
+			v = _mm256_loadu_si256((const __m256i *)(in + i + k));
+			if (pattern & (1 << k))
+				hi = _mm256_min_epu8(hi, v);
+			else
+				lo = _mm256_max_epu8(lo, v);
+		}
+
+		m = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+			_mm256_subs_epu8(hi, lo), _mm256_setzero_si256()));
+		if (m)
+			return (int)i + _dsp_ctz(m);
+	}
+
+	r = pulse_find_u8_generic(in + i, len - i, pattern);
+
+	return r < 0 ? r : (int)i + r;
+}
+
+static const struct dsp_ops dsp_avx2 = {
+	u8_to_s16_avx2,
+	u8_to_f32_avx2,
+	rotate_90_u8_avx2,
+	rotate_90_s16_avx2,
+	sum_s16_avx2,
+	sub_s16_avx2,
+	sum_f32_avx2,
+	sub_f32_avx2,
+	dot_s16_avx2,
+	dot_f32_avx2,
+	disc_poly_avx2,
+	disc_deriv_avx2,
+	energy_s16_avx2,
+	magnitude_u8_avx2,
+	pulse_find_u8_avx2,
+};
+
+#endif /* DSP_HAVE_AVX2 */
+
+#ifdef DSP_HAVE_NEON
+
+static void u8_to_s16_neon(const uint8_t *in, int16_t *out, uint32_t len)
+{
+	const int16x8_t bias = vdupq_n_s16(S16_BIAS);
+	uint8x16_t x;
+	uint32_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		x = vld1q_u8(in + i);
+		vst1q_s16(out + i, vsubq_s16(vreinterpretq_s16_u16(
+			  vshll_n_u8(vget_low_u8(x), 8)), bias));
+		vst1q_s16(out + i + 8, vsubq_s16(vreinterpretq_s16_u16(
+			  vshll_n_u8(vget_high_u8(x), 8)), bias));
+	}
+
+	u8_to_s16_generic(in + i, out + i, len - i);
+}
+
+static void u8_to_f32_neon(const uint8_t *in, float *out, uint32_t len)
+{
+	const float32x4_t bias = vdupq_n_f32(127.5f);
+	const float32x4_t scale = vdupq_n_f32(1.0f / 127.5f);
+	uint16x8_t w;
+	float32x4_t f;
+	uint32_t i;
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		w = vmovl_u8(vld1_u8(in + i));
+		f = vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(w))), bias);
+		vst1q_f32(out + i, vmulq_f32(f, scale));
+		f = vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(w))), bias);
+		vst1q_f32(out + i + 4, vmulq_f32(f, scale));
+	}
+
+	u8_to_f32_generic(in + i, out + i, len - i);
+}
+
+static void rotate_90_u8_neon(uint8_t *buf, uint32_t len)
+{
+	const uint8x16_t swap = vld1q_u8(rot_u8_swap);
+	const uint8x16_t neg = vld1q_u8(rot_u8_neg);
+	uint8x16_t x;
+	uint32_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		x = vld1q_u8(buf + i);
+		x = vbslq_u8(swap, vrev16q_u8(x), x);
+		vst1q_u8(buf + i, veorq_u8(x, neg));
+	}
+
+	rotate_90_u8_generic(buf + i, len - i);
+}
+
+static void rotate_90_s16_neon(int16_t *buf, uint32_t len)
+{
+	const uint16x8_t swap = vreinterpretq_u16_s16(vld1q_s16(rot_s16_swap));
+	const int16x8_t neg = vld1q_s16(rot_s16_neg);
+	int16x8_t x;
+	uint32_t i;
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		x = vld1q_s16(buf + i);
+		x = vbslq_s16(swap, vrev32q_s16(x), x);
+		x = vsubq_s16(veorq_s16(x, neg), neg);
+		vst1q_s16(buf + i, x);
+	}
+
+	rotate_90_s16_generic(buf + i, len - i);
+}
+
+static void sum_s16_neon(const int16_t *buf, uint32_t len,
+			 int64_t *i, int64_t *q)
+{
+	int16x8x2_t x;
+	int32x4_t acc_i, acc_q;
+	uint32_t n = 0, k;
+
+	while (n + 16 <= len) {
+		acc_i = vdupq_n_s32(0);
+		acc_q = vdupq_n_s32(0);
+
+		/* two values per lane and step */
+		for (k = 0; k < SUM_S16_FLUSH / 2 && n + 16 <= len; k++, n += 16) {
+			x = vld2q_s16(buf + n);
+			acc_i = vpadalq_s16(acc_i, x.val[0]);
+			acc_q = vpadalq_s16(acc_q, x.val[1]);
+		}
+
+		*i += (int64_t)vgetq_lane_s32(acc_i, 0) + vgetq_lane_s32(acc_i, 1) +
+		      vgetq_lane_s32(acc_i, 2) + vgetq_lane_s32(acc_i, 3);
+		*q += (int64_t)vgetq_lane_s32(acc_q, 0) + vgetq_lane_s32(acc_q, 1) +
+		      vgetq_lane_s32(acc_q, 2) + vgetq_lane_s32(acc_q, 3);
+	}
+
+	sum_s16_generic(buf + n, len - n, i, q);
+}
+
+static void sub_s16_neon(int16_t *buf, uint32_t len, int16_t i, int16_t q)
+{
+	const int16x8_t d = vreinterpretq_s16_u32(vdupq_n_u32(
+		(uint16_t)i | ((uint32_t)(uint16_t)q << 16)));
+	uint32_t n;
+
+	for (n = 0; n + 8 <= len; n += 8)
+		vst1q_s16(buf + n, vqsubq_s16(vld1q_s16(buf + n), d));
+
+	sub_s16_generic(buf + n, len - n, i, q);
+}
+
+static void sum_f32_neon(const float *buf, uint32_t len,
+			 double *i, double *q)
+{
+	float32x4_t acc;
+	float lanes[4];
+	uint32_t n = 0, k;
+
+	while (n + 4 <= len) {
+		acc = vdupq_n_f32(0);
+
+		for (k = 0; k < SUM_F32_FLUSH && n + 4 <= len; k++, n += 4)
+			acc = vaddq_f32(acc, vld1q_f32(buf + n));
+
+		vst1q_f32(lanes, acc);
+		*i += (double)lanes[0] + lanes[2];
+		*q += (double)lanes[1] + lanes[3];
+	}
+
+	sum_f32_generic(buf + n, len - n, i, q);
+}
+
+static void sub_f32_neon(float *buf, uint32_t len, float i, float q)
+{
+	const float pattern[4] = { i, q, i, q };
+	const float32x4_t d = vld1q_f32(pattern);
+	uint32_t n;
+
+	for (n = 0; n + 4 <= len; n += 4)
+		vst1q_f32(buf + n, vsubq_f32(vld1q_f32(buf + n), d));
+
+	sub_f32_generic(buf + n, len - n, i, q);
+}
+
+static void dot_s16_neon(const int16_t *taps, const int16_t *i,
+			 const int16_t *q, uint32_t len,
+			 int32_t *ri, int32_t *rq)
+{
+	int32x4_t acc_i = vdupq_n_s32(0), acc_q = vdupq_n_s32(0);
+	int16x8_t t, x;
+	int32_t ti, tq;
+	uint32_t n;
+
+	for (n = 0; n + 8 <= len; n += 8) {
+		t = vld1q_s16(taps + n);
+		x = vld1q_s16(i + n);
+		acc_i = vmlal_s16(acc_i, vget_low_s16(t), vget_low_s16(x));
+		acc_i = vmlal_s16(acc_i, vget_high_s16(t), vget_high_s16(x));
+		x = vld1q_s16(q + n);
+		acc_q = vmlal_s16(acc_q, vget_low_s16(t), vget_low_s16(x));
+		acc_q = vmlal_s16(acc_q, vget_high_s16(t), vget_high_s16(x));
+	}
+
+	dot_s16_generic(taps + n, i + n, q + n, len - n, &ti, &tq);
+	*ri = ti + vgetq_lane_s32(acc_i, 0) + vgetq_lane_s32(acc_i, 1) +
+	      vgetq_lane_s32(acc_i, 2) + vgetq_lane_s32(acc_i, 3);
+	*rq = tq + vgetq_lane_s32(acc_q, 0) + vgetq_lane_s32(acc_q, 1) +
+	      vgetq_lane_s32(acc_q, 2) + vgetq_lane_s32(acc_q, 3);
+}
+
+static void dot_f32_neon(const float *taps, const float *i,
+			 const float *q, uint32_t len,
+			 float *ri, float *rq)
+{
+	float32x4_t t, acc_i = vdupq_n_f32(0), acc_q = vdupq_n_f32(0);
+	float lanes[4], ti, tq;
+	uint32_t n;
+
+	for (n = 0; n + 4 <= len; n += 4) {
+		t = vld1q_f32(taps + n);
+		acc_i = vmlaq_f32(acc_i, t, vld1q_f32(i + n));
+		acc_q = vmlaq_f32(acc_q, t, vld1q_f32(q + n));
+	}
+
+	dot_f32_generic(taps + n, i + n, q + n, len - n, &ti, &tq);
+	vst1q_f32(lanes, acc_i);
+	*ri = ti + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	vst1q_f32(lanes, acc_q);
+	*rq = tq + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+static int16x4_t _disc_round_neon(float32x4_t x)
+{
+	const uint32x4_t sign = vdupq_n_u32(0x80000000);
+	float32x4_t half;
+
+	x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-32768.0f)),
+		      vdupq_n_f32(32767.0f));
+	half = vreinterpretq_f32_u32(vorrq_u32(
+		vandq_u32(vreinterpretq_u32_f32(x), sign),
+		vreinterpretq_u32_f32(vdupq_n_f32(0.5f))));
+
+	return vqmovn_s32(vcvtq_s32_f32(vaddq_f32(x, half)));
+}
+
+static float32x4_t _disc_atan2_neon(float32x4_t im, float32x4_t re)
+{
+	const float32x4_t zero = vdupq_n_f32(0);
+	float32x4_t ax = vabsq_f32(re), ay = vabsq_f32(im);
+	float32x4_t mn = vminq_f32(ax, ay), mx = vmaxq_f32(ax, ay);
+	float32x4_t t, t2, p;
+	float tl[4], ml[4];
+	int j;
+
+	/* a true division, vrecpe would break the match with generic */
+	mx = vmaxq_f32(mx, vdupq_n_f32(DISC_TINY));
+	vst1q_f32(tl, mn);
+	vst1q_f32(ml, mx);
+	for (j = 0; j < 4; j++)
+		tl[j] /= ml[j];
+	t = vld1q_f32(tl);
+
+	t2 = vmulq_f32(t, t);
+	p = vaddq_f32(vmulq_f32(vdupq_n_f32(ATAN_C9), t2), vdupq_n_f32(ATAN_C7));
+	p = vaddq_f32(vmulq_f32(p, t2), vdupq_n_f32(ATAN_C5));
+	p = vaddq_f32(vmulq_f32(p, t2), vdupq_n_f32(ATAN_C3));
+	p = vaddq_f32(vmulq_f32(p, t2), vdupq_n_f32(ATAN_C1));
+	p = vmulq_f32(p, t);
+
+	p = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(DISC_PI_2), p), p);
+	p = vbslq_f32(vcltq_f32(re, zero), vsubq_f32(vdupq_n_f32(DISC_PI), p), p);
+	p = vbslq_f32(vcltq_f32(im, zero), vnegq_f32(p), p);
+
+	return vmulq_f32(p, vdupq_n_f32(DISC_SCALE));
+}
+
+static void disc_poly_neon(const int16_t *in, uint32_t n, int16_t *out)
+{
+	int16x4x2_t a, b;
+	float32x4_t ai, aq, bi, bq, re, im;
+	uint32_t k;
+
+	for (k = 0; k + 4 <= n; k += 4) {
+		a = vld2_s16(in + 2*k);
+		b = vld2_s16(in + 2*k - 2);
+		ai = vcvtq_f32_s32(vmovl_s16(a.val[0]));
+		aq = vcvtq_f32_s32(vmovl_s16(a.val[1]));
+		bi = vcvtq_f32_s32(vmovl_s16(b.val[0]));
+		bq = vcvtq_f32_s32(vmovl_s16(b.val[1]));
+		im = vsubq_f32(vmulq_f32(aq, bi), vmulq_f32(ai, bq));
+		re = vaddq_f32(vmulq_f32(ai, bi), vmulq_f32(aq, bq));
+		vst1_s16(out + k, _disc_round_neon(_disc_atan2_neon(im, re)));
+	}
+
+	disc_poly_generic(in + 2*k, n - k, out + k);
+}
+
+static void disc_deriv_neon(const int16_t *in, uint32_t n, int16_t *out,
+			    float scale)
+{
+	const float32x4_t s = vdupq_n_f32(scale);
+	int16x4x2_t a, b;
+	float32x4_t ai, aq, bi, bq, im;
+	uint32_t k;
+
+	for (k = 0; k + 4 <= n; k += 4) {
+		a = vld2_s16(in + 2*k);
+		b = vld2_s16(in + 2*k - 2);
+		ai = vcvtq_f32_s32(vmovl_s16(a.val[0]));
+		aq = vcvtq_f32_s32(vmovl_s16(a.val[1]));
+		bi = vcvtq_f32_s32(vmovl_s16(b.val[0]));
+		bq = vcvtq_f32_s32(vmovl_s16(b.val[1]));
+		im = vsubq_f32(vmulq_f32(aq, bi), vmulq_f32(ai, bq));
+		vst1_s16(out + k, _disc_round_neon(vmulq_f32(im, s)));
+	}
+
+	disc_deriv_generic(in + 2*k, n - k, out + k, scale);
+}
+
+static void energy_s16_neon(const int16_t *buf, uint32_t len, double *sum)
+{
+	int16x4x2_t x;
+	float32x4_t i, q, acc;
+	float lanes[4];
+	uint32_t n = 0, k;
+
+	while (n + 8 <= len) {
+		acc = vdupq_n_f32(0);
+
+		for (k = 0; k < SUM_F32_FLUSH && n + 8 <= len; k++, n += 8) {
+			x = vld2_s16(buf + n);
+			i = vcvtq_f32_s32(vmovl_s16(x.val[0]));
+			q = vcvtq_f32_s32(vmovl_s16(x.val[1]));
+			acc = vaddq_f32(acc, vaddq_f32(vmulq_f32(i, i),
+						       vmulq_f32(q, q)));
+		}
+
+		vst1q_f32(lanes, acc);
+		*sum += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+
+	energy_s16_generic(buf + n, len - n, sum);
+}
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+static uint32x4_t _mag_neon(int16x4_t i, int16x4_t q)
+{
+	int32x4_t s = vshrq_n_s32(vmlal_s16(vmull_s16(i, i), q, q), 1);
+
+	return vcvtq_u32_f32(vaddq_f32(vsqrtq_f32(vcvtq_f32_s32(s)),
+				       vdupq_n_f32(0.5f)));
+}
+
+static void magnitude_u8_neon(const uint8_t *in, uint8_t *out, uint32_t len)
+{
+	const int16x8_t bias = vdupq_n_s16(255);
+	uint8x8x2_t x;
+	int16x8_t i, q;
+	uint16x8_t m;
+	uint32_t k;
+
+	for (k = 0; k + 8 <= len / 2; k += 8) {
+		x = vld2_u8(in + 2*k);
+		i = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(x.val[0], 1)), bias);
+		q = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(x.val[1], 1)), bias);
+		m = vcombine_u16(vmovn_u32(_mag_neon(vget_low_s16(i), vget_low_s16(q))),
+				 vmovn_u32(_mag_neon(vget_high_s16(i), vget_high_s16(q))));
+		vst1_u8(out + k, vmovn_u16(m));
+	}
+
+	magnitude_u8_generic(in + 2*k, out + k, len - 2*k);
+}
+#else
+/* 32 bit NEON has no vector square root, the table beats four scalar ones */
+#define magnitude_u8_neon	magnitude_u8_generic
+#endif
+
+static int pulse_find_u8_neon(const uint8_t *in, uint32_t len,
+			      uint16_t pattern)
+{
+	uint8x16_t hi, lo, v;
+	uint64_t m;
+	uint32_t i;
+	int k, r;
+
+	for (i = 0; i + 31 <= len; i += 16) {
+		hi = vdupq_n_u8(0xff);
+		lo = vdupq_n_u8(0);
+
+		for (k = 0; k < 16; k++) {
+			v = vld1q_u8(in + i + k);
+			if (pattern & (1 << k))
+				hi = vminq_u8(hi, v);
+			else
+				lo = vmaxq_u8(lo, v);
+		}
+
+		/* four bits per offset, there is no movemask */
+		m = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(
+			vreinterpretq_u16_u8(vcgtq_u8(hi, lo)), 4)), 0);
+		if (m)
+			return (int)i + _dsp_ctz(m) / 4;
+	}
+
+	r = pulse_find_u8_generic(in + i, len - i, pattern);
+
+	return r < 0 ? r : (int)i + r;
+}
+
+static const struct dsp_ops dsp_neon = {
+	u8_to_s16_neon,
+	u8_to_f32_neon,
+	rotate_90_u8_neon,
+	rotate_90_s16_neon,
+	sum_s16_neon,
+	sub_s16_neon,
+	sum_f32_neon,
+	sub_f32_neon,
+	dot_s16_neon,
+	dot_f32_neon,
+	disc_poly_neon,
+	disc_deriv_neon,
+	energy_s16_neon,
+	magnitude_u8_neon,
+	pulse_find_u8_neon,
+};
+
+#endif /* DSP_HAVE_NEON */
+
+/* runtime dispatch */
+
+static const struct dsp_ops *dsp = &dsp_generic;
+static int dsp_simd = RTLSDR_DSP_GENERIC;
+static pthread_once_t dsp_once = PTHREAD_ONCE_INIT;
+
+#ifdef DSP_X86
+static int _dsp_cpu_has(int simd)
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 1);
+	if (RTLSDR_DSP_SSE2 == simd)
+		return !!(info[3] & (1 << 26));
+
+	/* AVX state must be enabled by the OS as well */
+	if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) ||
+	    (_xgetbv(0) & 6) != 6)
+		return 0;
+
+	__cpuidex(info, 7, 0);
+	return !!(info[1] & (1 << 5));
+#else
+	__builtin_cpu_init();
+
+	if (RTLSDR_DSP_SSE2 == simd)
+		return __builtin_cpu_supports("sse2");
+
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+static int _dsp_supported(int simd)
+{
+	switch (simd) {
+	case RTLSDR_DSP_GENERIC:
+		return 1;
+#ifdef DSP_HAVE_SSE2
+	case RTLSDR_DSP_SSE2:
+		return _dsp_cpu_has(simd);
+#endif
+#ifdef DSP_HAVE_AVX2
+	case RTLSDR_DSP_AVX2:
+		return _dsp_cpu_has(simd);
+#endif
+#ifdef DSP_HAVE_NEON
+	case RTLSDR_DSP_NEON:
+		return 1;
+#endif
+	default:
+		return 0;
+	}
+}
+
+static void _dsp_select(int simd)
+{
+	switch (simd) {
+#ifdef DSP_HAVE_SSE2
+	case RTLSDR_DSP_SSE2:
+		dsp = &dsp_sse2;
+		break;
+#endif
+#ifdef DSP_HAVE_AVX2
+	case RTLSDR_DSP_AVX2:
+		dsp = &dsp_avx2;
+		break;
+#endif
+#ifdef DSP_HAVE_NEON
+	case RTLSDR_DSP_NEON:
+		dsp = &dsp_neon;
+		break;
+#endif
+	default:
+		simd = RTLSDR_DSP_GENERIC;
+		dsp = &dsp_generic;
+		break;
+	}
+
+	dsp_simd = simd;
+}
+
+static void _dsp_init(void)
+{
+	int simd;
+
+	_mag_lut_init();
+
+	/* the later entries are the wider ones */
+	for (simd = RTLSDR_DSP_NEON; simd > RTLSDR_DSP_GENERIC; simd--) {
+		if (_dsp_supported(simd))
+			break;
+	}
+
+	_dsp_select(simd);
+}
+
+static const struct dsp_ops *_dsp_ops(void)
+{
+	pthread_once(&dsp_once, _dsp_init);
+
+	return dsp;
+}
+
+int rtlsdr_dsp_get_simd(void)
+{
+	pthread_once(&dsp_once, _dsp_init);
+
+	return dsp_simd;
+}
+
+int rtlsdr_dsp_set_simd(int simd)
+{
+	pthread_once(&dsp_once, _dsp_init);
+
+	if (!_dsp_supported(simd))
+		return -1;
+
+	_dsp_select(simd);
+
+	return 0;
+}
+
+void rtlsdr_dsp_u8_to_s16(const uint8_t *in, int16_t *out, uint32_t len)
+{
+	if (!in || !out)
+		return;
+
+	_dsp_ops()->u8_to_s16(in, out, len);
+}
+
+void rtlsdr_dsp_u8_to_f32(const uint8_t *in, float *out, uint32_t len)
+{
+	if (!in || !out)
+		return;
+
+	_dsp_ops()->u8_to_f32(in, out, len);
+}
+
+void rtlsdr_dsp_rotate_90_u8(uint8_t *buf, uint32_t len)
+{
+	if (!buf)
+		return;
+
+	_dsp_ops()->rotate_90_u8(buf, len);
+}
+
+void rtlsdr_dsp_rotate_90_s16(int16_t *buf, uint32_t len)
+{
+	if (!buf)
+		return;
+
+	_dsp_ops()->rotate_90_s16(buf, len);
+}
+
+void rtlsdr_dsp_magnitude_u8(const uint8_t *in, uint8_t *out, uint32_t len)
+{
+	if (!in || !out)
+		return;
+
+	_dsp_ops()->magnitude_u8(in, out, len);
+}
+
+int rtlsdr_dsp_pulse_find_u8(const uint8_t *in, uint32_t len,
+			     uint16_t pattern)
+{
+	if (!in)
+		return -1;
+
+	return _dsp_ops()->pulse_find_u8(in, len, pattern);
+}
+
+void rtlsdr_dsp_dc_init(rtlsdr_dsp_dc_t *dc, float weight)
+{
+	if (!dc)
+		return;
+
+	dc->i = 0;
+	dc->q = 0;
+	dc->weight = (weight > 0 && weight <= 1) ? weight : 1;
+}
+
+/* round half away from zero */
+static int16_t _dsp_round_s16(float x)
+{
+	return sat_s16((int32_t)(x < 0 ? x - 0.5f : x + 0.5f));
+}
+
+void rtlsdr_dsp_dc_remove_s16(rtlsdr_dsp_dc_t *dc, int16_t *buf, uint32_t len)
+{
+	int64_t i = 0, q = 0;
+	uint32_t n = len / 2;
+
+	if (!dc || !buf || !n)
+		return;
+
+	_dsp_ops()->sum_s16(buf, 2 * n, &i, &q);
+
+	dc->i += ((float)i / n - dc->i) * dc->weight;
+	dc->q += ((float)q / n - dc->q) * dc->weight;
+
+	_dsp_ops()->sub_s16(buf, 2 * n, _dsp_round_s16(dc->i),
+			    _dsp_round_s16(dc->q));
+}
+
+void rtlsdr_dsp_dc_remove_f32(rtlsdr_dsp_dc_t *dc, float *buf, uint32_t len)
+{
+	double i = 0, q = 0;
+	uint32_t n = len / 2;
+
+	if (!dc || !buf || !n)
+		return;
+
+	_dsp_ops()->sum_f32(buf, 2 * n, &i, &q);
+
+	dc->i += ((float)(i / n) - dc->i) * dc->weight;
+	dc->q += ((float)(q / n) - dc->q) * dc->weight;
+
+	_dsp_ops()->sub_f32(buf, 2 * n, dc->i, dc->q);
+}
+
+/* decimating FIR */
+
+/* complex samples taken from the input per pass */
+#define FIR_CHUNK		4096
+/* taps are padded to whole vectors of the widest kernels */
+#define FIR_ALIGN		16
+#define FIR_MAX_TAPS		65536
+
+struct rtlsdr_dsp_fir {
+	int decim;
+	int phase;		/* input samples until the next output */
+	uint32_t len;		/* padded number of taps */
+	int shift;		/* fixed point scale of taps16 */
+	/* reversed, the zero padding comes first */
+	int16_t *taps16;
+	float *taps;
+	/* planar history, len - 1 old samples followed by a chunk */
+	int16_t *i16, *q16;
+	float *i, *q;
+};
+
+/* Blackman windowed sinc with the -6 dB point at fc cycles per sample */
+static void _dsp_design_lowpass(double *h, uint32_t ntaps, double fc,
+				double gain)
+{
+	double x, sum = 0;
+	uint32_t k;
+
+	for (k = 0; k < ntaps; k++) {
+		x = k - (ntaps - 1) / 2.0;
+		h[k] = (x == 0) ? 2 * fc : sin(2 * M_PI * fc * x) / (M_PI * x);
+		if (ntaps > 1)
+			h[k] *= 0.42 - 0.5 * cos(2 * M_PI * k / (ntaps - 1)) +
+				0.08 * cos(4 * M_PI * k / (ntaps - 1));
+		sum += h[k];
+	}
+
+	for (k = 0; k < ntaps; k++)
+		h[k] *= gain / sum;
+}
+
+int rtlsdr_dsp_fir_create(rtlsdr_dsp_fir_t **out, int decim,
+			  int taps_per_phase, float cutoff, float gain)
+{
+	rtlsdr_dsp_fir_t *fir;
+	uint32_t ntaps, hist, k;
+	double *h, x, abs_sum = 0, peak = 0;
+
+	if (!out || decim < 1 || taps_per_phase < 1 || cutoff <= 0 ||
+	    cutoff > 1)
+		return -1;
+
+	ntaps = (uint32_t)decim * taps_per_phase;
+	if (ntaps > FIR_MAX_TAPS)
+		return -1;
+
+	fir = calloc(1, sizeof(rtlsdr_dsp_fir_t));
+	if (!fir)
+		return -ENOMEM;
+
+	fir->decim = decim;
+	fir->len = (ntaps + FIR_ALIGN - 1) & ~(FIR_ALIGN - 1);
+	hist = fir->len - 1 + FIR_CHUNK;
+
+	h = malloc(ntaps * sizeof(double));
+	fir->taps16 = calloc(fir->len, sizeof(int16_t));
+	fir->taps = calloc(fir->len, sizeof(float));
+	fir->i16 = calloc(hist, sizeof(int16_t));
+	fir->q16 = calloc(hist, sizeof(int16_t));
+	fir->i = calloc(hist, sizeof(float));
+	fir->q = calloc(hist, sizeof(float));
+	if (!h || !fir->taps16 || !fir->taps || !fir->i16 || !fir->q16 ||
+	    !fir->i || !fir->q) {
+		free(h);
+		rtlsdr_dsp_fir_destroy(fir);
+		return -ENOMEM;
+	}
+
+	_dsp_design_lowpass(h, ntaps, 0.5 * cutoff / decim, gain);
+
+	for (k = 0; k < ntaps; k++) {
+		abs_sum += fabs(h[k]);
+		if (fabs(h[k]) > peak)
+			peak = fabs(h[k]);
+	}
+
+	/* largest scale at which every tap fits and the 32 bit sums of
+	 * full scale input can not wrap */
+	for (fir->shift = 30; fir->shift > 0; fir->shift--) {
+		if (ldexp(peak, fir->shift) < 32767.0 &&
+		    ldexp(abs_sum, fir->shift) < 65535.0)
+			break;
+	}
+
+	for (k = 0; k < ntaps; k++) {
+		x = ldexp(h[k], fir->shift);
+		fir->taps16[fir->len - 1 - k] = (int16_t)(x < 0 ? x - 0.5 : x + 0.5);
+		fir->taps[fir->len - 1 - k] = (float)h[k];
+	}
+
+	free(h);
+	*out = fir;
+
+	return 0;
+}
+
+void rtlsdr_dsp_fir_destroy(rtlsdr_dsp_fir_t *fir)
+{
+	if (!fir)
+		return;
+
+	free(fir->taps16);
+	free(fir->taps);
+	free(fir->i16);
+	free(fir->q16);
+	free(fir->i);
+	free(fir->q);
+	free(fir);
+}
+
+void rtlsdr_dsp_fir_reset(rtlsdr_dsp_fir_t *fir)
+{
+	if (!fir)
+		return;
+
+	fir->phase = 0;
+	memset(fir->i16, 0, (fir->len - 1) * sizeof(int16_t));
+	memset(fir->q16, 0, (fir->len - 1) * sizeof(int16_t));
+	memset(fir->i, 0, (fir->len - 1) * sizeof(float));
+	memset(fir->q, 0, (fir->len - 1) * sizeof(float));
+}
+
+int rtlsdr_dsp_fir_decimate_s16(rtlsdr_dsp_fir_t *fir, const int16_t *in,
+				uint32_t len, int16_t *out)
+{
+	const struct dsp_ops *ops = _dsp_ops();
+	uint32_t keep, n = len / 2, c, k, p;
+	int32_t ri, rq;
+	int64_t round;
+	int o = 0;
+
+	if (!fir || !in || !out)
+		return -1;
+
+	keep = fir->len - 1;
+	round = fir->shift ? (int64_t)1 << (fir->shift - 1) : 0;
+
+	while (n) {
+		c = n < FIR_CHUNK ? n : FIR_CHUNK;
+
+		for (k = 0; k < c; k++) {
+			fir->i16[keep + k] = in[2*k];
+			fir->q16[keep + k] = in[2*k+1];
+		}
+
+		/* the window of the output ends at new sample p */
+		for (p = fir->phase; p < c; p += fir->decim) {
+			ops->dot_s16(fir->taps16, fir->i16 + p, fir->q16 + p,
+				     fir->len, &ri, &rq);
+			out[o++] = sat_s16((int32_t)((ri + round) >> fir->shift));
+			out[o++] = sat_s16((int32_t)((rq + round) >> fir->shift));
+		}
+
+		fir->phase = p - c;
+		memmove(fir->i16, fir->i16 + c, keep * sizeof(int16_t));
+		memmove(fir->q16, fir->q16 + c, keep * sizeof(int16_t));
+
+		in += 2 * c;
+		n -= c;
+	}
+
+	return o;
+}
+
+int rtlsdr_dsp_fir_decimate_f32(rtlsdr_dsp_fir_t *fir, const float *in,
+				uint32_t len, float *out)
+{
+	const struct dsp_ops *ops = _dsp_ops();
+	uint32_t keep, n = len / 2, c, k, p;
+	int o = 0;
+
+	if (!fir || !in || !out)
+		return -1;
+
+	keep = fir->len - 1;
+
+	while (n) {
+		c = n < FIR_CHUNK ? n : FIR_CHUNK;
+
+		for (k = 0; k < c; k++) {
+			fir->i[keep + k] = in[2*k];
+			fir->q[keep + k] = in[2*k+1];
+		}
+
+		for (p = fir->phase; p < c; p += fir->decim) {
+			ops->dot_f32(fir->taps, fir->i + p, fir->q + p,
+				     fir->len, &out[o], &out[o+1]);
+			o += 2;
+		}
+
+		fir->phase = p - c;
+		memmove(fir->i, fir->i + c, keep * sizeof(float));
+		memmove(fir->q, fir->q + c, keep * sizeof(float));
+
+		in += 2 * c;
+		n -= c;
+	}
+
+	return o;
+}
+
+/* polyphase FFT channelizer */
+
+struct rtlsdr_dsp_chan {
+	int bins;
+	int log2;
+	int phase;		/* input samples until the next frame */
+	int odd;		/* frame parity */
+	uint32_t len;		/* taps, a multiple of bins */
+	float *taps;		/* reversed */
+	float *i, *q;		/* planar history as for the FIR */
+	float *fold;		/* complex, one per bin */
+	float *twiddle;		/* cos/sin pairs */
+	int *bitrev;
+};
+
+int rtlsdr_dsp_chan_create(rtlsdr_dsp_chan_t **out, int bins,
+			   int taps_per_bin)
+{
+	rtlsdr_dsp_chan_t *ch;
+	uint32_t hist, k;
+	double *h;
+	int log2 = 0, j;
+
+	if (!out || bins < 2 || taps_per_bin < 1)
+		return -1;
+
+	while ((1 << log2) < bins)
+		log2++;
+	if ((1 << log2) != bins ||
+	    (uint32_t)bins * taps_per_bin > FIR_MAX_TAPS)
+		return -1;
+
+	ch = calloc(1, sizeof(rtlsdr_dsp_chan_t));
+	if (!ch)
+		return -ENOMEM;
+
+	ch->bins = bins;
+	ch->log2 = log2;
+	ch->len = (uint32_t)bins * taps_per_bin;
+	hist = ch->len - 1 + FIR_CHUNK;
+
+	h = malloc(ch->len * sizeof(double));
+	ch->taps = malloc(ch->len * sizeof(float));
+	ch->i = calloc(hist, sizeof(float));
+	ch->q = calloc(hist, sizeof(float));
+	ch->fold = malloc(2 * bins * sizeof(float));
+	ch->twiddle = malloc(bins * sizeof(float));
+	ch->bitrev = malloc(bins * sizeof(int));
+	if (!h || !ch->taps || !ch->i || !ch->q || !ch->fold ||
+	    !ch->twiddle || !ch->bitrev) {
+		free(h);
+		rtlsdr_dsp_chan_destroy(ch);
+		return -ENOMEM;
+	}
+
+	/* flat to 3/4 of the bin spacing, so every offset within half a
+	 * bin of the center keeps a channel of half the spacing intact,
+	 * and down before the aliases of the 2x output rate fold back */
+	_dsp_design_lowpass(h, ch->len, 1.0 / bins, 1.0);
+	for (k = 0; k < ch->len; k++)
+		ch->taps[ch->len - 1 - k] = (float)h[k];
+	free(h);
+
+	for (k = 0; k < (uint32_t)bins / 2; k++) {
+		ch->twiddle[2*k] = (float)cos(2 * M_PI * k / bins);
+		ch->twiddle[2*k+1] = (float)sin(2 * M_PI * k / bins);
+	}
+
+	for (k = 0; k < (uint32_t)bins; k++) {
+		ch->bitrev[k] = 0;
+		for (j = 0; j < log2; j++)
+			ch->bitrev[k] |= ((k >> j) & 1) << (log2 - 1 - j);
+	}
+
+	*out = ch;
+
+	return 0;
+}
+
+void rtlsdr_dsp_chan_destroy(rtlsdr_dsp_chan_t *ch)
+{
+	if (!ch)
+		return;
+
+	free(ch->taps);
+	free(ch->i);
+	free(ch->q);
+	free(ch->fold);
+	free(ch->twiddle);
+	free(ch->bitrev);
+	free(ch);
+}
+
+/* in place radix-2 with a positive exponent, input in bit reversed order */
+static void _dsp_chan_fft(rtlsdr_dsp_chan_t *ch, float *w)
+{
+	int size, half, stride, k, j, n = ch->bins;
+	float tr, ti, wr, wi;
+
+	for (size = 2; size <= n; size <<= 1) {
+		half = size >> 1;
+		stride = n / size;
+		for (k = 0; k < n; k += size) {
+			for (j = 0; j < half; j++) {
+				wr = ch->twiddle[2*j*stride];
+				wi = ch->twiddle[2*j*stride+1];
+				tr = w[2*(k+j+half)] * wr - w[2*(k+j+half)+1] * wi;
+				ti = w[2*(k+j+half)] * wi + w[2*(k+j+half)+1] * wr;
+				w[2*(k+j+half)] = w[2*(k+j)] - tr;
+				w[2*(k+j+half)+1] = w[2*(k+j)+1] - ti;
+				w[2*(k+j)] += tr;
+				w[2*(k+j)+1] += ti;
+			}
+		}
+	}
+}
+
+/*
+ * Bin k is the input mixed down by k * rate / bins, low pass filtered and
+ * decimated by bins / 2:
+ *
+ *   y_k[n] = sum_m h[m] x[nD - m] e^(-j 2 pi k (nD - m) / bins)
+ *
+ * Folding h[m] x[nD - m] modulo bins leaves one FFT per frame. With D of
+ * half the bins the remaining e^(-j 2 pi k nD / bins) is (-1)^(kn).
+ */
+static void _dsp_chan_frame(rtlsdr_dsp_chan_t *ch, uint32_t p, float *out)
+{
+	const float *taps, *i, *q;
+	float fi, fq;
+	int b, t, bins = ch->bins, rows = ch->len / bins;
+
+	for (b = 0; b < bins; b++) {
+		taps = ch->taps + b;
+		i = ch->i + p + b;
+		q = ch->q + p + b;
+		fi = 0;
+		fq = 0;
+		for (t = 0; t < rows; t++) {
+			fi += taps[t * bins] * i[t * bins];
+			fq += taps[t * bins] * q[t * bins];
+		}
+		/* reversed taps, column b holds m = bins - 1 - b modulo bins */
+		out[2 * ch->bitrev[bins - 1 - b]] = fi;
+		out[2 * ch->bitrev[bins - 1 - b] + 1] = fq;
+	}
+
+	_dsp_chan_fft(ch, out);
+
+	if (ch->odd) {
+		for (b = 1; b < bins; b += 2) {
+			out[2*b] = -out[2*b];
+			out[2*b+1] = -out[2*b+1];
+		}
+	}
+	ch->odd = !ch->odd;
+}
+
+int rtlsdr_dsp_chan_process(rtlsdr_dsp_chan_t *ch, const float *in,
+			    uint32_t len, float *out)
+{
+	uint32_t keep, n = len / 2, c, k, p, hop;
+	int frames = 0;
+
+	if (!ch || !in || !out)
+		return -1;
+
+	keep = ch->len - 1;
+	hop = ch->bins / 2;
+
+	while (n) {
+		c = n < FIR_CHUNK ? n : FIR_CHUNK;
+
+		for (k = 0; k < c; k++) {
+			ch->i[keep + k] = in[2*k];
+			ch->q[keep + k] = in[2*k+1];
+		}
+
+		for (p = ch->phase; p < c; p += hop) {
+			_dsp_chan_frame(ch, p, out + 2 * ch->bins * frames);
+			frames++;
+		}
+
+		ch->phase = p - c;
+		memmove(ch->i, ch->i + c, keep * sizeof(float));
+		memmove(ch->q, ch->q + c, keep * sizeof(float));
+
+		in += 2 * c;
+		n -= c;
+	}
+
+	return frames;
+}
+
+/* FM discriminator */
+
+#define DISC_TABLE_BITS		10
+
+struct rtlsdr_dsp_disc {
+	int method;
+	int bits;
+	int16_t *table;		/* atan(k / 2^bits), k = 0..2^bits */
+	int16_t prev[2];
+};
+
+int rtlsdr_dsp_disc_create(rtlsdr_dsp_disc_t **out, int method,
+			   int table_bits)
+{
+	rtlsdr_dsp_disc_t *d;
+	int k, size;
+
+	if (!out || method < RTLSDR_DSP_DISC_ATAN2 ||
+	    method > RTLSDR_DSP_DISC_DERIV)
+		return -1;
+
+	if (!table_bits)
+		table_bits = DISC_TABLE_BITS;
+	if (table_bits < 4 || table_bits > 16)
+		return -1;
+
+	d = calloc(1, sizeof(rtlsdr_dsp_disc_t));
+	if (!d)
+		return -ENOMEM;
+
+	d->method = method;
+	d->bits = table_bits;
+
+	if (RTLSDR_DSP_DISC_TABLE == method) {
+		size = 1 << table_bits;
+		d->table = malloc((size + 1) * sizeof(int16_t));
+		if (!d->table) {
+			free(d);
+			return -ENOMEM;
+		}
+		for (k = 0; k <= size; k++)
+			d->table[k] = _round_s16((float)(atan((double)k / size) *
+							  DISC_SCALE));
+	}
+
+	*out = d;
+
+	return 0;
+}
+
+void rtlsdr_dsp_disc_destroy(rtlsdr_dsp_disc_t *d)
+{
+	if (!d)
+		return;
+
+	free(d->table);
+	free(d);
+}
+
+static int16_t _disc_exact(int ai, int aq, int bi, int bq)
+{
+	double re = (double)ai * bi + (double)aq * bq;
+	double im = (double)aq * bi - (double)ai * bq;
+
+	return _round_s16((float)(atan2(im, re) * (16384 / M_PI)));
+}
+
+static int16_t _disc_table(const rtlsdr_dsp_disc_t *d,
+			   int ai, int aq, int bi, int bq)
+{
+	float re = (float)ai * bi + (float)aq * bq;
+	float im = (float)aq * bi - (float)ai * bq;
+	float ax = re < 0 ? -re : re, ay = im < 0 ? -im : im;
+	int p;
+
+	if (ax >= ay) {
+		p = ax > 0 ? d->table[(int)(ay / ax * (1 << d->bits) + 0.5f)] : 0;
+	} else {
+		p = 8192 - d->table[(int)(ax / ay * (1 << d->bits) + 0.5f)];
+	}
+	if (re < 0)
+		p = 16384 - p;
+
+	return (int16_t)(im < 0 ? -p : p);
+}
+
+int rtlsdr_dsp_disc_process(rtlsdr_dsp_disc_t *d, const int16_t *in,
+			    uint32_t len, int16_t *out)
+{
+	const struct dsp_ops *ops = _dsp_ops();
+	uint32_t n = len / 2, k;
+	double energy = 0;
+	float scale = 0;
+
+	if (!d || !in || !out)
+		return -1;
+
+	if (!n)
+		return 0;
+
+	switch (d->method) {
+	case RTLSDR_DSP_DISC_ATAN2:
+		out[0] = _disc_exact(in[0], in[1], d->prev[0], d->prev[1]);
+		for (k = 1; k < n; k++)
+			out[k] = _disc_exact(in[2*k], in[2*k+1],
+					     in[2*k-2], in[2*k-1]);
+		break;
+	case RTLSDR_DSP_DISC_TABLE:
+		out[0] = _disc_table(d, in[0], in[1], d->prev[0], d->prev[1]);
+		for (k = 1; k < n; k++)
+			out[k] = _disc_table(d, in[2*k], in[2*k+1],
+					     in[2*k-2], in[2*k-1]);
+		break;
+	case RTLSDR_DSP_DISC_POLY:
+		out[0] = _round_s16(_disc_atan2(
+			(float)in[1] * d->prev[0] - (float)in[0] * d->prev[1],
+			(float)in[0] * d->prev[0] + (float)in[1] * d->prev[1]));
+		ops->disc_poly(in + 2, n - 1, out + 1);
+		break;
+	case RTLSDR_DSP_DISC_DERIV:
+		/* sin(angle) |a| |b|, normalized by the mean power of the
+		 * buffer instead of every sample */
+		ops->energy_s16(in, 2 * n, &energy);
+		if (energy > 0)
+			scale = (float)(DISC_SCALE * n / energy);
+		out[0] = _round_s16(((float)in[1] * d->prev[0] -
+				      (float)in[0] * d->prev[1]) * scale);
+		ops->disc_deriv(in + 2, n - 1, out + 1, scale);
+		break;
+	}
+
+	d->prev[0] = in[2*n-2];
+	d->prev[1] = in[2*n-1];
+
+	return (int)n;
+}
+
+/* resampler */
+
+#define RESAMP_CHUNK		4096
+#define RESAMP_MAX_PHASES	1024
+#define RESAMP_MAX_TAPS		(1 << 20)
+/* Farrow polynomials per input sample, the cubics are within -90 dB */
+#define RESAMP_SEGMENTS		16
+
+struct rtlsdr_dsp_resamp {
+	int mode;
+	uint32_t ntaps;		/* input samples under the filter */
+	float *taps;		/* reversed, ntaps per phase or per Farrow
+				 * segment and power */
+	uint32_t interp;	/* rational, out / in = interp / decim */
+	uint32_t decim;
+	uint32_t phase;
+	double step;		/* Farrow, input samples per output */
+	double frac;
+	float *hist;		/* ntaps - 1 of history, then new input */
+	uint32_t fill;
+	uint32_t pos;		/* newest sample of the next output */
+	uint32_t skip;		/* input before the history of the next output */
+};
+
+static uint32_t _gcd(uint32_t a, uint32_t b)
+{
+	uint32_t t;
+
+	while (b) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+/* windowed sinc over [0, len], as _dsp_design_lowpass() */
+static double _resamp_proto(double t, double len, double fc)
+{
+	double x = t - len / 2;
+
+	if (t <= 0 || t >= len)
+		return 0;
+
+	return ((x == 0) ? 2 * fc : sin(2 * M_PI * fc * x) / (M_PI * x)) *
+		(0.42 - 0.5 * cos(2 * M_PI * t / len) +
+		 0.08 * cos(4 * M_PI * t / len));
+}
+
+static int _resamp_rational(rtlsdr_dsp_resamp_t *rs, double fc, double gain)
+{
+	uint32_t len = rs->interp * rs->ntaps, r, j;
+	double *h;
+
+	if (len > RESAMP_MAX_TAPS)
+		return -1;
+
+	h = malloc(len * sizeof(double));
+	rs->taps = malloc(len * sizeof(float));
+	if (!h || !rs->taps) {
+		free(h);
+		return -ENOMEM;
+	}
+
+	/* zero stuffing by interp takes that much gain */
+	_dsp_design_lowpass(h, len, fc / rs->interp, gain * rs->interp);
+
+	for (r = 0; r < rs->interp; r++)
+		for (j = 0; j < rs->ntaps; j++)
+			rs->taps[r * rs->ntaps + rs->ntaps - 1 - j] =
+				(float)h[j * rs->interp + r];
+
+	free(h);
+
+	return 0;
+}
+
+/* inverse of the Vandermonde matrix of 0, 1/3, 2/3, 1 */
+static const double _cubic_fit[4][4] = {
+	{  1.0,   0.0,   0.0,  0.0 },
+	{ -5.5,   9.0,  -4.5,  1.0 },
+	{  9.0, -22.5,  18.0, -4.5 },
+	{ -4.5,  13.5, -13.5,  4.5 },
+};
+
+static int _resamp_farrow(rtlsdr_dsp_resamp_t *rs, double fc, double gain)
+{
+	uint32_t n = rs->ntaps, s, j;
+	double f[4], c, sum = 0;
+	int i, m;
+
+	if ((uint64_t)RESAMP_SEGMENTS * 4 * n > RESAMP_MAX_TAPS)
+		return -1;
+
+	rs->taps = malloc(RESAMP_SEGMENTS * 4 * n * sizeof(float));
+	if (!rs->taps)
+		return -ENOMEM;
+
+	for (j = 0; j < n; j++)
+		sum += _resamp_proto(j, n, fc);
+
+	/* taps of x[n - j] at j + (s + v) / SEGMENTS, as cubics in v */
+	for (s = 0; s < RESAMP_SEGMENTS; s++) {
+		for (j = 0; j < n; j++) {
+			for (i = 0; i < 4; i++)
+				f[i] = _resamp_proto(j + (s + i / 3.0) /
+						     RESAMP_SEGMENTS, n, fc);
+			for (m = 0; m < 4; m++) {
+				for (c = 0, i = 0; i < 4; i++)
+					c += _cubic_fit[m][i] * f[i];
+				rs->taps[(s * 4 + m) * n + n - 1 - j] =
+					(float)(c * gain / sum);
+			}
+		}
+	}
+
+	return 0;
+}
+
+int rtlsdr_dsp_resamp_create(rtlsdr_dsp_resamp_t **out, double in_rate,
+			     double out_rate, int mode, int taps, float cutoff,
+			     float gain)
+{
+	rtlsdr_dsp_resamp_t *rs;
+	uint32_t g = 0;
+	double ratio, fc;
+	int r;
+
+	if (!out || in_rate <= 0 || out_rate <= 0 || taps < 1 ||
+	    cutoff <= 0 || cutoff > 1 || mode < RTLSDR_DSP_RESAMP_AUTO ||
+	    mode > RTLSDR_DSP_RESAMP_FARROW)
+		return -1;
+
+	/* exact when both rates are whole and the ratio is small enough */
+	if (in_rate == floor(in_rate) && out_rate == floor(out_rate) &&
+	    in_rate < 4e9 && out_rate < 4e9)
+		g = _gcd((uint32_t)in_rate, (uint32_t)out_rate);
+	if (RTLSDR_DSP_RESAMP_AUTO == mode)
+		mode = (g && out_rate / g <= RESAMP_MAX_PHASES) ?
+			RTLSDR_DSP_RESAMP_RATIONAL : RTLSDR_DSP_RESAMP_FARROW;
+	if (RTLSDR_DSP_RESAMP_RATIONAL == mode &&
+	    (!g || out_rate / g > RESAMP_MAX_PHASES))
+		return -1;
+
+	rs = calloc(1, sizeof(rtlsdr_dsp_resamp_t));
+	if (!rs)
+		return -ENOMEM;
+
+	/* the filter spans taps samples of the lower rate */
+	ratio = in_rate / out_rate;
+	rs->mode = mode;
+	rs->ntaps = (uint32_t)ceil(taps * (ratio > 1 ? ratio : 1));
+	fc = 0.5 * cutoff * (ratio > 1 ? 1 / ratio : 1);
+
+	if (RTLSDR_DSP_RESAMP_RATIONAL == mode) {
+		rs->interp = (uint32_t)(out_rate / g);
+		rs->decim = (uint32_t)(in_rate / g);
+		r = _resamp_rational(rs, fc, gain);
+	} else {
+		rs->step = ratio;
+		r = _resamp_farrow(rs, fc, gain);
+	}
+
+	if (!r) {
+		rs->hist = malloc((rs->ntaps - 1 + RESAMP_CHUNK) * sizeof(float));
+		if (!rs->hist)
+			r = -ENOMEM;
+	}
+
+	if (r) {
+		rtlsdr_dsp_resamp_destroy(rs);
+		return r;
+	}
+
+	rtlsdr_dsp_resamp_reset(rs);
+	*out = rs;
+
+	return 0;
+}
+
+void rtlsdr_dsp_resamp_destroy(rtlsdr_dsp_resamp_t *rs)
+{
+	if (!rs)
+		return;
+
+	free(rs->taps);
+	free(rs->hist);
+	free(rs);
+}
+
+void rtlsdr_dsp_resamp_reset(rtlsdr_dsp_resamp_t *rs)
+{
+	if (!rs)
+		return;
+
+	memset(rs->hist, 0, (rs->ntaps - 1) * sizeof(float));
+	rs->fill = rs->ntaps - 1;
+	rs->pos = rs->ntaps - 1;
+	rs->skip = 0;
+	rs->phase = 0;
+	rs->frac = 0;
+}
+
+int rtlsdr_dsp_resamp_get_ratio(rtlsdr_dsp_resamp_t *rs, uint32_t *interp,
+				uint32_t *decim)
+{
+	if (!rs || RTLSDR_DSP_RESAMP_RATIONAL != rs->mode)
+		return -1;
+
+	if (interp)
+		*interp = rs->interp;
+	if (decim)
+		*decim = rs->decim;
+
+	return 0;
+}
+
+int rtlsdr_dsp_resamp_s16(rtlsdr_dsp_resamp_t *rs, const int16_t *in,
+			  uint32_t len, int16_t *out)
+{
+	const struct dsp_ops *ops = _dsp_ops();
+	const float *x, *t;
+	float v[4], unused;
+	uint32_t c, k, keep, seg;
+	double mu;
+	int o = 0, m;
+
+	if (!rs || !in || !out)
+		return -1;
+
+	while (len) {
+		c = len < rs->skip ? len : rs->skip;
+		rs->skip -= c;
+		in += c;
+		len -= c;
+
+		c = len < RESAMP_CHUNK ? len : RESAMP_CHUNK;
+		for (k = 0; k < c; k++)
+			rs->hist[rs->fill + k] = in[k];
+		rs->fill += c;
+		in += c;
+		len -= c;
+
+		/* real samples, the second sum of the kernel goes unused */
+		while (rs->pos < rs->fill) {
+			x = rs->hist + rs->pos - (rs->ntaps - 1);
+
+			if (RTLSDR_DSP_RESAMP_RATIONAL == rs->mode) {
+				ops->dot_f32(rs->taps + rs->phase * rs->ntaps,
+					     x, x, rs->ntaps, v, &unused);
+				out[o++] = _round_s16(v[0]);
+				rs->phase += rs->decim;
+				rs->pos += rs->phase / rs->interp;
+				rs->phase %= rs->interp;
+				continue;
+			}
+
+			mu = rs->frac * RESAMP_SEGMENTS;
+			seg = (uint32_t)mu;
+			mu -= seg;
+			t = rs->taps + seg * 4 * rs->ntaps;
+			for (m = 0; m < 4; m++)
+				ops->dot_f32(t + m * rs->ntaps, x, x, rs->ntaps,
+					     &v[m], &unused);
+			out[o++] = _round_s16((float)(((v[3] * mu + v[2]) * mu +
+							v[1]) * mu + v[0]));
+			rs->frac += rs->step;
+			rs->pos += (uint32_t)rs->frac;
+			rs->frac -= floor(rs->frac);
+		}
+
+		/* keep the history of the next output, which may lie beyond
+		 * the samples seen so far when decimating */
+		keep = rs->ntaps - 1;
+		if (rs->pos - keep < rs->fill) {
+			memmove(rs->hist, rs->hist + rs->pos - keep,
+				(rs->fill - (rs->pos - keep)) * sizeof(float));
+			rs->fill -= rs->pos - keep;
+		} else {
+			rs->skip = rs->pos - keep - rs->fill;
+			rs->fill = 0;
+		}
+		rs->pos = keep;
+	}
+
+	return o;
+}
@@ -0,0 +1,222 @@
+/*
+ * rtl-sdr, turns your Realtek RTL2832 based DVB dongle into a SDR receiver
+ * Register model of the RTL2832U and its tuners
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libusb.h>
+
+#include "rtl-sdr.h"
+#include "rtlsdr_sim.h"
+#include "tuner_e4k.h"
+#include "tuner_fc0012.h"
+#include "tuner_fc0013.h"
+#include "tuner_fc2580.h"
+#include "tuner_r820t.h"
+
+#define SIM_BLOCKS	7	/* DEMODB to IICB */
+#define SIM_IICB	6
+#define SIM_DEMOD_PAGES	16
+#define SIM_EEPROM_ADDR	0xa0
+
+/* an I2C slave with 8 bit register addresses */
+struct sim_i2c {
+	uint8_t addr;
+	uint8_t ptr; /* register the next transfer starts at */
+	uint8_t reg[256];
+};
+
+struct rtl2832_sim {
+	enum rtlsdr_tuner tuner;
+	uint8_t reg[SIM_BLOCKS][0x1000]; /* USB, SYS, ... blocks */
+	uint8_t demod[SIM_DEMOD_PAGES][256];
+	struct sim_i2c eeprom;
+	struct sim_i2c tun;
+};
+
+static uint8_t _bitrev(uint8_t v)
+{
+	v = (v & 0xf0) >> 4 | (v & 0x0f) << 4;
+	v = (v & 0xcc) >> 2 | (v & 0x33) << 2;
+	v = (v & 0xaa) >> 1 | (v & 0x55) << 1;
+
+	return v;
+}
+
+struct rtl2832_sim *rtl2832_sim_create(enum rtlsdr_tuner tuner)
+{
+	struct rtl2832_sim *sim;
+	struct sim_i2c *t;
+
+	sim = calloc(1, sizeof(struct rtl2832_sim));
+	if (!sim)
+		return NULL;
+
+	sim->tuner = tuner;
+	sim->eeprom.addr = SIM_EEPROM_ADDR;
+	memset(sim->eeprom.reg, 0xff, sizeof(sim->eeprom.reg));
+
+	t = &sim->tun;
+
+	switch (tuner) {
+	case RTLSDR_TUNER_E4000:
+		t->addr = E4K_I2C_ADDR;
+		t->reg[E4K_CHECK_ADDR] = E4K_CHECK_VAL;
+		break;
+	case RTLSDR_TUNER_FC0012:
+		t->addr = FC0012_I2C_ADDR;
+		t->reg[FC0012_CHECK_ADDR] = FC0012_CHECK_VAL;
+		break;
+	case RTLSDR_TUNER_FC0013:
+		t->addr = FC0013_I2C_ADDR;
+		t->reg[FC0013_CHECK_ADDR] = FC0013_CHECK_VAL;
+		break;
+	case RTLSDR_TUNER_FC2580:
+		t->addr = FC2580_I2C_ADDR;
+		t->reg[FC2580_CHECK_ADDR] = FC2580_CHECK_VAL;
+		break;
+	case RTLSDR_TUNER_R820T:
+		/* read only status, as the driver sees it after the bit
+		 * reversal: chip id, IMR level, PLL locked in VCO band 28,
+		 * RF gain, VCO fine tune 2 and filter code 8 */
+		t->addr = R820T_I2C_ADDR;
+		t->reg[0] = _bitrev(R820T_CHECK_VAL);
+		t->reg[1] = 0x20;
+		t->reg[2] = 0x40 | 28;
+		t->reg[3] = 0x00;
+		t->reg[4] = 0x28;
+		break;
+	default:
+		break;
+	}
+
+	return sim;
+}
+
+void rtl2832_sim_destroy(struct rtl2832_sim *sim)
+{
+	free(sim);
+}
+
+static void _sim_tuner_write(struct rtl2832_sim *sim, uint8_t reg, uint8_t val)
+{
+	/* the R820T status registers can not be written */
+	if (sim->tuner == RTLSDR_TUNER_R820T && reg < 5)
+		return;
+
+	sim->tun.reg[reg] = val;
+}
+
+static uint8_t _sim_tuner_read(struct rtl2832_sim *sim, uint8_t reg)
+{
+	uint8_t val = sim->tun.reg[reg];
+
+	switch (sim->tuner) {
+	case RTLSDR_TUNER_E4000:
+		if (reg == E4K_REG_SYNTH1)
+			val |= 0x01; /* PLL locked */
+		break;
+	case RTLSDR_TUNER_FC2580:
+		if (reg == 0x2f)
+			val |= 0xc0; /* VCO calibration done */
+		break;
+	case RTLSDR_TUNER_R820T:
+		val = _bitrev(val); /* shifted out LSB first */
+		break;
+	default:
+		break;
+	}
+
+	return val;
+}
+
+static int _sim_i2c(struct rtl2832_sim *sim, int in, uint8_t addr,
+		    unsigned char *data, uint16_t len)
+{
+	struct sim_i2c *dev;
+	uint16_t i;
+
+	if (addr == sim->eeprom.addr)
+		dev = &sim->eeprom;
+	else if (sim->tun.addr && addr == sim->tun.addr)
+		dev = &sim->tun;
+	else
+		return LIBUSB_ERROR_PIPE; /* nobody acknowledged the address */
+
+	if (!in) {
+		if (!len)
+			return 0;
+
+		dev->ptr = data[0];
+		for (i = 1; i < len; i++) {
+			if (dev == &sim->tun)
+				_sim_tuner_write(sim, dev->ptr, data[i]);
+			else
+				dev->reg[dev->ptr] = data[i];
+			dev->ptr++;
+		}
+
+		return len;
+	}
+
+	/* the R820T always starts reading at its first register */
+	if (dev == &sim->tun && sim->tuner == RTLSDR_TUNER_R820T)
+		dev->ptr = 0;
+
+	for (i = 0; i < len; i++, dev->ptr++)
+		data[i] = (dev == &sim->tun) ? _sim_tuner_read(sim, dev->ptr) :
+					      dev->reg[dev->ptr];
+
+	return len;
+}
+
+int rtl2832_sim_ctrl(struct rtl2832_sim *sim, uint8_t type, uint16_t value,
+		     uint16_t index, unsigned char *data, uint16_t len)
+{
+	int in = type & LIBUSB_ENDPOINT_IN;
+	uint8_t block = index >> 8;
+	uint8_t *reg;
+	uint16_t i, n;
+
+	if (block >= SIM_BLOCKS)
+		return LIBUSB_ERROR_PIPE;
+
+	if (block == SIM_IICB)
+		return _sim_i2c(sim, in, value & 0xff, data, len);
+
+	if (block == 0 && (value & 0xff) == 0x20) {
+		/* demod register, the page is in the low index bits */
+		reg = sim->demod[index & (SIM_DEMOD_PAGES - 1)];
+		n = 256;
+		value >>= 8;
+	} else {
+		reg = sim->reg[block];
+		n = sizeof(sim->reg[block]);
+		value &= n - 1;
+	}
+
+	for (i = 0; i < len; i++) {
+		if (in)
+			data[i] = reg[(value + i) % n];
+		else
+			reg[(value + i) % n] = data[i];
+	}
+
+	return len;
+}
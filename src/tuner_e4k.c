@@ -92,7 +92,7 @@ static int e4k_reg_set_mask(struct e4k_state *e4k, uint8_t reg,
 {
 	uint8_t tmp = e4k_reg_read(e4k, reg);
 
-	if ((tmp & mask) == val)
+	if ((tmp & mask) == val && !e4k->write_all)
 		return 0;
 
 	return e4k_reg_write(e4k, reg, (tmp & ~mask) | (val & mask));
@@ -11,9 +11,10 @@
 #include "rtlsdr_i2c.h"
 #include "tuner_r820t.h"
 
-int r820t_SetRfFreqHz(void *pTuner, unsigned long RfFreqHz)
+int r820t_SetRfFreqHz(struct r820t_state *priv, unsigned long RfFreqHz)
 {
 	R828_Set_Info R828Info;
+	R828_ErrCode r;
 
 //	if(pExtra->IsStandardModeSet==NO)
 //		goto error_status_set_tuner_rf_frequency;
@@ -23,24 +24,35 @@ int r820t_SetRfFreqHz(void *pTuner, unsigned long RfFreqHz)
 	R828Info.RF_Hz = (UINT32)(RfFreqHz);
 	R828Info.RF_KHz = (UINT32)(RfFreqHz/1000);
 
-	if(R828_SetFrequency(pTuner, R828Info, NORMAL_MODE) != RT_Success)
+	/* collect the register updates, only the final values are sent */
+	priv->R828_Deferred = 1;
+	r = R828_SetFrequency(priv, R828Info, NORMAL_MODE);
+	priv->R828_Deferred = 0;
+
+	if(R828_Flush(priv) != RT_Success || r != RT_Success)
 		return FUNCTION_ERROR;
 
 	return FUNCTION_SUCCESS;
 }
 
-int r820t_SetStandardMode(void *pTuner, int StandardMode)
+int r820t_SetStandardMode(struct r820t_state *priv, int StandardMode)
 {
-	if(R828_SetStandard(pTuner, (R828_Standard_Type)StandardMode) != RT_Success)
+	R828_ErrCode r;
+
+	priv->R828_Deferred = 1;
+	r = R828_SetStandard(priv, (R828_Standard_Type)StandardMode);
+	priv->R828_Deferred = 0;
+
+	if(R828_Flush(priv) != RT_Success || r != RT_Success)
 		return FUNCTION_ERROR;
 
 	return FUNCTION_SUCCESS;
 }
 
-int r820t_SetStandby(void *pTuner, int LoopThroughType)
+int r820t_SetStandby(struct r820t_state *priv, int LoopThroughType)
 {
 
-	if(R828_Standby(pTuner, (R828_LoopThrough_Type)LoopThroughType) != RT_Success)
+	if(R828_Standby(priv, (R828_LoopThrough_Type)LoopThroughType) != RT_Success)
 		return FUNCTION_ERROR;
 
 	return FUNCTION_SUCCESS;
@@ -74,11 +86,11 @@ r820t_Convert(int InvertNum)
 }
 
 R828_ErrCode
-I2C_Write_Len(void *pTuner, R828_I2C_LEN_TYPE *I2C_Info)
+I2C_Write_Len(struct r820t_state *priv, R828_I2C_LEN_TYPE *I2C_Info)
 {
 	unsigned char DeviceAddr;
 
-	unsigned int i, j;
+	unsigned int i, j, k;
 
 	unsigned char RegStartAddr;
 	unsigned char *pWritingBytes;
@@ -95,7 +107,7 @@ I2C_Write_Len(void *pTuner, R828_I2C_LEN_TYPE *I2C_Info)
 
 	// Calculate maximum writing byte number.
 //	WritingByteNumMax = pBaseInterface->I2cWritingByteNumMax - LEN_1_BYTE;
-	WritingByteNumMax = 2 - 1; //9 orig
+	WritingByteNumMax = R820T_I2C_MAX_LEN - 1;
 
 	// Set tuner register bytes with writing bytes.
 	// Note: Set tuner register bytes considering maximum writing byte number.
@@ -124,15 +136,25 @@ I2C_Write_Len(void *pTuner, R828_I2C_LEN_TYPE *I2C_Info)
 //			FUNCTION_SUCCESS)
 //			goto error_status_set_tuner_registers;
 
-		if (rtlsdr_i2c_write_fn(pTuner, R820T_I2C_ADDR, WritingBuffer, WritingByteNum + 1) < 0)
+		if (rtlsdr_i2c_write_fn(priv->rtl_dev, R820T_I2C_ADDR, WritingBuffer, WritingByteNum + 1) < 0)
 			return RT_Fail;
+
+		for(j = 0; j < WritingByteNum; j++)
+		{
+			k = RegWritingAddr + j - R828_REG_BASE;
+			if(k >= R828_REG_NUM)
+				continue;
+
+			priv->R828_Chip[k] = pWritingBytes[i + j];
+			priv->R828_Chip_Valid |= 1 << k;
+		}
 	}
 
 	return RT_Success;
 }
 
 R828_ErrCode
-I2C_Read_Len(void *pTuner, R828_I2C_LEN_TYPE *I2C_Info)
+I2C_Read_Len(struct r820t_state *priv, R828_I2C_LEN_TYPE *I2C_Info)
 {
 	uint8_t DeviceAddr;
 
@@ -146,13 +168,17 @@ I2C_Read_Len(void *pTuner, R828_I2C_LEN_TYPE *I2C_Info)
 	RegStartAddr  = 0x00;
 	ByteNum       = (unsigned long)I2C_Info->Len;
 
+	// Deferred writes must reach the chip before it is read back.
+	if(R828_Flush(priv) != RT_Success)
+		return RT_Fail;
+
 	// Set tuner register reading address.
 	// Note: The I2C format of tuner register reading address setting is as follows:
 	//       start_bit + (DeviceAddr | writing_bit) + RegReadingAddr + stop_bit
 //	if(pI2cBridge->ForwardI2cWritingCmd(pI2cBridge, DeviceAddr, &RegStartAddr, LEN_1_BYTE) != FUNCTION_SUCCESS)
 //		goto error_status_set_tuner_register_reading_address;
 
-	if (rtlsdr_i2c_write_fn(pTuner, R820T_I2C_ADDR, &RegStartAddr, 1) < 0)
+	if (rtlsdr_i2c_write_fn(priv->rtl_dev, R820T_I2C_ADDR, &RegStartAddr, 1) < 0)
 		return RT_Fail;
 
 	// Get tuner register bytes.
@@ -161,7 +187,7 @@ I2C_Read_Len(void *pTuner, R828_I2C_LEN_TYPE *I2C_Info)
 //	if(pI2cBridge->ForwardI2cReadingCmd(pI2cBridge, DeviceAddr, ReadingBytes, ByteNum) != FUNCTION_SUCCESS)
 //		goto error_status_get_tuner_registers;
 
-	if (rtlsdr_i2c_read_fn(pTuner, R820T_I2C_ADDR, ReadingBytes, ByteNum) < 0)
+	if (rtlsdr_i2c_read_fn(priv->rtl_dev, R820T_I2C_ADDR, ReadingBytes, ByteNum) < 0)
 		return RT_Fail;
 
 	for(i = 0; i<ByteNum; i++)
@@ -180,9 +206,25 @@ error_status_set_tuner_register_reading_address:
 }
 
 R828_ErrCode
-I2C_Write(void *pTuner, R828_I2C_TYPE *I2C_Info)
+I2C_Write(struct r820t_state *priv, R828_I2C_TYPE *I2C_Info)
 {
 	uint8_t WritingBuffer[2];
+	unsigned int k = I2C_Info->RegAddr - R828_REG_BASE;
+
+	if(k < R828_REG_NUM)
+	{
+		// Leave it to R828_Flush() while deferring.
+		if(priv->R828_Deferred)
+		{
+			priv->R828_Pend[k] = I2C_Info->Data;
+			priv->R828_Dirty |= 1 << k;
+			return RT_Success;
+		}
+
+		// The chip holds this value already.
+		if((priv->R828_Chip_Valid & (1 << k)) && priv->R828_Chip[k] == I2C_Info->Data)
+			return RT_Success;
+	}
 
 	// Set writing bytes.
 	// Note: The I2C format of tuner register byte setting is as follows:
@@ -196,18 +238,85 @@ I2C_Write(void *pTuner, R828_I2C_TYPE *I2C_Info)
 
 //	printf("called %s: %02x -> %02x\n", __FUNCTION__, WritingBuffer[0], WritingBuffer[1]);
 
-	if (rtlsdr_i2c_write_fn(pTuner, R820T_I2C_ADDR, WritingBuffer, 2) < 0)
+	if (rtlsdr_i2c_write_fn(priv->rtl_dev, R820T_I2C_ADDR, WritingBuffer, 2) < 0)
 		return RT_Fail;
 
+	if(k < R828_REG_NUM)
+	{
+		priv->R828_Chip[k] = I2C_Info->Data;
+		priv->R828_Chip_Valid |= 1 << k;
+	}
+
+	return RT_Success;
+}
+
+/*
+ * Send the deferred register writes. Registers whose value did not change
+ * are dropped, the rest goes out as bursts of adjacent registers, bridging
+ * a single unchanged register where that saves a transfer.
+ */
+R828_ErrCode
+R828_Flush(struct r820t_state *priv)
+{
+	R828_I2C_LEN_TYPE Burst;
+	UINT32 Need;
+	unsigned int i, j, Start, End;
+
+	Need = 0;
+	for(i = 0; i < R828_REG_NUM; i++)
+	{
+		if(!(priv->R828_Dirty & (1 << i)))
+			continue;
+
+		if(!(priv->R828_Chip_Valid & (1 << i)) || priv->R828_Chip[i] != priv->R828_Pend[i])
+			Need |= 1 << i;
+	}
+	priv->R828_Dirty = 0;
+
+	i = 0;
+	while(i < R828_REG_NUM)
+	{
+		if(!(Need & (1 << i)))
+		{
+			i++;
+			continue;
+		}
+
+		Start = End = i;
+		for(j = i + 1; j < R828_REG_NUM && j - Start < R820T_I2C_MAX_LEN - 1; j++)
+		{
+			if(Need & (1 << j))
+				End = j;
+			else if(j - End > 1 || !(priv->R828_Chip_Valid & (1 << j)))
+				break;
+		}
+
+		Burst.RegAddr = R828_REG_BASE + Start;
+		Burst.Len     = End - Start + 1;
+		for(j = Start; j <= End; j++)
+			Burst.Data[j - Start] = (Need & (1 << j)) ? priv->R828_Pend[j] : priv->R828_Chip[j];
+
+		if(I2C_Write_Len(priv, &Burst) != RT_Success)
+		{
+			priv->R828_Chip_Valid &= ~Need;
+			return RT_Fail;
+		}
+
+		i = End + 1;
+	}
+
 	return RT_Success;
 }
 
 void
 R828_Delay_MS(
-	void *pTuner,
+	struct r820t_state *priv,
 	unsigned long WaitTimeMs
 	)
 {
+	/* the wait orders the writes before it against those after it */
+	R828_Flush(priv);
+
 	/* simply don't wait for now */
 	return;
 }
@@ -252,64 +361,6 @@ UINT8 Rafael_Chip = R820T;
 //----------------------------------------------------------//
 //                   Internal Structs                       //
 //----------------------------------------------------------//
-typedef struct _R828_SectType
-{
-	UINT8 Phase_Y;
-	UINT8 Gain_X;
-	UINT16 Value;
-}R828_SectType;
-
-typedef enum _BW_Type
-{
-	BW_6M = 0,
-	BW_7M,
-	BW_8M,
-	BW_1_7M,
-	BW_10M,
-	BW_200K
-}BW_Type;
-
-typedef struct _Sys_Info_Type
-{
-	UINT16		IF_KHz;
-	BW_Type		BW;
-	UINT32		FILT_CAL_LO;
-	UINT8		FILT_GAIN;
-	UINT8		IMG_R;
-	UINT8		FILT_Q;
-	UINT8		HP_COR;
-	UINT8       EXT_ENABLE;
-	UINT8       LOOP_THROUGH;
-	UINT8       LT_ATT;
-	UINT8       FLT_EXT_WIDEST;
-	UINT8       POLYFIL_CUR;
-}Sys_Info_Type;
-
-typedef struct _Freq_Info_Type
-{
-	UINT8		OPEN_D;
-	UINT8		RF_MUX_PLOY;
-	UINT8		TF_C;
-	UINT8		XTAL_CAP20P;
-	UINT8		XTAL_CAP10P;
-	UINT8		XTAL_CAP0P;
-	UINT8		IMR_MEM;
-}Freq_Info_Type;
-
-typedef struct _SysFreq_Info_Type
-{
-	UINT8		LNA_TOP;
-	UINT8		LNA_VTH_L;
-	UINT8		MIXER_TOP;
-	UINT8		MIXER_VTH_L;
-	UINT8      AIR_CABLE1_IN;
-	UINT8      CABLE2_IN;
-	UINT8		PRE_DECT;
-	UINT8      LNA_DISCHARGE;
-	UINT8      CP_CUR;
-	UINT8      DIV_BUF_CUR;
-	UINT8      FILTER_CUR;
-}SysFreq_Info_Type;
 
 //----------------------------------------------------------//
 //                   Internal Parameters                    //
@@ -322,57 +373,33 @@ enum XTAL_CAP_VALUE
 	XTAL_LOW_CAP_0P,
 	XTAL_HIGH_CAP_0P
 };
-UINT8 R828_Arry[27];
-R828_SectType IMR_Data[5] = {
-                                                  {0, 0, 0},
-                                                  {0, 0, 0},
-                                                  {0, 0, 0},
-                                                  {0, 0, 0},
-                                                  {0, 0, 0}
-                                                };//Please keep this array data for standby mode.
-R828_I2C_TYPE  R828_I2C;
-R828_I2C_LEN_TYPE R828_I2C_Len;
-
-UINT32 R828_IF_khz;
-UINT32 R828_CAL_LO_khz;
-UINT8  R828_IMR_point_num;
-UINT8  R828_IMR_done_flag = FALSE;
-UINT8  R828_Fil_Cal_flag[STD_SIZE];
-static UINT8 R828_Fil_Cal_code[STD_SIZE];
-
-static UINT8 Xtal_cap_sel = XTAL_LOW_CAP_0P;
-static UINT8 Xtal_cap_sel_tmp = XTAL_LOW_CAP_0P;
 //----------------------------------------------------------//
 //                   Internal static struct                 //
 //----------------------------------------------------------//
-static SysFreq_Info_Type SysFreq_Info1;
-static Sys_Info_Type Sys_Info1;
-//static Freq_Info_Type R828_Freq_Info;
-static Freq_Info_Type Freq_Info1;
 //----------------------------------------------------------//
 //                   Internal Functions                     //
 //----------------------------------------------------------//
-R828_ErrCode R828_Xtal_Check(void *pTuner);
-R828_ErrCode R828_InitReg(void *pTuner);
-R828_ErrCode R828_IMR_Prepare(void *pTuner);
-R828_ErrCode R828_IMR(void *pTuner, UINT8 IMR_MEM, int IM_Flag);
-R828_ErrCode R828_PLL(void *pTuner, UINT32 LO_Freq, R828_Standard_Type R828_Standard);
-R828_ErrCode R828_MUX(void *pTuner, UINT32 RF_KHz);
-R828_ErrCode R828_IQ(void *pTuner, R828_SectType* IQ_Pont);
-R828_ErrCode R828_IQ_Tree(void *pTuner, UINT8 FixPot, UINT8 FlucPot, UINT8 PotReg, R828_SectType* CompareTree);
+R828_ErrCode R828_Xtal_Check(struct r820t_state *priv);
+R828_ErrCode R828_InitReg(struct r820t_state *priv);
+R828_ErrCode R828_IMR_Prepare(struct r820t_state *priv);
+R828_ErrCode R828_IMR(struct r820t_state *priv, UINT8 IMR_MEM, int IM_Flag);
+R828_ErrCode R828_PLL(struct r820t_state *priv, UINT32 LO_Freq, R828_Standard_Type R828_Standard);
+R828_ErrCode R828_MUX(struct r820t_state *priv, UINT32 RF_KHz);
+R828_ErrCode R828_IQ(struct r820t_state *priv, R828_SectType* IQ_Pont);
+R828_ErrCode R828_IQ_Tree(struct r820t_state *priv, UINT8 FixPot, UINT8 FlucPot, UINT8 PotReg, R828_SectType* CompareTree);
 R828_ErrCode R828_CompreCor(R828_SectType* CorArry);
-R828_ErrCode R828_CompreStep(void *pTuner, R828_SectType* StepArry, UINT8 Pace);
-R828_ErrCode R828_Muti_Read(void *pTuner, UINT8 IMR_Reg, UINT16* IMR_Result_Data);
-R828_ErrCode R828_Section(void *pTuner, R828_SectType* SectionArry);
-R828_ErrCode R828_F_IMR(void *pTuner, R828_SectType* IQ_Pont);
-R828_ErrCode R828_IMR_Cross(void *pTuner, R828_SectType* IQ_Pont, UINT8* X_Direct);
+R828_ErrCode R828_CompreStep(struct r820t_state *priv, R828_SectType* StepArry, UINT8 Pace);
+R828_ErrCode R828_Muti_Read(struct r820t_state *priv, UINT8 IMR_Reg, UINT16* IMR_Result_Data);
+R828_ErrCode R828_Section(struct r820t_state *priv, R828_SectType* SectionArry);
+R828_ErrCode R828_F_IMR(struct r820t_state *priv, R828_SectType* IQ_Pont);
+R828_ErrCode R828_IMR_Cross(struct r820t_state *priv, R828_SectType* IQ_Pont, UINT8* X_Direct);
 
 Sys_Info_Type R828_Sys_Sel(R828_Standard_Type R828_Standard);
 Freq_Info_Type R828_Freq_Sel(UINT32 RF_freq);
 SysFreq_Info_Type R828_SysFreq_Sel(R828_Standard_Type R828_Standard,UINT32 RF_freq);
 
-R828_ErrCode R828_Filt_Cal(void *pTuner, UINT32 Cal_Freq,BW_Type R828_BW);
-//R828_ErrCode R828_SetFrequency(void *pTuner, R828_Set_Info R828_INFO, R828_SetFreq_Type R828_SetFreqMode);
+R828_ErrCode R828_Filt_Cal(struct r820t_state *priv, UINT32 Cal_Freq,BW_Type R828_BW);
+//R828_ErrCode R828_SetFrequency(struct r820t_state *priv, R828_Set_Info R828_INFO, R828_SetFreq_Type R828_SetFreqMode);
 
 Sys_Info_Type R828_Sys_Sel(R828_Standard_Type R828_Standard)
 {
@@ -802,217 +829,226 @@ if ((Rafael_Chip==R820C) || (Rafael_Chip==R820T) || (Rafael_Chip==R828S))
 	
 	}
 
-R828_ErrCode R828_Xtal_Check(void *pTuner)
+R828_ErrCode R828_Xtal_Check(struct r820t_state *priv)
 {
 	UINT8 ArrayNum;
 
 	ArrayNum = 27;
 	for(ArrayNum=0;ArrayNum<27;ArrayNum++)
 	{
-		R828_Arry[ArrayNum] = R828_iniArry[ArrayNum];
+		priv->R828_Arry[ArrayNum] = R828_iniArry[ArrayNum];
 	}
 
 	//cap 30pF & Drive Low
-	R828_I2C.RegAddr = 0x10;
-	R828_Arry[11]    = (R828_Arry[11] & 0xF4) | 0x0B ;
-	R828_I2C.Data    = R828_Arry[11];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x10;
+	priv->R828_Arry[11]    = (priv->R828_Arry[11] & 0xF4) | 0x0B ;
+	priv->R828_I2C.Data    = priv->R828_Arry[11];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 	    return RT_Fail;
 
 	//set pll autotune = 128kHz
-	R828_I2C.RegAddr = 0x1A;
-	R828_Arry[21]    = R828_Arry[21] & 0xF3;
-	R828_I2C.Data    = R828_Arry[21];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x1A;
+	priv->R828_Arry[21]    = priv->R828_Arry[21] & 0xF3;
+	priv->R828_I2C.Data    = priv->R828_Arry[21];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	//set manual initial reg = 111111; 
-	R828_I2C.RegAddr = 0x13;
-	R828_Arry[14]    = (R828_Arry[14] & 0x80) | 0x7F;
-	R828_I2C.Data    = R828_Arry[14];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x13;
+	priv->R828_Arry[14]    = (priv->R828_Arry[14] & 0x80) | 0x7F;
+	priv->R828_I2C.Data    = priv->R828_Arry[14];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	//set auto
-	R828_I2C.RegAddr = 0x13;
-	R828_Arry[14]    = (R828_Arry[14] & 0xBF);
-	R828_I2C.Data    = R828_Arry[14];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x13;
+	priv->R828_Arry[14]    = (priv->R828_Arry[14] & 0xBF);
+	priv->R828_I2C.Data    = priv->R828_Arry[14];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 	
-	R828_Delay_MS(pTuner, 5);
+	R828_Delay_MS(priv, 5);
 
-	R828_I2C_Len.RegAddr = 0x00;
-	R828_I2C_Len.Len     = 3;
-	if(I2C_Read_Len(pTuner, &R828_I2C_Len) != RT_Success)
+	priv->R828_I2C_Len.RegAddr = 0x00;
+	priv->R828_I2C_Len.Len     = 3;
+	if(I2C_Read_Len(priv, &priv->R828_I2C_Len) != RT_Success)
 		return RT_Fail;
 
 	// if 30pF unlock, set to cap 20pF
 #if (USE_16M_XTAL==TRUE)
 	//VCO=2360MHz for 16M Xtal. VCO band 26
-    if(((R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((R828_I2C_Len.Data[2] & 0x3F) > 29) || ((R828_I2C_Len.Data[2] & 0x3F) < 23)) 
+    if(((priv->R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((priv->R828_I2C_Len.Data[2] & 0x3F) > 29) || ((priv->R828_I2C_Len.Data[2] & 0x3F) < 23)) 
 #else
-	if(((R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((R828_I2C_Len.Data[2] & 0x3F) == 0x3F)) 
+	if(((priv->R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((priv->R828_I2C_Len.Data[2] & 0x3F) == 0x3F)) 
 #endif
 	{
 		//cap 20pF 
-	    R828_I2C.RegAddr = 0x10;
-	    R828_Arry[11]    = (R828_Arry[11] & 0xFC) | 0x02;
-	    R828_I2C.Data    = R828_Arry[11];
-	    if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	    priv->R828_I2C.RegAddr = 0x10;
+	    priv->R828_Arry[11]    = (priv->R828_Arry[11] & 0xFC) | 0x02;
+	    priv->R828_I2C.Data    = priv->R828_Arry[11];
+	    if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		    return RT_Fail;
 
-		R828_Delay_MS(pTuner, 5);
+		R828_Delay_MS(priv, 5);
 	
-		R828_I2C_Len.RegAddr = 0x00;
-		R828_I2C_Len.Len     = 3;
-		if(I2C_Read_Len(pTuner, &R828_I2C_Len) != RT_Success)
+		priv->R828_I2C_Len.RegAddr = 0x00;
+		priv->R828_I2C_Len.Len     = 3;
+		if(I2C_Read_Len(priv, &priv->R828_I2C_Len) != RT_Success)
 		    return RT_Fail;
 
 		// if 20pF unlock, set to cap 10pF
 #if (USE_16M_XTAL==TRUE)
-        if(((R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((R828_I2C_Len.Data[2] & 0x3F) > 29) || ((R828_I2C_Len.Data[2] & 0x3F) < 23)) 
+        if(((priv->R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((priv->R828_I2C_Len.Data[2] & 0x3F) > 29) || ((priv->R828_I2C_Len.Data[2] & 0x3F) < 23)) 
 #else
-	    if(((R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((R828_I2C_Len.Data[2] & 0x3F) == 0x3F)) 
+	    if(((priv->R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((priv->R828_I2C_Len.Data[2] & 0x3F) == 0x3F)) 
 #endif
 	   {
 		   //cap 10pF 
-	       R828_I2C.RegAddr = 0x10;
-	       R828_Arry[11]    = (R828_Arry[11] & 0xFC) | 0x01;
-	       R828_I2C.Data    = R828_Arry[11];
-	       if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	       priv->R828_I2C.RegAddr = 0x10;
+	       priv->R828_Arry[11]    = (priv->R828_Arry[11] & 0xFC) | 0x01;
+	       priv->R828_I2C.Data    = priv->R828_Arry[11];
+	       if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		       return RT_Fail;
 
-		   R828_Delay_MS(pTuner, 5);
+		   R828_Delay_MS(priv, 5);
 	
-		   R828_I2C_Len.RegAddr = 0x00;
-		   R828_I2C_Len.Len     = 3;
-		   if(I2C_Read_Len(pTuner, &R828_I2C_Len) != RT_Success)
+		   priv->R828_I2C_Len.RegAddr = 0x00;
+		   priv->R828_I2C_Len.Len     = 3;
+		   if(I2C_Read_Len(priv, &priv->R828_I2C_Len) != RT_Success)
 		       return RT_Fail;
 
 		   // if 10pF unlock, set to cap 0pF
 #if (USE_16M_XTAL==TRUE)
-           if(((R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((R828_I2C_Len.Data[2] & 0x3F) > 29) || ((R828_I2C_Len.Data[2] & 0x3F) < 23)) 
+           if(((priv->R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((priv->R828_I2C_Len.Data[2] & 0x3F) > 29) || ((priv->R828_I2C_Len.Data[2] & 0x3F) < 23)) 
 #else
-	       if(((R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((R828_I2C_Len.Data[2] & 0x3F) == 0x3F)) 
+	       if(((priv->R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((priv->R828_I2C_Len.Data[2] & 0x3F) == 0x3F)) 
 #endif 
 	      {
 		      //cap 0pF 
-	          R828_I2C.RegAddr = 0x10;
-	          R828_Arry[11]    = (R828_Arry[11] & 0xFC) | 0x00;
-	          R828_I2C.Data    = R828_Arry[11];
-	          if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	          priv->R828_I2C.RegAddr = 0x10;
+	          priv->R828_Arry[11]    = (priv->R828_Arry[11] & 0xFC) | 0x00;
+	          priv->R828_I2C.Data    = priv->R828_Arry[11];
+	          if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		          return RT_Fail;
 		
-		      R828_Delay_MS(pTuner, 5);
+		      R828_Delay_MS(priv, 5);
 	
-		      R828_I2C_Len.RegAddr = 0x00;
-		      R828_I2C_Len.Len     = 3;
-		      if(I2C_Read_Len(pTuner, &R828_I2C_Len) != RT_Success)
+		      priv->R828_I2C_Len.RegAddr = 0x00;
+		      priv->R828_I2C_Len.Len     = 3;
+		      if(I2C_Read_Len(priv, &priv->R828_I2C_Len) != RT_Success)
 		           return RT_Fail;
 	
 		      // if unlock, set to high drive
 #if (USE_16M_XTAL==TRUE)
-               if(((R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((R828_I2C_Len.Data[2] & 0x3F) > 29) || ((R828_I2C_Len.Data[2] & 0x3F) < 23)) 
+               if(((priv->R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((priv->R828_I2C_Len.Data[2] & 0x3F) > 29) || ((priv->R828_I2C_Len.Data[2] & 0x3F) < 23)) 
 #else
-		      if(((R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((R828_I2C_Len.Data[2] & 0x3F) == 0x3F)) 
+		      if(((priv->R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((priv->R828_I2C_Len.Data[2] & 0x3F) == 0x3F)) 
 #endif 
 			  {
 				   //X'tal drive high
-	               R828_I2C.RegAddr = 0x10;
-	               R828_Arry[11]    = (R828_Arry[11] & 0xF7) ;
-	               R828_I2C.Data    = R828_Arry[11];
-	               if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	               priv->R828_I2C.RegAddr = 0x10;
+	               priv->R828_Arry[11]    = (priv->R828_Arry[11] & 0xF7) ;
+	               priv->R828_I2C.Data    = priv->R828_Arry[11];
+	               if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
                           return RT_Fail;
 
 				   //R828_Delay_MS(15);
-				   R828_Delay_MS(pTuner, 20);
+				   R828_Delay_MS(priv, 20);
 	
-		           R828_I2C_Len.RegAddr = 0x00;
-		           R828_I2C_Len.Len     = 3;
-		           if(I2C_Read_Len(pTuner, &R828_I2C_Len) != RT_Success)
+		           priv->R828_I2C_Len.RegAddr = 0x00;
+		           priv->R828_I2C_Len.Len     = 3;
+		           if(I2C_Read_Len(priv, &priv->R828_I2C_Len) != RT_Success)
 		                  return RT_Fail;
 
 #if (USE_16M_XTAL==TRUE)
-                   if(((R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((R828_I2C_Len.Data[2] & 0x3F) > 29) || ((R828_I2C_Len.Data[2] & 0x3F) < 23)) 
+                   if(((priv->R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((priv->R828_I2C_Len.Data[2] & 0x3F) > 29) || ((priv->R828_I2C_Len.Data[2] & 0x3F) < 23)) 
 #else
-	               if(((R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((R828_I2C_Len.Data[2] & 0x3F) == 0x3F)) 
+	               if(((priv->R828_I2C_Len.Data[2] & 0x40) == 0x00) || ((priv->R828_I2C_Len.Data[2] & 0x3F) == 0x3F)) 
 #endif
 				   {
 			             return RT_Fail;
 				   }
 				   else //0p+high drive lock
 				   {
-						Xtal_cap_sel_tmp = XTAL_HIGH_CAP_0P;
+						priv->Xtal_cap_sel_tmp = XTAL_HIGH_CAP_0P;
 				   }
 			  }
 		      else //0p lock
 			  {
-				   Xtal_cap_sel_tmp = XTAL_LOW_CAP_0P;
+				   priv->Xtal_cap_sel_tmp = XTAL_LOW_CAP_0P;
 			  }
 		   }
 		   else //10p lock
 		   {   
-			   Xtal_cap_sel_tmp = XTAL_LOW_CAP_10P;
+			   priv->Xtal_cap_sel_tmp = XTAL_LOW_CAP_10P;
 		   }
 		}
 		else //20p lock
 		{
-		   Xtal_cap_sel_tmp = XTAL_LOW_CAP_20P;
+		   priv->Xtal_cap_sel_tmp = XTAL_LOW_CAP_20P;
 		}
 	}
 	else // 30p lock
 	{
-		Xtal_cap_sel_tmp = XTAL_LOW_CAP_30P;
+		priv->Xtal_cap_sel_tmp = XTAL_LOW_CAP_30P;
 	}
 
     return RT_Success;
 }	
-R828_ErrCode R828_Init(void *pTuner)
+R828_ErrCode R828_Init(struct r820t_state *priv)
 {
 //	R820T_EXTRA_MODULE *pExtra;
     UINT8 i;
 
 	// Get tuner extra module.
-//	pExtra = &(pTuner->Extra.R820t);
+//	pExtra = &(priv->Extra.R820t);
+
+	// A new chip, forget what was written to the previous one.
+	priv->R828_Chip_Valid = 0;
+	priv->R828_Dirty = 0;
 
     //write initial reg
-	//if(R828_InitReg(pTuner) != RT_Success)         
+	//if(R828_InitReg(priv) != RT_Success)         
 	//	return RT_Fail;
 
-	if(R828_IMR_done_flag==FALSE)
+	// Calibration restored from a previous run, nothing to redo.
+	if(priv->R828_Cal_restored==TRUE)
+	{
+	  priv->R828_Cal_restored = FALSE;
+	}
+	else if(priv->R828_IMR_done_flag==FALSE)
 	{
 
 	  //write initial reg
-//	  if(R828_InitReg(pTuner) != RT_Success)        
+//	  if(R828_InitReg(priv) != RT_Success)        
 //		  return RT_Fail;
 
 	  //Do Xtal check
 	  if((Rafael_Chip==R820T) || (Rafael_Chip==R828S) || (Rafael_Chip==R820C))
 	  {
-		  Xtal_cap_sel = XTAL_HIGH_CAP_0P;
+		  priv->Xtal_cap_sel = XTAL_HIGH_CAP_0P;
 	  }
 	  else
 	  {
-          if(R828_Xtal_Check(pTuner) != RT_Success)        //1st
+          if(R828_Xtal_Check(priv) != RT_Success)        //1st
 	          return RT_Fail;
 
-		  Xtal_cap_sel = Xtal_cap_sel_tmp;
+		  priv->Xtal_cap_sel = priv->Xtal_cap_sel_tmp;
 		  
-		  if(R828_Xtal_Check(pTuner) != RT_Success)        //2nd
+		  if(R828_Xtal_Check(priv) != RT_Success)        //2nd
 	          return RT_Fail;
 		  
-		  if(Xtal_cap_sel_tmp > Xtal_cap_sel)
+		  if(priv->Xtal_cap_sel_tmp > priv->Xtal_cap_sel)
 		  {
-			  Xtal_cap_sel = Xtal_cap_sel_tmp;
+			  priv->Xtal_cap_sel = priv->Xtal_cap_sel_tmp;
 		  }
 
-		  if(R828_Xtal_Check(pTuner) != RT_Success)        //3rd
+		  if(R828_Xtal_Check(priv) != RT_Success)        //3rd
 	          return RT_Fail;
 		  
-		  if(Xtal_cap_sel_tmp > Xtal_cap_sel)
+		  if(priv->Xtal_cap_sel_tmp > priv->Xtal_cap_sel)
 		  {
-		      Xtal_cap_sel = Xtal_cap_sel_tmp;
+		      priv->Xtal_cap_sel = priv->Xtal_cap_sel_tmp;
 		  }
 
 	  }
@@ -1020,39 +1056,39 @@ R828_ErrCode R828_Init(void *pTuner)
 	  //reset filter cal.
       for (i=0; i<STD_SIZE; i++)
 	  {	  
-		  R828_Fil_Cal_flag[i] = FALSE;
-		  R828_Fil_Cal_code[i] = 0;
+		  priv->R828_Fil_Cal_flag[i] = FALSE;
+		  priv->R828_Fil_Cal_code[i] = 0;
 	  }
 
 #if 0
 	  //start imr cal.
-	  if(R828_InitReg(pTuner) != RT_Success)        //write initial reg before doing cal
+	  if(R828_InitReg(priv) != RT_Success)        //write initial reg before doing cal
 	      return RT_Fail;
 
-	  if(R828_IMR_Prepare(pTuner) != RT_Success)
+	  if(R828_IMR_Prepare(priv) != RT_Success)
 		return RT_Fail;
 
-	  if(R828_IMR(pTuner, 3, TRUE) != RT_Success)       //Full K node 3
+	  if(R828_IMR(priv, 3, TRUE) != RT_Success)       //Full K node 3
 		return RT_Fail;
 
-	  if(R828_IMR(pTuner, 1, FALSE) != RT_Success)
+	  if(R828_IMR(priv, 1, FALSE) != RT_Success)
 		return RT_Fail;
 
-	  if(R828_IMR(pTuner, 0, FALSE) != RT_Success)
+	  if(R828_IMR(priv, 0, FALSE) != RT_Success)
 		return RT_Fail;
 
-	  if(R828_IMR(pTuner, 2, FALSE) != RT_Success)
+	  if(R828_IMR(priv, 2, FALSE) != RT_Success)
 		return RT_Fail;
 
-	  if(R828_IMR(pTuner, 4, FALSE) != RT_Success)
+	  if(R828_IMR(priv, 4, FALSE) != RT_Success)
 		return RT_Fail;
 
-	  R828_IMR_done_flag = TRUE;
+	  priv->R828_IMR_done_flag = TRUE;
 #endif
 	}
 
 	//write initial reg
-	if(R828_InitReg(pTuner) != RT_Success)        
+	if(R828_InitReg(priv) != RT_Success)        
 		return RT_Fail;
 
 	return RT_Success;
@@ -1060,7 +1096,46 @@ R828_ErrCode R828_Init(void *pTuner)
 
 
 
-R828_ErrCode R828_InitReg(void *pTuner)
+R828_ErrCode R828_GetCal(struct r820t_state *priv, R828_Cal_Type *pCal)
+{
+	UINT8 i;
+
+	pCal->Xtal_cap_sel = priv->Xtal_cap_sel;
+	pCal->IMR_done_flag = priv->R828_IMR_done_flag;
+	for(i=0; i<5; i++)
+		pCal->IMR_Data[i] = priv->IMR_Data[i];
+	for(i=0; i<STD_SIZE; i++)
+	{
+		pCal->Fil_Cal_flag[i] = priv->R828_Fil_Cal_flag[i];
+		pCal->Fil_Cal_code[i] = priv->R828_Fil_Cal_code[i];
+	}
+
+	return RT_Success;
+}
+
+// Load results of an earlier calibration, the next R828_Init() keeps them.
+R828_ErrCode R828_SetCal(struct r820t_state *priv, const R828_Cal_Type *pCal)
+{
+	UINT8 i;
+
+	if(pCal->Xtal_cap_sel > XTAL_HIGH_CAP_0P)
+		return RT_Fail;
+
+	priv->Xtal_cap_sel = pCal->Xtal_cap_sel;
+	priv->R828_IMR_done_flag = pCal->IMR_done_flag;
+	for(i=0; i<5; i++)
+		priv->IMR_Data[i] = pCal->IMR_Data[i];
+	for(i=0; i<STD_SIZE; i++)
+	{
+		priv->R828_Fil_Cal_flag[i] = pCal->Fil_Cal_flag[i];
+		priv->R828_Fil_Cal_code[i] = pCal->Fil_Cal_code[i] & 0x0F;
+	}
+	priv->R828_Cal_restored = TRUE;
+
+	return RT_Success;
+}
+
+R828_ErrCode R828_InitReg(struct r820t_state *priv)
 {
 	UINT8 InitArryCount;
 	UINT8 InitArryNum;
@@ -1071,20 +1146,20 @@ R828_ErrCode R828_InitReg(void *pTuner)
 	//UINT32 LO_KHz      = 0;
 	
 	//Write Full Table
-	R828_I2C_Len.RegAddr = 0x05;
-	R828_I2C_Len.Len     = InitArryNum;
+	priv->R828_I2C_Len.RegAddr = 0x05;
+	priv->R828_I2C_Len.Len     = InitArryNum;
 	for(InitArryCount = 0;InitArryCount < InitArryNum;InitArryCount ++)
 	{
-		R828_I2C_Len.Data[InitArryCount] = R828_iniArry[InitArryCount];
+		priv->R828_I2C_Len.Data[InitArryCount] = R828_iniArry[InitArryCount];
 	}
-	if(I2C_Write_Len(pTuner, &R828_I2C_Len) != RT_Success)
+	if(I2C_Write_Len(priv, &priv->R828_I2C_Len) != RT_Success)
 		return RT_Fail;
 
 	return RT_Success;
 }
 
 
-R828_ErrCode R828_IMR_Prepare(void *pTuner)
+R828_ErrCode R828_IMR_Prepare(struct r820t_state *priv)
 
 {
      UINT8 ArrayNum;
@@ -1093,74 +1168,74 @@ R828_ErrCode R828_IMR_Prepare(void *pTuner)
 	 
      for(ArrayNum=0;ArrayNum<27;ArrayNum++)
      {
-           R828_Arry[ArrayNum] = R828_iniArry[ArrayNum];
+           priv->R828_Arry[ArrayNum] = R828_iniArry[ArrayNum];
      }
      //IMR Preparation    
      //lna off (air-in off)
-     R828_I2C.RegAddr = 0x05;
-     R828_Arry[0]     = R828_Arry[0]  | 0x20;
-     R828_I2C.Data    = R828_Arry[0];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+     priv->R828_I2C.RegAddr = 0x05;
+     priv->R828_Arry[0]     = priv->R828_Arry[0]  | 0x20;
+     priv->R828_I2C.Data    = priv->R828_Arry[0];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
            return RT_Fail; 
      //mixer gain mode = manual
-     R828_I2C.RegAddr = 0x07;
-     R828_Arry[2]     = (R828_Arry[2] & 0xEF);
-     R828_I2C.Data    = R828_Arry[2];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+     priv->R828_I2C.RegAddr = 0x07;
+     priv->R828_Arry[2]     = (priv->R828_Arry[2] & 0xEF);
+     priv->R828_I2C.Data    = priv->R828_Arry[2];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
            return RT_Fail;
      //filter corner = lowest
-     R828_I2C.RegAddr = 0x0A;
-     R828_Arry[5]     = R828_Arry[5] | 0x0F;
-     R828_I2C.Data    = R828_Arry[5];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+     priv->R828_I2C.RegAddr = 0x0A;
+     priv->R828_Arry[5]     = priv->R828_Arry[5] | 0x0F;
+     priv->R828_I2C.Data    = priv->R828_Arry[5];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
            return RT_Fail;
      //filter bw=+2cap, hp=5M
-     R828_I2C.RegAddr = 0x0B;
-     R828_Arry[6]    = (R828_Arry[6] & 0x90) | 0x60;
-     R828_I2C.Data    = R828_Arry[6];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+     priv->R828_I2C.RegAddr = 0x0B;
+     priv->R828_Arry[6]    = (priv->R828_Arry[6] & 0x90) | 0x60;
+     priv->R828_I2C.Data    = priv->R828_Arry[6];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
            return RT_Fail;
      //adc=on, vga code mode, gain = 26.5dB  
-     R828_I2C.RegAddr = 0x0C;
-     R828_Arry[7]    = (R828_Arry[7] & 0x60) | 0x0B;
-     R828_I2C.Data    = R828_Arry[7];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+     priv->R828_I2C.RegAddr = 0x0C;
+     priv->R828_Arry[7]    = (priv->R828_Arry[7] & 0x60) | 0x0B;
+     priv->R828_I2C.Data    = priv->R828_Arry[7];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
            return RT_Fail;
      //ring clk = on
-     R828_I2C.RegAddr = 0x0F;
-     R828_Arry[10]   &= 0xF7;
-     R828_I2C.Data    = R828_Arry[10];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+     priv->R828_I2C.RegAddr = 0x0F;
+     priv->R828_Arry[10]   &= 0xF7;
+     priv->R828_I2C.Data    = priv->R828_Arry[10];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
            return RT_Fail;
      //ring power = on
-     R828_I2C.RegAddr = 0x18;
-     R828_Arry[19]    = R828_Arry[19] | 0x10;
-     R828_I2C.Data    = R828_Arry[19];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+     priv->R828_I2C.RegAddr = 0x18;
+     priv->R828_Arry[19]    = priv->R828_Arry[19] | 0x10;
+     priv->R828_I2C.Data    = priv->R828_Arry[19];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
            return RT_Fail;
      //from ring = ring pll in
-     R828_I2C.RegAddr = 0x1C;
-     R828_Arry[23]    = R828_Arry[23] | 0x02;
-     R828_I2C.Data    = R828_Arry[23];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+     priv->R828_I2C.RegAddr = 0x1C;
+     priv->R828_Arry[23]    = priv->R828_Arry[23] | 0x02;
+     priv->R828_I2C.Data    = priv->R828_Arry[23];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
            return RT_Fail;
      //sw_pdect = det3
-     R828_I2C.RegAddr = 0x1E;
-     R828_Arry[25]    = R828_Arry[25] | 0x80;
-     R828_I2C.Data    = R828_Arry[25];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+     priv->R828_I2C.RegAddr = 0x1E;
+     priv->R828_Arry[25]    = priv->R828_Arry[25] | 0x80;
+     priv->R828_I2C.Data    = priv->R828_Arry[25];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
            return RT_Fail;
 	// Set filt_3dB
-	R828_Arry[1]  = R828_Arry[1] | 0x20;  
-	R828_I2C.RegAddr  = 0x06;
-	R828_I2C.Data     = R828_Arry[1];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_Arry[1]  = priv->R828_Arry[1] | 0x20;  
+	priv->R828_I2C.RegAddr  = 0x06;
+	priv->R828_I2C.Data     = priv->R828_Arry[1];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
       return RT_Success;
 }
 
-R828_ErrCode R828_IMR(void *pTuner, UINT8 IMR_MEM, int IM_Flag)
+R828_ErrCode R828_IMR(struct r820t_state *priv, UINT8 IMR_MEM, int IM_Flag)
 {
 
 	UINT32 RingVCO;
@@ -1198,50 +1273,50 @@ R828_ErrCode R828_IMR(void *pTuner, UINT8 IMR_MEM, int IM_Flag)
 
 	}
 
-	R828_Arry[19] &= 0xF0;      //set ring[3:0]
-	R828_Arry[19] |= n_ring;
+	priv->R828_Arry[19] &= 0xF0;      //set ring[3:0]
+	priv->R828_Arry[19] |= n_ring;
 	RingVCO = (16+n_ring)* 8 * RingRef;
-	R828_Arry[19]&=0xDF;   //clear ring_se23
-	R828_Arry[20]&=0xFC;   //clear ring_seldiv
-	R828_Arry[26]&=0xFC;   //clear ring_att
+	priv->R828_Arry[19]&=0xDF;   //clear ring_se23
+	priv->R828_Arry[20]&=0xFC;   //clear ring_seldiv
+	priv->R828_Arry[26]&=0xFC;   //clear ring_att
 
 	switch(IMR_MEM)
 	{
 	case 0:
 		RingFreq = RingVCO/48;
-		R828_Arry[19]|=0x20;  // ring_se23 = 1
-		R828_Arry[20]|=0x03;  // ring_seldiv = 3
-		R828_Arry[26]|=0x02;  // ring_att 10
+		priv->R828_Arry[19]|=0x20;  // ring_se23 = 1
+		priv->R828_Arry[20]|=0x03;  // ring_seldiv = 3
+		priv->R828_Arry[26]|=0x02;  // ring_att 10
 		break;
 	case 1:
 		RingFreq = RingVCO/16;
-		R828_Arry[19]|=0x00;  // ring_se23 = 0
-		R828_Arry[20]|=0x02;  // ring_seldiv = 2
-		R828_Arry[26]|=0x00;  // pw_ring 00
+		priv->R828_Arry[19]|=0x00;  // ring_se23 = 0
+		priv->R828_Arry[20]|=0x02;  // ring_seldiv = 2
+		priv->R828_Arry[26]|=0x00;  // pw_ring 00
 		break;
 	case 2:
 		RingFreq = RingVCO/8;
-		R828_Arry[19]|=0x00;  // ring_se23 = 0
-		R828_Arry[20]|=0x01;  // ring_seldiv = 1
-		R828_Arry[26]|=0x03;  // pw_ring 11
+		priv->R828_Arry[19]|=0x00;  // ring_se23 = 0
+		priv->R828_Arry[20]|=0x01;  // ring_seldiv = 1
+		priv->R828_Arry[26]|=0x03;  // pw_ring 11
 		break;
 	case 3:
 		RingFreq = RingVCO/6;
-		R828_Arry[19]|=0x20;  // ring_se23 = 1
-		R828_Arry[20]|=0x00;  // ring_seldiv = 0
-		R828_Arry[26]|=0x03;  // pw_ring 11
+		priv->R828_Arry[19]|=0x20;  // ring_se23 = 1
+		priv->R828_Arry[20]|=0x00;  // ring_seldiv = 0
+		priv->R828_Arry[26]|=0x03;  // pw_ring 11
 		break;
 	case 4:
 		RingFreq = RingVCO/4;
-		R828_Arry[19]|=0x00;  // ring_se23 = 0
-		R828_Arry[20]|=0x00;  // ring_seldiv = 0
-		R828_Arry[26]|=0x01;  // pw_ring 01
+		priv->R828_Arry[19]|=0x00;  // ring_se23 = 0
+		priv->R828_Arry[20]|=0x00;  // ring_seldiv = 0
+		priv->R828_Arry[26]|=0x01;  // pw_ring 01
 		break;
 	default:
 		RingFreq = RingVCO/4;
-		R828_Arry[19]|=0x00;  // ring_se23 = 0
-		R828_Arry[20]|=0x00;  // ring_seldiv = 0
-		R828_Arry[26]|=0x01;  // pw_ring 01
+		priv->R828_Arry[19]|=0x00;  // ring_se23 = 0
+		priv->R828_Arry[20]|=0x00;  // ring_seldiv = 0
+		priv->R828_Arry[26]|=0x01;  // pw_ring 01
 		break;
 	}
 
@@ -1249,39 +1324,39 @@ R828_ErrCode R828_IMR(void *pTuner, UINT8 IMR_MEM, int IM_Flag)
 	//write pw_ring,n_ring,ringdiv2 to I2C
 
 	//------------n_ring,ring_se23----------//
-	R828_I2C.RegAddr = 0x18;
-	R828_I2C.Data    = R828_Arry[19];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x18;
+	priv->R828_I2C.Data    = priv->R828_Arry[19];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 	//------------ring_sediv----------------//
-	R828_I2C.RegAddr = 0x19;
-	R828_I2C.Data    = R828_Arry[20];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x19;
+	priv->R828_I2C.Data    = priv->R828_Arry[20];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 	//------------pw_ring-------------------//
-	R828_I2C.RegAddr = 0x1f;
-	R828_I2C.Data    = R828_Arry[26];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x1f;
+	priv->R828_I2C.Data    = priv->R828_Arry[26];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 	
 	//Must do before PLL() 
-	if(R828_MUX(pTuner, RingFreq - 5300) != RT_Success)				//MUX input freq ~ RF_in Freq
+	if(R828_MUX(priv, RingFreq - 5300) != RT_Success)				//MUX input freq ~ RF_in Freq
 		return RT_Fail;
 
-	if(R828_PLL(pTuner, (RingFreq - 5300) * 1000, STD_SIZE) != RT_Success)                //set pll freq = ring freq - 6M
+	if(R828_PLL(priv, (RingFreq - 5300) * 1000, STD_SIZE) != RT_Success)                //set pll freq = ring freq - 6M
 	    return RT_Fail;
 
 	if(IM_Flag == TRUE)
 	{
-	if(R828_IQ(pTuner, &IMR_POINT) != RT_Success)
+	if(R828_IQ(priv, &IMR_POINT) != RT_Success)
 		return RT_Fail;
 	}
 	else
 	{
-		IMR_POINT.Gain_X = IMR_Data[3].Gain_X;
-		IMR_POINT.Phase_Y = IMR_Data[3].Phase_Y;
-		IMR_POINT.Value = IMR_Data[3].Value;
-		if(R828_F_IMR(pTuner, &IMR_POINT) != RT_Success)
+		IMR_POINT.Gain_X = priv->IMR_Data[3].Gain_X;
+		IMR_POINT.Phase_Y = priv->IMR_Data[3].Phase_Y;
+		IMR_POINT.Value = priv->IMR_Data[3].Value;
+		if(R828_F_IMR(priv, &IMR_POINT) != RT_Success)
 			return RT_Fail;
 	}
 
@@ -1289,40 +1364,40 @@ R828_ErrCode R828_IMR(void *pTuner, UINT8 IMR_MEM, int IM_Flag)
 	switch(IMR_MEM)
 	{
 	case 0:
-		IMR_Data[0].Gain_X  = IMR_POINT.Gain_X;
-		IMR_Data[0].Phase_Y = IMR_POINT.Phase_Y;
-		IMR_Data[0].Value   = IMR_POINT.Value;
+		priv->IMR_Data[0].Gain_X  = IMR_POINT.Gain_X;
+		priv->IMR_Data[0].Phase_Y = IMR_POINT.Phase_Y;
+		priv->IMR_Data[0].Value   = IMR_POINT.Value;
 		break;
 	case 1:
-		IMR_Data[1].Gain_X  = IMR_POINT.Gain_X;
-		IMR_Data[1].Phase_Y = IMR_POINT.Phase_Y;
-		IMR_Data[1].Value   = IMR_POINT.Value;
+		priv->IMR_Data[1].Gain_X  = IMR_POINT.Gain_X;
+		priv->IMR_Data[1].Phase_Y = IMR_POINT.Phase_Y;
+		priv->IMR_Data[1].Value   = IMR_POINT.Value;
 		break;
 	case 2:
-		IMR_Data[2].Gain_X  = IMR_POINT.Gain_X;
-		IMR_Data[2].Phase_Y = IMR_POINT.Phase_Y;
-		IMR_Data[2].Value   = IMR_POINT.Value;
+		priv->IMR_Data[2].Gain_X  = IMR_POINT.Gain_X;
+		priv->IMR_Data[2].Phase_Y = IMR_POINT.Phase_Y;
+		priv->IMR_Data[2].Value   = IMR_POINT.Value;
 		break;
 	case 3:
-		IMR_Data[3].Gain_X  = IMR_POINT.Gain_X;
-		IMR_Data[3].Phase_Y = IMR_POINT.Phase_Y;
-		IMR_Data[3].Value   = IMR_POINT.Value;
+		priv->IMR_Data[3].Gain_X  = IMR_POINT.Gain_X;
+		priv->IMR_Data[3].Phase_Y = IMR_POINT.Phase_Y;
+		priv->IMR_Data[3].Value   = IMR_POINT.Value;
 		break;
 	case 4:
-		IMR_Data[4].Gain_X  = IMR_POINT.Gain_X;
-		IMR_Data[4].Phase_Y = IMR_POINT.Phase_Y;
-		IMR_Data[4].Value   = IMR_POINT.Value;
+		priv->IMR_Data[4].Gain_X  = IMR_POINT.Gain_X;
+		priv->IMR_Data[4].Phase_Y = IMR_POINT.Phase_Y;
+		priv->IMR_Data[4].Value   = IMR_POINT.Value;
 		break;
     default:
-		IMR_Data[4].Gain_X  = IMR_POINT.Gain_X;
-		IMR_Data[4].Phase_Y = IMR_POINT.Phase_Y;
-		IMR_Data[4].Value   = IMR_POINT.Value;
+		priv->IMR_Data[4].Gain_X  = IMR_POINT.Gain_X;
+		priv->IMR_Data[4].Phase_Y = IMR_POINT.Phase_Y;
+		priv->IMR_Data[4].Value   = IMR_POINT.Value;
 		break;
 	}
 	return RT_Success;
 }
 
-R828_ErrCode R828_PLL(void *pTuner, UINT32 LO_Freq, R828_Standard_Type R828_Standard)
+R828_ErrCode R828_PLL(struct r820t_state *priv, UINT32 LO_Freq, R828_Standard_Type R828_Standard)
 {
 
 //	R820T_EXTRA_MODULE *pExtra;
@@ -1344,6 +1419,8 @@ R828_ErrCode R828_PLL(void *pTuner, UINT32 LO_Freq, R828_Standard_Type R828_Stan
 	UINT16 SDM8to1;
 	//UINT8  Judge    = 0;
 	UINT8  VCO_fine_tune;
+	int    LockWait_ms;
+	int    Locked;
 
 	MixDiv   = 2;
 	DivBuf   = 0;
@@ -1368,12 +1445,12 @@ R828_ErrCode R828_PLL(void *pTuner, UINT32 LO_Freq, R828_Standard_Type R828_Stan
 	{
 		if(R828_Standard <= SECAM_L1)	  //ref set refdiv2, reffreq = Xtal/2 on ATV application
 		{
-			R828_Arry[11] |= 0x10; //b4=1
+			priv->R828_Arry[11] |= 0x10; //b4=1
 			PLL_Ref = R828_Xtal /2;
 		}
 		else //DTV, FilCal, IMR
 		{
-			R828_Arry[11] &= 0xEF;
+			priv->R828_Arry[11] &= 0xEF;
 			PLL_Ref = R828_Xtal;
 		}
 	}
@@ -1381,37 +1458,37 @@ R828_ErrCode R828_PLL(void *pTuner, UINT32 LO_Freq, R828_Standard_Type R828_Stan
 	{
 		if(R828_Xtal > 24000)
 		{
-			R828_Arry[11] |= 0x10; //b4=1
+			priv->R828_Arry[11] |= 0x10; //b4=1
 			PLL_Ref = R828_Xtal /2;
 		}
 		else
 		{
-			R828_Arry[11] &= 0xEF;
+			priv->R828_Arry[11] &= 0xEF;
 			PLL_Ref = R828_Xtal;
 		}
 	}
 #endif
 	//FIXME hack
-	R828_Arry[11] &= 0xEF;
-	PLL_Ref = rtlsdr_get_tuner_clock(pTuner);
+	priv->R828_Arry[11] &= 0xEF;
+	PLL_Ref = rtlsdr_get_tuner_clock(priv->rtl_dev);
 
-	R828_I2C.RegAddr = 0x10;
-	R828_I2C.Data = R828_Arry[11];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x10;
+	priv->R828_I2C.Data = priv->R828_Arry[11];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	//set pll autotune = 128kHz
-	R828_I2C.RegAddr = 0x1A;
-	R828_Arry[21]    = R828_Arry[21] & 0xF3;
-	R828_I2C.Data    = R828_Arry[21];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x1A;
+	priv->R828_Arry[21]    = priv->R828_Arry[21] & 0xF3;
+	priv->R828_I2C.Data    = priv->R828_Arry[21];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	//Set VCO current = 100
-	R828_I2C.RegAddr = 0x12;
-	R828_Arry[13]    = (R828_Arry[13] & 0x1F) | 0x80; 
-	R828_I2C.Data    = R828_Arry[13];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x12;
+	priv->R828_Arry[13]    = (priv->R828_Arry[13] & 0x1F) | 0x80; 
+	priv->R828_I2C.Data    = priv->R828_Arry[13];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	//Divider
@@ -1430,23 +1507,23 @@ R828_ErrCode R828_PLL(void *pTuner, UINT32 LO_Freq, R828_Standard_Type R828_Stan
 		MixDiv = MixDiv << 1;
 	}
 
-	R828_I2C_Len.RegAddr = 0x00;
-	R828_I2C_Len.Len     = 5;
-	if(I2C_Read_Len(pTuner, &R828_I2C_Len) != RT_Success)
+	priv->R828_I2C_Len.RegAddr = 0x00;
+	priv->R828_I2C_Len.Len     = 5;
+	if(I2C_Read_Len(priv, &priv->R828_I2C_Len) != RT_Success)
 		return RT_Fail;	
 
-	VCO_fine_tune = (R828_I2C_Len.Data[4] & 0x30)>>4;
+	VCO_fine_tune = (priv->R828_I2C_Len.Data[4] & 0x30)>>4;
 
 	if(VCO_fine_tune > VCO_pwr_ref)
 		DivNum = DivNum - 1;
 	else if(VCO_fine_tune < VCO_pwr_ref)
 	    DivNum = DivNum + 1; 
 	
-	R828_I2C.RegAddr = 0x10;
-	R828_Arry[11] &= 0x1F;
-	R828_Arry[11] |= (DivNum << 5);
-	R828_I2C.Data = R828_Arry[11];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x10;
+	priv->R828_Arry[11] &= 0x1F;
+	priv->R828_Arry[11] |= (DivNum << 5);
+	priv->R828_I2C.Data = priv->R828_Arry[11];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	VCO_Freq = (uint64_t)(LO_Freq * (uint64_t)MixDiv);
@@ -1481,21 +1558,21 @@ R828_ErrCode R828_PLL(void *pTuner, UINT32 LO_Freq, R828_Standard_Type R828_Stan
 	//N & S
 	Ni       = (Nint - 13) / 4;
 	Si       = Nint - 4 *Ni - 13;
-	R828_I2C.RegAddr = 0x14;
-	R828_Arry[15]  = 0x00;
-	R828_Arry[15] |= (Ni + (Si << 6));
-	R828_I2C.Data = R828_Arry[15];
+	priv->R828_I2C.RegAddr = 0x14;
+	priv->R828_Arry[15]  = 0x00;
+	priv->R828_Arry[15] |= (Ni + (Si << 6));
+	priv->R828_I2C.Data = priv->R828_Arry[15];
 	
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 	  return RT_Fail;
 
 	//pw_sdm
-	R828_I2C.RegAddr = 0x12;
-	R828_Arry[13] &= 0xF7;
+	priv->R828_I2C.RegAddr = 0x12;
+	priv->R828_Arry[13] &= 0xF7;
 	if(VCO_Fra == 0)
-		R828_Arry[13] |= 0x08;
-	R828_I2C.Data = R828_Arry[13];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_Arry[13] |= 0x08;
+	priv->R828_I2C.Data = priv->R828_Arry[13];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	//SDM calculator
@@ -1514,15 +1591,15 @@ R828_ErrCode R828_PLL(void *pTuner, UINT32 LO_Freq, R828_Standard_Type R828_Stan
 	SDM16to9 = SDM >> 8;
 	SDM8to1 =  SDM - (SDM16to9 << 8);
 
-	R828_I2C.RegAddr = 0x16;
-	R828_Arry[17]    = (UINT8) SDM16to9;
-	R828_I2C.Data    = R828_Arry[17];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x16;
+	priv->R828_Arry[17]    = (UINT8) SDM16to9;
+	priv->R828_I2C.Data    = priv->R828_Arry[17];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
-	R828_I2C.RegAddr = 0x15;
-	R828_Arry[16]    = (UINT8) SDM8to1;
-	R828_I2C.Data    = R828_Arry[16];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x15;
+	priv->R828_Arry[16]    = (UINT8) SDM8to1;
+	priv->R828_I2C.Data    = priv->R828_Arry[16];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 //	R828_Delay_MS(10);
@@ -1530,44 +1607,60 @@ R828_ErrCode R828_PLL(void *pTuner, UINT32 LO_Freq, R828_Standard_Type R828_Stan
 	if ((Rafael_Chip==R620D) || (Rafael_Chip==R828D) || (Rafael_Chip==R828))
 	{
 		if(R828_Standard <= SECAM_L1)
-			R828_Delay_MS(pTuner, 20);
+			LockWait_ms = 20;
 		else
-			R828_Delay_MS(pTuner, 10);
+			LockWait_ms = 10;
 	}
 	else
 	{
-		R828_Delay_MS(pTuner, 10);
+		LockWait_ms = 10;
 	}
 
-	//check PLL lock status
-	R828_I2C_Len.RegAddr = 0x00;
-	R828_I2C_Len.Len     = 3;
-	if(I2C_Read_Len(pTuner, &R828_I2C_Len) != RT_Success)
-		return RT_Fail;
+	//poll the PLL lock status, one read per ms of the vendor wait time
+	//(R828_Delay_MS() itself does not sleep)
+	for(Locked = 0; LockWait_ms > 0 && !Locked; LockWait_ms--)
+	{
+		R828_Delay_MS(priv, 1);
 
-	if( (R828_I2C_Len.Data[2] & 0x40) == 0x00 )
+		if(R828_GetLockStatus(priv, &Locked) != RT_Success)
+			return RT_Fail;
+	}
+
+	if(!Locked)
 	{
 		fprintf(stderr, "[R820T] PLL not locked for %u Hz!\n", LO_Freq);
-		R828_I2C.RegAddr = 0x12;
-		R828_Arry[13]    = (R828_Arry[13] & 0x1F) | 0x60;  //increase VCO current
-		R828_I2C.Data    = R828_Arry[13];
-		if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_I2C.RegAddr = 0x12;
+		priv->R828_Arry[13]    = (priv->R828_Arry[13] & 0x1F) | 0x60;  //increase VCO current
+		priv->R828_I2C.Data    = priv->R828_Arry[13];
+		if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
 
 		return RT_Fail;
 	}
 
 	//set pll autotune = 8kHz
-	R828_I2C.RegAddr = 0x1A;
-	R828_Arry[21]    = R828_Arry[21] | 0x08;
-	R828_I2C.Data    = R828_Arry[21];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x1A;
+	priv->R828_Arry[21]    = priv->R828_Arry[21] | 0x08;
+	priv->R828_I2C.Data    = priv->R828_Arry[21];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
+		return RT_Fail;
+
+	return RT_Success;
+}
+
+R828_ErrCode R828_GetLockStatus(struct r820t_state *priv, int *pLocked)
+{
+	priv->R828_I2C_Len.RegAddr = 0x00;
+	priv->R828_I2C_Len.Len     = 3;
+	if(I2C_Read_Len(priv, &priv->R828_I2C_Len) != RT_Success)
 		return RT_Fail;
 
+	*pLocked = (priv->R828_I2C_Len.Data[2] & 0x40) != 0;
+
 	return RT_Success;
 }
 
-R828_ErrCode R828_MUX(void *pTuner, UINT32 RF_KHz)
+R828_ErrCode R828_MUX(struct r820t_state *priv, UINT32 RF_KHz)
 {	
 	UINT8 RT_Reg08;
 	UINT8 RT_Reg09;
@@ -1575,66 +1668,66 @@ R828_ErrCode R828_MUX(void *pTuner, UINT32 RF_KHz)
 	RT_Reg08   = 0;
 	RT_Reg09   = 0;
 
-	//Freq_Info_Type Freq_Info1;
-	Freq_Info1 = R828_Freq_Sel(RF_KHz);
+	//Freq_Info_Type priv->Freq_Info1;
+	priv->Freq_Info1 = R828_Freq_Sel(RF_KHz);
 
 	// Open Drain
-	R828_I2C.RegAddr = 0x17;
-	R828_Arry[18] = (R828_Arry[18] & 0xF7) | Freq_Info1.OPEN_D;
-	R828_I2C.Data = R828_Arry[18];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x17;
+	priv->R828_Arry[18] = (priv->R828_Arry[18] & 0xF7) | priv->Freq_Info1.OPEN_D;
+	priv->R828_I2C.Data = priv->R828_Arry[18];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	// RF_MUX,Polymux 
-	R828_I2C.RegAddr = 0x1A;
-	R828_Arry[21] = (R828_Arry[21] & 0x3C) | Freq_Info1.RF_MUX_PLOY;
-	R828_I2C.Data = R828_Arry[21];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x1A;
+	priv->R828_Arry[21] = (priv->R828_Arry[21] & 0x3C) | priv->Freq_Info1.RF_MUX_PLOY;
+	priv->R828_I2C.Data = priv->R828_Arry[21];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	// TF BAND
-	R828_I2C.RegAddr = 0x1B;
-	R828_Arry[22] &= 0x00;
-	R828_Arry[22] |= Freq_Info1.TF_C;	
-	R828_I2C.Data = R828_Arry[22];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x1B;
+	priv->R828_Arry[22] &= 0x00;
+	priv->R828_Arry[22] |= priv->Freq_Info1.TF_C;	
+	priv->R828_I2C.Data = priv->R828_Arry[22];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	// XTAL CAP & Drive
-	R828_I2C.RegAddr = 0x10;
-	R828_Arry[11] &= 0xF4;
-	switch(Xtal_cap_sel)
+	priv->R828_I2C.RegAddr = 0x10;
+	priv->R828_Arry[11] &= 0xF4;
+	switch(priv->Xtal_cap_sel)
 	{
 	   case XTAL_LOW_CAP_30P:
 	   case XTAL_LOW_CAP_20P:
-		   R828_Arry[11] = R828_Arry[11] | Freq_Info1.XTAL_CAP20P | 0x08;
+		   priv->R828_Arry[11] = priv->R828_Arry[11] | priv->Freq_Info1.XTAL_CAP20P | 0x08;
 		   break;
 
 	   case XTAL_LOW_CAP_10P:
-	   R828_Arry[11] = R828_Arry[11] | Freq_Info1.XTAL_CAP10P | 0x08;
+	   priv->R828_Arry[11] = priv->R828_Arry[11] | priv->Freq_Info1.XTAL_CAP10P | 0x08;
 		   break;
 
 	   case XTAL_LOW_CAP_0P:
-		   R828_Arry[11] = R828_Arry[11] | Freq_Info1.XTAL_CAP0P | 0x08;
+		   priv->R828_Arry[11] = priv->R828_Arry[11] | priv->Freq_Info1.XTAL_CAP0P | 0x08;
 		   break;
 	
 	   case XTAL_HIGH_CAP_0P:
-		   R828_Arry[11] = R828_Arry[11] | Freq_Info1.XTAL_CAP0P | 0x00;
+		   priv->R828_Arry[11] = priv->R828_Arry[11] | priv->Freq_Info1.XTAL_CAP0P | 0x00;
 		   break;
 
 	   default:
-	       R828_Arry[11] = R828_Arry[11] | Freq_Info1.XTAL_CAP0P | 0x08;
+	       priv->R828_Arry[11] = priv->R828_Arry[11] | priv->Freq_Info1.XTAL_CAP0P | 0x08;
 		   break;
 	}
-	R828_I2C.Data    = R828_Arry[11];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.Data    = priv->R828_Arry[11];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	//Set_IMR
-	if(R828_IMR_done_flag == TRUE)
+	if(priv->R828_IMR_done_flag == TRUE)
 	{
-		RT_Reg08 = IMR_Data[Freq_Info1.IMR_MEM].Gain_X & 0x3F;
-		RT_Reg09 = IMR_Data[Freq_Info1.IMR_MEM].Phase_Y & 0x3F;
+		RT_Reg08 = priv->IMR_Data[priv->Freq_Info1.IMR_MEM].Gain_X & 0x3F;
+		RT_Reg09 = priv->IMR_Data[priv->Freq_Info1.IMR_MEM].Phase_Y & 0x3F;
 	}
 	else
 	{
@@ -1642,24 +1735,24 @@ R828_ErrCode R828_MUX(void *pTuner, UINT32 RF_KHz)
 	    RT_Reg09 = 0;
 	}
 
-	R828_I2C.RegAddr = 0x08;
-	R828_Arry[3] = R828_iniArry[3] & 0xC0;
-	R828_Arry[3] = R828_Arry[3] | RT_Reg08;
-	R828_I2C.Data = R828_Arry[3];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x08;
+	priv->R828_Arry[3] = R828_iniArry[3] & 0xC0;
+	priv->R828_Arry[3] = priv->R828_Arry[3] | RT_Reg08;
+	priv->R828_I2C.Data = priv->R828_Arry[3];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
-	R828_I2C.RegAddr = 0x09;
-	R828_Arry[4] = R828_iniArry[4] & 0xC0;
-	R828_Arry[4] = R828_Arry[4] | RT_Reg09;
-	R828_I2C.Data =R828_Arry[4]  ;
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x09;
+	priv->R828_Arry[4] = R828_iniArry[4] & 0xC0;
+	priv->R828_Arry[4] = priv->R828_Arry[4] | RT_Reg09;
+	priv->R828_I2C.Data =priv->R828_Arry[4]  ;
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	return RT_Success;
 }
 
-R828_ErrCode R828_IQ(void *pTuner, R828_SectType* IQ_Pont)
+R828_ErrCode R828_IQ(struct r820t_state *priv, R828_SectType* IQ_Pont)
 {
 	R828_SectType Compare_IQ[3];
 //	R828_SectType CompareTemp;
@@ -1674,14 +1767,14 @@ R828_ErrCode R828_IQ(void *pTuner, R828_SectType* IQ_Pont)
 	// increase VGA power to let image significant
 	for(VGA_Count = 12;VGA_Count < 16;VGA_Count ++)
 	{
-		R828_I2C.RegAddr = 0x0C;
-		R828_I2C.Data    = (R828_Arry[7] & 0xF0) + VGA_Count;  
-		if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_I2C.RegAddr = 0x0C;
+		priv->R828_I2C.Data    = (priv->R828_Arry[7] & 0xF0) + VGA_Count;  
+		if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
 
-		R828_Delay_MS(pTuner, 10); //
+		R828_Delay_MS(priv, 10); //
 		
-		if(R828_Muti_Read(pTuner, 0x01, &VGA_Read) != RT_Success)
+		if(R828_Muti_Read(priv, 0x01, &VGA_Read) != RT_Success)
 			return RT_Fail;
 
 		if(VGA_Read > 40*4)
@@ -1697,7 +1790,7 @@ R828_ErrCode R828_IQ(void *pTuner, R828_SectType* IQ_Pont)
 	//while(IQ_Count < 3)
 	//{
 	    // Determine X or Y
-	    if(R828_IMR_Cross(pTuner, &Compare_IQ[0], &X_Direction) != RT_Success)
+	    if(R828_IMR_Cross(priv, &Compare_IQ[0], &X_Direction) != RT_Success)
 			return RT_Fail;
 
 		//if(X_Direction==1)
@@ -1733,7 +1826,7 @@ R828_ErrCode R828_IQ(void *pTuner, R828_SectType* IQ_Pont)
 			  return RT_Fail;
 
 		    //increase step to find min value of this direction
-		    if(R828_CompreStep(pTuner, &Compare_IQ[0], 0x08) != RT_Success)  //X
+		    if(R828_CompreStep(priv, &Compare_IQ[0], 0x08) != RT_Success)  //X
 			  return RT_Fail;
 		}
 		else
@@ -1743,7 +1836,7 @@ R828_ErrCode R828_IQ(void *pTuner, R828_SectType* IQ_Pont)
 		   	 return RT_Fail;
 
 		   //increase step to find min value of this direction
-		   if(R828_CompreStep(pTuner, &Compare_IQ[0], 0x09) != RT_Success)  //Y
+		   if(R828_CompreStep(priv, &Compare_IQ[0], 0x09) != RT_Success)  //Y
 			 return RT_Fail;
 		}
 		/*
@@ -1764,7 +1857,7 @@ R828_ErrCode R828_IQ(void *pTuner, R828_SectType* IQ_Pont)
 		//Another direction
 		if(X_Direction==1)
 		{	    
-           if(R828_IQ_Tree(pTuner, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success) //Y
+           if(R828_IQ_Tree(priv, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success) //Y
 		     return RT_Fail;
 
 		   //compare and find min of 3 points. determine I/Q direction
@@ -1772,12 +1865,12 @@ R828_ErrCode R828_IQ(void *pTuner, R828_SectType* IQ_Pont)
 		   	 return RT_Fail;
 
 		   //increase step to find min value of this direction
-		   if(R828_CompreStep(pTuner, &Compare_IQ[0], 0x09) != RT_Success)  //Y
+		   if(R828_CompreStep(priv, &Compare_IQ[0], 0x09) != RT_Success)  //Y
 			 return RT_Fail;
 		}
 		else
 		{
-		   if(R828_IQ_Tree(pTuner, Compare_IQ[0].Phase_Y, Compare_IQ[0].Gain_X, 0x09, &Compare_IQ[0]) != RT_Success) //X
+		   if(R828_IQ_Tree(priv, Compare_IQ[0].Phase_Y, Compare_IQ[0].Gain_X, 0x09, &Compare_IQ[0]) != RT_Success) //X
 		     return RT_Fail;
 
 		   //compare and find min of 3 points. determine I/Q direction
@@ -1785,7 +1878,7 @@ R828_ErrCode R828_IQ(void *pTuner, R828_SectType* IQ_Pont)
 		     return RT_Fail;
 
 	       //increase step to find min value of this direction
-		   if(R828_CompreStep(pTuner, &Compare_IQ[0], 0x08) != RT_Success) //X
+		   if(R828_CompreStep(priv, &Compare_IQ[0], 0x08) != RT_Success) //X
 		     return RT_Fail;
 		}
 		//CompareTemp = Compare_IQ[0];
@@ -1793,12 +1886,12 @@ R828_ErrCode R828_IQ(void *pTuner, R828_SectType* IQ_Pont)
 		//--- Check 3 points again---//
 		if(X_Direction==1)
 		{
-		    if(R828_IQ_Tree(pTuner, Compare_IQ[0].Phase_Y, Compare_IQ[0].Gain_X, 0x09, &Compare_IQ[0]) != RT_Success) //X
+		    if(R828_IQ_Tree(priv, Compare_IQ[0].Phase_Y, Compare_IQ[0].Gain_X, 0x09, &Compare_IQ[0]) != RT_Success) //X
 			  return RT_Fail;
 		}
 		else
 		{
-		   if(R828_IQ_Tree(pTuner, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success) //Y
+		   if(R828_IQ_Tree(priv, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success) //Y
 			return RT_Fail;
 		}
 
@@ -1831,20 +1924,20 @@ R828_ErrCode R828_IQ(void *pTuner, R828_SectType* IQ_Pont)
 
     //Section-9 check
     //if(R828_F_IMR(&Compare_IQ[0]) != RT_Success)
-	if(R828_Section(pTuner, &Compare_IQ[0]) != RT_Success)
+	if(R828_Section(priv, &Compare_IQ[0]) != RT_Success)
 			return RT_Fail;
 
 	*IQ_Pont = Compare_IQ[0];
 
 	//reset gain/phase control setting
-	R828_I2C.RegAddr = 0x08;
-	R828_I2C.Data    = R828_iniArry[3] & 0xC0; //Jason
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x08;
+	priv->R828_I2C.Data    = R828_iniArry[3] & 0xC0; //Jason
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
-	R828_I2C.RegAddr = 0x09;
-	R828_I2C.Data    = R828_iniArry[4] & 0xC0;
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x09;
+	priv->R828_I2C.Data    = R828_iniArry[4] & 0xC0;
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	return RT_Success;
@@ -1859,7 +1952,7 @@ R828_ErrCode R828_IQ(void *pTuner, R828_SectType* IQ_Pont)
 //        CompareTree: 3 IMR trace and results
 // output: TREU or FALSE
 //--------------------------------------------------------------------------------------------
-R828_ErrCode R828_IQ_Tree(void *pTuner, UINT8 FixPot, UINT8 FlucPot, UINT8 PotReg, R828_SectType* CompareTree)
+R828_ErrCode R828_IQ_Tree(struct r820t_state *priv, UINT8 FixPot, UINT8 FlucPot, UINT8 PotReg, R828_SectType* CompareTree)
 {
 	UINT8 TreeCount;
 	UINT8 TreeTimes;
@@ -1878,17 +1971,17 @@ R828_ErrCode R828_IQ_Tree(void *pTuner, UINT8 FixPot, UINT8 FlucPot, UINT8 PotRe
 
 	for(TreeCount = 0;TreeCount < TreeTimes;TreeCount ++)
 	{
-		R828_I2C.RegAddr = PotReg;
-		R828_I2C.Data    = FixPot;
-		if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_I2C.RegAddr = PotReg;
+		priv->R828_I2C.Data    = FixPot;
+		if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
 
-		R828_I2C.RegAddr = PntReg;
-		R828_I2C.Data    = FlucPot;
-		if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_I2C.RegAddr = PntReg;
+		priv->R828_I2C.Data    = FlucPot;
+		if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
 
-		if(R828_Muti_Read(pTuner, 0x01, &CompareTree[TreeCount].Value) != RT_Success)
+		if(R828_Muti_Read(priv, 0x01, &CompareTree[TreeCount].Value) != RT_Success)
 			return RT_Fail;
 	
 		if(PotReg == 0x08)
@@ -1960,7 +2053,7 @@ R828_ErrCode R828_CompreCor(R828_SectType* CorArry)
 //        Pace: gain or phase register
 // output: TRUE or FALSE 
 //-------------------------------------------------------------------------------------//
-R828_ErrCode R828_CompreStep(void *pTuner, R828_SectType* StepArry, UINT8 Pace)
+R828_ErrCode R828_CompreStep(struct r820t_state *priv, R828_SectType* StepArry, UINT8 Pace)
 {
 	//UINT8 StepCount = 0;
 	R828_SectType StepTemp;
@@ -1976,17 +2069,17 @@ R828_ErrCode R828_CompreStep(void *pTuner, R828_SectType* StepArry, UINT8 Pace)
 		else
 			StepTemp.Phase_Y ++;
 	
-		R828_I2C.RegAddr = 0x08;
-		R828_I2C.Data    = StepTemp.Gain_X ;
-		if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_I2C.RegAddr = 0x08;
+		priv->R828_I2C.Data    = StepTemp.Gain_X ;
+		if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
 
-		R828_I2C.RegAddr = 0x09;
-		R828_I2C.Data    = StepTemp.Phase_Y;
-		if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_I2C.RegAddr = 0x09;
+		priv->R828_I2C.Data    = StepTemp.Phase_Y;
+		if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
 
-		if(R828_Muti_Read(pTuner, 0x01, &StepTemp.Value) != RT_Success)
+		if(R828_Muti_Read(priv, 0x01, &StepTemp.Value) != RT_Success)
 			return RT_Fail;
 
 		if(StepTemp.Value <= StepArry[0].Value)
@@ -2011,7 +2104,7 @@ R828_ErrCode R828_CompreStep(void *pTuner, R828_SectType* StepArry, UINT8 Pace)
 //        IMR_Result_Data: result 
 // output: TRUE or FALSE
 //-----------------------------------------------------------------------------------/
-R828_ErrCode R828_Muti_Read(void *pTuner, UINT8 IMR_Reg, UINT16* IMR_Result_Data)  //jason modified
+R828_ErrCode R828_Muti_Read(struct r820t_state *priv, UINT8 IMR_Reg, UINT16* IMR_Result_Data)  //jason modified
 {
 	UINT8 ReadCount;
 	UINT16 ReadAmount;
@@ -2025,16 +2118,16 @@ R828_ErrCode R828_Muti_Read(void *pTuner, UINT8 IMR_Reg, UINT16* IMR_Result_Data
 	ReadMin = 255;
 	ReadData = 0;
 
-    R828_Delay_MS(pTuner, 5);
+    R828_Delay_MS(priv, 5);
 	
 	for(ReadCount = 0;ReadCount < 6;ReadCount ++)
 	{
-		R828_I2C_Len.RegAddr = 0x00;
-		R828_I2C_Len.Len     = IMR_Reg + 1;  //IMR_Reg = 0x01
-		if(I2C_Read_Len(pTuner, &R828_I2C_Len) != RT_Success)
+		priv->R828_I2C_Len.RegAddr = 0x00;
+		priv->R828_I2C_Len.Len     = IMR_Reg + 1;  //IMR_Reg = 0x01
+		if(I2C_Read_Len(priv, &priv->R828_I2C_Len) != RT_Success)
 			return RT_Fail;
 
-		ReadData = R828_I2C_Len.Data[1];
+		ReadData = priv->R828_I2C_Len.Data[1];
 		
 		ReadAmount = ReadAmount + (UINT16)ReadData;
 		
@@ -2049,7 +2142,7 @@ R828_ErrCode R828_Muti_Read(void *pTuner, UINT8 IMR_Reg, UINT16* IMR_Result_Data
 	return RT_Success;
 }
 
-R828_ErrCode R828_Section(void *pTuner, R828_SectType* IQ_Pont)
+R828_ErrCode R828_Section(struct r820t_state *priv, R828_SectType* IQ_Pont)
 {
 	R828_SectType Compare_IQ[3];
 	R828_SectType Compare_Bet[3];
@@ -2069,7 +2162,7 @@ R828_ErrCode R828_Section(void *pTuner, R828_SectType* IQ_Pont)
 		Compare_IQ[0].Gain_X  = IQ_Pont->Gain_X - 1;  //left point
 	Compare_IQ[0].Phase_Y = IQ_Pont->Phase_Y;
 
-	if(R828_IQ_Tree(pTuner, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success)  // y-direction
+	if(R828_IQ_Tree(priv, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success)  // y-direction
 		return RT_Fail;
 
 	if(R828_CompreCor(&Compare_IQ[0]) != RT_Success)
@@ -2083,7 +2176,7 @@ R828_ErrCode R828_Section(void *pTuner, R828_SectType* IQ_Pont)
 	Compare_IQ[0].Gain_X = IQ_Pont->Gain_X;
 	Compare_IQ[0].Phase_Y = IQ_Pont->Phase_Y;
 
-	if(R828_IQ_Tree(pTuner, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success)
+	if(R828_IQ_Tree(priv, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success)
 		return RT_Fail;
 
 	if(R828_CompreCor(&Compare_IQ[0]) != RT_Success)
@@ -2100,7 +2193,7 @@ R828_ErrCode R828_Section(void *pTuner, R828_SectType* IQ_Pont)
 	    Compare_IQ[0].Gain_X = IQ_Pont->Gain_X + 1;
 	Compare_IQ[0].Phase_Y = IQ_Pont->Phase_Y;
 
-	if(R828_IQ_Tree(pTuner, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success)
+	if(R828_IQ_Tree(priv, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success)
 		return RT_Fail;
 
 	if(R828_CompreCor(&Compare_IQ[0]) != RT_Success)
@@ -2118,7 +2211,7 @@ R828_ErrCode R828_Section(void *pTuner, R828_SectType* IQ_Pont)
 	return RT_Success;
 }
 
-R828_ErrCode R828_IMR_Cross(void *pTuner, R828_SectType* IQ_Pont, UINT8* X_Direct)
+R828_ErrCode R828_IMR_Cross(struct r820t_state *priv, R828_SectType* IQ_Pont, UINT8* X_Direct)
 {
 
 	R828_SectType Compare_Cross[5]; //(0,0)(0,Q-1)(0,I-1)(Q-1,0)(I-1,0)
@@ -2167,17 +2260,17 @@ R828_ErrCode R828_IMR_Cross(void *pTuner, R828_SectType* IQ_Pont, UINT8* X_Direc
 		  Compare_Cross[CrossCount].Phase_Y = Reg09;
 		}
 
-    	R828_I2C.RegAddr = 0x08;
-	    R828_I2C.Data    = Compare_Cross[CrossCount].Gain_X;
-	    if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+    	priv->R828_I2C.RegAddr = 0x08;
+	    priv->R828_I2C.Data    = Compare_Cross[CrossCount].Gain_X;
+	    if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		   return RT_Fail;
 
-	    R828_I2C.RegAddr = 0x09;
-	    R828_I2C.Data    = Compare_Cross[CrossCount].Phase_Y;
-	    if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	    priv->R828_I2C.RegAddr = 0x09;
+	    priv->R828_I2C.Data    = Compare_Cross[CrossCount].Phase_Y;
+	    if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		  return RT_Fail;
 	
-        if(R828_Muti_Read(pTuner, 0x01, &Compare_Cross[CrossCount].Value) != RT_Success)
+        if(R828_Muti_Read(priv, 0x01, &Compare_Cross[CrossCount].Value) != RT_Success)
 		  return RT_Fail;
 
 		if( Compare_Cross[CrossCount].Value < Compare_Temp.Value)
@@ -2229,7 +2322,7 @@ R828_ErrCode R828_IMR_Cross(void *pTuner, R828_SectType* IQ_Pont, UINT8* X_Direc
 //                 will be updated to final best point                 
 // output: TRUE or FALSE
 //----------------------------------------------------------------------------------------//
-R828_ErrCode R828_F_IMR(void *pTuner, R828_SectType* IQ_Pont)
+R828_ErrCode R828_F_IMR(struct r820t_state *priv, R828_SectType* IQ_Pont)
 {
 	R828_SectType Compare_IQ[3];
 	R828_SectType Compare_Bet[3];
@@ -2242,14 +2335,14 @@ R828_ErrCode R828_F_IMR(void *pTuner, R828_SectType* IQ_Pont)
 	//VGA
 	for(VGA_Count = 12;VGA_Count < 16;VGA_Count ++)
 	{
-		R828_I2C.RegAddr = 0x0C;
-        R828_I2C.Data    = (R828_Arry[7] & 0xF0) + VGA_Count;
-		if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_I2C.RegAddr = 0x0C;
+        priv->R828_I2C.Data    = (priv->R828_Arry[7] & 0xF0) + VGA_Count;
+		if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
 
-		R828_Delay_MS(pTuner, 10);
+		R828_Delay_MS(priv, 10);
 		
-		if(R828_Muti_Read(pTuner, 0x01, &VGA_Read) != RT_Success)
+		if(R828_Muti_Read(priv, 0x01, &VGA_Read) != RT_Success)
 			return RT_Fail;
 
 		if(VGA_Read > 40*4)
@@ -2265,7 +2358,7 @@ R828_ErrCode R828_F_IMR(void *pTuner, R828_SectType* IQ_Pont)
 		Compare_IQ[0].Gain_X  = IQ_Pont->Gain_X - 1;  //left point
 	Compare_IQ[0].Phase_Y = IQ_Pont->Phase_Y;
 
-	if(R828_IQ_Tree(pTuner, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success)  // y-direction
+	if(R828_IQ_Tree(priv, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success)  // y-direction
 		return RT_Fail;
 
 	if(R828_CompreCor(&Compare_IQ[0]) != RT_Success)
@@ -2279,7 +2372,7 @@ R828_ErrCode R828_F_IMR(void *pTuner, R828_SectType* IQ_Pont)
 	Compare_IQ[0].Gain_X = IQ_Pont->Gain_X;
 	Compare_IQ[0].Phase_Y = IQ_Pont->Phase_Y;
 
-	if(R828_IQ_Tree(pTuner, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success)
+	if(R828_IQ_Tree(priv, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success)
 		return RT_Fail;
 
 	if(R828_CompreCor(&Compare_IQ[0]) != RT_Success)
@@ -2296,7 +2389,7 @@ R828_ErrCode R828_F_IMR(void *pTuner, R828_SectType* IQ_Pont)
 	    Compare_IQ[0].Gain_X = IQ_Pont->Gain_X + 1;
 	Compare_IQ[0].Phase_Y = IQ_Pont->Phase_Y;
 
-	if(R828_IQ_Tree(pTuner, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success)
+	if(R828_IQ_Tree(priv, Compare_IQ[0].Gain_X, Compare_IQ[0].Phase_Y, 0x08, &Compare_IQ[0]) != RT_Success)
 		return RT_Fail;
 
 	if(R828_CompreCor(&Compare_IQ[0]) != RT_Success)
@@ -2314,22 +2407,22 @@ R828_ErrCode R828_F_IMR(void *pTuner, R828_SectType* IQ_Pont)
 	return RT_Success;
 }
 
-R828_ErrCode R828_GPIO(void *pTuner, R828_GPIO_Type R828_GPIO_Conrl)
+R828_ErrCode R828_GPIO(struct r820t_state *priv, R828_GPIO_Type R828_GPIO_Conrl)
 {
 	if(R828_GPIO_Conrl == HI_SIG)
-		R828_Arry[10] |= 0x01;
+		priv->R828_Arry[10] |= 0x01;
 	else
-		R828_Arry[10] &= 0xFE;
+		priv->R828_Arry[10] &= 0xFE;
 
-	R828_I2C.RegAddr = 0x0F;
-	R828_I2C.Data    = R828_Arry[10];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x0F;
+	priv->R828_I2C.Data    = priv->R828_Arry[10];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	return RT_Success;
 }
 
-R828_ErrCode R828_SetStandard(void *pTuner, R828_Standard_Type RT_Standard)
+R828_ErrCode R828_SetStandard(struct r820t_state *priv, R828_Standard_Type RT_Standard)
 {
 
 	// Used Normal Arry to Modify
@@ -2338,238 +2431,238 @@ R828_ErrCode R828_SetStandard(void *pTuner, R828_Standard_Type RT_Standard)
 	ArrayNum = 27;
 	for(ArrayNum=0;ArrayNum<27;ArrayNum++)
 	{
-		R828_Arry[ArrayNum] = R828_iniArry[ArrayNum];
+		priv->R828_Arry[ArrayNum] = R828_iniArry[ArrayNum];
 	}
 
 
 	// Record Init Flag & Xtal_check Result
-	if(R828_IMR_done_flag == TRUE)
-        R828_Arry[7]    = (R828_Arry[7] & 0xF0) | 0x01 | (Xtal_cap_sel<<1);
+	if(priv->R828_IMR_done_flag == TRUE)
+        priv->R828_Arry[7]    = (priv->R828_Arry[7] & 0xF0) | 0x01 | (priv->Xtal_cap_sel<<1);
 	else
-	    R828_Arry[7]    = (R828_Arry[7] & 0xF0) | 0x00;
+	    priv->R828_Arry[7]    = (priv->R828_Arry[7] & 0xF0) | 0x00;
 
-	R828_I2C.RegAddr = 0x0C;
-    R828_I2C.Data    = R828_Arry[7];
-    if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x0C;
+    priv->R828_I2C.Data    = priv->R828_Arry[7];
+    if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
        return RT_Fail;
 
 	// Record version
-	R828_I2C.RegAddr = 0x13;
-	R828_Arry[14]    = (R828_Arry[14] & 0xC0) | VER_NUM;
-	R828_I2C.Data    = R828_Arry[14];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x13;
+	priv->R828_Arry[14]    = (priv->R828_Arry[14] & 0xC0) | VER_NUM;
+	priv->R828_I2C.Data    = priv->R828_Arry[14];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 	    return RT_Fail;
 
 
     //for LT Gain test
 	if(RT_Standard > SECAM_L1)
 	{
-		R828_I2C.RegAddr = 0x1D;  //[5:3] LNA TOP
-		R828_I2C.Data = (R828_Arry[24] & 0xC7) | 0x00;
-	    if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_I2C.RegAddr = 0x1D;  //[5:3] LNA TOP
+		priv->R828_I2C.Data = (priv->R828_Arry[24] & 0xC7) | 0x00;
+	    if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		    return RT_Fail;
 
 		//R828_Delay_MS(1);
 	}
 
 	// Look Up System Dependent Table
-	Sys_Info1 = R828_Sys_Sel(RT_Standard);
-	R828_IF_khz = Sys_Info1.IF_KHz;
-	R828_CAL_LO_khz = Sys_Info1.FILT_CAL_LO;
+	priv->Sys_Info1 = R828_Sys_Sel(RT_Standard);
+	priv->R828_IF_khz = priv->Sys_Info1.IF_KHz;
+	priv->R828_CAL_LO_khz = priv->Sys_Info1.FILT_CAL_LO;
 
 	// Filter Calibration
-    if(R828_Fil_Cal_flag[RT_Standard] == FALSE)
+    if(priv->R828_Fil_Cal_flag[RT_Standard] == FALSE)
 	{
 		// do filter calibration 
-		if(R828_Filt_Cal(pTuner, Sys_Info1.FILT_CAL_LO,Sys_Info1.BW) != RT_Success)
+		if(R828_Filt_Cal(priv, priv->Sys_Info1.FILT_CAL_LO,priv->Sys_Info1.BW) != RT_Success)
 		    return RT_Fail;
 
 
 		// read and set filter code
-		R828_I2C_Len.RegAddr = 0x00;
-		R828_I2C_Len.Len     = 5;
-		if(I2C_Read_Len(pTuner, &R828_I2C_Len) != RT_Success)
+		priv->R828_I2C_Len.RegAddr = 0x00;
+		priv->R828_I2C_Len.Len     = 5;
+		if(I2C_Read_Len(priv, &priv->R828_I2C_Len) != RT_Success)
 			return RT_Fail;
 
-		R828_Fil_Cal_code[RT_Standard] = R828_I2C_Len.Data[4] & 0x0F;
+		priv->R828_Fil_Cal_code[RT_Standard] = priv->R828_I2C_Len.Data[4] & 0x0F;
 
 		//Filter Cali. Protection
-		if(R828_Fil_Cal_code[RT_Standard]==0 || R828_Fil_Cal_code[RT_Standard]==15)
+		if(priv->R828_Fil_Cal_code[RT_Standard]==0 || priv->R828_Fil_Cal_code[RT_Standard]==15)
 		{
-		   if(R828_Filt_Cal(pTuner, Sys_Info1.FILT_CAL_LO,Sys_Info1.BW) != RT_Success)
+		   if(R828_Filt_Cal(priv, priv->Sys_Info1.FILT_CAL_LO,priv->Sys_Info1.BW) != RT_Success)
 			   return RT_Fail;
 
-		   R828_I2C_Len.RegAddr = 0x00;
-		   R828_I2C_Len.Len     = 5;
-		   if(I2C_Read_Len(pTuner, &R828_I2C_Len) != RT_Success)
+		   priv->R828_I2C_Len.RegAddr = 0x00;
+		   priv->R828_I2C_Len.Len     = 5;
+		   if(I2C_Read_Len(priv, &priv->R828_I2C_Len) != RT_Success)
 			   return RT_Fail;
 
-		   R828_Fil_Cal_code[RT_Standard] = R828_I2C_Len.Data[4] & 0x0F;
+		   priv->R828_Fil_Cal_code[RT_Standard] = priv->R828_I2C_Len.Data[4] & 0x0F;
 
-		   if(R828_Fil_Cal_code[RT_Standard]==15) //narrowest
-			   R828_Fil_Cal_code[RT_Standard] = 0;
+		   if(priv->R828_Fil_Cal_code[RT_Standard]==15) //narrowest
+			   priv->R828_Fil_Cal_code[RT_Standard] = 0;
 			   
 		}
-        R828_Fil_Cal_flag[RT_Standard] = TRUE;
+        priv->R828_Fil_Cal_flag[RT_Standard] = TRUE;
 	}
 
 	// Set Filter Q
-	R828_Arry[5]  = (R828_Arry[5] & 0xE0) | Sys_Info1.FILT_Q | R828_Fil_Cal_code[RT_Standard];  
-	R828_I2C.RegAddr  = 0x0A;
-	R828_I2C.Data     = R828_Arry[5];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_Arry[5]  = (priv->R828_Arry[5] & 0xE0) | priv->Sys_Info1.FILT_Q | priv->R828_Fil_Cal_code[RT_Standard];  
+	priv->R828_I2C.RegAddr  = 0x0A;
+	priv->R828_I2C.Data     = priv->R828_Arry[5];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	// Set BW, Filter_gain, & HP corner
-	R828_Arry[6]= (R828_Arry[6] & 0x10) | Sys_Info1.HP_COR;
-	R828_I2C.RegAddr  = 0x0B;
-	R828_I2C.Data     = R828_Arry[6];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_Arry[6]= (priv->R828_Arry[6] & 0x10) | priv->Sys_Info1.HP_COR;
+	priv->R828_I2C.RegAddr  = 0x0B;
+	priv->R828_I2C.Data     = priv->R828_Arry[6];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	// Set Img_R
-	R828_Arry[2]  = (R828_Arry[2] & 0x7F) | Sys_Info1.IMG_R;  
-	R828_I2C.RegAddr  = 0x07;
-	R828_I2C.Data     = R828_Arry[2];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_Arry[2]  = (priv->R828_Arry[2] & 0x7F) | priv->Sys_Info1.IMG_R;  
+	priv->R828_I2C.RegAddr  = 0x07;
+	priv->R828_I2C.Data     = priv->R828_Arry[2];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 
 	// Set filt_3dB, V6MHz
-	R828_Arry[1]  = (R828_Arry[1] & 0xCF) | Sys_Info1.FILT_GAIN;  
-	R828_I2C.RegAddr  = 0x06;
-	R828_I2C.Data     = R828_Arry[1];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_Arry[1]  = (priv->R828_Arry[1] & 0xCF) | priv->Sys_Info1.FILT_GAIN;  
+	priv->R828_I2C.RegAddr  = 0x06;
+	priv->R828_I2C.Data     = priv->R828_Arry[1];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
     //channel filter extension
-	R828_Arry[25]  = (R828_Arry[25] & 0x9F) | Sys_Info1.EXT_ENABLE;  
-	R828_I2C.RegAddr  = 0x1E;
-	R828_I2C.Data     = R828_Arry[25];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_Arry[25]  = (priv->R828_Arry[25] & 0x9F) | priv->Sys_Info1.EXT_ENABLE;  
+	priv->R828_I2C.RegAddr  = 0x1E;
+	priv->R828_I2C.Data     = priv->R828_Arry[25];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 
 	//Loop through
-	R828_Arry[0]  = (R828_Arry[0] & 0x7F) | Sys_Info1.LOOP_THROUGH;  
-	R828_I2C.RegAddr  = 0x05;
-	R828_I2C.Data     = R828_Arry[0];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_Arry[0]  = (priv->R828_Arry[0] & 0x7F) | priv->Sys_Info1.LOOP_THROUGH;  
+	priv->R828_I2C.RegAddr  = 0x05;
+	priv->R828_I2C.Data     = priv->R828_Arry[0];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	//Loop through attenuation
-	R828_Arry[26]  = (R828_Arry[26] & 0x7F) | Sys_Info1.LT_ATT;  
-	R828_I2C.RegAddr  = 0x1F;
-	R828_I2C.Data     = R828_Arry[26];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_Arry[26]  = (priv->R828_Arry[26] & 0x7F) | priv->Sys_Info1.LT_ATT;  
+	priv->R828_I2C.RegAddr  = 0x1F;
+	priv->R828_I2C.Data     = priv->R828_Arry[26];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
     //filter extention widest
-	R828_Arry[10]  = (R828_Arry[10] & 0x7F) | Sys_Info1.FLT_EXT_WIDEST;  
-	R828_I2C.RegAddr  = 0x0F;
-	R828_I2C.Data     = R828_Arry[10];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_Arry[10]  = (priv->R828_Arry[10] & 0x7F) | priv->Sys_Info1.FLT_EXT_WIDEST;  
+	priv->R828_I2C.RegAddr  = 0x0F;
+	priv->R828_I2C.Data     = priv->R828_Arry[10];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	//RF poly filter current
-	R828_Arry[20]  = (R828_Arry[20] & 0x9F) | Sys_Info1.POLYFIL_CUR;  
-	R828_I2C.RegAddr  = 0x19;
-	R828_I2C.Data     = R828_Arry[20];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_Arry[20]  = (priv->R828_Arry[20] & 0x9F) | priv->Sys_Info1.POLYFIL_CUR;  
+	priv->R828_I2C.RegAddr  = 0x19;
+	priv->R828_I2C.Data     = priv->R828_Arry[20];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	return RT_Success;
 }
 
-R828_ErrCode R828_Filt_Cal(void *pTuner, UINT32 Cal_Freq,BW_Type R828_BW)
+R828_ErrCode R828_Filt_Cal(struct r820t_state *priv, UINT32 Cal_Freq,BW_Type R828_BW)
 {
 	  //set in Sys_sel()
 	/*
 	if(R828_BW == BW_8M)
 	{
 		//set filt_cap = no cap
-		R828_I2C.RegAddr = 0x0B;  //reg11
-		R828_Arry[6]   &= 0x9F;  //filt_cap = no cap
-		R828_I2C.Data    = R828_Arry[6];		
+		priv->R828_I2C.RegAddr = 0x0B;  //reg11
+		priv->R828_Arry[6]   &= 0x9F;  //filt_cap = no cap
+		priv->R828_I2C.Data    = priv->R828_Arry[6];		
 	}
 	else if(R828_BW == BW_7M)
 	{
 		//set filt_cap = +1 cap
-		R828_I2C.RegAddr = 0x0B;  //reg11
-		R828_Arry[6]   &= 0x9F;  //filt_cap = no cap
-		R828_Arry[6]   |= 0x20;  //filt_cap = +1 cap
-		R828_I2C.Data    = R828_Arry[6];		
+		priv->R828_I2C.RegAddr = 0x0B;  //reg11
+		priv->R828_Arry[6]   &= 0x9F;  //filt_cap = no cap
+		priv->R828_Arry[6]   |= 0x20;  //filt_cap = +1 cap
+		priv->R828_I2C.Data    = priv->R828_Arry[6];		
 	}
 	else if(R828_BW == BW_6M)
 	{
 		//set filt_cap = +2 cap
-		R828_I2C.RegAddr = 0x0B;  //reg11
-		R828_Arry[6]   &= 0x9F;  //filt_cap = no cap
-		R828_Arry[6]   |= 0x60;  //filt_cap = +2 cap
-		R828_I2C.Data    = R828_Arry[6];		
+		priv->R828_I2C.RegAddr = 0x0B;  //reg11
+		priv->R828_Arry[6]   &= 0x9F;  //filt_cap = no cap
+		priv->R828_Arry[6]   |= 0x60;  //filt_cap = +2 cap
+		priv->R828_I2C.Data    = priv->R828_Arry[6];		
 	}
 
 
-    if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+    if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;	
 */
 
     // Set filt_cap
-	R828_I2C.RegAddr  = 0x0B;
-	R828_Arry[6]= (R828_Arry[6] & 0x9F) | (Sys_Info1.HP_COR & 0x60);
-	R828_I2C.Data     = R828_Arry[6];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr  = 0x0B;
+	priv->R828_Arry[6]= (priv->R828_Arry[6] & 0x9F) | (priv->Sys_Info1.HP_COR & 0x60);
+	priv->R828_I2C.Data     = priv->R828_Arry[6];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 
 	//set cali clk =on
-	R828_I2C.RegAddr = 0x0F;  //reg15
-	R828_Arry[10]   |= 0x04;  //calibration clk=on
-	R828_I2C.Data    = R828_Arry[10];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x0F;  //reg15
+	priv->R828_Arry[10]   |= 0x04;  //calibration clk=on
+	priv->R828_I2C.Data    = priv->R828_Arry[10];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	//X'tal cap 0pF for PLL
-	R828_I2C.RegAddr = 0x10;
-	R828_Arry[11]    = (R828_Arry[11] & 0xFC) | 0x00;
-	R828_I2C.Data    = R828_Arry[11];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x10;
+	priv->R828_Arry[11]    = (priv->R828_Arry[11] & 0xFC) | 0x00;
+	priv->R828_I2C.Data    = priv->R828_Arry[11];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	//Set PLL Freq = Filter Cali Freq
-	if(R828_PLL(pTuner, Cal_Freq * 1000, STD_SIZE) != RT_Success)
+	if(R828_PLL(priv, Cal_Freq * 1000, STD_SIZE) != RT_Success)
 		return RT_Fail;
 
 	//Start Trigger
-	R828_I2C.RegAddr = 0x0B;	//reg11
-	R828_Arry[6]   |= 0x10;	    //vstart=1	
-	R828_I2C.Data    = R828_Arry[6];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x0B;	//reg11
+	priv->R828_Arry[6]   |= 0x10;	    //vstart=1	
+	priv->R828_I2C.Data    = priv->R828_Arry[6];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	//delay 0.5ms
-	R828_Delay_MS(pTuner, 1);  
+	R828_Delay_MS(priv, 1);  
 
 	//Stop Trigger
-	R828_I2C.RegAddr = 0x0B;
-	R828_Arry[6]   &= 0xEF;     //vstart=0
-	R828_I2C.Data    = R828_Arry[6];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x0B;
+	priv->R828_Arry[6]   &= 0xEF;     //vstart=0
+	priv->R828_I2C.Data    = priv->R828_Arry[6];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 
 	//set cali clk =off
-	R828_I2C.RegAddr  = 0x0F;	//reg15
-	R828_Arry[10]    &= 0xFB;	//calibration clk=off
-	R828_I2C.Data     = R828_Arry[10];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr  = 0x0F;	//reg15
+	priv->R828_Arry[10]    &= 0xFB;	//calibration clk=off
+	priv->R828_I2C.Data     = priv->R828_Arry[10];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	return RT_Success;
 
 }
 
-R828_ErrCode R828_SetFrequency(void *pTuner, R828_Set_Info R828_INFO, R828_SetFreq_Type R828_SetFreqMode)
+R828_ErrCode R828_SetFrequency(struct r820t_state *priv, R828_Set_Info R828_INFO, R828_SetFreq_Type R828_SetFreqMode)
 {
 	UINT32	LO_Hz;
 
@@ -2582,105 +2675,105 @@ R828_ErrCode R828_SetFrequency(void *pTuner, R828_Set_Info R828_INFO, R828_SetFr
 #endif
 
 	 if(R828_INFO.R828_Standard==SECAM_L1)
-		LO_Hz = R828_INFO.RF_Hz - (Sys_Info1.IF_KHz * 1000);
+		LO_Hz = R828_INFO.RF_Hz - (priv->Sys_Info1.IF_KHz * 1000);
 	 else
-		LO_Hz = R828_INFO.RF_Hz + (Sys_Info1.IF_KHz * 1000);
+		LO_Hz = R828_INFO.RF_Hz + (priv->Sys_Info1.IF_KHz * 1000);
 
 	 //Set MUX dependent var. Must do before PLL( ) 
-     if(R828_MUX(pTuner, LO_Hz/1000) != RT_Success)
+     if(R828_MUX(priv, LO_Hz/1000) != RT_Success)
         return RT_Fail;
 
      //Set PLL
-     if(R828_PLL(pTuner, LO_Hz, R828_INFO.R828_Standard) != RT_Success)
+     if(R828_PLL(priv, LO_Hz, R828_INFO.R828_Standard) != RT_Success)
         return RT_Fail;
 
-     R828_IMR_point_num = Freq_Info1.IMR_MEM;
+     priv->R828_IMR_point_num = priv->Freq_Info1.IMR_MEM;
 
 
      //Set TOP,VTH,VTL
-     SysFreq_Info1 = R828_SysFreq_Sel(R828_INFO.R828_Standard, R828_INFO.RF_KHz);
+     priv->SysFreq_Info1 = R828_SysFreq_Sel(R828_INFO.R828_Standard, R828_INFO.RF_KHz);
 
     
      // write DectBW, pre_dect_TOP
-     R828_Arry[24] = (R828_Arry[24] & 0x38) | (SysFreq_Info1.LNA_TOP & 0xC7);
-     R828_I2C.RegAddr = 0x1D;
-     R828_I2C.Data = R828_Arry[24];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+     priv->R828_Arry[24] = (priv->R828_Arry[24] & 0x38) | (priv->SysFreq_Info1.LNA_TOP & 0xC7);
+     priv->R828_I2C.RegAddr = 0x1D;
+     priv->R828_I2C.Data = priv->R828_Arry[24];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
          return RT_Fail;
 
      // write MIXER TOP, TOP+-1
-     R828_Arry[23] = (R828_Arry[23] & 0x07) | (SysFreq_Info1.MIXER_TOP & 0xF8); 
-     R828_I2C.RegAddr = 0x1C;
-     R828_I2C.Data = R828_Arry[23];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+     priv->R828_Arry[23] = (priv->R828_Arry[23] & 0x07) | (priv->SysFreq_Info1.MIXER_TOP & 0xF8); 
+     priv->R828_I2C.RegAddr = 0x1C;
+     priv->R828_I2C.Data = priv->R828_Arry[23];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
         return RT_Fail;
 
 
      // write LNA VTHL
-     R828_Arry[8] = (R828_Arry[8] & 0x00) | SysFreq_Info1.LNA_VTH_L;
-     R828_I2C.RegAddr = 0x0D;
-     R828_I2C.Data = R828_Arry[8];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+     priv->R828_Arry[8] = (priv->R828_Arry[8] & 0x00) | priv->SysFreq_Info1.LNA_VTH_L;
+     priv->R828_I2C.RegAddr = 0x0D;
+     priv->R828_I2C.Data = priv->R828_Arry[8];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
         return RT_Fail;
 
      // write MIXER VTHL
-     R828_Arry[9] = (R828_Arry[9] & 0x00) | SysFreq_Info1.MIXER_VTH_L;
-     R828_I2C.RegAddr = 0x0E;
-     R828_I2C.Data = R828_Arry[9];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+     priv->R828_Arry[9] = (priv->R828_Arry[9] & 0x00) | priv->SysFreq_Info1.MIXER_VTH_L;
+     priv->R828_I2C.RegAddr = 0x0E;
+     priv->R828_I2C.Data = priv->R828_Arry[9];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
         return RT_Fail;
 
 	 // Cable-1/Air in 
-	 R828_I2C.RegAddr = 0x05;
-	 R828_Arry[0] &= 0x9F;
-	 R828_Arry[0] |= SysFreq_Info1.AIR_CABLE1_IN;
-	 R828_I2C.Data = R828_Arry[0];
-	 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	 priv->R828_I2C.RegAddr = 0x05;
+	 priv->R828_Arry[0] &= 0x9F;
+	 priv->R828_Arry[0] |= priv->SysFreq_Info1.AIR_CABLE1_IN;
+	 priv->R828_I2C.Data = priv->R828_Arry[0];
+	 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	 // Cable-2 in 
-	 R828_I2C.RegAddr = 0x06;
-	 R828_Arry[1] &= 0xF7;
-	 R828_Arry[1] |= SysFreq_Info1.CABLE2_IN;
-	 R828_I2C.Data = R828_Arry[1];
-	 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	 priv->R828_I2C.RegAddr = 0x06;
+	 priv->R828_Arry[1] &= 0xF7;
+	 priv->R828_Arry[1] |= priv->SysFreq_Info1.CABLE2_IN;
+	 priv->R828_I2C.Data = priv->R828_Arry[1];
+	 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
      //CP current
-	 R828_I2C.RegAddr = 0x11;
-	 R828_Arry[12] &= 0xC7;
-	 R828_Arry[12] |= SysFreq_Info1.CP_CUR;	
-	 R828_I2C.Data = R828_Arry[12];
-	 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	 priv->R828_I2C.RegAddr = 0x11;
+	 priv->R828_Arry[12] &= 0xC7;
+	 priv->R828_Arry[12] |= priv->SysFreq_Info1.CP_CUR;	
+	 priv->R828_I2C.Data = priv->R828_Arry[12];
+	 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		 return RT_Fail;	
 
 	 //div buffer current
-	 R828_I2C.RegAddr = 0x17;
-	 R828_Arry[18] &= 0xCF;
-	 R828_Arry[18] |= SysFreq_Info1.DIV_BUF_CUR;
-	 R828_I2C.Data = R828_Arry[18];
-	 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	 priv->R828_I2C.RegAddr = 0x17;
+	 priv->R828_Arry[18] &= 0xCF;
+	 priv->R828_Arry[18] |= priv->SysFreq_Info1.DIV_BUF_CUR;
+	 priv->R828_I2C.Data = priv->R828_Arry[18];
+	 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		 return RT_Fail;	
 
 	 // Set channel filter current 
-	 R828_I2C.RegAddr  = 0x0A;
-	 R828_Arry[5]  = (R828_Arry[5] & 0x9F) | SysFreq_Info1.FILTER_CUR;  
-	 R828_I2C.Data     = R828_Arry[5];
-     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	 priv->R828_I2C.RegAddr  = 0x0A;
+	 priv->R828_Arry[5]  = (priv->R828_Arry[5] & 0x9F) | priv->SysFreq_Info1.FILTER_CUR;  
+	 priv->R828_I2C.Data     = priv->R828_Arry[5];
+     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
          return RT_Fail;
 
      //Air-In only for Astrometa
-	 R828_Arry[0] =  (R828_Arry[0] & 0x9F) | 0x00;
-     R828_Arry[1] =  (R828_Arry[1] & 0xF7) | 0x00;
+	 priv->R828_Arry[0] =  (priv->R828_Arry[0] & 0x9F) | 0x00;
+     priv->R828_Arry[1] =  (priv->R828_Arry[1] & 0xF7) | 0x00;
 
-	 R828_I2C.RegAddr = 0x05;
-     R828_I2C.Data = R828_Arry[0];
-	 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	 priv->R828_I2C.RegAddr = 0x05;
+     priv->R828_I2C.Data = priv->R828_Arry[0];
+	 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
 
-	 R828_I2C.RegAddr = 0x06;
-     R828_I2C.Data = R828_Arry[1];
-	 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	 priv->R828_I2C.RegAddr = 0x06;
+     priv->R828_I2C.Data = priv->R828_Arry[1];
+	 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
 
      //Set LNA
@@ -2689,97 +2782,97 @@ R828_ErrCode R828_SetFrequency(void *pTuner, R828_Set_Info R828_INFO, R828_SetFr
 
 		 if(R828_SetFreqMode==FAST_MODE)       //FAST mode 
 		 {
-			 //R828_Arry[24] = (R828_Arry[24] & 0xC7) | 0x20; //LNA TOP:4
-			 R828_Arry[24] = (R828_Arry[24] & 0xC7) | 0x00; //LNA TOP:lowest
-			 R828_I2C.RegAddr = 0x1D;
-			 R828_I2C.Data = R828_Arry[24];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 //priv->R828_Arry[24] = (priv->R828_Arry[24] & 0xC7) | 0x20; //LNA TOP:4
+			 priv->R828_Arry[24] = (priv->R828_Arry[24] & 0xC7) | 0x00; //LNA TOP:lowest
+			 priv->R828_I2C.RegAddr = 0x1D;
+			 priv->R828_I2C.Data = priv->R828_Arry[24];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				 return RT_Fail;
 
-			 R828_Arry[23] = (R828_Arry[23] & 0xFB);  // 0: normal mode
-			 R828_I2C.RegAddr = 0x1C;
-			 R828_I2C.Data = R828_Arry[23];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[23] = (priv->R828_Arry[23] & 0xFB);  // 0: normal mode
+			 priv->R828_I2C.RegAddr = 0x1C;
+			 priv->R828_I2C.Data = priv->R828_Arry[23];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 			
-			 R828_Arry[1]  = (R828_Arry[1] & 0xBF);   //0: PRE_DECT off
-			 R828_I2C.RegAddr  = 0x06;
-			 R828_I2C.Data     = R828_Arry[1];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[1]  = (priv->R828_Arry[1] & 0xBF);   //0: PRE_DECT off
+			 priv->R828_I2C.RegAddr  = 0x06;
+			 priv->R828_I2C.Data     = priv->R828_Arry[1];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 
 			 //agc clk 250hz
-			 R828_Arry[21]  = (R828_Arry[21] & 0xCF) | 0x30;
-			 R828_I2C.RegAddr  = 0x1A;
-			 R828_I2C.Data     = R828_Arry[21];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[21]  = (priv->R828_Arry[21] & 0xCF) | 0x30;
+			 priv->R828_I2C.RegAddr  = 0x1A;
+			 priv->R828_I2C.Data     = priv->R828_Arry[21];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 		 }
 		 else  //NORMAL mode
 		 {
 			 			
-			 R828_Arry[24] = (R828_Arry[24] & 0xC7) | 0x00; //LNA TOP:lowest
-			 R828_I2C.RegAddr = 0x1D;
-			 R828_I2C.Data = R828_Arry[24];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[24] = (priv->R828_Arry[24] & 0xC7) | 0x00; //LNA TOP:lowest
+			 priv->R828_I2C.RegAddr = 0x1D;
+			 priv->R828_I2C.Data = priv->R828_Arry[24];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				 return RT_Fail;
 
-			 R828_Arry[23] = (R828_Arry[23] & 0xFB);  // 0: normal mode
-			 R828_I2C.RegAddr = 0x1C;
-			 R828_I2C.Data = R828_Arry[23];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[23] = (priv->R828_Arry[23] & 0xFB);  // 0: normal mode
+			 priv->R828_I2C.RegAddr = 0x1C;
+			 priv->R828_I2C.Data = priv->R828_Arry[23];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 			
-			 R828_Arry[1]  = (R828_Arry[1] & 0xBF);   //0: PRE_DECT off
-			 R828_I2C.RegAddr  = 0x06;
-			 R828_I2C.Data     = R828_Arry[1];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[1]  = (priv->R828_Arry[1] & 0xBF);   //0: PRE_DECT off
+			 priv->R828_I2C.RegAddr  = 0x06;
+			 priv->R828_I2C.Data     = priv->R828_Arry[1];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 
              //agc clk 250hz
-			 R828_Arry[21]  = (R828_Arry[21] & 0xCF) | 0x30;   //250hz
-			 R828_I2C.RegAddr  = 0x1A;
-			 R828_I2C.Data     = R828_Arry[21];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[21]  = (priv->R828_Arry[21] & 0xCF) | 0x30;   //250hz
+			 priv->R828_I2C.RegAddr  = 0x1A;
+			 priv->R828_I2C.Data     = priv->R828_Arry[21];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 
-			 R828_Delay_MS(pTuner, 250);
+			 R828_Delay_MS(priv, 250);
 			 
 			 // PRE_DECT on
 			 /*
-			 R828_Arry[1]  = (R828_Arry[1] & 0xBF) | SysFreq_Info1.PRE_DECT;
-			 R828_I2C.RegAddr  = 0x06;
-			 R828_I2C.Data     = R828_Arry[1];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[1]  = (priv->R828_Arry[1] & 0xBF) | priv->SysFreq_Info1.PRE_DECT;
+			 priv->R828_I2C.RegAddr  = 0x06;
+			 priv->R828_I2C.Data     = priv->R828_Arry[1];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;			 
              */
 			 // write LNA TOP = 3
-			 //R828_Arry[24] = (R828_Arry[24] & 0xC7) | (SysFreq_Info1.LNA_TOP & 0x38);
-			 R828_Arry[24] = (R828_Arry[24] & 0xC7) | 0x18;  //TOP=3
-			 R828_I2C.RegAddr = 0x1D;
-			 R828_I2C.Data = R828_Arry[24];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 //priv->R828_Arry[24] = (priv->R828_Arry[24] & 0xC7) | (priv->SysFreq_Info1.LNA_TOP & 0x38);
+			 priv->R828_Arry[24] = (priv->R828_Arry[24] & 0xC7) | 0x18;  //TOP=3
+			 priv->R828_I2C.RegAddr = 0x1D;
+			 priv->R828_I2C.Data = priv->R828_Arry[24];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				 return RT_Fail;
 
 			 // write discharge mode
-			 R828_Arry[23] = (R828_Arry[23] & 0xFB) | (SysFreq_Info1.MIXER_TOP & 0x04);
-			 R828_I2C.RegAddr = 0x1C;
-			 R828_I2C.Data = R828_Arry[23];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[23] = (priv->R828_Arry[23] & 0xFB) | (priv->SysFreq_Info1.MIXER_TOP & 0x04);
+			 priv->R828_I2C.RegAddr = 0x1C;
+			 priv->R828_I2C.Data = priv->R828_Arry[23];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 
 			 // LNA discharge current
-			 R828_Arry[25]  = (R828_Arry[25] & 0xE0) | SysFreq_Info1.LNA_DISCHARGE;
-			 R828_I2C.RegAddr  = 0x1E;
-			 R828_I2C.Data     = R828_Arry[25];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[25]  = (priv->R828_Arry[25] & 0xE0) | priv->SysFreq_Info1.LNA_DISCHARGE;
+			 priv->R828_I2C.RegAddr  = 0x1E;
+			 priv->R828_I2C.Data     = priv->R828_Arry[25];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 
 			 //agc clk 60hz 
-			 R828_Arry[21]  = (R828_Arry[21] & 0xCF) | 0x20;
-			 R828_I2C.RegAddr  = 0x1A;
-			 R828_I2C.Data     = R828_Arry[21];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[21]  = (priv->R828_Arry[21] & 0xCF) | 0x20;
+			 priv->R828_I2C.RegAddr  = 0x1A;
+			 priv->R828_I2C.Data     = priv->R828_Arry[21];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 		 }
 	 }
@@ -2789,51 +2882,51 @@ R828_ErrCode R828_SetFrequency(void *pTuner, R828_Set_Info R828_INFO, R828_SetFr
 		 {
 			 /*
              // PRE_DECT on
-			 R828_Arry[1]  = (R828_Arry[1] & 0xBF) | SysFreq_Info1.PRE_DECT;
-			 R828_I2C.RegAddr  = 0x06;
-			 R828_I2C.Data     = R828_Arry[1];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[1]  = (priv->R828_Arry[1] & 0xBF) | priv->SysFreq_Info1.PRE_DECT;
+			 priv->R828_I2C.RegAddr  = 0x06;
+			 priv->R828_I2C.Data     = priv->R828_Arry[1];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
              */
 			  // PRE_DECT off
-			 R828_Arry[1]  = (R828_Arry[1] & 0xBF);   //0: PRE_DECT off
-			 R828_I2C.RegAddr  = 0x06;
-			 R828_I2C.Data     = R828_Arry[1];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[1]  = (priv->R828_Arry[1] & 0xBF);   //0: PRE_DECT off
+			 priv->R828_I2C.RegAddr  = 0x06;
+			 priv->R828_I2C.Data     = priv->R828_Arry[1];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 
 			 // write LNA TOP
-			 R828_Arry[24] = (R828_Arry[24] & 0xC7) | (SysFreq_Info1.LNA_TOP & 0x38);
-			 R828_I2C.RegAddr = 0x1D;
-			 R828_I2C.Data = R828_Arry[24];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[24] = (priv->R828_Arry[24] & 0xC7) | (priv->SysFreq_Info1.LNA_TOP & 0x38);
+			 priv->R828_I2C.RegAddr = 0x1D;
+			 priv->R828_I2C.Data = priv->R828_Arry[24];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				 return RT_Fail;
 
 			 // write discharge mode
-			 R828_Arry[23] = (R828_Arry[23] & 0xFB) | (SysFreq_Info1.MIXER_TOP & 0x04); 
-			 R828_I2C.RegAddr = 0x1C;
-			 R828_I2C.Data = R828_Arry[23];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[23] = (priv->R828_Arry[23] & 0xFB) | (priv->SysFreq_Info1.MIXER_TOP & 0x04); 
+			 priv->R828_I2C.RegAddr = 0x1C;
+			 priv->R828_I2C.Data = priv->R828_Arry[23];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 
 			 // LNA discharge current
-			 R828_Arry[25]  = (R828_Arry[25] & 0xE0) | SysFreq_Info1.LNA_DISCHARGE;  
-			 R828_I2C.RegAddr  = 0x1E;
-			 R828_I2C.Data     = R828_Arry[25];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[25]  = (priv->R828_Arry[25] & 0xE0) | priv->SysFreq_Info1.LNA_DISCHARGE;  
+			 priv->R828_I2C.RegAddr  = 0x1E;
+			 priv->R828_I2C.Data     = priv->R828_Arry[25];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 
 			 // agc clk 1Khz, external det1 cap 1u
-			 R828_Arry[21]  = (R828_Arry[21] & 0xCF) | 0x00;   			
-			 R828_I2C.RegAddr  = 0x1A;
-			 R828_I2C.Data     = R828_Arry[21];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[21]  = (priv->R828_Arry[21] & 0xCF) | 0x00;   			
+			 priv->R828_I2C.RegAddr  = 0x1A;
+			 priv->R828_I2C.Data     = priv->R828_Arry[21];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 
-			 R828_Arry[11]  = (R828_Arry[11] & 0xFB) | 0x00;   			
-			 R828_I2C.RegAddr  = 0x10;
-			 R828_I2C.Data     = R828_Arry[11];
-			 if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+			 priv->R828_Arry[11]  = (priv->R828_Arry[11] & 0xFB) | 0x00;   			
+			 priv->R828_I2C.RegAddr  = 0x10;
+			 priv->R828_I2C.Data     = priv->R828_Arry[11];
+			 if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 				return RT_Fail;
 		 }
 	 }
@@ -2842,93 +2935,93 @@ R828_ErrCode R828_SetFrequency(void *pTuner, R828_Set_Info R828_INFO, R828_SetFr
 
 }
 
-R828_ErrCode R828_Standby(void *pTuner, R828_LoopThrough_Type R828_LoopSwitch)
+R828_ErrCode R828_Standby(struct r820t_state *priv, R828_LoopThrough_Type R828_LoopSwitch)
 {
 	if(R828_LoopSwitch == LOOP_THROUGH)
 	{
-		R828_I2C.RegAddr = 0x06;
-		R828_I2C.Data    = 0xB1;
-		if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_I2C.RegAddr = 0x06;
+		priv->R828_I2C.Data    = 0xB1;
+		if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
-		R828_I2C.RegAddr = 0x05;
-		R828_I2C.Data = 0x03;
+		priv->R828_I2C.RegAddr = 0x05;
+		priv->R828_I2C.Data = 0x03;
 
 
-		if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 	}
 	else
 	{
-		R828_I2C.RegAddr = 0x05;
-		R828_I2C.Data    = 0xA3;
-		if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_I2C.RegAddr = 0x05;
+		priv->R828_I2C.Data    = 0xA3;
+		if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
 
-		R828_I2C.RegAddr = 0x06;
-		R828_I2C.Data    = 0xB1;
-		if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_I2C.RegAddr = 0x06;
+		priv->R828_I2C.Data    = 0xB1;
+		if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
 	}
 
-	R828_I2C.RegAddr = 0x07;
-	R828_I2C.Data    = 0x3A;
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x07;
+	priv->R828_I2C.Data    = 0x3A;
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
-	R828_I2C.RegAddr = 0x08;
-	R828_I2C.Data    = 0x40;
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x08;
+	priv->R828_I2C.Data    = 0x40;
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
-	R828_I2C.RegAddr = 0x09;
-	R828_I2C.Data    = 0xC0;   //polyfilter off
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x09;
+	priv->R828_I2C.Data    = 0xC0;   //polyfilter off
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
-	R828_I2C.RegAddr = 0x0A;
-	R828_I2C.Data    = 0x36;
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x0A;
+	priv->R828_I2C.Data    = 0x36;
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
-	R828_I2C.RegAddr = 0x0C;
-	R828_I2C.Data    = 0x35;
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x0C;
+	priv->R828_I2C.Data    = 0x35;
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
-	R828_I2C.RegAddr = 0x0F;
-	R828_I2C.Data    = 0x78;
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x0F;
+	priv->R828_I2C.Data    = 0x78;
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
-	R828_I2C.RegAddr = 0x11;
-	R828_I2C.Data    = 0x03;
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x11;
+	priv->R828_I2C.Data    = 0x03;
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
-	R828_I2C.RegAddr = 0x17;
-	R828_I2C.Data    = 0xF4;
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x17;
+	priv->R828_I2C.Data    = 0xF4;
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
-	R828_I2C.RegAddr = 0x19;
-	R828_I2C.Data    = 0x0C;
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x19;
+	priv->R828_I2C.Data    = 0x0C;
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	
 	return RT_Success;
 }
 
-R828_ErrCode R828_GetRfGain(void *pTuner, R828_RF_Gain_Info *pR828_rf_gain)
+R828_ErrCode R828_GetRfGain(struct r820t_state *priv, R828_RF_Gain_Info *pR828_rf_gain)
 {
 
-	R828_I2C_Len.RegAddr = 0x00;
-	R828_I2C_Len.Len     = 4;
-	if(I2C_Read_Len(pTuner, &R828_I2C_Len) != RT_Success)
+	priv->R828_I2C_Len.RegAddr = 0x00;
+	priv->R828_I2C_Len.Len     = 4;
+	if(I2C_Read_Len(priv, &priv->R828_I2C_Len) != RT_Success)
 		return RT_Fail;
 
-	pR828_rf_gain->RF_gain1 = (R828_I2C_Len.Data[3] & 0x0F);
-	pR828_rf_gain->RF_gain2 = ((R828_I2C_Len.Data[3] & 0xF0) >> 4);
+	pR828_rf_gain->RF_gain1 = (priv->R828_I2C_Len.Data[3] & 0x0F);
+	pR828_rf_gain->RF_gain2 = ((priv->R828_I2C_Len.Data[3] & 0xF0) >> 4);
 	pR828_rf_gain->RF_gain_comb = pR828_rf_gain->RF_gain1*2 + pR828_rf_gain->RF_gain2;
 
     return RT_Success;
@@ -2953,7 +3046,7 @@ static const int r820t_mixer_gain_steps[]  = {
 	0, 5, 10, 10, 19, 9, 10, 25, 17, 10, 8, 16, 13, 6, 3, -8
 };
 
-R828_ErrCode R828_SetRfGain(void *pTuner, int gain)
+R828_ErrCode R828_SetRfGain(struct r820t_state *priv, int gain)
 {
 	int i, total_gain = 0;
 	uint8_t mix_index = 0, lna_index = 0;
@@ -2971,23 +3064,23 @@ R828_ErrCode R828_SetRfGain(void *pTuner, int gain)
 	}
 
 	/* set LNA gain */
-	R828_I2C.RegAddr = 0x05;
-	R828_Arry[0] = (R828_Arry[0] & 0xF0) | lna_index;
-	R828_I2C.Data = R828_Arry[0];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x05;
+	priv->R828_Arry[0] = (priv->R828_Arry[0] & 0xF0) | lna_index;
+	priv->R828_I2C.Data = priv->R828_Arry[0];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	/* set Mixer gain */
-	R828_I2C.RegAddr = 0x07;
-	R828_Arry[2] = (R828_Arry[2] & 0xF0) | mix_index;
-	R828_I2C.Data = R828_Arry[2];
-	if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	priv->R828_I2C.RegAddr = 0x07;
+	priv->R828_Arry[2] = (priv->R828_Arry[2] & 0xF0) | mix_index;
+	priv->R828_I2C.Data = priv->R828_Arry[2];
+	if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		return RT_Fail;
 
 	return RT_Success;
 }
 
-R828_ErrCode R828_RfGainMode(void *pTuner, int manual)
+R828_ErrCode R828_RfGainMode(struct r820t_state *priv, int manual)
 {
 	UINT8 MixerGain;
 	UINT8 LnaGain;
@@ -2997,52 +3090,52 @@ R828_ErrCode R828_RfGainMode(void *pTuner, int manual)
 
 	if (manual) {
 		//LNA auto off
-	     R828_I2C.RegAddr = 0x05;
-	     R828_Arry[0] = R828_Arry[0] | 0x10;
-		 R828_I2C.Data = R828_Arry[0];
-	     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	     priv->R828_I2C.RegAddr = 0x05;
+	     priv->R828_Arry[0] = priv->R828_Arry[0] | 0x10;
+		 priv->R828_I2C.Data = priv->R828_Arry[0];
+	     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		       return RT_Fail;
 
 		 //Mixer auto off
-	     R828_I2C.RegAddr = 0x07;
-	     R828_Arry[2] = R828_Arry[2] & 0xEF;
-		 R828_I2C.Data = R828_Arry[2];
-	     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	     priv->R828_I2C.RegAddr = 0x07;
+	     priv->R828_Arry[2] = priv->R828_Arry[2] & 0xEF;
+		 priv->R828_I2C.Data = priv->R828_Arry[2];
+	     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		       return RT_Fail;
 
-		R828_I2C_Len.RegAddr = 0x00;
-		R828_I2C_Len.Len     = 4; 
-		if(I2C_Read_Len(pTuner, &R828_I2C_Len) != RT_Success)
+		priv->R828_I2C_Len.RegAddr = 0x00;
+		priv->R828_I2C_Len.Len     = 4; 
+		if(I2C_Read_Len(priv, &priv->R828_I2C_Len) != RT_Success)
 			return RT_Fail;
 
 		/* set fixed VGA gain for now (16.3 dB) */
-		R828_I2C.RegAddr = 0x0C;
-		R828_Arry[7]    = (R828_Arry[7] & 0x60) | 0x08;
-		R828_I2C.Data    = R828_Arry[7];
-		if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_I2C.RegAddr = 0x0C;
+		priv->R828_Arry[7]    = (priv->R828_Arry[7] & 0x60) | 0x08;
+		priv->R828_I2C.Data    = priv->R828_Arry[7];
+		if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
 
 
 	} else {
 	    //LNA
-	     R828_I2C.RegAddr = 0x05;
-	     R828_Arry[0] = R828_Arry[0] & 0xEF;
-		 R828_I2C.Data = R828_Arry[0];
-	     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	     priv->R828_I2C.RegAddr = 0x05;
+	     priv->R828_Arry[0] = priv->R828_Arry[0] & 0xEF;
+		 priv->R828_I2C.Data = priv->R828_Arry[0];
+	     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		       return RT_Fail;
 
 		 //Mixer
-	     R828_I2C.RegAddr = 0x07;
-	     R828_Arry[2] = R828_Arry[2] | 0x10;
-		 R828_I2C.Data = R828_Arry[2];
-	     if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+	     priv->R828_I2C.RegAddr = 0x07;
+	     priv->R828_Arry[2] = priv->R828_Arry[2] | 0x10;
+		 priv->R828_I2C.Data = priv->R828_Arry[2];
+	     if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 		       return RT_Fail;
 
 		/* set fixed VGA gain for now (26.5 dB) */
-		R828_I2C.RegAddr = 0x0C;
-		R828_Arry[7]    = (R828_Arry[7] & 0x60) | 0x0B;
-		R828_I2C.Data    = R828_Arry[7];
-		if(I2C_Write(pTuner, &R828_I2C) != RT_Success)
+		priv->R828_I2C.RegAddr = 0x0C;
+		priv->R828_Arry[7]    = (priv->R828_Arry[7] & 0x60) | 0x0B;
+		priv->R828_I2C.Data    = priv->R828_Arry[7];
+		if(I2C_Write(priv, &priv->R828_I2C) != RT_Success)
 			return RT_Fail;
 	}
 